@@ -0,0 +1,848 @@
+#include "inexor/vulkan-renderer/offset_allocator.hpp"
+
+#include <benchmark/benchmark.h>
+#include <vma/vma_usage.h>
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using inexor::vulkan_renderer::OffsetAllocation;
+using inexor::vulkan_renderer::OffsetAllocator;
+
+// The replay which is used if INEXOR_VMA_REPLAY is not set. It's written by VMA's recording, or by
+// vma-statistics/convert_allocation_statistics.py from an allocation statistics stream.
+constexpr const char *DEFAULT_REPLAY_FILE = "vma-replays/vma_replay.csv";
+
+// Mesh arenas hand out ranges in units of this many bytes.
+constexpr VkDeviceSize ARENA_UNIT_SIZE = 16;
+
+/// @brief One call of a recorded replay.
+struct ReplayCall {
+    enum class Type { CREATE_BUFFER, DESTROY_BUFFER, CREATE_IMAGE, DESTROY_IMAGE };
+
+    Type type = Type::CREATE_BUFFER;
+
+    /// The recorded VmaAllocation, which identifies the allocation in later calls.
+    std::uint64_t allocation = 0;
+
+    VkBufferCreateInfo buffer_create_info = {};
+    VkImageCreateInfo image_create_info = {};
+    VmaAllocationCreateInfo allocation_create_info = {};
+};
+
+struct Replay {
+    /// The memory properties of the recording device, if the replay has a Config section.
+    std::optional<VkPhysicalDeviceMemoryProperties> memory_properties;
+
+    std::vector<ReplayCall> calls;
+};
+
+std::vector<std::string> split_line(const std::string &line) {
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+
+    while (std::getline(stream, field, ',')) {
+        fields.push_back(field);
+    }
+
+    return fields;
+}
+
+std::uint64_t parse_integer(const std::string &field) {
+    return std::strtoull(field.c_str(), nullptr, 10);
+}
+
+std::uint64_t parse_pointer(const std::string &field) {
+    // Pointers are written with %p, which has no 0x prefix on Windows. strtoull accepts both.
+    return std::strtoull(field.c_str(), nullptr, 16);
+}
+
+void parse_allocation_create_info(const std::vector<std::string> &fields, const std::size_t first_field, VmaAllocationCreateInfo &allocation_create_info) {
+    allocation_create_info.flags = static_cast<VmaAllocationCreateFlags>(parse_integer(fields[first_field]));
+    allocation_create_info.usage = static_cast<VmaMemoryUsage>(parse_integer(fields[first_field + 1]));
+    allocation_create_info.requiredFlags = static_cast<VkMemoryPropertyFlags>(parse_integer(fields[first_field + 2]));
+    allocation_create_info.preferredFlags = static_cast<VkMemoryPropertyFlags>(parse_integer(fields[first_field + 3]));
+    allocation_create_info.memoryTypeBits = static_cast<std::uint32_t>(parse_integer(fields[first_field + 4]));
+
+    // The user data of the recording is not available, and the pool is chosen by the replay strategy.
+    allocation_create_info.flags &= ~static_cast<VmaAllocationCreateFlags>(VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT);
+}
+
+void parse_memory_properties(const std::vector<std::string> &fields, VkPhysicalDeviceMemoryProperties &memory_properties) {
+    if (fields.size() == 3 && fields[1] == "HeapCount") {
+        memory_properties.memoryHeapCount = std::min<std::uint32_t>(static_cast<std::uint32_t>(parse_integer(fields[2])), VK_MAX_MEMORY_HEAPS);
+    } else if (fields.size() == 3 && fields[1] == "TypeCount") {
+        memory_properties.memoryTypeCount = std::min<std::uint32_t>(static_cast<std::uint32_t>(parse_integer(fields[2])), VK_MAX_MEMORY_TYPES);
+    } else if (fields.size() == 5 && fields[1] == "Heap") {
+        const auto heap_index = parse_integer(fields[2]);
+        if (heap_index >= VK_MAX_MEMORY_HEAPS) {
+            return;
+        }
+
+        if (fields[3] == "size") {
+            memory_properties.memoryHeaps[heap_index].size = parse_integer(fields[4]);
+        } else if (fields[3] == "flags") {
+            memory_properties.memoryHeaps[heap_index].flags = static_cast<VkMemoryHeapFlags>(parse_integer(fields[4]));
+        }
+    } else if (fields.size() == 5 && fields[1] == "Type") {
+        const auto type_index = parse_integer(fields[2]);
+        if (type_index >= VK_MAX_MEMORY_TYPES) {
+            return;
+        }
+
+        if (fields[3] == "heapIndex") {
+            memory_properties.memoryTypes[type_index].heapIndex = static_cast<std::uint32_t>(parse_integer(fields[4]));
+        } else if (fields[3] == "propertyFlags") {
+            memory_properties.memoryTypes[type_index].propertyFlags = static_cast<VkMemoryPropertyFlags>(parse_integer(fields[4]));
+        }
+    }
+}
+
+/// @brief Reads the buffer and image calls of a VMA replay CSV. Other calls are skipped.
+std::optional<Replay> load_replay(const std::string &file_name) {
+    std::ifstream file(file_name);
+
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    Replay replay;
+    VkPhysicalDeviceMemoryProperties memory_properties = {};
+
+    std::string line;
+
+    while (std::getline(file, line)) {
+        const auto fields = split_line(line);
+
+        if (fields.size() >= 2 && fields[0] == "PhysicalDeviceMemory") {
+            parse_memory_properties(fields, memory_properties);
+            continue;
+        }
+
+        if (fields.size() < 5) {
+            continue;
+        }
+
+        const std::string &function = fields[3];
+        ReplayCall call;
+
+        if (function == "vmaCreateBuffer" && fields.size() >= 15) {
+            call.type = ReplayCall::Type::CREATE_BUFFER;
+            call.buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            call.buffer_create_info.flags = static_cast<VkBufferCreateFlags>(parse_integer(fields[4]));
+            call.buffer_create_info.size = parse_integer(fields[5]);
+            call.buffer_create_info.usage = static_cast<VkBufferUsageFlags>(parse_integer(fields[6]));
+            call.buffer_create_info.sharingMode = static_cast<VkSharingMode>(parse_integer(fields[7]));
+            parse_allocation_create_info(fields, 8, call.allocation_create_info);
+            call.allocation = parse_pointer(fields[14]);
+        } else if (function == "vmaCreateImage" && fields.size() >= 24) {
+            call.type = ReplayCall::Type::CREATE_IMAGE;
+            call.image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            call.image_create_info.flags = static_cast<VkImageCreateFlags>(parse_integer(fields[4]));
+            call.image_create_info.imageType = static_cast<VkImageType>(parse_integer(fields[5]));
+            call.image_create_info.format = static_cast<VkFormat>(parse_integer(fields[6]));
+            call.image_create_info.extent.width = static_cast<std::uint32_t>(parse_integer(fields[7]));
+            call.image_create_info.extent.height = static_cast<std::uint32_t>(parse_integer(fields[8]));
+            call.image_create_info.extent.depth = static_cast<std::uint32_t>(parse_integer(fields[9]));
+            call.image_create_info.mipLevels = static_cast<std::uint32_t>(parse_integer(fields[10]));
+            call.image_create_info.arrayLayers = static_cast<std::uint32_t>(parse_integer(fields[11]));
+            call.image_create_info.samples = static_cast<VkSampleCountFlagBits>(parse_integer(fields[12]));
+            call.image_create_info.tiling = static_cast<VkImageTiling>(parse_integer(fields[13]));
+            call.image_create_info.usage = static_cast<VkImageUsageFlags>(parse_integer(fields[14]));
+            call.image_create_info.sharingMode = static_cast<VkSharingMode>(parse_integer(fields[15]));
+            call.image_create_info.initialLayout = static_cast<VkImageLayout>(parse_integer(fields[16]));
+            parse_allocation_create_info(fields, 17, call.allocation_create_info);
+            call.allocation = parse_pointer(fields[23]);
+        } else if (function == "vmaDestroyBuffer" || function == "vmaDestroyImage") {
+            call.type = function == "vmaDestroyBuffer" ? ReplayCall::Type::DESTROY_BUFFER : ReplayCall::Type::DESTROY_IMAGE;
+            call.allocation = parse_pointer(fields[4]);
+
+            // Destroying a null allocation does nothing.
+            if (call.allocation == 0) {
+                continue;
+            }
+        } else {
+            continue;
+        }
+
+        replay.calls.push_back(call);
+    }
+
+    if (memory_properties.memoryHeapCount > 0 && memory_properties.memoryTypeCount > 0) {
+        replay.memory_properties = memory_properties;
+    }
+
+    return replay;
+}
+
+/// @brief The replay named by INEXOR_VMA_REPLAY, which is loaded once for all benchmarks.
+const std::optional<Replay> &get_replay() {
+    static const std::optional<Replay> replay = []() {
+        const char *file_name = std::getenv("INEXOR_VMA_REPLAY");
+        return load_replay(file_name != nullptr ? file_name : DEFAULT_REPLAY_FILE);
+    }();
+
+    return replay;
+}
+
+template <typename Handle>
+Handle to_handle(const std::uint64_t value) {
+    if constexpr (std::is_pointer_v<Handle>) {
+        return reinterpret_cast<Handle>(static_cast<std::uintptr_t>(value));
+    } else {
+        return static_cast<Handle>(value);
+    }
+}
+
+template <typename Handle>
+std::uint64_t from_handle(const Handle handle) {
+    if constexpr (std::is_pointer_v<Handle>) {
+        return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(handle));
+    } else {
+        return static_cast<std::uint64_t>(handle);
+    }
+}
+
+std::uint32_t get_texel_size(const VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+        return 1;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+/// @brief A Vulkan device without a GPU. Buffers, images and device memory are only handles, and the memory
+/// requirements are estimated, so VMA can be driven by a replay on any machine. The handles of the null device
+/// and its physical device are pointers to the NullDevice object.
+/// @note Mapped pointers are made up and must not be dereferenced, which VMA doesn't do in its default configuration.
+class NullDevice {
+private:
+    VkPhysicalDeviceProperties properties = {};
+    VkPhysicalDeviceMemoryProperties memory_properties = {};
+
+    std::uint64_t next_handle = 1;
+
+    std::unordered_map<std::uint64_t, VkMemoryRequirements> memory_requirements;
+    std::unordered_map<std::uint64_t, std::pair<std::uint32_t, VkDeviceSize>> memory_allocations;
+    std::vector<VkDeviceSize> heap_usages;
+
+    VkDeviceSize allocated_bytes = 0;
+    VkDeviceSize peak_allocated_bytes = 0;
+
+    static NullDevice &get(VkDevice device) {
+        return *reinterpret_cast<NullDevice *>(device);
+    }
+
+    static NullDevice &get(VkPhysicalDevice physical_device) {
+        return *reinterpret_cast<NullDevice *>(physical_device);
+    }
+
+    [[nodiscard]] std::uint32_t get_all_memory_types() const {
+        return memory_properties.memoryTypeCount == 32 ? 0xFFFFFFFF : (1u << memory_properties.memoryTypeCount) - 1;
+    }
+
+    static void VKAPI_CALL get_physical_device_properties(VkPhysicalDevice physical_device, VkPhysicalDeviceProperties *device_properties) {
+        *device_properties = get(physical_device).properties;
+    }
+
+    static void VKAPI_CALL get_physical_device_memory_properties(VkPhysicalDevice physical_device, VkPhysicalDeviceMemoryProperties *device_memory_properties) {
+        *device_memory_properties = get(physical_device).memory_properties;
+    }
+
+    static VkResult VKAPI_CALL allocate_memory(VkDevice device, const VkMemoryAllocateInfo *allocate_info, const VkAllocationCallbacks *,
+                                               VkDeviceMemory *memory) {
+        NullDevice &null_device = get(device);
+
+        const std::uint32_t heap_index = null_device.memory_properties.memoryTypes[allocate_info->memoryTypeIndex].heapIndex;
+
+        if (null_device.heap_usages[heap_index] + allocate_info->allocationSize > null_device.memory_properties.memoryHeaps[heap_index].size) {
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+
+        null_device.heap_usages[heap_index] += allocate_info->allocationSize;
+        null_device.allocated_bytes += allocate_info->allocationSize;
+        null_device.peak_allocated_bytes = std::max(null_device.peak_allocated_bytes, null_device.allocated_bytes);
+
+        const std::uint64_t handle = null_device.next_handle++;
+        null_device.memory_allocations[handle] = {heap_index, allocate_info->allocationSize};
+
+        *memory = to_handle<VkDeviceMemory>(handle);
+        return VK_SUCCESS;
+    }
+
+    static void VKAPI_CALL free_memory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks *) {
+        NullDevice &null_device = get(device);
+
+        auto allocation = null_device.memory_allocations.find(from_handle(memory));
+        if (allocation == null_device.memory_allocations.end()) {
+            return;
+        }
+
+        null_device.heap_usages[allocation->second.first] -= allocation->second.second;
+        null_device.allocated_bytes -= allocation->second.second;
+        null_device.memory_allocations.erase(allocation);
+    }
+
+    static VkResult VKAPI_CALL map_memory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags, void **data) {
+        *data = to_handle<std::uint8_t *>(from_handle(memory) << 32) + offset;
+        return VK_SUCCESS;
+    }
+
+    static void VKAPI_CALL unmap_memory(VkDevice, VkDeviceMemory) {}
+
+    static VkResult VKAPI_CALL flush_memory_ranges(VkDevice, std::uint32_t, const VkMappedMemoryRange *) {
+        return VK_SUCCESS;
+    }
+
+    static VkResult VKAPI_CALL bind_buffer_memory(VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize) {
+        return VK_SUCCESS;
+    }
+
+    static VkResult VKAPI_CALL bind_image_memory(VkDevice, VkImage, VkDeviceMemory, VkDeviceSize) {
+        return VK_SUCCESS;
+    }
+
+    static void VKAPI_CALL get_buffer_memory_requirements(VkDevice device, VkBuffer buffer, VkMemoryRequirements *requirements) {
+        *requirements = get(device).memory_requirements.at(from_handle(buffer));
+    }
+
+    static void VKAPI_CALL get_image_memory_requirements(VkDevice device, VkImage image, VkMemoryRequirements *requirements) {
+        *requirements = get(device).memory_requirements.at(from_handle(image));
+    }
+
+    static VkResult VKAPI_CALL create_buffer(VkDevice device, const VkBufferCreateInfo *create_info, const VkAllocationCallbacks *, VkBuffer *buffer) {
+        NullDevice &null_device = get(device);
+
+        // Most drivers align buffers to 256 bytes, which is the largest minUniformBufferOffsetAlignment.
+        VkMemoryRequirements requirements = {};
+        requirements.alignment = 256;
+        requirements.size = (create_info->size + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+        requirements.memoryTypeBits = null_device.get_all_memory_types();
+
+        const std::uint64_t handle = null_device.next_handle++;
+        null_device.memory_requirements[handle] = requirements;
+
+        *buffer = to_handle<VkBuffer>(handle);
+        return VK_SUCCESS;
+    }
+
+    static void VKAPI_CALL destroy_buffer(VkDevice device, VkBuffer buffer, const VkAllocationCallbacks *) {
+        get(device).memory_requirements.erase(from_handle(buffer));
+    }
+
+    static VkResult VKAPI_CALL create_image(VkDevice device, const VkImageCreateInfo *create_info, const VkAllocationCallbacks *, VkImage *image) {
+        NullDevice &null_device = get(device);
+
+        VkDeviceSize size = 0;
+
+        for (std::uint32_t mip_level = 0; mip_level < std::max(create_info->mipLevels, 1u); mip_level++) {
+            const VkDeviceSize width = std::max(create_info->extent.width >> mip_level, 1u);
+            const VkDeviceSize height = std::max(create_info->extent.height >> mip_level, 1u);
+            const VkDeviceSize depth = std::max(create_info->extent.depth >> mip_level, 1u);
+
+            size += width * height * depth * get_texel_size(create_info->format);
+        }
+
+        size *= std::max(create_info->arrayLayers, 1u) * std::max<std::uint32_t>(create_info->samples, 1u);
+
+        VkMemoryRequirements requirements = {};
+        requirements.alignment = create_info->tiling == VK_IMAGE_TILING_OPTIMAL ? 65536 : 4096;
+        requirements.size = (size + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+        requirements.memoryTypeBits = null_device.get_all_memory_types();
+
+        const std::uint64_t handle = null_device.next_handle++;
+        null_device.memory_requirements[handle] = requirements;
+
+        *image = to_handle<VkImage>(handle);
+        return VK_SUCCESS;
+    }
+
+    static void VKAPI_CALL destroy_image(VkDevice device, VkImage image, const VkAllocationCallbacks *) {
+        get(device).memory_requirements.erase(from_handle(image));
+    }
+
+    static void VKAPI_CALL cmd_copy_buffer(VkCommandBuffer, VkBuffer, VkBuffer, std::uint32_t, const VkBufferCopy *) {}
+
+public:
+    /// @brief Creates a null device.
+    /// @param memory_properties [in] The memory heaps and types, usually those of the recording device.
+    explicit NullDevice(const VkPhysicalDeviceMemoryProperties &device_memory_properties) : memory_properties(device_memory_properties) {
+        properties.apiVersion = VK_API_VERSION_1_0;
+        properties.deviceType = VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+        std::strncpy(properties.deviceName, "Inexor null device", VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1);
+
+        properties.limits.maxMemoryAllocationCount = 4096;
+        properties.limits.bufferImageGranularity = 1024;
+        properties.limits.nonCoherentAtomSize = 64;
+
+        heap_usages.resize(memory_properties.memoryHeapCount, 0);
+    }
+
+    NullDevice(const NullDevice &) = delete;
+    NullDevice &operator=(const NullDevice &) = delete;
+
+    /// @brief The memory of a discrete graphics card, which is used if a replay has no memory properties.
+    static VkPhysicalDeviceMemoryProperties get_default_memory_properties() {
+        VkPhysicalDeviceMemoryProperties memory_properties = {};
+
+        memory_properties.memoryHeapCount = 2;
+        memory_properties.memoryHeaps[0] = {8ull * 1024 * 1024 * 1024, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT};
+        memory_properties.memoryHeaps[1] = {16ull * 1024 * 1024 * 1024, 0};
+
+        memory_properties.memoryTypeCount = 3;
+        memory_properties.memoryTypes[0] = {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0};
+        memory_properties.memoryTypes[1] = {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1};
+        memory_properties.memoryTypes[2] = {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 1};
+
+        return memory_properties;
+    }
+
+    [[nodiscard]] VkPhysicalDevice get_physical_device() {
+        return reinterpret_cast<VkPhysicalDevice>(this);
+    }
+
+    [[nodiscard]] VkDevice get_device() {
+        return reinterpret_cast<VkDevice>(this);
+    }
+
+    [[nodiscard]] static VmaVulkanFunctions get_vulkan_functions() {
+        VmaVulkanFunctions vulkan_functions = {};
+
+        vulkan_functions.vkGetPhysicalDeviceProperties = &NullDevice::get_physical_device_properties;
+        vulkan_functions.vkGetPhysicalDeviceMemoryProperties = &NullDevice::get_physical_device_memory_properties;
+        vulkan_functions.vkAllocateMemory = &NullDevice::allocate_memory;
+        vulkan_functions.vkFreeMemory = &NullDevice::free_memory;
+        vulkan_functions.vkMapMemory = &NullDevice::map_memory;
+        vulkan_functions.vkUnmapMemory = &NullDevice::unmap_memory;
+        vulkan_functions.vkFlushMappedMemoryRanges = &NullDevice::flush_memory_ranges;
+        vulkan_functions.vkInvalidateMappedMemoryRanges = &NullDevice::flush_memory_ranges;
+        vulkan_functions.vkBindBufferMemory = &NullDevice::bind_buffer_memory;
+        vulkan_functions.vkBindImageMemory = &NullDevice::bind_image_memory;
+        vulkan_functions.vkGetBufferMemoryRequirements = &NullDevice::get_buffer_memory_requirements;
+        vulkan_functions.vkGetImageMemoryRequirements = &NullDevice::get_image_memory_requirements;
+        vulkan_functions.vkCreateBuffer = &NullDevice::create_buffer;
+        vulkan_functions.vkDestroyBuffer = &NullDevice::destroy_buffer;
+        vulkan_functions.vkCreateImage = &NullDevice::create_image;
+        vulkan_functions.vkDestroyImage = &NullDevice::destroy_image;
+        vulkan_functions.vkCmdCopyBuffer = &NullDevice::cmd_copy_buffer;
+
+        return vulkan_functions;
+    }
+
+    /// @brief Returns the largest amount of device memory which was allocated at the same time.
+    [[nodiscard]] VkDeviceSize get_peak_allocated_bytes() const {
+        return peak_allocated_bytes;
+    }
+};
+
+/// @brief How a replay places its allocations.
+enum class ReplayStrategy {
+    /// Every allocation is made by VMA with its default block sizes.
+    VMA_DEFAULT,
+
+    /// Every allocation is made from a custom pool of its memory type, with a fixed block size.
+    VMA_POOLS,
+
+    /// Vertex and index buffers are sub-allocated from mesh arena buffers with an OffsetAllocator, like MeshArena does.
+    /// Everything else is made by VMA with its default block sizes.
+    MESH_ARENA
+};
+
+const char *get_strategy_name(const ReplayStrategy strategy) {
+    switch (strategy) {
+    case ReplayStrategy::VMA_POOLS:
+        return "vma_pools";
+    case ReplayStrategy::MESH_ARENA:
+        return "mesh_arena";
+    default:
+        return "vma_default";
+    }
+}
+
+struct ReplaySettings {
+    ReplayStrategy strategy = ReplayStrategy::VMA_DEFAULT;
+
+    /// The block size of custom pools, or the size of a mesh arena's buffer.
+    VkDeviceSize block_size = 64 * 1024 * 1024;
+
+    /// Custom pools use the buddy algorithm instead of VMA's default algorithm.
+    bool buddy_algorithm = false;
+};
+
+/// @brief Executes the calls of a replay against VMA on a null device.
+class AllocationReplayer {
+private:
+    struct MeshArenaBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        OffsetAllocator allocator;
+
+        explicit MeshArenaBuffer(std::uint32_t capacity) : allocator(capacity) {}
+    };
+
+    struct LiveAllocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkImage image = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+
+        /// The range of a mesh arena buffer, if the allocation was sub-allocated.
+        MeshArenaBuffer *arena = nullptr;
+        OffsetAllocation range;
+    };
+
+    ReplaySettings settings;
+
+    NullDevice null_device;
+    VmaAllocator vma_allocator = VK_NULL_HANDLE;
+
+    /// The custom pools by memory type.
+    std::unordered_map<std::uint32_t, VmaPool> pools;
+
+    /// The memory types of the custom pools by image flag, usage and allocation create info, so they are looked up once.
+    std::map<std::tuple<bool, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t>, std::uint32_t> pool_memory_types;
+
+    std::vector<std::unique_ptr<MeshArenaBuffer>> arena_buffers;
+
+    /// The allocations which have not been destroyed yet, by their recorded VmaAllocation.
+    std::unordered_map<std::uint64_t, LiveAllocation> live_allocations;
+
+    std::uint64_t failed_allocations = 0;
+
+    VmaPool get_pool(const bool is_image, const void *create_info, const VmaAllocationCreateInfo &allocation_create_info) {
+        const auto usage = is_image ? static_cast<const VkImageCreateInfo *>(create_info)->usage : static_cast<const VkBufferCreateInfo *>(create_info)->usage;
+        const auto key = std::make_tuple(is_image, static_cast<std::uint32_t>(usage), static_cast<std::uint32_t>(allocation_create_info.usage),
+                                         allocation_create_info.requiredFlags, allocation_create_info.preferredFlags, allocation_create_info.memoryTypeBits);
+
+        auto memory_type = pool_memory_types.find(key);
+
+        if (memory_type == pool_memory_types.end()) {
+            std::uint32_t memory_type_index = 0;
+
+            const VkResult result =
+                is_image ? vmaFindMemoryTypeIndexForImageInfo(vma_allocator, static_cast<const VkImageCreateInfo *>(create_info), &allocation_create_info,
+                                                              &memory_type_index)
+                         : vmaFindMemoryTypeIndexForBufferInfo(vma_allocator, static_cast<const VkBufferCreateInfo *>(create_info),
+                                                               &allocation_create_info, &memory_type_index);
+            if (result != VK_SUCCESS) {
+                return VK_NULL_HANDLE;
+            }
+
+            memory_type = pool_memory_types.insert({key, memory_type_index}).first;
+        }
+
+        auto pool = pools.find(memory_type->second);
+
+        if (pool == pools.end()) {
+            VmaPoolCreateInfo pool_create_info = {};
+
+            pool_create_info.memoryTypeIndex = memory_type->second;
+            pool_create_info.blockSize = settings.block_size;
+
+            if (settings.buddy_algorithm) {
+                pool_create_info.flags = VMA_POOL_CREATE_BUDDY_ALGORITHM_BIT;
+            }
+
+            VmaPool new_pool = VK_NULL_HANDLE;
+            if (vmaCreatePool(vma_allocator, &pool_create_info, &new_pool) != VK_SUCCESS) {
+                return VK_NULL_HANDLE;
+            }
+
+            pool = pools.insert({memory_type->second, new_pool}).first;
+        }
+
+        return pool->second;
+    }
+
+    /// @brief Sub-allocates a vertex or index buffer from a mesh arena buffer, and creates another arena buffer if all are full.
+    bool allocate_from_arena(const VkBufferCreateInfo &buffer_create_info, LiveAllocation &live_allocation) {
+        const VkDeviceSize unit_count = (buffer_create_info.size + ARENA_UNIT_SIZE - 1) / ARENA_UNIT_SIZE;
+
+        if (unit_count == 0 || buffer_create_info.size > settings.block_size) {
+            return false;
+        }
+
+        for (auto &arena_buffer : arena_buffers) {
+            live_allocation.range = arena_buffer->allocator.allocate(static_cast<std::uint32_t>(unit_count));
+
+            if (live_allocation.range.is_valid()) {
+                live_allocation.arena = arena_buffer.get();
+                return true;
+            }
+        }
+
+        VkBufferCreateInfo arena_create_info = {};
+
+        arena_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        arena_create_info.size = settings.block_size;
+        arena_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        arena_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocation_create_info = {};
+        allocation_create_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        auto arena_buffer = std::make_unique<MeshArenaBuffer>(static_cast<std::uint32_t>(settings.block_size / ARENA_UNIT_SIZE));
+
+        if (vmaCreateBuffer(vma_allocator, &arena_create_info, &allocation_create_info, &arena_buffer->buffer, &arena_buffer->allocation, nullptr) !=
+            VK_SUCCESS) {
+            return false;
+        }
+
+        live_allocation.range = arena_buffer->allocator.allocate(static_cast<std::uint32_t>(unit_count));
+        live_allocation.arena = arena_buffer.get();
+
+        arena_buffers.push_back(std::move(arena_buffer));
+
+        return live_allocation.range.is_valid();
+    }
+
+    void create_buffer(const ReplayCall &call) {
+        LiveAllocation live_allocation;
+
+        const bool is_mesh_buffer = (call.buffer_create_info.usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) != 0;
+
+        if (settings.strategy == ReplayStrategy::MESH_ARENA && is_mesh_buffer && allocate_from_arena(call.buffer_create_info, live_allocation)) {
+            live_allocations[call.allocation] = live_allocation;
+            return;
+        }
+
+        VmaAllocationCreateInfo allocation_create_info = call.allocation_create_info;
+
+        if (settings.strategy == ReplayStrategy::VMA_POOLS) {
+            // Allocations from custom pools can't have dedicated memory.
+            allocation_create_info.flags &= ~static_cast<VmaAllocationCreateFlags>(VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+            allocation_create_info.pool = get_pool(false, &call.buffer_create_info, call.allocation_create_info);
+        }
+
+        VkResult result = vmaCreateBuffer(vma_allocator, &call.buffer_create_info, &allocation_create_info, &live_allocation.buffer,
+                                          &live_allocation.allocation, nullptr);
+
+        if (result != VK_SUCCESS && allocation_create_info.pool != VK_NULL_HANDLE) {
+            // The buffer doesn't fit into a block of the pool.
+            result = vmaCreateBuffer(vma_allocator, &call.buffer_create_info, &call.allocation_create_info, &live_allocation.buffer,
+                                     &live_allocation.allocation, nullptr);
+        }
+
+        if (result != VK_SUCCESS) {
+            failed_allocations++;
+            return;
+        }
+
+        live_allocations[call.allocation] = live_allocation;
+    }
+
+    void create_image(const ReplayCall &call) {
+        LiveAllocation live_allocation;
+
+        VmaAllocationCreateInfo allocation_create_info = call.allocation_create_info;
+
+        if (settings.strategy == ReplayStrategy::VMA_POOLS) {
+            allocation_create_info.flags &= ~static_cast<VmaAllocationCreateFlags>(VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+            allocation_create_info.pool = get_pool(true, &call.image_create_info, call.allocation_create_info);
+        }
+
+        VkResult result = vmaCreateImage(vma_allocator, &call.image_create_info, &allocation_create_info, &live_allocation.image,
+                                         &live_allocation.allocation, nullptr);
+
+        if (result != VK_SUCCESS && allocation_create_info.pool != VK_NULL_HANDLE) {
+            // The image doesn't fit into a block of the pool.
+            result = vmaCreateImage(vma_allocator, &call.image_create_info, &call.allocation_create_info, &live_allocation.image,
+                                    &live_allocation.allocation, nullptr);
+        }
+
+        if (result != VK_SUCCESS) {
+            failed_allocations++;
+            return;
+        }
+
+        live_allocations[call.allocation] = live_allocation;
+    }
+
+    void destroy(const LiveAllocation &live_allocation) {
+        if (live_allocation.arena != nullptr) {
+            live_allocation.arena->allocator.free(live_allocation.range);
+        } else if (live_allocation.image != VK_NULL_HANDLE) {
+            vmaDestroyImage(vma_allocator, live_allocation.image, live_allocation.allocation);
+        } else {
+            vmaDestroyBuffer(vma_allocator, live_allocation.buffer, live_allocation.allocation);
+        }
+    }
+
+public:
+    AllocationReplayer(const Replay &replay, const ReplaySettings &settings)
+        : settings(settings), null_device(replay.memory_properties.value_or(NullDevice::get_default_memory_properties())) {
+        const VmaVulkanFunctions vulkan_functions = NullDevice::get_vulkan_functions();
+
+        VmaAllocatorCreateInfo allocator_info = {};
+
+        allocator_info.physicalDevice = null_device.get_physical_device();
+        allocator_info.device = null_device.get_device();
+        allocator_info.pVulkanFunctions = &vulkan_functions;
+
+        if (vmaCreateAllocator(&allocator_info, &vma_allocator) != VK_SUCCESS) {
+            throw std::runtime_error("Error: vmaCreateAllocator failed for the null device!");
+        }
+    }
+
+    AllocationReplayer(const AllocationReplayer &) = delete;
+    AllocationReplayer &operator=(const AllocationReplayer &) = delete;
+
+    ~AllocationReplayer() {
+        for (const auto &live_allocation : live_allocations) {
+            destroy(live_allocation.second);
+        }
+
+        for (const auto &arena_buffer : arena_buffers) {
+            vmaDestroyBuffer(vma_allocator, arena_buffer->buffer, arena_buffer->allocation);
+        }
+
+        for (const auto &pool : pools) {
+            vmaDestroyPool(vma_allocator, pool.second);
+        }
+
+        vmaDestroyAllocator(vma_allocator);
+    }
+
+    void execute(const ReplayCall &call) {
+        switch (call.type) {
+        case ReplayCall::Type::CREATE_BUFFER:
+        case ReplayCall::Type::CREATE_IMAGE: {
+            // A recorded handle is only reused after it was destroyed, unless calls are missing from the replay.
+            auto previous_allocation = live_allocations.find(call.allocation);
+            if (previous_allocation != live_allocations.end()) {
+                destroy(previous_allocation->second);
+                live_allocations.erase(previous_allocation);
+            }
+
+            if (call.type == ReplayCall::Type::CREATE_BUFFER) {
+                create_buffer(call);
+            } else {
+                create_image(call);
+            }
+            break;
+        }
+        default: {
+            auto live_allocation = live_allocations.find(call.allocation);
+            if (live_allocation != live_allocations.end()) {
+                destroy(live_allocation->second);
+                live_allocations.erase(live_allocation);
+            }
+            break;
+        }
+        }
+    }
+
+    /// @brief Returns the fraction of free memory which is not part of the largest free range, across VMA's blocks
+    /// and the mesh arena buffers. 0 means that all free memory is contiguous.
+    [[nodiscard]] double calculate_fragmentation() const {
+        VmaStats stats = {};
+        vmaCalculateStats(vma_allocator, &stats);
+
+        // The arena buffers are used memory from VMA's point of view, their free ranges are added.
+        VkDeviceSize unused_bytes = stats.total.unusedBytes;
+        VkDeviceSize largest_unused_range = stats.total.unusedRangeSizeMax;
+
+        for (const auto &arena_buffer : arena_buffers) {
+            const auto arena_statistics = arena_buffer->allocator.get_statistics();
+
+            unused_bytes += static_cast<VkDeviceSize>(arena_statistics.capacity - arena_statistics.used) * ARENA_UNIT_SIZE;
+            largest_unused_range = std::max(largest_unused_range, static_cast<VkDeviceSize>(arena_statistics.largest_free_block) * ARENA_UNIT_SIZE);
+        }
+
+        if (unused_bytes == 0) {
+            return 0.0;
+        }
+
+        return 1.0 - static_cast<double>(largest_unused_range) / static_cast<double>(unused_bytes);
+    }
+
+    [[nodiscard]] VkDeviceSize get_peak_memory() const {
+        return null_device.get_peak_allocated_bytes();
+    }
+
+    [[nodiscard]] std::uint64_t get_failed_allocations() const {
+        return failed_allocations;
+    }
+};
+
+/// @brief Replays the allocations and frees of a recorded VMA replay with a null device.
+/// The replay is read from the file named by the INEXOR_VMA_REPLAY environment variable, or from vma-replays/vma_replay.csv.
+/// Reports the time of the whole replay, the peak device memory, and the fragmentation of the memory which is
+/// still allocated at the end of the replay.
+/// @param state.range(0) The ReplayStrategy.
+/// @param state.range(1) The block size of custom pools or the size of mesh arena buffers, in MiB.
+/// @param state.range(2) 1 if custom pools use the buddy algorithm, 0 otherwise.
+void BM_AllocationReplay(benchmark::State &state) {
+    const auto &replay = get_replay();
+
+    if (!replay.has_value() || replay->calls.empty()) {
+        state.SkipWithError("No VMA replay found, set INEXOR_VMA_REPLAY to a replay CSV.");
+        return;
+    }
+
+    ReplaySettings settings;
+    settings.strategy = static_cast<ReplayStrategy>(state.range(0));
+    settings.block_size = static_cast<VkDeviceSize>(state.range(1)) * 1024 * 1024;
+    settings.buddy_algorithm = state.range(2) != 0;
+
+    state.SetLabel(get_strategy_name(settings.strategy));
+
+    double fragmentation = 0.0;
+    VkDeviceSize peak_memory = 0;
+    std::uint64_t failed_allocations = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto replayer = std::make_unique<AllocationReplayer>(*replay, settings);
+        state.ResumeTiming();
+
+        for (const auto &call : replay->calls) {
+            replayer->execute(call);
+        }
+
+        state.PauseTiming();
+        fragmentation = replayer->calculate_fragmentation();
+        peak_memory = replayer->get_peak_memory();
+        failed_allocations = replayer->get_failed_allocations();
+        replayer.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * replay->calls.size()));
+
+    state.counters["peak_memory_mib"] = static_cast<double>(peak_memory) / (1024.0 * 1024.0);
+    state.counters["fragmentation"] = fragmentation;
+    state.counters["failed_allocations"] = static_cast<double>(failed_allocations);
+}
+
+} // namespace
+
+BENCHMARK(BM_AllocationReplay)
+    ->Args({static_cast<std::int64_t>(ReplayStrategy::VMA_DEFAULT), 0, 0})
+    ->Args({static_cast<std::int64_t>(ReplayStrategy::VMA_POOLS), 16, 0})
+    ->Args({static_cast<std::int64_t>(ReplayStrategy::VMA_POOLS), 64, 0})
+    ->Args({static_cast<std::int64_t>(ReplayStrategy::VMA_POOLS), 64, 1})
+    ->Args({static_cast<std::int64_t>(ReplayStrategy::MESH_ARENA), 64, 0})
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,87 @@
+#include "inexor/vulkan-renderer/manager_template.hpp"
+#include "inexor/vulkan-renderer/snapshot_manager_template.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using inexor::vulkan_renderer::ManagerClassTemplate;
+using inexor::vulkan_renderer::SnapshotManagerClassTemplate;
+
+// The number of entries in the managers, roughly the number of fences and semaphores of the renderer.
+constexpr std::size_t MANAGER_ENTRY_COUNT = 32;
+
+/// @brief Makes the protected interface of a manager template accessible to the benchmark.
+template <typename Base>
+class BenchmarkManager : public Base {
+public:
+    using Base::add_entry;
+    using Base::get_entry;
+    using Base::update_entry;
+};
+
+template <typename Base>
+class ManagerFixture : public benchmark::Fixture {
+public:
+    static inline std::unique_ptr<BenchmarkManager<Base>> manager;
+    static inline std::vector<std::string> entry_names;
+
+    void SetUp(const benchmark::State &state) override {
+        // Only the first thread creates the shared manager.
+        if (state.thread_index != 0) {
+            return;
+        }
+
+        manager = std::make_unique<BenchmarkManager<Base>>();
+        entry_names.clear();
+
+        for (std::size_t i = 0; i < MANAGER_ENTRY_COUNT; i++) {
+            entry_names.push_back("in_flight_fence_" + std::to_string(i));
+            manager->add_entry(entry_names.back(), std::make_shared<int>(static_cast<int>(i)));
+        }
+    }
+
+    void TearDown(const benchmark::State &state) override {
+        if (state.thread_index == 0) {
+            manager.reset();
+        }
+    }
+
+    /// @brief Thread 0 keeps updating entries, all other threads look them up.
+    /// Only the lookups are counted as processed items.
+    void run(benchmark::State &state) {
+        std::size_t i = static_cast<std::size_t>(state.thread_index);
+
+        if (state.thread_index == 0) {
+            for (auto _ : state) {
+                auto new_entry = std::make_shared<int>(static_cast<int>(i));
+                manager->update_entry(entry_names[i++ % MANAGER_ENTRY_COUNT], new_entry);
+            }
+        } else {
+            for (auto _ : state) {
+                benchmark::DoNotOptimize(manager->get_entry(entry_names[i++ % MANAGER_ENTRY_COUNT]));
+            }
+            state.SetItemsProcessed(state.iterations());
+        }
+    }
+};
+
+using SharedMutexManagerFixture = ManagerFixture<ManagerClassTemplate<int>>;
+using SnapshotManagerFixture = ManagerFixture<SnapshotManagerClassTemplate<int>>;
+
+BENCHMARK_DEFINE_F(SharedMutexManagerFixture, OneWriterManyReaders)(benchmark::State &state) {
+    run(state);
+}
+
+BENCHMARK_DEFINE_F(SnapshotManagerFixture, OneWriterManyReaders)(benchmark::State &state) {
+    run(state);
+}
+
+BENCHMARK_REGISTER_F(SharedMutexManagerFixture, OneWriterManyReaders)->ThreadRange(2, 16)->UseRealTime();
+BENCHMARK_REGISTER_F(SnapshotManagerFixture, OneWriterManyReaders)->ThreadRange(2, 16)->UseRealTime();
+
+} // namespace
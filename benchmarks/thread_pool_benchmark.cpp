@@ -0,0 +1,93 @@
+#include "inexor/vulkan-renderer/thread_pool.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <vector>
+
+namespace {
+
+// The number of tasks which are submitted in every simulated frame.
+constexpr std::size_t FRAME_TASK_COUNT = 64;
+
+// The amount of work of one task and of the simulated render thread.
+constexpr std::size_t TASK_WORK_ITERATIONS = 20000;
+constexpr std::size_t RENDER_WORK_ITERATIONS = 200000;
+
+std::uint64_t simulate_work(std::size_t iterations) {
+    std::uint64_t value = 0x9E3779B97F4A7C15ull;
+
+    for (std::size_t i = 0; i < iterations; i++) {
+        value ^= value << 13;
+        value ^= value >> 7;
+        value ^= value << 17;
+    }
+
+    return value;
+}
+
+/// @brief Simulates frames in which the main thread does render work while the threadpool runs the frame's tasks.
+/// Reports the mean frame time and its standard deviation, which is what pinning and reserved cores should improve.
+/// @param state.range(0) The number of reserved cores.
+/// @param state.range(1) 1 if the worker threads are pinned, 0 otherwise.
+void BM_ThreadPoolFrameTimeVariance(benchmark::State &state) {
+    inexor::ThreadPoolSettings settings;
+    settings.reserved_core_count = static_cast<std::size_t>(state.range(0));
+    settings.pin_threads = state.range(1) != 0;
+
+    inexor::ThreadPool thread_pool(settings);
+
+    std::vector<double> frame_times;
+    std::vector<std::future<std::uint64_t>> futures;
+    futures.reserve(FRAME_TASK_COUNT);
+
+    for (auto _ : state) {
+        const auto frame_start_time = std::chrono::steady_clock::now();
+
+        thread_pool.begin_frame(std::chrono::microseconds(16667));
+
+        for (std::size_t i = 0; i < FRAME_TASK_COUNT; i++) {
+            futures.push_back(thread_pool.execute(simulate_work, TASK_WORK_ITERATIONS));
+        }
+
+        benchmark::DoNotOptimize(simulate_work(RENDER_WORK_ITERATIONS));
+
+        for (auto &future : futures) {
+            benchmark::DoNotOptimize(future.get());
+        }
+        futures.clear();
+
+        frame_times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frame_start_time).count());
+    }
+
+    if (frame_times.empty()) {
+        return;
+    }
+
+    double mean = 0.0;
+
+    for (const auto frame_time : frame_times) {
+        mean += frame_time;
+    }
+    mean /= static_cast<double>(frame_times.size());
+
+    double variance = 0.0;
+
+    for (const auto frame_time : frame_times) {
+        variance += (frame_time - mean) * (frame_time - mean);
+    }
+    variance /= static_cast<double>(frame_times.size());
+
+    std::sort(frame_times.begin(), frame_times.end());
+
+    state.counters["frame_mean_us"] = mean;
+    state.counters["frame_stddev_us"] = std::sqrt(variance);
+    state.counters["frame_p99_us"] = frame_times[static_cast<std::size_t>(0.99 * static_cast<double>(frame_times.size() - 1))];
+}
+
+} // namespace
+
+BENCHMARK(BM_ThreadPoolFrameTimeVariance)->Args({0, 0})->Args({1, 0})->Args({1, 1})->Unit(benchmark::kMicrosecond)->UseRealTime();
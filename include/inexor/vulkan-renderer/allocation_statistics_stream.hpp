@@ -0,0 +1,153 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <vma/vma_usage.h>
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief The kinds of events an allocation statistics stream records.
+enum class AllocationEventType { CREATE_BUFFER, DESTROY_BUFFER, CREATE_IMAGE, DESTROY_IMAGE, ALLOCATE_DEVICE_MEMORY, FREE_DEVICE_MEMORY };
+
+/// @brief One allocation event. Only the fields of its type are set.
+struct AllocationEvent {
+    AllocationEventType type = AllocationEventType::CREATE_BUFFER;
+
+    std::uint32_t thread_id = 0;
+    std::uint32_t frame_index = 0;
+
+    /// The time since the stream was created, in seconds.
+    double time = 0.0;
+
+    /// The VmaAllocation, or the VkDeviceMemory of device memory events.
+    std::uint64_t handle = 0;
+
+    /// The create infos of buffers and images, without their pointers.
+    VkBufferCreateInfo buffer_create_info = {};
+    VkImageCreateInfo image_create_info = {};
+    VmaAllocationCreateInfo allocation_create_info = {};
+
+    /// The memory type and the size of device memory events.
+    std::uint32_t memory_type = 0;
+    VkDeviceSize size = 0;
+};
+
+struct AllocationStatisticsSettings {
+    std::string file_name = "vma-statistics/allocation_statistics.bin";
+
+    /// The number of events the ring can hold between two writes. Events which don't fit are dropped and counted.
+    std::size_t event_capacity = 16384;
+
+    /// How often the background thread writes the recorded events.
+    std::chrono::milliseconds write_interval{250};
+
+    /// How often the background thread writes a snapshot of VMA's statistics and budget.
+    std::chrono::milliseconds snapshot_interval{1000};
+};
+
+struct AllocationStatisticsStreamStatistics {
+    std::uint64_t recorded_events = 0;
+    std::uint64_t dropped_events = 0;
+    std::uint64_t snapshots = 0;
+    std::uint64_t written_bytes = 0;
+};
+
+/// @brief Records allocation events into an in-memory ring, and writes them together with periodic snapshots of
+/// VMA's statistics in a compact binary format. The file is written by a background thread, so recording an event
+/// only copies it into the ring, unlike VMA's recording, which writes and flushes a CSV line on every call.
+/// The events are recorded by the call sites of vmaCreateBuffer, vmaCreateImage and their destroy functions,
+/// and by VMA's device memory callbacks, which have to be passed to vmaCreateAllocator.
+/// vma-statistics/convert_allocation_statistics.py converts the file into VMA's JSON dumps and into VMA's CSV replays.
+/// @note Recording is thread safe. Only one stream can be attached to an allocator.
+class AllocationStatisticsStream {
+private:
+    VmaAllocator vma_allocator = VK_NULL_HANDLE;
+
+    AllocationStatisticsSettings settings;
+
+    std::ofstream file;
+
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    std::atomic<std::uint32_t> frame_index = 0;
+
+    /// The ring of recorded events which have not been written yet.
+    std::vector<AllocationEvent> events;
+    std::size_t first_event = 0;
+    std::size_t event_count = 0;
+
+    std::mutex events_mutex;
+
+    std::thread writer_thread;
+    std::condition_variable writer_condition;
+    std::mutex writer_mutex;
+    bool stop_writer = false;
+
+    std::atomic<std::uint64_t> recorded_events = 0;
+    std::atomic<std::uint64_t> dropped_events = 0;
+    std::atomic<std::uint64_t> snapshots = 0;
+    std::atomic<std::uint64_t> written_bytes = 0;
+
+    /// @brief Records an event with the stream which is attached to the allocator, if there is one.
+    static void record(VmaAllocator vma_allocator, AllocationEvent &event);
+
+    /// @brief Copies an event into the ring, or drops it if the ring is full.
+    void record(AllocationEvent &event);
+
+    static void VKAPI_CALL on_allocate_device_memory(VmaAllocator vma_allocator, std::uint32_t memory_type, VkDeviceMemory memory, VkDeviceSize size);
+    static void VKAPI_CALL on_free_device_memory(VmaAllocator vma_allocator, std::uint32_t memory_type, VkDeviceMemory memory, VkDeviceSize size);
+
+    /// @brief Writes the recorded events, and a snapshot if it's time for one, until the stream is stopped.
+    void write_loop();
+
+    /// @brief Takes the recorded events out of the ring and appends them to the bytes which are written.
+    void encode_events(std::vector<std::uint8_t> &bytes);
+
+    /// @brief Queries VMA's statistics and budget and appends them to the bytes which are written.
+    void encode_snapshot(std::vector<std::uint8_t> &bytes);
+
+    void write(const std::vector<std::uint8_t> &bytes);
+
+public:
+    /// @brief Opens the file, writes the memory properties, attaches the stream to the allocator and starts the writer thread.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle. It should have been created with
+    /// get_device_memory_callbacks(), otherwise device memory events are not recorded.
+    /// @param settings [in] The file name, the size of the ring and the write intervals.
+    AllocationStatisticsStream(const VmaAllocator vma_allocator, const AllocationStatisticsSettings &settings = {});
+
+    AllocationStatisticsStream(const AllocationStatisticsStream &) = delete;
+    AllocationStatisticsStream &operator=(const AllocationStatisticsStream &) = delete;
+
+    /// @brief Detaches the stream, writes the remaining events and a last snapshot, and closes the file.
+    ~AllocationStatisticsStream();
+
+    /// @brief Returns the callbacks which record VMA's allocations of device memory blocks.
+    [[nodiscard]] static const VmaDeviceMemoryCallbacks *get_device_memory_callbacks();
+
+    /// @brief These record an event if a stream is attached to the allocator, and do nothing otherwise.
+    static void on_create_buffer(VmaAllocator vma_allocator, const VkBufferCreateInfo &buffer_create_info,
+                                 const VmaAllocationCreateInfo &allocation_create_info, VmaAllocation allocation);
+    static void on_destroy_buffer(VmaAllocator vma_allocator, VmaAllocation allocation);
+    static void on_create_image(VmaAllocator vma_allocator, const VkImageCreateInfo &image_create_info,
+                                const VmaAllocationCreateInfo &allocation_create_info, VmaAllocation allocation);
+    static void on_destroy_image(VmaAllocator vma_allocator, VmaAllocation allocation);
+
+    /// @brief Advances the frame index which is stored with every event. This should be called once per frame.
+    void next_frame() {
+        frame_index.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] AllocationStatisticsStreamStatistics get_statistics() const;
+};
+
+} // namespace inexor::vulkan_renderer
@@ -8,6 +8,7 @@
 #include "inexor/vulkan-renderer/standard_ubo.hpp"
 #include "inexor/vulkan-renderer/thread_pool.hpp"
 #include "inexor/vulkan-renderer/tools/cla_parser.hpp"
+#include "inexor/vulkan-renderer/tools/cpu_topology.hpp"
 #include "inexor/vulkan-renderer/world/cube.hpp"
 
 #include <GLFW/glfw3.h>
@@ -16,6 +17,9 @@
 
 namespace inexor::vulkan_renderer {
 
+// The time budget of one frame for the threadpool's background tasks, which corresponds to 60 frames per second.
+constexpr std::chrono::microseconds THREADPOOL_FRAME_BUDGET{16667};
+
 class Application : public VulkanRenderer, public tools::CommandLineArgumentParser {
 public:
     Application() = default;
@@ -37,6 +41,9 @@ private:
     // Call thread_pool->execute(); to order new tasks to be worked on.
     std::shared_ptr<ThreadPool> thread_pool;
 
+    /// The placement settings of the threadpool, loaded from the TOML file and the command line arguments.
+    ThreadPoolSettings thread_pool_settings;
+
     std::size_t current_frame = 0;
 
     // TODO: Refactor into a manger class.
@@ -75,7 +82,9 @@ private:
 
     /// @brief Implementation of the uniform buffer update method.
     /// @param current_image [in] The current image index.
-    VkResult update_uniform_buffers(const std::size_t current_image);
+    /// @brief Writes the uniform data of this frame into the region of the swapchain image.
+    /// @param image_index [in] The index of the swapchain image which will be rendered.
+    VkResult update_uniform_buffers(const std::uint32_t image_index);
 
     VkResult update_keyboard_input();
 
@@ -44,6 +44,13 @@ public:
 
     float get_far_clip();
 
+    /// @brief Estimates the size of a bounding sphere on the screen, for example to select the mip levels of its textures.
+    /// @param center [in] The center of the sphere in world space.
+    /// @param radius [in] The radius of the sphere.
+    /// @param viewport_height [in] The height of the viewport in pixels.
+    /// @return The projected diameter of the sphere in pixels. A sphere which contains the camera covers the whole viewport.
+    float estimate_screen_size(const glm::vec3 &center, float radius, float viewport_height) const;
+
     void set_perspective(float fov, float aspect, float z_near, float z_far);
 
     void update_aspect_ratio(float aspect);
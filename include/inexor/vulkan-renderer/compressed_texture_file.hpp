@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief The size of the blocks of a block compressed format.
+struct CompressedBlockInfo {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+
+    /// The size of one block in bytes.
+    std::uint32_t size = 0;
+};
+
+/// @brief One mip level of a compressed texture file.
+struct CompressedMipLevel {
+    /// The offset of the mip level from the beginning of the texture data.
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+};
+
+/// @brief A 2D texture with block compressed mip levels, loaded from a KTX2 or a DDS file.
+/// Supported are BC1, BC3, BC5 and BC7, and in KTX2 files all ASTC LDR block sizes. The mip levels are taken as they are stored,
+/// so they can be copied into an image without decoding them. Supercompressed KTX2 files (Basis Universal, zstd) are not supported.
+/// @note tools/texture-compressor converts the textures in assets/textures into KTX2 files.
+class CompressedTextureFile {
+private:
+    std::string file_name;
+
+    VkFormat format = VK_FORMAT_UNDEFINED;
+
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+
+    /// The data of all mip levels, largest level first.
+    std::vector<std::uint8_t> data;
+
+    std::vector<CompressedMipLevel> mip_levels;
+
+    void load_ktx2(const std::vector<char> &file_data);
+
+    void load_dds(const std::vector<char> &file_data);
+
+    /// @brief Copies the mip levels out of the file data and checks their sizes against the format.
+    /// @param file_data [in] The file data.
+    /// @param level_offsets [in] The offsets of the mip levels in the file, largest level first.
+    /// @param level_sizes [in] The sizes of the mip levels in the file.
+    void copy_mip_levels(const std::vector<char> &file_data, const std::vector<std::uint64_t> &level_offsets, const std::vector<std::uint64_t> &level_sizes);
+
+public:
+    /// @brief Loads a KTX2 or DDS file, depending on its file extension.
+    /// @param file_name [in] The file name of the texture.
+    /// @throws std::runtime_error if the file can't be read, or if its layout or format is not supported.
+    explicit CompressedTextureFile(const std::string &file_name);
+
+    /// @brief Checks if the file extension of a texture is one of a compressed texture file.
+    [[nodiscard]] static bool is_compressed_texture_file(const std::string &file_name);
+
+    /// @brief Returns the block size of a format, or false if the format is not a supported block compressed format.
+    [[nodiscard]] static bool get_block_info(VkFormat format, CompressedBlockInfo &block_info);
+
+    /// @brief Checks if the graphics card can sample a format with optimal tiling.
+    /// @note BC formats also need the textureCompressionBC feature, ASTC formats the textureCompressionASTC_LDR feature.
+    [[nodiscard]] static bool is_format_supported(VkPhysicalDevice graphics_card, VkFormat format);
+
+    [[nodiscard]] const std::string &get_file_name() const {
+        return file_name;
+    }
+
+    [[nodiscard]] VkFormat get_format() const {
+        return format;
+    }
+
+    [[nodiscard]] std::uint32_t get_width() const {
+        return width;
+    }
+
+    [[nodiscard]] std::uint32_t get_height() const {
+        return height;
+    }
+
+    [[nodiscard]] const std::vector<std::uint8_t> &get_data() const {
+        return data;
+    }
+
+    [[nodiscard]] const std::vector<CompressedMipLevel> &get_mip_levels() const {
+        return mip_levels;
+    }
+};
+
+} // namespace inexor::vulkan_renderer
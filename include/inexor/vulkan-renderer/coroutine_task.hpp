@@ -0,0 +1,401 @@
+#pragma once
+
+// Coroutine based tasks require C++20, see INEXOR_USE_COROUTINES in CMakeLists.txt.
+#ifdef INEXOR_USE_COROUTINES
+
+#include "inexor/vulkan-renderer/fence_manager.hpp"
+#include "inexor/vulkan-renderer/thread_pool.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace inexor {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+/// @brief The part of the promise of a Task which does not depend on the result type.
+class TaskPromiseBase {
+public:
+    /// @brief Resumes the awaiting coroutine (if any) once the task is finished.
+    struct FinalAwaiter {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto &promise = handle.promise();
+
+            // Read the continuation first: once done is set, the owner of the task might destroy it.
+            auto continuation = promise.continuation;
+
+            promise.done.store(true, std::memory_order_release);
+
+            if (continuation) {
+                return continuation;
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    /// The coroutine which awaits this task.
+    std::coroutine_handle<> continuation;
+
+    std::exception_ptr exception;
+
+    /// Set once the coroutine has finished, so root tasks can be polled from another thread.
+    std::atomic<bool> done = false;
+
+    /// Tasks are lazy, they start when they are awaited or started.
+    std::suspend_always initial_suspend() const noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept {
+        return {};
+    }
+
+    void unhandled_exception() noexcept {
+        exception = std::current_exception();
+    }
+
+    void rethrow_if_exception() const {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U &&new_value) {
+        value.emplace(std::forward<U>(new_value));
+    }
+
+    T take_result() {
+        rethrow_if_exception();
+        return std::move(*value);
+    }
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void take_result() const {
+        rethrow_if_exception();
+    }
+};
+
+} // namespace detail
+
+/// @brief A lazily started coroutine which returns a value of type T.
+/// A task can be awaited by another coroutine, or started as a root task with start() or spawn().
+/// Together with schedule_on, IoCompletion and wait_for_fence, a chain like file I/O, decoding,
+/// GPU upload and fence wait can be written as one function which never blocks a thread:
+/// @code
+/// Task<Texture> load_texture(ThreadPool &thread_pool, ...) {
+///     co_await schedule_on(thread_pool, TaskPriority::BACKGROUND);
+///     auto pixels = decode(co_await read_file(...));
+///     auto fence = submit_upload(pixels);
+///     co_await wait_for_fence(fence_manager, fence, thread_pool);
+///     co_return ...;
+/// }
+/// @endcode
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    Task(const Task &) = delete;
+    Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    Task &operator=(const Task &) = delete;
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    /// @brief Starts a root task on the calling thread. It runs until it is suspended the first time.
+    /// @warning The task must not be destroyed before it is done.
+    void start() {
+        assert(handle);
+        handle.resume();
+    }
+
+    /// @brief Checks if the task has finished. This can be called from any thread.
+    [[nodiscard]] bool is_done() const {
+        assert(handle);
+        return handle.promise().done.load(std::memory_order_acquire);
+    }
+
+    /// @brief Returns the result of a finished root task, or rethrows its exception.
+    [[nodiscard]] T get() {
+        assert(is_done());
+        return handle.promise().take_result();
+    }
+
+    auto operator co_await() &&noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            // Symmetric transfer: the awaited task runs right away, without growing the stack.
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting_coroutine) noexcept {
+                handle.promise().continuation = awaiting_coroutine;
+                return handle;
+            }
+
+            T await_resume() {
+                return handle.promise().take_result();
+            }
+        };
+
+        assert(handle);
+        return Awaiter{handle};
+    }
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/// @brief A coroutine which starts right away and destroys itself once it is finished.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() const noexcept {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept {
+            return {};
+        }
+
+        void return_void() const noexcept {}
+
+        void unhandled_exception() const noexcept {
+            try {
+                std::rethrow_exception(std::current_exception());
+            } catch (const std::exception &exception) {
+                spdlog::error("Unhandled exception in spawned task: {}", exception.what());
+            } catch (...) {
+                spdlog::error("Unhandled exception in spawned task!");
+            }
+        }
+    };
+};
+
+inline DetachedTask run_detached(Task<void> task) {
+    co_await std::move(task);
+}
+
+} // namespace detail
+
+/// @brief Starts a task on the calling thread and lets it run to completion on its own.
+/// Exceptions of the task are logged.
+inline void spawn(Task<void> task) {
+    detail::run_detached(std::move(task));
+}
+
+/// @brief Resumes the awaiting coroutine on a worker thread of the threadpool.
+class ThreadPoolAwaiter {
+private:
+    ThreadPool &thread_pool;
+    TaskPriority priority;
+
+public:
+    ThreadPoolAwaiter(ThreadPool &thread_pool, TaskPriority priority) : thread_pool(thread_pool), priority(priority) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // The future does not need to be kept, the coroutine itself is the continuation.
+        thread_pool.execute_with_priority(priority, [handle]() { handle.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+};
+
+/// @brief Moves the awaiting coroutine onto a worker thread of the threadpool, for CPU work.
+/// @param thread_pool [in] The threadpool.
+/// @param priority [in] The priority lane to queue the coroutine in.
+[[nodiscard]] inline ThreadPoolAwaiter schedule_on(ThreadPool &thread_pool, TaskPriority priority = TaskPriority::NORMAL) {
+    return ThreadPoolAwaiter(thread_pool, priority);
+}
+
+/// @brief A one-shot completion of an I/O operation, which can be awaited by one coroutine.
+/// The coroutine is resumed on the thread which calls complete(), or right away if it already completed.
+template <typename T>
+class IoCompletion {
+private:
+    std::mutex completion_mutex;
+
+    std::optional<T> result;
+
+    std::coroutine_handle<> waiting_coroutine;
+
+public:
+    IoCompletion() = default;
+
+    IoCompletion(const IoCompletion &) = delete;
+    IoCompletion &operator=(const IoCompletion &) = delete;
+
+    /// @brief Completes the I/O operation and resumes the awaiting coroutine.
+    /// @param value [in] The result of the I/O operation.
+    void complete(T value) {
+        std::coroutine_handle<> coroutine;
+
+        {
+            std::lock_guard<std::mutex> lock(completion_mutex);
+
+            assert(!result.has_value());
+
+            result.emplace(std::move(value));
+            coroutine = std::exchange(waiting_coroutine, nullptr);
+        }
+
+        if (coroutine) {
+            coroutine.resume();
+        }
+    }
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            IoCompletion &completion;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lock(completion.completion_mutex);
+
+                // Do not suspend if the I/O operation already completed.
+                if (completion.result.has_value()) {
+                    return false;
+                }
+
+                assert(!completion.waiting_coroutine);
+
+                completion.waiting_coroutine = handle;
+                return true;
+            }
+
+            T await_resume() {
+                std::lock_guard<std::mutex> lock(completion.completion_mutex);
+                return std::move(*completion.result);
+            }
+        };
+
+        return Awaiter{*this};
+    }
+};
+
+} // namespace inexor
+
+namespace inexor::vulkan_renderer {
+
+/// @brief Resumes the awaiting coroutine on the threadpool once a fence is signaled.
+/// The fence is polled by VulkanFenceManager::poll_fence_callbacks, so no thread waits on it.
+/// If the status of the fence can't be checked, e.g. because the device was lost, co_await throws std::runtime_error.
+class FenceAwaiter {
+private:
+    VulkanFenceManager &fence_manager;
+    ThreadPool &thread_pool;
+    VkFence fence;
+    TaskPriority priority;
+
+    /// The status of the fence, which is set before the coroutine is resumed.
+    VkResult result = VK_NOT_READY;
+
+public:
+    FenceAwaiter(VulkanFenceManager &fence_manager, VkFence fence, ThreadPool &thread_pool, TaskPriority priority)
+        : fence_manager(fence_manager), thread_pool(thread_pool), fence(fence), priority(priority) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // The awaiter lives in the coroutine frame until the coroutine is resumed.
+        fence_manager.add_fence_callback(fence, [this, handle](const VkResult fence_result) {
+            result = fence_result;
+            thread_pool.execute_with_priority(priority, [handle]() { handle.resume(); });
+        });
+    }
+
+    void await_resume() const {
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("Error: Waiting for a fence failed: " + get_error_description_text(result));
+        }
+    }
+};
+
+/// @brief Suspends the awaiting coroutine until the fence is signaled.
+/// @param fence_manager [in] The fence manager which polls the fence.
+/// @param fence [in] The fence to wait for.
+/// @param thread_pool [in] The threadpool to resume the coroutine on.
+/// @param priority [in] The priority lane to resume the coroutine in.
+[[nodiscard]] inline FenceAwaiter wait_for_fence(VulkanFenceManager &fence_manager, VkFence fence, ThreadPool &thread_pool,
+                                                 TaskPriority priority = TaskPriority::NORMAL) {
+    return FenceAwaiter(fence_manager, fence, thread_pool, priority);
+}
+
+} // namespace inexor::vulkan_renderer
+
+#endif
@@ -46,6 +46,13 @@ public:
 
     void create_descriptor_sets();
 
+    /// @brief Replaces the image of a binding in one descriptor set, for example after a texture has replaced its image view.
+    /// @param set_index [in] The index of the descriptor set, which is the index of its swapchain image.
+    /// @param binding [in] The binding, which must have an image descriptor type.
+    /// @param image_info [in] The new image.
+    /// @warning The descriptor set must not be used by a command buffer which is pending.
+    void update_image_descriptor(std::uint32_t set_index, std::uint32_t binding, const VkDescriptorImageInfo &image_info);
+
     /// @brief Resets descriptor.
     /// @note This will be called when swapchain needs to be recreated.
     void reset(const bool clear_descriptor_layout_bindings = false);
@@ -2,17 +2,25 @@
 
 #include "inexor/vulkan-renderer/debug_marker_manager.hpp"
 #include "inexor/vulkan-renderer/error_handling.hpp"
-#include "inexor/vulkan-renderer/manager_template.hpp"
+#include "inexor/vulkan-renderer/hashed_name.hpp"
+#include "inexor/vulkan-renderer/slot_map.hpp"
+#include "inexor/vulkan-renderer/snapshot_manager_template.hpp"
 
 #include <vulkan/vulkan.h>
 
 #include <cassert>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <vector>
 
 namespace inexor::vulkan_renderer {
 
-class VulkanFenceManager : public ManagerClassTemplate<VkFence> {
+/// @brief A handle to a fence which was created with VulkanFenceManager::create_fence_handle.
+using FenceHandle = SlotMap<VkFence>::Handle;
+
+class VulkanFenceManager : public SnapshotManagerClassTemplate<VkFence> {
 private:
     bool fence_manager_initialised = false;
 
@@ -22,6 +30,30 @@ private:
 
     std::shared_ptr<VulkanDebugMarkerManager> debug_marker_manager;
 
+    /// The function which checks the status of the fences with callbacks.
+    PFN_vkGetFenceStatus get_fence_status = vkGetFenceStatus;
+
+    /// @brief A callback which is called once its fence is signaled, or once checking its status failed.
+    struct FenceCallback {
+        VkFence fence;
+        std::function<void(VkResult)> callback;
+    };
+
+    /// The callbacks of fences which have not been signaled yet.
+    std::vector<FenceCallback> fence_callbacks;
+
+    std::mutex fence_callbacks_mutex;
+
+    /// The fences which are referenced by handle. Their names are only kept for debugging.
+    SlotMap<VkFence> fences;
+
+    std::shared_mutex fences_mutex;
+
+    /// @brief Creates a Vulkan fence.
+    /// @param create_as_signaled [in] Describes if the fence will be created as signaled.
+    /// @param fence [out] The new fence.
+    VkResult create_vulkan_fence(bool create_as_signaled, VkFence &fence);
+
 public:
     VulkanFenceManager() = default;
 
@@ -30,12 +62,15 @@ public:
     /// @brief Initialises Vulkan fence manager.
     /// @param device [in] The Vulkan device.
     /// @param debug_marker_manager [in] A pointer to the debug marker manager.
-    VkResult init(const VkDevice &device, std::shared_ptr<VulkanDebugMarkerManager> debug_marker_manager);
+    /// @param get_fence_status [in] The function which checks the status of the fences with callbacks. It can be replaced to test
+    /// the callbacks without a device.
+    VkResult init(const VkDevice &device, std::shared_ptr<VulkanDebugMarkerManager> debug_marker_manager,
+                  PFN_vkGetFenceStatus get_fence_status = vkGetFenceStatus);
 
     /// @brief Checks if a fence with this name already exists.
     /// @param fence_name [in] The name of the fence.
     /// @return True if a fence with this name already exists, false otherwise.
-    [[nodiscard]] bool does_fence_exist(const std::string &fence_name);
+    [[nodiscard]] bool does_fence_exist(const HashedName &fence_name);
 
     /// @brief Creates a new Vulkan fence.
     /// @param device [in] The Vulkan device.
@@ -44,9 +79,38 @@ public:
     [[nodiscard]] std::optional<std::shared_ptr<VkFence>> create_fence(const std::string &fence_name, bool create_as_signaled = true);
 
     /// @brief Gets a certain fence by name.
-    /// @param fence_name [in] The name of the fence.
+    /// @param fence_name [in] The name of the fence, preferably hashed at compile time.
     /// @return The acquired fence (if existent), std::nullopt otherwise.
-    [[nodiscard]] std::optional<std::shared_ptr<VkFence>> get_fence(const std::string &fence_name);
+    [[nodiscard]] std::optional<std::shared_ptr<VkFence>> get_fence(const HashedName &fence_name);
+
+    /// @brief Creates a new Vulkan fence which is referenced by handle instead of by name.
+    /// @param debug_name [in] The name of the fence, which is only kept in debug builds.
+    /// @param create_as_signaled [in] Describes if the fence will be created as signaled (turned on).
+    /// @return The handle of the fence, or std::nullopt if the fence could not be created.
+    [[nodiscard]] std::optional<FenceHandle> create_fence_handle(const std::string &debug_name, bool create_as_signaled = true);
+
+    /// @brief Gets a fence by handle in O(1).
+    /// @param fence_handle [in] The handle of the fence.
+    /// @return The fence, or VK_NULL_HANDLE if the handle is stale.
+    [[nodiscard]] VkFence get_fence(FenceHandle fence_handle);
+
+    /// @brief Destroys a fence which was created by handle.
+    /// @param fence_handle [in] The handle of the fence.
+    void destroy_fence(FenceHandle fence_handle);
+
+    /// @brief Registers a callback which is called once the fence is signaled.
+    /// The fence is not waited on, instead poll_fence_callbacks checks its status.
+    /// @param fence [in] The fence to wait for.
+    /// @param callback [in] The callback, which is called on the thread which polls the fences. Its parameter is VK_SUCCESS
+    /// if the fence was signaled, or the error code of vkGetFenceStatus, e.g. VK_ERROR_DEVICE_LOST.
+    /// @note This method is thread safe.
+    void add_fence_callback(VkFence fence, std::function<void(VkResult)> callback);
+
+    /// @brief Checks the status of every fence which has callbacks and calls the callbacks of signaled fences.
+    /// The callbacks of fences whose status could not be checked are called with the error code.
+    /// Called once per frame by the render loop.
+    /// @return VK_SUCCESS, or the first error code of vkGetFenceStatus.
+    VkResult poll_fence_callbacks();
 
     /// @brief Destroys all existing fences.
     /// @param device [in] The Vulkan device.
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/error_handling.hpp"
+
+#include <spdlog/spdlog.h>
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief Tracks the progress of queues with one timeline semaphore (VK_KHR_timeline_semaphore) per queue.
+/// Every submission through this class signals the next value of its queue's counter, so a value stands for
+/// a point in the history of the queue. The value which a frame's submission signals is the number of the frame:
+/// CPU code can wait for "frame N finished" without keeping a fence per frame in flight. The upload batches signal
+/// the counters of the graphics and the data transfer queue as well, and deferred deletions are keyed off the same
+/// counters, see defer_until().
+/// @note Swapchain image acquisition and presentation still need binary semaphores.
+class VulkanFrameTimeline {
+private:
+    bool frame_timeline_initialised = false;
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    // The timeline semaphore commands are part of an extension, so we have to load them explicitly.
+    PFN_vkGetSemaphoreCounterValueKHR vkGetSemaphoreCounterValueKHR = nullptr;
+    PFN_vkWaitSemaphoresKHR vkWaitSemaphoresKHR = nullptr;
+
+    struct QueueTimeline {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+
+        /// The value which was signaled by the last submission to the queue.
+        std::uint64_t last_submitted_value = 0;
+    };
+
+    /// One monotonically increasing counter per queue.
+    std::unordered_map<VkQueue, QueueTimeline> queue_timelines;
+
+    /// @brief A task which runs once its queue has reached a value, like the deletion of a buffer.
+    struct DeferredTask {
+        VkQueue queue;
+        std::uint64_t value;
+        std::function<void()> task;
+    };
+
+    std::vector<DeferredTask> deferred_tasks;
+
+    std::mutex frame_timeline_mutex;
+
+    /// @brief Returns the timeline of a queue. The lock must be held by the caller.
+    [[nodiscard]] QueueTimeline &get_queue_timeline(VkQueue queue);
+
+    /// @brief Returns the value the queue has reached. The lock must be held by the caller.
+    [[nodiscard]] std::uint64_t get_completed_value_locked(VkQueue queue);
+
+public:
+    VulkanFrameTimeline() = default;
+
+    ~VulkanFrameTimeline() = default;
+
+    /// @brief Checks if a graphics card supports timeline semaphores.
+    /// The device extension VK_KHR_timeline_semaphore must be checked separately.
+    /// @param graphics_card [in] The graphics card.
+    /// @return True if the timelineSemaphore feature is supported, false otherwise.
+    [[nodiscard]] static bool is_supported(const VkPhysicalDevice &graphics_card);
+
+    /// @brief Initialises the frame timeline.
+    /// @param device [in] The Vulkan device, which must be created with the timelineSemaphore feature enabled.
+    /// @param queues [in] The queues to track. Duplicates share one timeline.
+    VkResult init(const VkDevice &device, const std::vector<VkQueue> &queues);
+
+    /// @brief Submits work to a queue and signals the next value of the queue's timeline.
+    /// The timeline semaphore is appended to the signal semaphores of the submission.
+    /// @param queue [in] The queue to submit to.
+    /// @param submit_info [in] The submission, with binary semaphores only and without a pNext chain.
+    /// @param fence [in] An optional fence to signal as well.
+    /// @param signaled_value [out] The value which will be signaled once the submission is finished.
+    /// @note This method is thread safe. It synchronises the access to the queue as well.
+    VkResult submit(VkQueue queue, const VkSubmitInfo &submit_info, VkFence fence, std::uint64_t &signaled_value);
+
+    /// @brief Returns the value which will be signaled by the last submission to the queue.
+    [[nodiscard]] std::uint64_t get_last_submitted_value(VkQueue queue);
+
+    /// @brief Returns the value the queue has reached, without waiting.
+    [[nodiscard]] std::uint64_t get_completed_value(VkQueue queue);
+
+    /// @brief Waits until the queue has reached a value.
+    /// @param queue [in] The queue.
+    /// @param value [in] The value to wait for.
+    /// @param timeout [in] The timeout in nanoseconds.
+    /// @return VK_SUCCESS, or VK_TIMEOUT if the value was not reached in time.
+    VkResult wait_for_value(VkQueue queue, std::uint64_t value, std::uint64_t timeout = UINT64_MAX);
+
+    /// @brief Runs a task once the queue has reached a value, for example to destroy a buffer
+    /// which is used by the submission which signals the value.
+    /// @param queue [in] The queue.
+    /// @param value [in] The value to wait for.
+    /// @param task [in] The task, which is run by run_completed_tasks.
+    /// @note This method is thread safe.
+    void defer_until(VkQueue queue, std::uint64_t value, std::function<void()> task);
+
+    /// @brief Runs all deferred tasks whose queues have reached their values.
+    /// @return The number of tasks which were run.
+    std::size_t run_completed_tasks();
+
+    /// @brief Runs all remaining deferred tasks and destroys the timeline semaphores.
+    /// @warning The device must be idle.
+    void shutdown();
+
+    [[nodiscard]] bool is_initialised() const {
+        return frame_timeline_initialised;
+    }
+};
+
+} // namespace inexor::vulkan_renderer
@@ -4,10 +4,25 @@
 #include <vma/vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 
 namespace inexor::vulkan_renderer {
 
+/// @brief Where the data of a buffer which is read by the GPU is stored, and how it gets there.
+enum class MemoryPlacement {
+    /// Decide from the memory properties of the graphics card, see GPUMemoryBuffer::decide_memory_placement.
+    AUTOMATIC,
+
+    /// Device local memory which is filled through a staging buffer, as on discrete graphics cards.
+    DEVICE_LOCAL_STAGED,
+
+    /// Memory which is both device local and host visible, so the CPU writes the data directly without a staging copy.
+    /// This is the case on integrated graphics cards and on discrete graphics cards with resizable BAR.
+    HOST_VISIBLE_DIRECT
+};
+
 class GPUMemoryBuffer {
 protected:
     std::string name;
@@ -16,9 +31,17 @@ protected:
     VmaAllocator vma_allocator;
     VkBuffer buffer = VK_NULL_HANDLE;
     VkDeviceSize buffer_size = 0;
+    VkBufferUsageFlags buffer_usage = 0;
     VmaAllocation allocation = VK_NULL_HANDLE;
     VmaAllocationInfo allocation_info = {};
     VmaAllocationCreateInfo allocation_create_info = {};
+    MemoryPlacement memory_placement = MemoryPlacement::AUTOMATIC;
+
+    /// @brief Creates the buffer with the current allocation create info and assigns its debug name.
+    VkResult create_buffer(const VkBufferUsageFlags &buffer_usage);
+
+    /// @brief Assigns the internal name to the buffer, if debug markers are available.
+    void assign_debug_name();
 
 public:
     /// Delete the copy constructor so gpu memory buffers are move-only objects.
@@ -51,8 +74,41 @@ public:
     GPUMemoryBuffer(const VkDevice &device, const VmaAllocator &vma_allocator, const std::string &name, const VkDeviceSize &buffer_size, void *data,
                     const std::size_t data_size, const VkBufferUsageFlags &buffer_usage, const VmaMemoryUsage &memory_usage);
 
+    /// @brief Creates a new GPU memory buffer for data which is read by the GPU, like vertices.
+    /// @param device [in] The Vulkan device from which the buffer will be created.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param name [in] The internal name of the buffer.
+    /// @param size [in] The size of the buffer in bytes.
+    /// @param buffer_usage [in] The Vulkan buffer usage flags.
+    /// @param memory_placement [in] The memory placement. If it is AUTOMATIC and no device local host visible memory
+    /// is left, the buffer falls back to DEVICE_LOCAL_STAGED. Use get_memory_placement to find out how to fill it.
+    GPUMemoryBuffer(const VkDevice &device, const VmaAllocator &vma_allocator, const std::string &name, const VkDeviceSize &size,
+                    const VkBufferUsageFlags &buffer_usage, const MemoryPlacement memory_placement);
+
     virtual ~GPUMemoryBuffer();
 
+    /// @brief Decides the memory placement from the memory properties of the graphics card.
+    /// If the CPU can write to the largest device local memory heap, data is written directly, otherwise it is staged.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    [[nodiscard]] static MemoryPlacement decide_memory_placement(const VmaAllocator &vma_allocator);
+
+    /// @brief Copies data into the buffer, which must be host visible and mapped.
+    /// @param data [in] The address of the data which will be copied.
+    /// @param data_size [in] The size of the data in bytes.
+    /// @param offset [in] The offset in bytes at which the data is written.
+    void update(const void *data, const std::size_t data_size, const VkDeviceSize offset = 0);
+
+    /// @brief Creates a buffer like this one, binds it to the memory the allocation is moved to by defragmentation,
+    /// and makes it the buffer of this object.
+    /// @param memory [in] The memory the allocation is moved to.
+    /// @param offset [in] The offset of the allocation in that memory.
+    /// @return The old buffer, which the data still has to be copied from. The caller destroys it once the GPU no longer uses it.
+    /// @note The allocation info is outdated until refresh_allocation_info is called after the defragmentation has ended.
+    [[nodiscard]] VkBuffer rebind(const VkDeviceMemory memory, const VkDeviceSize offset);
+
+    /// @brief Queries the allocation info from VMA again, for example after the allocation was moved.
+    void refresh_allocation_info();
+
     [[nodiscard]] const std::string &get_name() const {
         return name;
     }
@@ -61,6 +117,10 @@ public:
         return buffer;
     }
 
+    [[nodiscard]] VkDeviceSize get_buffer_size() const {
+        return buffer_size;
+    }
+
     [[nodiscard]] const VmaAllocation get_allocation() const {
         return allocation;
     }
@@ -72,6 +132,11 @@ public:
     [[nodiscard]] const VmaAllocationCreateInfo get_allocation_create_info() const {
         return allocation_create_info;
     }
+
+    /// @brief Returns the memory placement of a buffer which was created with one, AUTOMATIC otherwise.
+    [[nodiscard]] MemoryPlacement get_memory_placement() const {
+        return memory_placement;
+    }
 };
 
 } // namespace inexor::vulkan_renderer
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief The name of a resource, stored as its 64 bit FNV-1a hash.
+/// Names which are created from string literals are hashed at compile time, so lookups by a HashedName
+/// neither construct a std::string nor hash any characters. Use a constexpr variable to make sure of it:
+/// @code
+/// constexpr HashedName IN_FLIGHT_FENCE_NAME = "in_flight_fence";
+/// @endcode
+/// The hash of a std::string is computed at runtime.
+class HashedName {
+private:
+    static constexpr std::uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ull;
+    static constexpr std::uint64_t FNV_PRIME = 0x100000001B3ull;
+
+    std::uint64_t hash = FNV_OFFSET_BASIS;
+
+    [[nodiscard]] static constexpr std::uint64_t hash_string(std::string_view name) {
+        std::uint64_t hash = FNV_OFFSET_BASIS;
+
+        for (const char character : name) {
+            hash ^= static_cast<std::uint8_t>(character);
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+    /// @brief Returns the length of a null terminated name in a char array, which is at most the size of the array.
+    /// A char buffer may contain a shorter name than its size, followed by more null characters or garbage.
+    template <std::size_t N>
+    [[nodiscard]] static constexpr std::size_t get_length(const char (&name)[N]) {
+        std::size_t length = 0;
+
+        while (length < N && name[length] != '\0') {
+            length++;
+        }
+
+        return length;
+    }
+
+public:
+    /// @brief Hashes a string literal or a null terminated name in a char array, at compile time if the name is used in a constant expression.
+    template <std::size_t N>
+    constexpr HashedName(const char (&name)[N]) : hash(hash_string(std::string_view(name, get_length(name)))) {}
+
+    /// @brief Hashes a name at runtime.
+    HashedName(const std::string &name) : hash(hash_string(name)) {}
+
+    constexpr explicit HashedName(std::string_view name) : hash(hash_string(name)) {}
+
+    [[nodiscard]] constexpr std::uint64_t get_hash() const {
+        return hash;
+    }
+
+    /// @brief Checks if this is the hash of an empty name.
+    [[nodiscard]] constexpr bool empty() const {
+        return hash == FNV_OFFSET_BASIS;
+    }
+
+    constexpr bool operator==(const HashedName &other) const {
+        return hash == other.hash;
+    }
+
+    constexpr bool operator!=(const HashedName &other) const {
+        return hash != other.hash;
+    }
+};
+
+} // namespace inexor::vulkan_renderer
+
+namespace std {
+
+/// The name is a hash already, so it is not hashed again.
+template <>
+struct hash<inexor::vulkan_renderer::HashedName> {
+    std::size_t operator()(const inexor::vulkan_renderer::HashedName &name) const noexcept {
+        return static_cast<std::size_t>(name.get_hash());
+    }
+};
+
+} // namespace std
@@ -1,7 +1,13 @@
 ﻿#pragma once
 
+#include "inexor/vulkan-renderer/hashed_name.hpp"
+
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <shared_mutex>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -12,10 +18,17 @@ namespace inexor::vulkan_renderer {
 /// key/value pairs for various data types. In most cases, std::string is the
 /// key. The value however can be of an arbitrary data type. This template class
 /// bundles common add/get/update/delete methods in a thread safe enviroment.
+/// The keys are stored as HashedName, so lookups with names which were hashed
+/// at compile time do not construct or hash any strings.
 template <typename T>
 class ManagerClassTemplate {
 private:
-    std::unordered_map<std::string, std::shared_ptr<T>> stored_types;
+    std::unordered_map<HashedName, std::shared_ptr<T>> stored_types;
+
+#ifndef NDEBUG
+    /// The names of the keys, for error messages and to detect hash collisions.
+    std::unordered_map<HashedName, std::string> type_names;
+#endif
 
 protected:
     // We use shared_mutex to give write access to exactly one thread, but read
@@ -32,7 +45,7 @@ protected:
     /// @brief Checks if a value exists by given key.
     /// @param type_name [in] The name of the type (the key).
     /// @return True if the value exists, false otherwise.
-    bool does_key_exist(const std::string &type_name);
+    bool does_key_exist(const HashedName &type_name);
 
     // TODO: does_value_exist?
 
@@ -40,6 +53,7 @@ protected:
     /// @param type_name [in] The name of the new type (the key).
     /// @param new_type [in] The new type (the value).
     /// @note This method is thread safe thanks to the lock guard.
+    /// @note In debug builds, an exception is thrown if the hash of the name collides with another name.
     /// @return True if adding the type was successful, false otherwise.
     bool add_entry(const std::string &type_name, const std::shared_ptr<T> new_type);
 
@@ -50,12 +64,17 @@ protected:
     /// @note This method is thread safe thanks to the lock guard.
     /// @return True of the value could be updated, false if the key doesn't
     /// exist.
-    bool update_entry(const std::string &type_name, const std::shared_ptr<T> new_type);
+    bool update_entry(const HashedName &type_name, const std::shared_ptr<T> new_type);
 
     /// @brief Returns a type (value) by given name (key).
     /// @param type_name [in] The name of the type (the key).
     /// @return An std::optional shared pointer of the type (the value).
-    std::optional<std::shared_ptr<T>> get_entry(const std::string &type_name);
+    std::optional<std::shared_ptr<T>> get_entry(const HashedName &type_name);
+
+    /// @brief Returns the name of a key for error messages.
+    /// @param type_name [in] The name of the type (the key).
+    /// @return The name in debug builds, the hash in release builds.
+    std::string get_key_name(const HashedName &type_name);
 
     /// @brief Returns the number of types available.
     /// @return The number of types available.
@@ -79,7 +98,7 @@ protected:
     /// @param type_name [in] The name of the type to delete.
     /// @note This method is thread safe thanks to the lock guard.
     /// @return The number of deleted types.
-    std::size_t delete_entry(const std::string &type_name);
+    std::size_t delete_entry(const HashedName &type_name);
 
     /// @brief Deletes all types.
     /// @TODO Refactor: Accept locked state so pre-shutdown doesn't have to unlock
@@ -89,7 +108,7 @@ protected:
 };
 
 template <typename T>
-bool ManagerClassTemplate<T>::does_key_exist(const std::string &type_name) {
+bool ManagerClassTemplate<T>::does_key_exist(const HashedName &type_name) {
     // Lock read access.
     std::shared_lock<std::shared_mutex> lock(type_manager_shared_mutex);
 
@@ -101,21 +120,34 @@ bool ManagerClassTemplate<T>::does_key_exist(const std::string &type_name) {
 
 template <typename T>
 bool ManagerClassTemplate<T>::add_entry(const std::string &type_name, const std::shared_ptr<T> new_type) {
-    if (does_key_exist(type_name)) {
-        return false;
-    }
+    const HashedName hashed_type_name(type_name);
 
     // Lock write access.
     std::unique_lock<std::shared_mutex> lock(type_manager_shared_mutex);
 
-    // Add a new entry.
-    stored_types.insert({type_name, new_type});
+#ifndef NDEBUG
+    // Two names with the same hash would silently share one entry.
+    auto type_name_entry = type_names.find(hashed_type_name);
+
+    if (type_name_entry != type_names.end() && type_name_entry->second != type_name) {
+        throw std::runtime_error("Error: The names '" + type_name + "' and '" + type_name_entry->second + "' have the same hash!");
+    }
+#endif
+
+    // Add a new entry, unless the key already exists.
+    if (!stored_types.insert({hashed_type_name, new_type}).second) {
+        return false;
+    }
+
+#ifndef NDEBUG
+    type_names.insert({hashed_type_name, type_name});
+#endif
 
     return true;
 }
 
 template <typename T>
-bool ManagerClassTemplate<T>::update_entry(const std::string &type_name, const std::shared_ptr<T> new_type) {
+bool ManagerClassTemplate<T>::update_entry(const HashedName &type_name, const std::shared_ptr<T> new_type) {
     if (!does_key_exist(type_name)) {
         return false;
     }
@@ -130,17 +162,34 @@ bool ManagerClassTemplate<T>::update_entry(const std::string &type_name, const s
 }
 
 template <typename T>
-std::optional<std::shared_ptr<T>> ManagerClassTemplate<T>::get_entry(const std::string &type_name) {
-    if (does_key_exist(type_name)) {
-        // Lock read access.
-        std::shared_lock<std::shared_mutex> lock(type_manager_shared_mutex);
+std::optional<std::shared_ptr<T>> ManagerClassTemplate<T>::get_entry(const HashedName &type_name) {
+    // Lock read access.
+    std::shared_lock<std::shared_mutex> lock(type_manager_shared_mutex);
+
+    // Don't use operator[] here, it would insert the key under a read lock.
+    auto entry = stored_types.find(type_name);
+
+    if (entry == stored_types.end()) {
+        return std::nullopt;
+    }
+
+    return entry->second;
+}
 
-        auto return_value = stored_types[type_name];
+template <typename T>
+std::string ManagerClassTemplate<T>::get_key_name(const HashedName &type_name) {
+#ifndef NDEBUG
+    // Lock read access.
+    std::shared_lock<std::shared_mutex> lock(type_manager_shared_mutex);
 
-        return return_value;
+    auto type_name_entry = type_names.find(type_name);
+
+    if (type_name_entry != type_names.end()) {
+        return type_name_entry->second;
     }
+#endif
 
-    return std::nullopt;
+    return "#" + std::to_string(type_name.get_hash());
 }
 
 template <typename T>
@@ -202,7 +251,7 @@ std::vector<std::shared_ptr<T>> ManagerClassTemplate<T>::get_all_values() {
 }
 
 template <typename T>
-std::size_t ManagerClassTemplate<T>::delete_entry(const std::string &type_name) {
+std::size_t ManagerClassTemplate<T>::delete_entry(const HashedName &type_name) {
     if (!does_key_exist(type_name)) {
         return 0;
     }
@@ -212,6 +261,10 @@ std::size_t ManagerClassTemplate<T>::delete_entry(const std::string &type_name)
 
     std::size_t number_of_deleted_entries = stored_types.erase(type_name);
 
+#ifndef NDEBUG
+    type_names.erase(type_name);
+#endif
+
     return number_of_deleted_entries;
 }
 
@@ -221,5 +274,9 @@ void ManagerClassTemplate<T>::delete_all_entries() {
     std::unique_lock<std::shared_mutex> lock(type_manager_shared_mutex);
 
     stored_types.clear();
+
+#ifndef NDEBUG
+    type_names.clear();
+#endif
 }
 } // namespace inexor::vulkan_renderer
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <vma/vma_usage.h>
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief The subsystems whose memory usage is tracked separately.
+enum class MemoryTag { MESHES, TEXTURES, UNIFORMS, STAGING, COUNT };
+
+/// @brief How close the usage of a memory heap is to its budget.
+enum class MemoryPressure { NONE, SOFT, HARD };
+
+/// @brief The fractions of a heap's budget at which eviction starts.
+struct MemoryBudgetThresholds {
+    /// Above this fraction, the eviction handlers are asked to free memory which is cheap to recreate.
+    float soft = 0.8f;
+
+    /// Above this fraction, the eviction handlers are asked to free everything they can.
+    float hard = 0.95f;
+};
+
+/// @brief The memory usage and the budget of one memory heap, in bytes.
+struct HeapBudget {
+    /// The estimated usage of the whole process, including memory which was not allocated through VMA.
+    VkDeviceSize usage = 0;
+
+    /// The estimated amount of memory the process can use.
+    VkDeviceSize budget = 0;
+
+    /// The size of all memory blocks VMA allocated from the heap.
+    VkDeviceSize block_bytes = 0;
+
+    /// The size of all allocations in these blocks.
+    VkDeviceSize allocation_bytes = 0;
+
+    /// The bytes the eviction handlers have promised to free, which the usage doesn't show as freed yet.
+    VkDeviceSize pending_eviction_bytes = 0;
+
+    MemoryPressure pressure = MemoryPressure::NONE;
+};
+
+/// @brief Tracks the memory budget of every memory heap while the renderer is running.
+/// The budget is queried through VMA once per frame. VMA uses VK_EXT_memory_budget if the allocator was created with
+/// VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT, and estimates the budget from the heap sizes otherwise.
+/// If the usage of a heap goes over a threshold, the registered eviction handlers are called, the ones of the
+/// subsystem which uses the most memory first, until they have freed enough memory. This lets texture and mesh
+/// streaming degrade gracefully instead of failing an allocation. The memory is usually freed some frames later,
+/// so the bytes the handlers promised are not asked for again until the usage of the heap has dropped by them.
+/// @note This class is not thread safe.
+class MemoryBudgetTracker {
+public:
+    /// @brief Returns the number of bytes a subsystem currently uses.
+    using UsageProvider = std::function<VkDeviceSize()>;
+
+    /// @brief Frees memory of a subsystem.
+    /// The handler receives the heap which is over its threshold, the pressure, and the number of bytes which should be freed.
+    /// It returns the number of bytes it has freed, or will free once the GPU is done with them.
+    using EvictionHandler = std::function<VkDeviceSize(std::uint32_t heap_index, MemoryPressure pressure, VkDeviceSize bytes_to_free)>;
+
+private:
+    static constexpr std::size_t TAG_COUNT = static_cast<std::size_t>(MemoryTag::COUNT);
+
+    VmaAllocator vma_allocator = VK_NULL_HANDLE;
+
+    MemoryBudgetThresholds thresholds;
+
+    std::uint32_t frame_index = 0;
+
+    std::vector<HeapBudget> heap_budgets;
+
+    std::array<std::vector<UsageProvider>, TAG_COUNT> usage_providers;
+    std::array<std::vector<EvictionHandler>, TAG_COUNT> eviction_handlers;
+
+    std::array<VkDeviceSize, TAG_COUNT> tag_usages = {};
+
+    /// @brief Calls the eviction handlers for a heap which is over a threshold.
+    /// @return The number of bytes the handlers have freed or will free.
+    VkDeviceSize evict(std::uint32_t heap_index, MemoryPressure pressure, VkDeviceSize bytes_to_free);
+
+public:
+    /// @brief Creates a memory budget tracker.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param thresholds [in] The fractions of the budget at which eviction starts.
+    MemoryBudgetTracker(const VmaAllocator vma_allocator, const MemoryBudgetThresholds &thresholds = {});
+
+    MemoryBudgetTracker(const MemoryBudgetTracker &) = delete;
+    MemoryBudgetTracker &operator=(const MemoryBudgetTracker &) = delete;
+
+    ~MemoryBudgetTracker() = default;
+
+    /// @brief Returns the name of a tag for logging.
+    [[nodiscard]] static const char *get_tag_name(MemoryTag tag);
+
+    /// @brief Adds a function which reports the memory usage of a subsystem. A tag can have several providers.
+    void add_usage_provider(MemoryTag tag, UsageProvider provider);
+
+    /// @brief Adds a function which frees memory of a subsystem when a heap is over a threshold.
+    void add_eviction_handler(MemoryTag tag, EvictionHandler handler);
+
+    /// @brief Queries the budgets and the usage of every subsystem, and calls the eviction handlers if necessary.
+    /// This should be called once per frame. It advances VMA's frame index, which refreshes VMA's budget cache.
+    void update();
+
+    void set_thresholds(const MemoryBudgetThresholds &thresholds);
+
+    [[nodiscard]] const MemoryBudgetThresholds &get_thresholds() const {
+        return thresholds;
+    }
+
+    [[nodiscard]] const std::vector<HeapBudget> &get_heap_budgets() const {
+        return heap_budgets;
+    }
+
+    /// @brief Returns the memory usage of a subsystem as of the last update.
+    [[nodiscard]] VkDeviceSize get_tag_usage(MemoryTag tag) const {
+        assert(tag != MemoryTag::COUNT);
+        return tag_usages[static_cast<std::size_t>(tag)];
+    }
+
+    /// @brief Logs the budget of every heap and the usage of every subsystem.
+    void log_statistics() const;
+};
+
+} // namespace inexor::vulkan_renderer
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/frame_timeline.hpp"
+#include "inexor/vulkan-renderer/gpu_memory_buffer.hpp"
+#include "inexor/vulkan-renderer/upload_batcher.hpp"
+
+#include <spdlog/spdlog.h>
+#include <vma/vma_usage.h>
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief When the memory defragmenter runs and how much work a pass may do.
+struct MemoryDefragmenterSettings {
+    /// A defragmentation run starts once the fragmentation of device local memory is above this fraction.
+    float fragmentation_threshold = 0.3f;
+
+    /// The number of frames between two fragmentation checks while no run is active.
+    std::uint32_t check_interval = 300;
+
+    /// The number of frames which can use a buffer after it was replaced, so the old buffers are destroyed after that.
+    /// This is not needed if the defragmenter uses the frame timeline.
+    std::uint32_t frames_in_flight = 3;
+
+    /// The CPU time a pass should take, including the planning in VMA. The bytes per pass are adapted to it.
+    std::chrono::microseconds time_budget{500};
+
+    /// The number of bytes the first pass of a run may move.
+    VkDeviceSize initial_bytes_per_pass = 4 * 1024 * 1024;
+
+    VkDeviceSize min_bytes_per_pass = 256 * 1024;
+    VkDeviceSize max_bytes_per_pass = 64 * 1024 * 1024;
+
+    /// The number of allocations a pass may move.
+    std::uint32_t max_allocations_per_pass = 64;
+};
+
+struct MemoryDefragmenterStatistics {
+    std::uint64_t runs = 0;
+    std::uint64_t passes = 0;
+    std::uint64_t allocations_moved = 0;
+    VkDeviceSize bytes_moved = 0;
+    VkDeviceSize bytes_freed = 0;
+    std::uint64_t blocks_freed = 0;
+
+    /// The fragmentation of device local memory before and after the last run.
+    float fragmentation_before = 0.0f;
+    float fragmentation_after = 0.0f;
+};
+
+/// @brief Defragments device local buffer memory in the background, one small pass per frame.
+/// Every pass uses VMA's incremental defragmentation with a limit of bytes and allocations to move. VMA plans the
+/// moves and reserves their destinations, the buffers are recreated at the destinations, and the copies are recorded
+/// into the upload batcher. The source ranges and the old buffers stay valid until the frames which were recorded
+/// with the old buffers have finished, only then the pass is ended and the memory is given back to VMA. These frames
+/// are counted by the defragmenter, or tracked by the timeline of the queue which renders them, see use_frame_timeline().
+/// Whenever buffers were replaced, the relocation callback is called, so command buffers can be re-recorded.
+/// @note Only buffers which are filled through staging buffers can be moved, because the copies run on the GPU.
+/// Images are not moved, because VMA can't move images with optimal tiling by copying their memory.
+/// @note This class is not thread safe.
+class MemoryDefragmenter {
+public:
+    /// @brief Appends the buffers which may be moved.
+    using BufferProvider = std::function<void(std::vector<GPUMemoryBuffer *> &buffers)>;
+
+    /// @brief Called once the buffer handles of a pass have been replaced.
+    using RelocationCallback = std::function<void()>;
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator vma_allocator = VK_NULL_HANDLE;
+    UploadBatcher &upload_batcher;
+
+    MemoryDefragmenterSettings settings;
+
+    std::vector<BufferProvider> buffer_providers;
+    RelocationCallback relocation_callback;
+
+    std::uint64_t frame_index = 0;
+    std::uint64_t last_check_frame_index = 0;
+
+    /// A run consists of passes until a pass does not move anything.
+    bool run_active = false;
+
+    VkDeviceSize bytes_per_pass = 0;
+
+    /// The context of the pending pass. Every pass has a context of its own, because the moved allocations
+    /// must not be queried before vmaDefragmentationEnd, and the buffers need their new allocation infos.
+    VmaDefragmentationContext pass_context = VK_NULL_HANDLE;
+
+    /// Filled by VMA once the pass context has ended.
+    VmaDefragmentationStats pass_statistics = {};
+
+    /// The queue which renders the frames and its timeline, if the frame timeline is used.
+    VulkanFrameTimeline *frame_timeline = nullptr;
+    VkQueue frame_queue = VK_NULL_HANDLE;
+
+    std::uint64_t pass_frame_index = 0;
+
+    /// The value of the frame queue's timeline which is signaled by the last submission that might use the old buffers.
+    std::uint64_t pass_frame_value = 0;
+
+    UploadToken pass_copy_token = 0;
+
+    std::vector<GPUMemoryBuffer *> moved_buffers;
+    std::vector<VkBuffer> old_buffers;
+
+    MemoryDefragmenterStatistics statistics;
+
+    /// @brief Plans a pass, moves the buffers and records the copies.
+    void begin_pass();
+
+    /// @brief Ends the pending pass, gives the source ranges back to VMA and destroys the old buffers.
+    void end_pass();
+
+    /// @brief Checks if the frames which might use the old buffers of the pending pass have finished.
+    [[nodiscard]] bool are_pass_frames_finished();
+
+    void end_run();
+
+public:
+    /// @brief Creates a memory defragmenter.
+    /// @param device [in] The Vulkan device.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param upload_batcher [in] The upload batcher the copies are recorded into. It must submit to the queue
+    /// which renders the frames, so the copies are finished before the buffers are used.
+    /// @param settings [in] When the defragmenter runs and how much work a pass may do.
+    MemoryDefragmenter(const VkDevice device, const VmaAllocator vma_allocator, UploadBatcher &upload_batcher,
+                       const MemoryDefragmenterSettings &settings = {});
+
+    MemoryDefragmenter(const MemoryDefragmenter &) = delete;
+    MemoryDefragmenter &operator=(const MemoryDefragmenter &) = delete;
+
+    /// @brief Ends the pending pass. The device must be idle.
+    ~MemoryDefragmenter();
+
+    /// @brief Adds a function which appends buffers that may be moved. It is called at the start of every pass.
+    /// Only buffers with MemoryPlacement::DEVICE_LOCAL_STAGED are moved, others are skipped.
+    /// @warning The buffers must live until the pass has ended, see finish().
+    void add_buffer_provider(BufferProvider provider);
+
+    /// @brief Tracks the frames which might use the old buffers with the timeline of the queue which renders them,
+    /// instead of counting frames.
+    /// @param frame_timeline [in] The frame timeline.
+    /// @param frame_queue [in] The queue which renders the frames.
+    void use_frame_timeline(VulkanFrameTimeline &frame_timeline, VkQueue frame_queue);
+
+    /// @brief Sets the function which is called once the buffer handles of a pass have been replaced.
+    void set_relocation_callback(RelocationCallback callback) {
+        relocation_callback = std::move(callback);
+    }
+
+    /// @brief Ends the pending pass if its frames have finished, checks the fragmentation every few frames,
+    /// and begins the next pass of an active run. This should be called once per frame, after the frame was submitted.
+    void update();
+
+    /// @brief Ends the pending pass and the active run right away, for example before buffers are destroyed.
+    /// @warning The device must be idle.
+    void finish();
+
+    /// @brief Returns the fraction of free device local memory which is not part of the largest free range of its heap.
+    /// 0 means that the free memory of every heap is contiguous.
+    /// @note This traverses all of VMA's memory blocks, so it is called rarely.
+    [[nodiscard]] float calculate_fragmentation() const;
+
+    [[nodiscard]] const MemoryDefragmenterStatistics &get_statistics() const {
+        return statistics;
+    }
+
+    /// @brief Logs the statistics of all runs.
+    void log_statistics() const;
+};
+
+} // namespace inexor::vulkan_renderer
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/gpu_memory_buffer.hpp"
+#include "inexor/vulkan-renderer/offset_allocator.hpp"
+#include "inexor/vulkan-renderer/slot_map.hpp"
+#include "inexor/vulkan-renderer/upload_batcher.hpp"
+
+#include <spdlog/spdlog.h>
+#include <vma/vma_usage.h>
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief The part of a mesh arena's buffers which belongs to one mesh.
+struct MeshRange {
+    /// The firstVertex of vkCmdDraw, or the vertexOffset of vkCmdDrawIndexed.
+    std::uint32_t first_vertex = 0;
+    std::uint32_t vertex_count = 0;
+
+    /// The firstIndex of vkCmdDrawIndexed.
+    std::uint32_t first_index = 0;
+    std::uint32_t index_count = 0;
+};
+
+/// @brief The occupancy of a mesh arena's vertex buffer and index buffer, in vertices and indices.
+struct MeshArenaStatistics {
+    std::uint32_t mesh_count = 0;
+    OffsetAllocatorStatistics vertices;
+    OffsetAllocatorStatistics indices;
+};
+
+/// @brief Stores the vertices and indices of many meshes in one device local vertex buffer and one index buffer.
+/// Meshes are sub-allocated with an OffsetAllocator and become ranges of these buffers, so a frame binds the
+/// buffers once and draws every mesh with its firstVertex and firstIndex, instead of creating two buffers per mesh.
+/// All meshes of an arena have the same vertex structure, and indices are always 32 bit. Indices are relative
+/// to the first vertex of their mesh.
+/// @note This class is not thread safe.
+class MeshArena {
+private:
+    struct ArenaMesh {
+        OffsetAllocation vertex_allocation;
+        OffsetAllocation index_allocation;
+        MeshRange range;
+    };
+
+public:
+    using MeshHandle = SlotMap<ArenaMesh>::Handle;
+
+    /// @brief Called for every mesh whose range changed during defragmentation, for example to re-record command buffers.
+    using RelocationCallback = std::function<void(MeshHandle mesh, const MeshRange &new_range)>;
+
+private:
+    std::string name;
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator vma_allocator = VK_NULL_HANDLE;
+    UploadBatcher *upload_batcher = nullptr;
+
+    VkDeviceSize vertex_stride = 0;
+
+    MemoryPlacement memory_placement = MemoryPlacement::AUTOMATIC;
+
+    // The buffers are replaced during defragmentation, so they are not stored by value.
+    std::unique_ptr<GPUMemoryBuffer> vertex_buffer;
+    std::unique_ptr<GPUMemoryBuffer> index_buffer;
+
+    OffsetAllocator vertex_allocator;
+    OffsetAllocator index_allocator;
+
+    SlotMap<ArenaMesh> meshes;
+
+    RelocationCallback relocation_callback;
+
+    [[nodiscard]] std::unique_ptr<GPUMemoryBuffer> create_vertex_buffer() const;
+
+    [[nodiscard]] std::unique_ptr<GPUMemoryBuffer> create_index_buffer() const;
+
+    /// @brief Uploads data into one of the arena's buffers.
+    void upload(GPUMemoryBuffer &target_buffer, const VkDeviceSize target_offset, const void *data, const VkDeviceSize data_size);
+
+public:
+    /// @brief Creates a mesh arena and its buffers.
+    /// @param device [in] The Vulkan device.
+    /// @param upload_batcher [in] The upload batcher which uploads the meshes.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param name [in] The internal name of the arena.
+    /// @param vertex_stride [in] The size of the vertex structure in bytes.
+    /// @param vertex_capacity [in] The number of vertices the arena can store.
+    /// @param index_capacity [in] The number of indices the arena can store. No index buffer is created if this is 0.
+    /// @param memory_placement [in] Where the vertices and indices are stored. AUTOMATIC decides from the memory properties.
+    MeshArena(const VkDevice device, UploadBatcher &upload_batcher, const VmaAllocator vma_allocator, const std::string &name,
+              const VkDeviceSize vertex_stride, const std::uint32_t vertex_capacity, const std::uint32_t index_capacity, const MemoryPlacement memory_placement = MemoryPlacement::AUTOMATIC);
+
+    MeshArena(const MeshArena &) = delete;
+    MeshArena &operator=(const MeshArena &) = delete;
+
+    ~MeshArena() = default;
+
+    /// @brief Sub-allocates a mesh and records the upload of its data into the open batch of the upload batcher.
+    /// The mesh can be drawn by submissions after that batch.
+    /// @param mesh_name [in] The name of the mesh, only kept in debug builds.
+    /// @param vertices [in] The vertices, each vertex_stride bytes large.
+    /// @param vertex_count [in] The number of vertices.
+    /// @param indices [in] The indices, or nullptr if the mesh is not indexed.
+    /// @param index_count [in] The number of indices.
+    /// @return The handle of the mesh, or std::nullopt if the arena has no free range which is large enough.
+    [[nodiscard]] std::optional<MeshHandle> add_mesh(const std::string &mesh_name, const void *vertices, const std::uint32_t vertex_count,
+                                                     const std::uint32_t *indices = nullptr, const std::uint32_t index_count = 0);
+
+    /// @brief Frees the ranges of a mesh.
+    /// @warning The mesh must not be used by any pending submission.
+    void remove_mesh(MeshHandle mesh);
+
+    [[nodiscard]] bool contains_mesh(MeshHandle mesh) const {
+        return meshes.contains(mesh);
+    }
+
+    /// @brief Returns the ranges of a mesh.
+    [[nodiscard]] const MeshRange &get_mesh_range(MeshHandle mesh) const;
+
+    /// @brief Binds the vertex buffer, and the index buffer if there is one. This is needed once per command buffer.
+    void bind(VkCommandBuffer command_buffer) const;
+
+    /// @brief Draws a mesh. The arena's buffers must be bound.
+    void draw(VkCommandBuffer command_buffer, MeshHandle mesh, const std::uint32_t instance_count = 1) const;
+
+    /// @brief Sets the function which is called for every mesh which is moved by defragment().
+    void set_relocation_callback(RelocationCallback callback) {
+        relocation_callback = std::move(callback);
+    }
+
+    /// @brief Moves all meshes to the start of new buffers, so the free space becomes one contiguous block.
+    /// The relocation callback is called for every mesh whose range changed.
+    /// @return The number of meshes which were moved.
+    /// @warning The device must be idle, because the old buffers are destroyed.
+    std::uint32_t defragment();
+
+    [[nodiscard]] MeshArenaStatistics get_statistics() const;
+
+    /// @brief Returns the size of the arena's buffers in bytes.
+    [[nodiscard]] VkDeviceSize get_memory_size() const {
+        return vertex_buffer->get_allocation_info().size + (index_buffer ? index_buffer->get_allocation_info().size : 0);
+    }
+
+    /// @brief Appends the arena's buffers, for example to let the memory defragmenter move their allocations.
+    /// @warning The pointers are invalidated by defragment().
+    void get_gpu_memory_buffers(std::vector<GPUMemoryBuffer *> &buffers) {
+        buffers.push_back(vertex_buffer.get());
+        if (index_buffer) {
+            buffers.push_back(index_buffer.get());
+        }
+    }
+
+    [[nodiscard]] VkBuffer get_vertex_buffer() const {
+        return vertex_buffer->get_buffer();
+    }
+
+    [[nodiscard]] VkBuffer get_index_buffer() const {
+        return index_buffer ? index_buffer->get_buffer() : VK_NULL_HANDLE;
+    }
+};
+
+} // namespace inexor::vulkan_renderer
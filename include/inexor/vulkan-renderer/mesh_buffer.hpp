@@ -38,6 +38,11 @@ private:
     // Don't forget that index buffers are optional!
     bool index_buffer_available = false;
 
+    /// @brief Fills a buffer directly if it is host visible, or through a staging buffer otherwise.
+    static void upload(const VkDevice device, VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index,
+                       CommandBufferRecycler &command_buffer_recycler, const VmaAllocator vma_allocator, const std::string &name,
+                       GPUMemoryBuffer &target_buffer, void *data, const std::size_t data_size);
+
 public:
     // Delete the copy constructor so mesh buffers are move-only objects.
     MeshBuffer(const MeshBuffer &) = delete;
@@ -48,13 +53,18 @@ public:
     MeshBuffer &operator=(MeshBuffer &&) noexcept = default;
 
     /// @brief Creates a new vertex buffer and an associated index buffer.
-    MeshBuffer(const VkDevice device, VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index, const VmaAllocator vma_allocator,
-               const std::string &name, const VkDeviceSize size_of_vertex_structure, const std::size_t number_of_vertices, void *vertices,
-               const VkDeviceSize size_of_index_structure, const std::size_t number_of_indices, void *indices);
+    /// @param memory_placement [in] Where the vertices and indices are stored. AUTOMATIC decides from the memory properties.
+    MeshBuffer(const VkDevice device, VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index,
+               CommandBufferRecycler &command_buffer_recycler, const VmaAllocator vma_allocator, const std::string &name,
+               const VkDeviceSize size_of_vertex_structure, const std::size_t number_of_vertices, void *vertices, const VkDeviceSize size_of_index_structure,
+               const std::size_t number_of_indices, void *indices, const MemoryPlacement memory_placement = MemoryPlacement::AUTOMATIC);
 
     /// @brief Creates a vertex buffer without index buffer.
-    MeshBuffer(const VkDevice device, VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index, const VmaAllocator vma_allocator,
-               const std::string &name, const VkDeviceSize size_of_vertex_structure, const std::size_t number_of_vertices, void *vertices);
+    /// @param memory_placement [in] Where the vertices are stored. AUTOMATIC decides from the memory properties.
+    MeshBuffer(const VkDevice device, VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index,
+               CommandBufferRecycler &command_buffer_recycler, const VmaAllocator vma_allocator, const std::string &name,
+               const VkDeviceSize size_of_vertex_structure, const std::size_t number_of_vertices, void *vertices,
+               const MemoryPlacement memory_placement = MemoryPlacement::AUTOMATIC);
 
     ~MeshBuffer();
 
@@ -79,6 +89,15 @@ public:
         return number_of_indices;
     }
 
+    [[nodiscard]] MemoryPlacement get_memory_placement() const {
+        return vertex_buffer.get_memory_placement();
+    }
+
+    /// @brief Returns the size of the vertex buffer and the index buffer in bytes.
+    [[nodiscard]] VkDeviceSize get_memory_size() const {
+        return vertex_buffer.get_allocation_info().size + (index_buffer ? index_buffer.value().get_allocation_info().size : 0);
+    }
+
     // TODO: Update data!
     // void update_vertex_buffer();
     // void update_index_buffer();
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief An allocation of an OffsetAllocator.
+struct OffsetAllocation {
+    static constexpr std::uint32_t NO_SPACE = 0xFFFFFFFF;
+
+    std::uint32_t offset = NO_SPACE;
+
+    /// The internal node of the allocation, which is needed to free it.
+    std::uint32_t node = NO_SPACE;
+
+    [[nodiscard]] bool is_valid() const {
+        return offset != NO_SPACE;
+    }
+};
+
+/// @brief The occupancy of an OffsetAllocator.
+struct OffsetAllocatorStatistics {
+    std::uint32_t capacity = 0;
+    std::uint32_t used = 0;
+    std::uint32_t allocation_count = 0;
+    std::uint32_t free_block_count = 0;
+    std::uint32_t largest_free_block = 0;
+
+    /// @brief Returns the used fraction of the capacity.
+    [[nodiscard]] float get_occupancy() const {
+        return capacity > 0 ? static_cast<float>(used) / static_cast<float>(capacity) : 0.0f;
+    }
+
+    /// @brief Returns how much of the free space is not part of the largest free block.
+    /// 0 means all free space is contiguous.
+    [[nodiscard]] float get_fragmentation() const {
+        const std::uint32_t free_space = capacity - used;
+        return free_space > 0 ? 1.0f - static_cast<float>(largest_free_block) / static_cast<float>(free_space) : 0.0f;
+    }
+};
+
+/// @brief A two-level segregated fit (TLSF) allocator which hands out ranges of an address space, like parts of a buffer.
+/// It does not allocate any memory itself. Free blocks are sorted into size classes, with a bitmap of the non-empty
+/// classes, so allocate and free are O(1). Neighbouring free blocks are merged when an allocation is freed.
+/// The units are chosen by the owner, for example vertices or indices, so offsets never need to be aligned.
+/// @note This class is not thread safe.
+class OffsetAllocator {
+private:
+    // Each power of two size range is split into 16 linearly spaced size classes.
+    static constexpr std::uint32_t SECOND_LEVEL_LOG2 = 4;
+    static constexpr std::uint32_t SECOND_LEVEL_COUNT = 1u << SECOND_LEVEL_LOG2;
+
+    // Rounded up sizes can use up to 33 bits.
+    static constexpr std::uint32_t FIRST_LEVEL_COUNT = 33 - SECOND_LEVEL_LOG2 + 1;
+
+    static constexpr std::uint32_t NO_NODE = 0xFFFFFFFF;
+
+    struct Node {
+        std::uint32_t offset = 0;
+        std::uint32_t size = 0;
+
+        // The neighbouring blocks in the address space.
+        std::uint32_t previous_physical = NO_NODE;
+        std::uint32_t next_physical = NO_NODE;
+
+        // The neighbouring blocks in the free list of the size class.
+        std::uint32_t previous_free = NO_NODE;
+        std::uint32_t next_free = NO_NODE;
+
+        bool used = false;
+    };
+
+    std::uint32_t capacity = 0;
+    std::uint32_t used = 0;
+    std::uint32_t allocation_count = 0;
+    std::uint32_t free_block_count = 0;
+
+    std::vector<Node> nodes;
+
+    /// The indices of nodes which can be reused.
+    std::vector<std::uint32_t> unused_nodes;
+
+    /// One bit per first level which has a non-empty size class.
+    std::uint32_t first_level_bitmap = 0;
+
+    /// One bit per non-empty size class of each first level.
+    std::array<std::uint32_t, FIRST_LEVEL_COUNT> second_level_bitmaps{};
+
+    /// The first free block of each size class.
+    std::array<std::uint32_t, FIRST_LEVEL_COUNT * SECOND_LEVEL_COUNT> free_list_heads{};
+
+    /// @brief Returns the size class which contains a size.
+    static void map_size(std::uint64_t size, std::uint32_t &first_level, std::uint32_t &second_level);
+
+    /// @brief Returns the first size class which only contains blocks of at least the given size.
+    static void map_size_round_up(std::uint64_t size, std::uint32_t &first_level, std::uint32_t &second_level);
+
+    [[nodiscard]] std::uint32_t create_node(std::uint32_t offset, std::uint32_t size);
+
+    void release_node(std::uint32_t node_index);
+
+    void insert_free_node(std::uint32_t node_index);
+
+    void remove_free_node(std::uint32_t node_index);
+
+public:
+    /// @brief Creates an allocator with one free block of the given capacity.
+    /// @param capacity [in] The size of the address space, in units of the owner's choice.
+    explicit OffsetAllocator(std::uint32_t capacity);
+
+    /// @brief Allocates a range.
+    /// @param size [in] The size of the range, which must be greater than 0.
+    /// @return The allocation, which is invalid if there is no free block which is large enough.
+    [[nodiscard]] OffsetAllocation allocate(std::uint32_t size);
+
+    /// @brief Frees a range and merges it with its free neighbours.
+    /// @param allocation [in] A valid allocation of this allocator.
+    void free(OffsetAllocation allocation);
+
+    [[nodiscard]] std::uint32_t get_allocation_size(OffsetAllocation allocation) const {
+        assert(allocation.is_valid());
+        return nodes[allocation.node].size;
+    }
+
+    /// @brief Frees all allocations.
+    void reset();
+
+    [[nodiscard]] std::uint32_t get_capacity() const {
+        return capacity;
+    }
+
+    [[nodiscard]] OffsetAllocatorStatistics get_statistics() const;
+};
+
+} // namespace inexor::vulkan_renderer
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "inexor/vulkan-renderer/recycling_pools.hpp"
+
 #include <spdlog/spdlog.h>
 #include <vulkan/vulkan.h>
 
@@ -9,10 +11,12 @@
 namespace inexor::vulkan_renderer {
 
 /// @brief A OnceCommandBuffer is a command buffer which is being used only once.
+/// The command buffer and the fence which is waited on are taken from recycling pools, so no
+/// command pool is created or destroyed for it.
 class OnceCommandBuffer {
 private:
     VkDevice device = VK_NULL_HANDLE;
-    VkCommandPool command_pool = VK_NULL_HANDLE;
+    CommandBufferRecycler *command_buffer_recycler = nullptr;
     VkCommandBuffer command_buffer = VK_NULL_HANDLE;
     VkQueue data_transfer_queue = VK_NULL_HANDLE;
     std::uint32_t data_transfer_queue_family_index = 0;
@@ -32,7 +36,10 @@ public:
     /// @brief Creates a new commandbuffer which is being called only once.
     /// @param device [in] The Vulkan device.
     /// @param data_transfer_queue [in] The data transfer queue.
-    OnceCommandBuffer(const VkDevice device, const VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index);
+    /// @param data_transfer_queue_family_index [in] The queue family index of the data transfer queue.
+    /// @param command_buffer_recycler [in] The recycler the command buffer is taken from.
+    OnceCommandBuffer(const VkDevice device, const VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index,
+                      CommandBufferRecycler &command_buffer_recycler);
 
     ~OnceCommandBuffer();
 
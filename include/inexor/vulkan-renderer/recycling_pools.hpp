@@ -0,0 +1,181 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief How often a recycling pool could reuse an object (hit) or had to create a new one (miss).
+struct RecyclingPoolStatistics {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+};
+
+/// @brief A pool of fences which are reset and reused instead of being destroyed.
+/// @note This class is thread safe.
+class FencePool {
+private:
+    VkDevice device = VK_NULL_HANDLE;
+
+    /// Every fence which was created by this pool.
+    std::vector<VkFence> fences;
+
+    /// The unsignaled fences which can be acquired.
+    std::vector<VkFence> free_fences;
+
+    std::mutex fence_pool_mutex;
+
+    std::atomic<std::uint64_t> hits = 0;
+    std::atomic<std::uint64_t> misses = 0;
+
+public:
+    /// @brief Creates an empty fence pool.
+    /// @param device [in] The Vulkan device.
+    explicit FencePool(const VkDevice device);
+
+    FencePool(const FencePool &) = delete;
+    FencePool &operator=(const FencePool &) = delete;
+
+    /// @brief Destroys all fences. None of them may be in use.
+    ~FencePool();
+
+    /// @brief Returns an unsignaled fence.
+    [[nodiscard]] VkFence acquire();
+
+    /// @brief Resets a fence and returns it to the pool.
+    /// @param fence [in] A fence which was acquired from this pool and which is not used by any pending submission.
+    void release(VkFence fence);
+
+    [[nodiscard]] RecyclingPoolStatistics get_statistics() const;
+};
+
+/// @brief A pool of binary semaphores which are reused instead of being destroyed.
+/// @note This class is thread safe.
+class SemaphorePool {
+private:
+    VkDevice device = VK_NULL_HANDLE;
+
+    /// Every semaphore which was created by this pool.
+    std::vector<VkSemaphore> semaphores;
+
+    /// The unsignaled semaphores which can be acquired.
+    std::vector<VkSemaphore> free_semaphores;
+
+    std::mutex semaphore_pool_mutex;
+
+    std::atomic<std::uint64_t> hits = 0;
+    std::atomic<std::uint64_t> misses = 0;
+
+public:
+    /// @brief Creates an empty semaphore pool.
+    /// @param device [in] The Vulkan device.
+    explicit SemaphorePool(const VkDevice device);
+
+    SemaphorePool(const SemaphorePool &) = delete;
+    SemaphorePool &operator=(const SemaphorePool &) = delete;
+
+    /// @brief Destroys all semaphores. None of them may be in use.
+    ~SemaphorePool();
+
+    /// @brief Returns an unsignaled binary semaphore.
+    [[nodiscard]] VkSemaphore acquire();
+
+    /// @brief Returns a semaphore to the pool.
+    /// @param semaphore [in] A semaphore which was acquired from this pool. It must be unsignaled and must not
+    /// be used by any pending submission, for example because the submission which waited on it has finished.
+    void release(VkSemaphore semaphore);
+
+    [[nodiscard]] RecyclingPoolStatistics get_statistics() const;
+};
+
+/// @brief Hands out primary command buffers from one command pool per thread and queue family.
+/// Command pools must be externally synchronised, so every thread records into its own pools.
+/// Released command buffers are reset and reused. When a thread exits, its pools are handed to the next thread
+/// which needs a pool for the same queue family, so the worker threads which come and go with the threadpool
+/// don't leave their pools behind. The pools are only destroyed with the recycler.
+class CommandBufferRecycler {
+private:
+    struct ThreadCommandPool {
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+
+        /// The reset command buffers which can be acquired.
+        std::vector<VkCommandBuffer> free_command_buffers;
+    };
+
+    /// @brief The command pools, which are shared with the threads that use them, so a thread can hand its pools
+    /// back when it exits, even if that happens after the recycler was destroyed.
+    struct CommandPools {
+        /// The command pools by thread and queue family index. The nodes of a std::map are never moved,
+        /// so a thread can use its command pool without holding the lock.
+        std::map<std::pair<std::thread::id, std::uint32_t>, ThreadCommandPool> thread_command_pools;
+
+        /// The command pools of threads which have exited, by queue family index.
+        std::multimap<std::uint32_t, ThreadCommandPool> retired_command_pools;
+
+        std::mutex command_pools_mutex;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    FencePool &fence_pool;
+
+    std::shared_ptr<CommandPools> command_pools = std::make_shared<CommandPools>();
+
+    std::atomic<std::uint64_t> hits = 0;
+    std::atomic<std::uint64_t> misses = 0;
+    std::atomic<std::uint64_t> command_pool_count = 0;
+
+    /// @brief Returns the command pool of the calling thread for the queue family. If the thread has none yet,
+    /// it takes over the pool of a thread which has exited, or a new one is created.
+    [[nodiscard]] ThreadCommandPool &get_thread_command_pool(std::uint32_t queue_family_index);
+
+    /// @brief Moves the command pools of a thread which has exited to the retired command pools.
+    static void retire_thread_command_pools(CommandPools &command_pools, std::thread::id thread_id);
+
+public:
+    /// @brief Creates a command buffer recycler without any command pools.
+    /// @param device [in] The Vulkan device.
+    /// @param fence_pool [in] The fence pool which is used to wait for submissions of recycled command buffers.
+    CommandBufferRecycler(const VkDevice device, FencePool &fence_pool);
+
+    CommandBufferRecycler(const CommandBufferRecycler &) = delete;
+    CommandBufferRecycler &operator=(const CommandBufferRecycler &) = delete;
+
+    /// @brief Destroys all command pools. None of the command buffers may be in use.
+    ~CommandBufferRecycler();
+
+    /// @brief Returns a reset primary command buffer from the calling thread's command pool.
+    /// @param queue_family_index [in] The queue family the command buffer will be submitted to.
+    [[nodiscard]] VkCommandBuffer acquire(std::uint32_t queue_family_index);
+
+    /// @brief Resets a command buffer and returns it to the calling thread's command pool.
+    /// @param queue_family_index [in] The queue family index the command buffer was acquired for.
+    /// @param command_buffer [in] The command buffer, which must have been acquired by the calling thread
+    /// and which must not be used by any pending submission.
+    /// @note A thread must release all its command buffers before it exits.
+    void release(std::uint32_t queue_family_index, VkCommandBuffer command_buffer);
+
+    [[nodiscard]] FencePool &get_fence_pool() {
+        return fence_pool;
+    }
+
+    [[nodiscard]] RecyclingPoolStatistics get_statistics() const;
+
+    /// @brief Returns the number of command pools which have been created, at most one per thread and queue family.
+    [[nodiscard]] std::uint64_t get_command_pool_count() const {
+        return command_pool_count.load(std::memory_order_relaxed);
+    }
+};
+
+} // namespace inexor::vulkan_renderer
@@ -7,18 +7,28 @@
 #include "inexor/vulkan-renderer/error_handling.hpp"
 #include "inexor/vulkan-renderer/fence_manager.hpp"
 #include "inexor/vulkan-renderer/fps_counter.hpp"
+#include "inexor/vulkan-renderer/frame_timeline.hpp"
 #include "inexor/vulkan-renderer/gpu_info.hpp"
 #include "inexor/vulkan-renderer/gpu_queue_manager.hpp"
 #include "inexor/vulkan-renderer/image_buffer.hpp"
+#include "inexor/vulkan-renderer/allocation_statistics_stream.hpp"
+#include "inexor/vulkan-renderer/memory_budget_tracker.hpp"
+#include "inexor/vulkan-renderer/memory_defragmenter.hpp"
+#include "inexor/vulkan-renderer/mesh_arena.hpp"
 #include "inexor/vulkan-renderer/mesh_buffer.hpp"
 #include "inexor/vulkan-renderer/msaa_target.hpp"
 #include "inexor/vulkan-renderer/octree_vertex.hpp"
+#include "inexor/vulkan-renderer/recycling_pools.hpp"
+#include "inexor/vulkan-renderer/sampler_cache.hpp"
 #include "inexor/vulkan-renderer/semaphore_manager.hpp"
 #include "inexor/vulkan-renderer/settings_decision_maker.hpp"
 #include "inexor/vulkan-renderer/standard_ubo.hpp"
 #include "inexor/vulkan-renderer/texture.hpp"
+#include "inexor/vulkan-renderer/texture_streamer.hpp"
 #include "inexor/vulkan-renderer/time_step.hpp"
 #include "inexor/vulkan-renderer/uniform_buffer.hpp"
+#include "inexor/vulkan-renderer/uniform_ring_buffer.hpp"
+#include "inexor/vulkan-renderer/upload_batcher.hpp"
 
 // Those components have been refactored to fulfill RAII idioms.
 #include "inexor/vulkan-renderer/shader.hpp"
@@ -44,6 +54,15 @@ namespace inexor::vulkan_renderer {
 // TODO: Refactoring! That is triple buffering essentially!
 constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 3;
 
+// The size of the uniform data one frame can write into the uniform ring buffer.
+constexpr VkDeviceSize UNIFORM_RING_BUFFER_REGION_SIZE = 64 * 1024;
+
+// The number of vertices the octree mesh arena can store.
+constexpr std::uint32_t OCTREE_MESH_ARENA_VERTEX_CAPACITY = 1024 * 1024;
+
+// The size of the staging memory the upload batcher reuses for all uploads. Larger uploads get a staging buffer of their own.
+constexpr VkDeviceSize UPLOAD_BATCHER_STAGING_RING_SIZE = 64 * 1024 * 1024;
+
 class VulkanRenderer {
 protected:
     // We try to avoid inheritance here and prefer a composition pattern.
@@ -53,6 +72,33 @@ protected:
 
     std::shared_ptr<VulkanSemaphoreManager> semaphore_manager = std::make_shared<VulkanSemaphoreManager>();
 
+    std::shared_ptr<VulkanFrameTimeline> frame_timeline = std::make_shared<VulkanFrameTimeline>();
+
+    // The pools need the device, so they are created once the device exists.
+    std::unique_ptr<FencePool> fence_pool = nullptr;
+
+    std::unique_ptr<SemaphorePool> semaphore_pool = nullptr;
+
+    std::unique_ptr<CommandBufferRecycler> command_buffer_recycler = nullptr;
+
+    std::unique_ptr<UploadBatcher> upload_batcher = nullptr;
+
+    // Shares the samplers of all textures which use the same sampler state.
+    std::unique_ptr<SamplerCache> sampler_cache = nullptr;
+
+    // Streams assets on the data transfer queue while the graphics queue keeps rendering.
+    std::unique_ptr<UploadBatcher> transfer_upload_batcher = nullptr;
+
+    std::unique_ptr<MemoryBudgetTracker> memory_budget_tracker = nullptr;
+
+    std::unique_ptr<MemoryDefragmenter> memory_defragmenter = nullptr;
+
+    // Streams the mip levels of the textures within a budget of device memory, see -texture_streaming.
+    std::unique_ptr<TextureStreamer> texture_streamer = nullptr;
+
+    // Streams allocation events and statistics to a file, see -vma_statistics.
+    std::unique_ptr<AllocationStatisticsStream> allocation_statistics_stream = nullptr;
+
     std::shared_ptr<VulkanQueueManager> gpu_queue_manager = std::make_shared<VulkanQueueManager>();
 
     std::shared_ptr<VulkanGraphicsCardInfoViewer> gpu_info_manager = std::make_shared<VulkanGraphicsCardInfoViewer>();
@@ -105,13 +151,36 @@ protected:
 
     std::vector<VkCommandBuffer> command_buffers;
 
-    std::vector<std::shared_ptr<VkSemaphore>> image_available_semaphores;
+    /// The command buffers which use buffers that were moved since they were recorded. They are recorded again
+    /// before their next submission, once the previous submission of their swapchain image has finished.
+    std::vector<bool> command_buffers_outdated;
+
+    /// The descriptor sets which still use the old image view of a streamed texture. They are written again
+    /// before the command buffer of their swapchain image is recorded again.
+    std::vector<bool> texture_descriptors_outdated;
+
+    std::vector<SemaphoreHandle> image_available_semaphores;
+
+    std::vector<SemaphoreHandle> rendering_finished_semaphores;
+
+    std::vector<FenceHandle> in_flight_fences;
 
-    std::vector<std::shared_ptr<VkSemaphore>> rendering_finished_semaphores;
+    std::vector<VkFence> images_in_flight;
 
-    std::vector<std::shared_ptr<VkFence>> in_flight_fences;
+    /// Frames are synchronised with timeline semaphores instead of fences, see -timeline_semaphores.
+    bool frame_timeline_enabled = false;
 
-    std::vector<std::shared_ptr<VkFence>> images_in_flight;
+    /// The number of the frame which last rendered into each swapchain image, if the frame timeline is enabled.
+    std::vector<std::uint64_t> image_frame_numbers;
+
+    /// The number of the frame which last used the semaphores of each frame in flight, if the frame timeline is enabled.
+    std::vector<std::uint64_t> in_flight_frame_numbers;
+
+    /// VK_EXT_memory_budget is enabled, so VMA reports the budget of the driver instead of estimating it.
+    bool memory_budget_enabled = false;
+
+    /// The allocation statistics stream replaces VMA's recording, see -vma_statistics.
+    bool allocation_statistics_enabled = false;
 
     VkDebugReportCallbackEXT debug_report_callback = {};
 
@@ -153,8 +222,12 @@ protected:
 
     std::vector<Shader> shaders;
     std::vector<Texture> textures;
-    std::vector<UniformBuffer> uniform_buffers;
+    std::unique_ptr<UniformRingBuffer> uniform_ring_buffer = nullptr;
     std::vector<MeshBuffer> mesh_buffers;
+
+    // The octree geometry is stored in one vertex buffer and drawn with one bind per command buffer.
+    std::unique_ptr<MeshArena> octree_mesh_arena = nullptr;
+    std::vector<MeshArena::MeshHandle> octree_meshes;
     std::vector<Descriptor> descriptors;
 
     // TODO(Hanni): Remove this with RAII refactoring of descriptors!
@@ -171,7 +244,10 @@ protected:
 
     /// @brief Create a physical device handle.
     /// @param graphics_card The regarded graphics card.
-    VkResult create_physical_device(const VkPhysicalDevice &graphics_card, const bool enable_debug_markers = true);
+    /// @param enable_timeline_semaphores Enables VK_KHR_timeline_semaphore, which must be supported.
+    /// @param enable_memory_budget Enables VK_EXT_memory_budget, which must be supported.
+    VkResult create_physical_device(const VkPhysicalDevice &graphics_card, const bool enable_debug_markers = true,
+                                    const bool enable_timeline_semaphores = false, const bool enable_memory_budget = false);
 
     /// @brief Creates an instance of VulkanDebugMarkerManager
     VkResult initialise_debug_marker_manager(const bool enable_debug_markers = true);
@@ -190,6 +266,10 @@ protected:
     /// @brief Creates the command buffers.
     VkResult create_command_buffers();
 
+    /// @brief Records the command buffer of one swapchain image.
+    /// @param image_index [in] The index of the swapchain image. Its command buffer must not be in use.
+    VkResult record_command_buffer(const std::uint32_t image_index);
+
     /// @brief Records the command buffers.
     VkResult record_command_buffers();
 
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief How often the sampler cache could share a sampler (hit) or had to create a new one (miss).
+struct SamplerCacheStatistics {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+
+    /// The number of samplers which exist right now.
+    std::size_t samplers = 0;
+};
+
+/// @brief Shares samplers between all users which create them with the same state.
+/// The samplers are keyed by all fields of VkSamplerCreateInfo, and they are reference counted: a sampler is destroyed
+/// when its last user releases it. Drivers limit the number of samplers (maxSamplerAllocationCount), and textures
+/// and materials usually only use a handful of distinct sampler states.
+/// @note Create infos with a pNext chain are not supported, because the chained structures are not part of the key.
+/// @note This class is thread safe.
+class SamplerCache {
+private:
+    struct CreateInfoHash {
+        std::size_t operator()(const VkSamplerCreateInfo &create_info) const;
+    };
+
+    struct CreateInfoEqual {
+        bool operator()(const VkSamplerCreateInfo &lhs, const VkSamplerCreateInfo &rhs) const;
+    };
+
+    struct CachedSampler {
+        VkSamplerCreateInfo create_info = {};
+        std::uint32_t reference_count = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    PFN_vkCreateSampler create_sampler = nullptr;
+    PFN_vkDestroySampler destroy_sampler = nullptr;
+
+    std::unordered_map<VkSamplerCreateInfo, VkSampler, CreateInfoHash, CreateInfoEqual> samplers;
+    std::unordered_map<VkSampler, CachedSampler> cached_samplers;
+
+    mutable std::mutex sampler_cache_mutex;
+
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+
+public:
+    /// @brief Creates an empty sampler cache.
+    /// @param device [in] The Vulkan device.
+    /// @param create_sampler [in] The function which creates the samplers. It can be replaced to test the cache without a device.
+    /// @param destroy_sampler [in] The function which destroys the samplers.
+    explicit SamplerCache(const VkDevice device, PFN_vkCreateSampler create_sampler = vkCreateSampler,
+                          PFN_vkDestroySampler destroy_sampler = vkDestroySampler);
+
+    SamplerCache(const SamplerCache &) = delete;
+    SamplerCache &operator=(const SamplerCache &) = delete;
+
+    /// @brief Destroys all samplers. None of them may be in use.
+    ~SamplerCache();
+
+    /// @brief Returns a sampler with the given state, which is only created if the cache doesn't contain one yet.
+    /// Every sampler which was acquired must be released again.
+    /// @param create_info [in] The state of the sampler. sType and pNext are not part of the key.
+    /// @throws std::runtime_error if the sampler can't be created.
+    [[nodiscard]] VkSampler acquire(const VkSamplerCreateInfo &create_info);
+
+    /// @brief Releases a sampler, which is destroyed once all users have released it.
+    /// @param sampler [in] A sampler which was acquired from this cache and which is not used by any pending submission.
+    void release(VkSampler sampler);
+
+    [[nodiscard]] SamplerCacheStatistics get_statistics() const;
+};
+
+} // namespace inexor::vulkan_renderer
@@ -2,18 +2,24 @@
 
 #include "inexor/vulkan-renderer/debug_marker_manager.hpp"
 #include "inexor/vulkan-renderer/error_handling.hpp"
-#include "inexor/vulkan-renderer/manager_template.hpp"
+#include "inexor/vulkan-renderer/hashed_name.hpp"
+#include "inexor/vulkan-renderer/slot_map.hpp"
+#include "inexor/vulkan-renderer/snapshot_manager_template.hpp"
 
 #include <spdlog/spdlog.h>
 #include <vulkan/vulkan.h>
 
 #include <cassert>
 #include <mutex>
+#include <shared_mutex>
 
 namespace inexor::vulkan_renderer {
 
+/// @brief A handle to a semaphore which was created with VulkanSemaphoreManager::create_semaphore_handle.
+using SemaphoreHandle = SlotMap<VkSemaphore>::Handle;
+
 /// @brief VulkanSemaphoreManager
-class VulkanSemaphoreManager : public ManagerClassTemplate<VkSemaphore> {
+class VulkanSemaphoreManager : public SnapshotManagerClassTemplate<VkSemaphore> {
 private:
     bool semaphore_manager_initialised = false;
 
@@ -23,6 +29,15 @@ private:
 
     std::shared_ptr<VulkanDebugMarkerManager> debug_marker_manager;
 
+    /// The semaphores which are referenced by handle. Their names are only kept for debugging.
+    SlotMap<VkSemaphore> semaphores;
+
+    std::shared_mutex semaphores_mutex;
+
+    /// @brief Creates a Vulkan semaphore.
+    /// @param semaphore [out] The new semaphore.
+    VkResult create_vulkan_semaphore(VkSemaphore &semaphore);
+
 public:
     VulkanSemaphoreManager() = default;
 
@@ -36,7 +51,7 @@ public:
     /// @brief Checks if a semaphore with this name already exists.
     /// @param semaphore_name The name of the semaphore.
     /// @return True if a Vulkan semaphore with this name already exists, false otherwise.
-    [[nodiscard]] bool does_semaphore_exist(const std::string &semaphore_name);
+    [[nodiscard]] bool does_semaphore_exist(const HashedName &semaphore_name);
 
     /// @brief Creates a new Vulkan semaphore.
     /// @param device [in] The Vulkan device handle.
@@ -44,9 +59,23 @@ public:
     [[nodiscard]] std::optional<std::shared_ptr<VkSemaphore>> create_semaphore(const std::string &semaphore_name);
 
     /// @brief Gets a certain semaphore by name.
-    /// @param semaphore_name [in] The name of the semaphore.
+    /// @param semaphore_name [in] The name of the semaphore, preferably hashed at compile time.
     /// @return The acquired semaphore (if existent), std::nullopt otherwise.
-    [[nodiscard]] std::optional<std::shared_ptr<VkSemaphore>> get_semaphore(const std::string &semaphore_name);
+    [[nodiscard]] std::optional<std::shared_ptr<VkSemaphore>> get_semaphore(const HashedName &semaphore_name);
+
+    /// @brief Creates a new Vulkan semaphore which is referenced by handle instead of by name.
+    /// @param debug_name [in] The name of the semaphore, which is only kept in debug builds.
+    /// @return The handle of the semaphore, or std::nullopt if the semaphore could not be created.
+    [[nodiscard]] std::optional<SemaphoreHandle> create_semaphore_handle(const std::string &debug_name);
+
+    /// @brief Gets a semaphore by handle in O(1).
+    /// @param semaphore_handle [in] The handle of the semaphore.
+    /// @return The semaphore, or VK_NULL_HANDLE if the handle is stale.
+    [[nodiscard]] VkSemaphore get_semaphore(SemaphoreHandle semaphore_handle);
+
+    /// @brief Destroys a semaphore which was created by handle.
+    /// @param semaphore_handle [in] The handle of the semaphore.
+    void destroy_semaphore(SemaphoreHandle semaphore_handle);
 
     /// @brief Destroys all existing semaphores.
     /// @param device [in] The Vulkan device.
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief A container which stores its values densely and returns 32 bit generational handles to them.
+/// Lookups by handle are O(1) and do not hash anything. When a value is erased, the generation of its slot
+/// is increased, so handles to erased values are detected as stale instead of returning another value.
+/// Names can be attached to values for debugging, they are only stored in debug builds.
+/// @note This container is not thread safe, the owner has to synchronise access.
+template <typename T>
+class SlotMap {
+private:
+    // A handle stores the index of its slot in the lower bits and the generation of the slot in the upper bits.
+    static constexpr std::uint32_t INDEX_BITS = 20;
+    static constexpr std::uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr std::uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    // The highest slot index is never used, so no valid handle equals the invalid handle.
+    static constexpr std::uint32_t MAX_SLOT_COUNT = INDEX_MASK;
+
+    static constexpr std::uint32_t NO_FREE_SLOT = 0xFFFFFFFF;
+
+public:
+    /// @brief A 32 bit generational handle to a value of a SlotMap.
+    class Handle {
+    private:
+        friend class SlotMap;
+
+        static constexpr std::uint32_t INVALID_VALUE = 0xFFFFFFFF;
+
+        std::uint32_t value = INVALID_VALUE;
+
+        Handle(std::uint32_t index, std::uint32_t generation) : value((generation << INDEX_BITS) | index) {}
+
+    public:
+        /// @brief Creates an invalid handle.
+        Handle() = default;
+
+        [[nodiscard]] bool is_valid() const {
+            return value != INVALID_VALUE;
+        }
+
+        [[nodiscard]] std::uint32_t get_index() const {
+            return value & INDEX_MASK;
+        }
+
+        [[nodiscard]] std::uint32_t get_generation() const {
+            return value >> INDEX_BITS;
+        }
+
+        /// @brief Returns the raw 32 bit value, for example to use the handle as a key.
+        [[nodiscard]] std::uint32_t get_value() const {
+            return value;
+        }
+
+        bool operator==(const Handle &other) const {
+            return value == other.value;
+        }
+
+        bool operator!=(const Handle &other) const {
+            return value != other.value;
+        }
+    };
+
+private:
+    struct Slot {
+        /// The index of the value in the dense storage, or the index of the next free slot if the slot is free.
+        std::uint32_t dense_index = NO_FREE_SLOT;
+
+        std::uint32_t generation = 0;
+    };
+
+    std::vector<Slot> slots;
+
+    /// The values, stored without gaps.
+    std::vector<T> values;
+
+    /// The slot index of every value, so the slot can be updated when a value is moved.
+    std::vector<std::uint32_t> value_slots;
+
+#ifndef NDEBUG
+    /// The debug name of every value.
+    std::vector<std::string> debug_names;
+#endif
+
+    /// The first slot of the list of free slots.
+    std::uint32_t free_slot_head = NO_FREE_SLOT;
+
+    /// @brief Returns the dense index of a value, or NO_FREE_SLOT if the handle is stale or invalid.
+    [[nodiscard]] std::uint32_t find_dense_index(Handle handle) const {
+        if (!handle.is_valid() || handle.get_index() >= slots.size()) {
+            return NO_FREE_SLOT;
+        }
+
+        const Slot &slot = slots[handle.get_index()];
+
+        if (slot.generation != handle.get_generation()) {
+            return NO_FREE_SLOT;
+        }
+
+        return slot.dense_index;
+    }
+
+public:
+    SlotMap() = default;
+
+    /// @brief Inserts a value.
+    /// @param value [in] The value to insert.
+    /// @param debug_name [in] The name of the value, only stored in debug builds.
+    /// @return The handle of the value.
+    Handle insert(T value, const std::string &debug_name = "") {
+        std::uint32_t slot_index = free_slot_head;
+
+        if (slot_index == NO_FREE_SLOT) {
+            if (slots.size() >= MAX_SLOT_COUNT) {
+                throw std::runtime_error("Error: Slot map is full!");
+            }
+
+            slot_index = static_cast<std::uint32_t>(slots.size());
+            slots.emplace_back();
+        } else {
+            free_slot_head = slots[slot_index].dense_index;
+        }
+
+        Slot &slot = slots[slot_index];
+        slot.dense_index = static_cast<std::uint32_t>(values.size());
+
+        values.push_back(std::move(value));
+        value_slots.push_back(slot_index);
+
+#ifndef NDEBUG
+        debug_names.push_back(debug_name);
+#endif
+
+        return Handle(slot_index, slot.generation);
+    }
+
+    /// @brief Erases a value. The handle and all copies of it become stale.
+    /// @param handle [in] The handle of the value.
+    /// @return True if the value was erased, false if the handle was stale or invalid.
+    bool erase(Handle handle) {
+        const std::uint32_t dense_index = find_dense_index(handle);
+
+        if (dense_index == NO_FREE_SLOT) {
+            return false;
+        }
+
+        // Move the last value into the gap, so the values stay dense.
+        const std::uint32_t last_dense_index = static_cast<std::uint32_t>(values.size() - 1);
+
+        if (dense_index != last_dense_index) {
+            values[dense_index] = std::move(values[last_dense_index]);
+            value_slots[dense_index] = value_slots[last_dense_index];
+            slots[value_slots[dense_index]].dense_index = dense_index;
+
+#ifndef NDEBUG
+            debug_names[dense_index] = std::move(debug_names[last_dense_index]);
+#endif
+        }
+
+        values.pop_back();
+        value_slots.pop_back();
+
+#ifndef NDEBUG
+        debug_names.pop_back();
+#endif
+
+        Slot &slot = slots[handle.get_index()];
+
+        slot.generation = (slot.generation + 1) & GENERATION_MASK;
+        slot.dense_index = free_slot_head;
+        free_slot_head = handle.get_index();
+
+        return true;
+    }
+
+    /// @brief Returns a pointer to a value, or nullptr if the handle is stale or invalid.
+    [[nodiscard]] T *get(Handle handle) {
+        const std::uint32_t dense_index = find_dense_index(handle);
+        return dense_index == NO_FREE_SLOT ? nullptr : &values[dense_index];
+    }
+
+    /// @brief Returns a pointer to a value, or nullptr if the handle is stale or invalid.
+    [[nodiscard]] const T *get(Handle handle) const {
+        const std::uint32_t dense_index = find_dense_index(handle);
+        return dense_index == NO_FREE_SLOT ? nullptr : &values[dense_index];
+    }
+
+    /// @brief Checks if the handle refers to a value which has not been erased.
+    [[nodiscard]] bool contains(Handle handle) const {
+        return find_dense_index(handle) != NO_FREE_SLOT;
+    }
+
+    /// @brief Returns the debug name of a value.
+    /// @return The name, or an empty string in release builds or if the handle is stale or invalid.
+    [[nodiscard]] std::string get_debug_name(Handle handle) const {
+#ifndef NDEBUG
+        const std::uint32_t dense_index = find_dense_index(handle);
+
+        if (dense_index != NO_FREE_SLOT) {
+            return debug_names[dense_index];
+        }
+#endif
+        return "";
+    }
+
+    /// @brief Erases all values. All handles become stale.
+    void clear() {
+        for (std::uint32_t slot_index : value_slots) {
+            Slot &slot = slots[slot_index];
+
+            slot.generation = (slot.generation + 1) & GENERATION_MASK;
+            slot.dense_index = free_slot_head;
+            free_slot_head = slot_index;
+        }
+
+        values.clear();
+        value_slots.clear();
+
+#ifndef NDEBUG
+        debug_names.clear();
+#endif
+    }
+
+    void reserve(std::size_t capacity) {
+        slots.reserve(capacity);
+        values.reserve(capacity);
+        value_slots.reserve(capacity);
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return values.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return values.empty();
+    }
+
+    // The values can be iterated like a std::vector. The order changes when values are erased.
+    auto begin() {
+        return values.begin();
+    }
+
+    auto end() {
+        return values.end();
+    }
+
+    auto begin() const {
+        return values.begin();
+    }
+
+    auto end() const {
+        return values.end();
+    }
+
+    /// @brief Calls a function with the handle and the value of every value.
+    /// @param function [in] A function which takes a Handle and a T &. It must not insert or erase values.
+    template <typename Function>
+    void for_each(Function function) {
+        for (std::uint32_t dense_index = 0; dense_index < values.size(); dense_index++) {
+            const std::uint32_t slot_index = value_slots[dense_index];
+            function(Handle(slot_index, slots[slot_index].generation), values[dense_index]);
+        }
+    }
+};
+
+} // namespace inexor::vulkan_renderer
@@ -0,0 +1,248 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/hashed_name.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief A read optimised variant of ManagerClassTemplate with the same interface.
+/// Every write copies the map, modifies the copy and publishes it as a new immutable snapshot.
+/// Readers do not take any lock, they only look up the current snapshot. This is a good fit for
+/// managers like the fence and semaphore managers, which are written during setup but read every frame.
+/// A write waits until no reader uses the replaced snapshot anymore and frees it right away.
+template <typename T>
+class SnapshotManagerClassTemplate {
+private:
+    using Snapshot = std::unordered_map<HashedName, std::shared_ptr<T>>;
+
+    /// The snapshot readers look up. It is never modified once it has been published.
+    std::atomic<const Snapshot *> current_snapshot = nullptr;
+
+    /// Owns the current snapshot.
+    std::unique_ptr<const Snapshot> current_snapshot_owner;
+
+    /// Readers register in the reader count of the current epoch.
+    /// A writer advances the epoch and waits for the readers of the previous epoch to finish.
+    std::atomic<std::size_t> epoch = 0;
+
+    /// The number of readers in flight for even and odd epochs.
+    std::array<std::atomic<std::size_t>, 2> reader_counts{};
+
+    /// Serialises writers, readers never take this lock.
+    std::mutex writer_mutex;
+
+#ifndef NDEBUG
+    /// The names of the keys, for error messages and to detect hash collisions. Protected by writer_mutex.
+    std::unordered_map<HashedName, std::string> type_names;
+#endif
+
+    /// @brief Calls a function with the current snapshot, while it is protected from being freed.
+    template <typename Function>
+    auto read_snapshot(Function &&function) {
+        // The increment must be visible before the snapshot is loaded, otherwise a writer could
+        // free the snapshot in between. All operations are sequentially consistent for this reason.
+        auto &reader_count = reader_counts[epoch.load(std::memory_order_seq_cst) % 2];
+
+        reader_count.fetch_add(1, std::memory_order_seq_cst);
+
+        struct ReaderGuard {
+            std::atomic<std::size_t> &reader_count;
+            ~ReaderGuard() {
+                reader_count.fetch_sub(1, std::memory_order_seq_cst);
+            }
+        } reader_guard{reader_count};
+
+        const Snapshot *snapshot = current_snapshot.load(std::memory_order_seq_cst);
+
+        return function(*snapshot);
+    }
+
+    /// @brief Publishes a modified copy of the current snapshot.
+    /// @param modify [in] Modifies the copy, returns false if nothing should be published.
+    /// @return The return value of modify.
+    template <typename Function>
+    bool write_snapshot(Function &&modify) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+
+        auto new_snapshot = std::make_unique<Snapshot>(*current_snapshot_owner);
+
+        if (!modify(*new_snapshot)) {
+            return false;
+        }
+
+        current_snapshot.store(new_snapshot.get(), std::memory_order_seq_cst);
+
+        // Readers which start from now on will see the new snapshot. The epoch is advanced twice, so every reader
+        // which might have loaded the old snapshot is waited for, even if it read the epoch before the last write.
+        // New readers register in the other reader count, so the waits end after a few nanoseconds.
+        for (int i = 0; i < 2; i++) {
+            const std::size_t previous_epoch = epoch.fetch_add(1, std::memory_order_seq_cst);
+
+            while (reader_counts[previous_epoch % 2].load(std::memory_order_seq_cst) != 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        // Nobody can use the old snapshot anymore.
+        current_snapshot_owner = std::move(new_snapshot);
+
+        return true;
+    }
+
+protected:
+    SnapshotManagerClassTemplate() : current_snapshot_owner(std::make_unique<const Snapshot>()) {
+        current_snapshot.store(current_snapshot_owner.get());
+    }
+
+    ~SnapshotManagerClassTemplate() = default;
+
+    SnapshotManagerClassTemplate(const SnapshotManagerClassTemplate &) = delete;
+    SnapshotManagerClassTemplate &operator=(const SnapshotManagerClassTemplate &) = delete;
+
+    /// @brief Checks if a value exists by given key.
+    /// @param type_name [in] The name of the type (the key).
+    /// @return True if the value exists, false otherwise.
+    bool does_key_exist(const HashedName &type_name) {
+        return read_snapshot([&](const Snapshot &snapshot) { return snapshot.find(type_name) != snapshot.end(); });
+    }
+
+    /// @brief Adds a new type to the type map.
+    /// @param type_name [in] The name of the new type (the key).
+    /// @param new_type [in] The new type (the value).
+    /// @note In debug builds, an exception is thrown if the hash of the name collides with another name.
+    /// @return True if adding the type was successful, false if the key already exists.
+    bool add_entry(const std::string &type_name, const std::shared_ptr<T> new_type) {
+        const HashedName hashed_type_name(type_name);
+
+        return write_snapshot([&](Snapshot &snapshot) {
+#ifndef NDEBUG
+            // Two names with the same hash would silently share one entry.
+            auto type_name_entry = type_names.find(hashed_type_name);
+
+            if (type_name_entry != type_names.end() && type_name_entry->second != type_name) {
+                throw std::runtime_error("Error: The names '" + type_name + "' and '" + type_name_entry->second + "' have the same hash!");
+            }
+#endif
+
+            if (!snapshot.insert({hashed_type_name, new_type}).second) {
+                return false;
+            }
+
+#ifndef NDEBUG
+            type_names.insert({hashed_type_name, type_name});
+#endif
+            return true;
+        });
+    }
+
+    /// @brief Updates the value of a type.
+    /// @param type_name [in] The name of the type (the key).
+    /// @param new_type [in] The new type (the value).
+    /// @return True of the value could be updated, false if the key doesn't exist.
+    bool update_entry(const HashedName &type_name, const std::shared_ptr<T> new_type) {
+        return write_snapshot([&](Snapshot &snapshot) {
+            auto entry = snapshot.find(type_name);
+
+            if (entry == snapshot.end()) {
+                return false;
+            }
+
+            entry->second = new_type;
+            return true;
+        });
+    }
+
+    /// @brief Returns a type (value) by given name (key).
+    /// @param type_name [in] The name of the type (the key).
+    /// @return An std::optional shared pointer of the type (the value).
+    std::optional<std::shared_ptr<T>> get_entry(const HashedName &type_name) {
+        return read_snapshot([&](const Snapshot &snapshot) -> std::optional<std::shared_ptr<T>> {
+            auto entry = snapshot.find(type_name);
+
+            if (entry == snapshot.end()) {
+                return std::nullopt;
+            }
+
+            return entry->second;
+        });
+    }
+
+    /// @brief Returns the name of a key for error messages.
+    /// @param type_name [in] The name of the type (the key).
+    /// @return The name in debug builds, the hash in release builds.
+    std::string get_key_name(const HashedName &type_name) {
+#ifndef NDEBUG
+        std::lock_guard<std::mutex> lock(writer_mutex);
+
+        auto type_name_entry = type_names.find(type_name);
+
+        if (type_name_entry != type_names.end()) {
+            return type_name_entry->second;
+        }
+#endif
+
+        return "#" + std::to_string(type_name.get_hash());
+    }
+
+    /// @brief Returns the number of types available.
+    std::size_t get_entry_count() {
+        return read_snapshot([](const Snapshot &snapshot) { return snapshot.size(); });
+    }
+
+    /// @brief Returns all values.
+    /// @return A std::vector of shared pointers of the values.
+    std::vector<std::shared_ptr<T>> get_all_values() {
+        return read_snapshot([](const Snapshot &snapshot) {
+            std::vector<std::shared_ptr<T>> all_values;
+            all_values.reserve(snapshot.size());
+
+            for (const auto &entry : snapshot) {
+                all_values.push_back(entry.second);
+            }
+
+            return all_values;
+        });
+    }
+
+    /// @brief Deletes a certain type by name (key).
+    /// @param type_name [in] The name of the type to delete.
+    /// @return The number of deleted types.
+    std::size_t delete_entry(const HashedName &type_name) {
+        std::size_t number_of_deleted_entries = 0;
+
+        write_snapshot([&](Snapshot &snapshot) {
+            number_of_deleted_entries = snapshot.erase(type_name);
+
+#ifndef NDEBUG
+            type_names.erase(type_name);
+#endif
+            return number_of_deleted_entries > 0;
+        });
+
+        return number_of_deleted_entries;
+    }
+
+    /// @brief Deletes all types.
+    void delete_all_entries() {
+        write_snapshot([&](Snapshot &snapshot) {
+            snapshot.clear();
+
+#ifndef NDEBUG
+            type_names.clear();
+#endif
+            return true;
+        });
+    }
+};
+
+} // namespace inexor::vulkan_renderer
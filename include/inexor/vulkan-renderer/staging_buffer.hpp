@@ -29,17 +29,20 @@ public:
     /// @brief Creates a new staging buffer.
     /// @param device [in] The Vulkan device from which the buffer will be created.
     /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param command_buffer_recycler [in] The recycler the command buffer for copying is taken from.
     /// @param name [in] The internal name of the buffer.
     /// @param data [in] The address of the data which will be copied.
     /// @param size [in] The size of the buffer in bytes.
     /// @note Staging buffers always have VK_BUFFER_USAGE_TRANSFER_SRC_BIT as VkBufferUsageFlags.
     /// @note Staging buffers always have VMA_MEMORY_USAGE_CPU_ONLY as VmaMemoryUsage.
     StagingBuffer(const VkDevice device, const VmaAllocator vma_allocator, const VkQueue data_transfer_queue,
-                  const std::uint32_t data_transfer_queueu_family_index, const std::string &name, const VkDeviceSize buffer_size, void *data,
-                  const std::size_t data_size);
+                  const std::uint32_t data_transfer_queueu_family_index, CommandBufferRecycler &command_buffer_recycler, const std::string &name,
+                  const VkDeviceSize buffer_size, void *data, const std::size_t data_size);
 
-    ///
-    void upload_data_to_gpu(const GPUMemoryBuffer &target_buffer);
+    /// @brief Copies the data of the staging buffer into another buffer and waits until the copy has finished.
+    /// @param target_buffer [in] The buffer to copy the data into.
+    /// @param target_offset [in] The offset in bytes at which the data is written into the target buffer.
+    void upload_data_to_gpu(const GPUMemoryBuffer &target_buffer, const VkDeviceSize target_offset = 0);
 
     ~StagingBuffer() = default;
 };
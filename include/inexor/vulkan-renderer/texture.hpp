@@ -1,13 +1,17 @@
 #pragma once
 
+#include "inexor/vulkan-renderer/compressed_texture_file.hpp"
 #include "inexor/vulkan-renderer/gpu_memory_buffer.hpp"
-#include "inexor/vulkan-renderer/once_command_buffer.hpp"
-#include "inexor/vulkan-renderer/staging_buffer.hpp"
+#include "inexor/vulkan-renderer/sampler_cache.hpp"
+#include "inexor/vulkan-renderer/texture_file.hpp"
+#include "inexor/vulkan-renderer/upload_batcher.hpp"
 
 #include <vulkan/vulkan.h>
 
 #include <cassert>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
@@ -20,7 +24,31 @@ namespace inexor::vulkan_renderer {
 
 // TODO: 3D textures and cube maps.
 // TODO: Scan asset directory automatically.
-// TODO: Create multiple textures from file and submit them in 1 command buffer for performance reasons.
+
+/// @brief How the mip levels of a texture are generated.
+enum class MipmapGeneration {
+    /// The texture only has its full resolution level.
+    NONE,
+
+    /// The mip levels are blitted on the GPU if the format supports linear filtering of blits, otherwise they are generated on the CPU.
+    AUTOMATIC,
+
+    /// The mip levels are generated on the CPU with a box filter and uploaded together with the texture.
+    CPU
+};
+
+// Streamed textures start with the mip levels which are at most this many texels wide and high.
+constexpr int TEXTURE_STREAMING_INITIAL_SIZE = 64;
+
+/// @brief The image of a streamed texture which was replaced by a residency change.
+/// It must be destroyed with Texture::destroy_retired_image() once no frame uses it anymore.
+struct RetiredTextureImage {
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator vma_allocator = VK_NULL_HANDLE;
+    VkImage image = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    VkImageView image_view = VK_NULL_HANDLE;
+};
 
 class Texture {
 private:
@@ -31,10 +59,15 @@ private:
     int texture_channels = 0;
     int mip_levels = 0;
 
+    MipmapGeneration mipmap_generation = MipmapGeneration::AUTOMATIC;
+
     VkDevice device = VK_NULL_HANDLE;
     VkPhysicalDevice graphics_card = VK_NULL_HANDLE;
-    VkQueue data_transfer_queue = VK_NULL_HANDLE;
-    std::uint32_t data_transfer_queue_family_index = 0;
+    UploadBatcher *upload_batcher = nullptr;
+    SamplerCache *sampler_cache = nullptr;
+
+    /// The token of the batch which uploads the texture data.
+    UploadToken upload_token = 0;
 
     VmaAllocator vma_allocator = VK_NULL_HANDLE;
     VmaAllocation allocation;
@@ -45,18 +78,70 @@ private:
     VkSampler sampler = VK_NULL_HANDLE;
     VkFormat texture_image_format = VK_FORMAT_R8G8B8A8_UNORM;
 
-    OnceCommandBuffer copy_command_buffer;
+    /// A streamed texture keeps the data of all mip levels in host memory, and its image only contains the levels from the resident mip level on.
+    bool streamed = false;
+    std::uint32_t resident_mip_level = 0;
 
-    ///
-    void create_texture(void *texture_data, const std::size_t texture_size);
+    /// The coarser levels from this one on are always resident.
+    std::uint32_t initial_mip_level = 0;
+
+    std::vector<std::uint8_t> streaming_data;
+    std::vector<VkBufferImageCopy> streaming_regions;
+
+    /// The image of a residency change, which replaces the image of the texture once its upload has finished.
+    VkImage pending_image = VK_NULL_HANDLE;
+    VmaAllocation pending_allocation = VK_NULL_HANDLE;
+    VmaAllocationInfo pending_allocation_info = {};
+    VkImageView pending_image_view = VK_NULL_HANDLE;
+    std::uint32_t pending_mip_level = 0;
+    UploadToken pending_upload_token = 0;
+
+    /// @brief Creates an image with the format of the texture, which contains the mip levels from a mip level on.
+    /// @param usage [in] The usage of the image.
+    /// @param first_mip_level [in] The mip level of the texture which becomes the first mip level of the image.
+    /// @param image [out] The image.
+    /// @param allocation [out] The allocation of the image.
+    /// @param allocation_info [out] The allocation info of the image.
+    VkResult create_image(VkImageUsageFlags usage, std::uint32_t first_mip_level, VkImage &image, VmaAllocation &allocation,
+                          VmaAllocationInfo &allocation_info);
+
+    /// @brief Creates the image with the size, the resident mip levels and the format of the texture.
+    void create_image(VkImageUsageFlags usage);
+
+    /// @brief Creates a view of all mip levels of an image which was created with create_image().
+    VkResult create_image_view(VkImage image, std::uint32_t first_mip_level, VkImageView &image_view) const;
+
+    /// @brief Returns the first mip level which is at most TEXTURE_STREAMING_INITIAL_SIZE texels wide and high.
+    [[nodiscard]] std::uint32_t calculate_initial_mip_level() const;
+
+    /// @brief Uploads the mip levels from a mip level on into an image which was created with create_image().
+    /// @param image [in] The image.
+    /// @param first_mip_level [in] The mip level of the texture which is the first mip level of the image.
+    /// @param data [in] The data of all mip levels of the texture.
+    /// @param size [in] The size of the data in bytes.
+    /// @param regions [in] The copy regions of all mip levels of the texture, ordered by mip level and offset.
+    /// @return The token of the batch which uploads the mip levels.
+    UploadToken upload_mip_levels(VkImage image, std::uint32_t first_mip_level, const std::uint8_t *data, std::size_t size,
+                                  const std::vector<VkBufferImageCopy> &regions);
 
     ///
-    void transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout);
+    void create_texture(const void *texture_data, const std::size_t texture_size);
+
+    /// @brief Creates the texture from the mip levels of a compressed texture file, which are copied without decoding them.
+    void create_compressed_texture(const CompressedTextureFile &texture_file);
+
+    /// @brief Checks if the texture format supports blits with linear filtering with optimal tiling.
+    [[nodiscard]] bool supports_linear_blit() const;
+
+    /// @brief Records blits from every mip level into the next one, and transitions all levels to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+    /// @param command_buffer [in] The command buffer, which must support graphics operations.
+    /// @param image [in] The image, whose mip levels are all in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL.
+    static void record_mip_level_blits(VkCommandBuffer command_buffer, VkImage image, std::int32_t width, std::int32_t height, std::uint32_t mip_levels);
 
     ///
     void create_texture_image_view();
 
-    ///
+    /// @brief Acquires the sampler of the texture from the sampler cache.
     void create_texture_sampler();
 
 public:
@@ -68,16 +153,37 @@ public:
     Texture &operator=(const Texture &) = delete;
     Texture &operator=(Texture &&) noexcept = default;
 
-    /// @brief Creates a texture from a file.
+    /// @brief Creates a texture from a file. KTX2 and DDS files are loaded with their block compressed format and mip levels,
+    /// all other files are decoded by stb_image into RGBA8.
     /// @param device [in] The Vulkan device from which the texture will be created.
     /// @param graphics_card [in] The graphics card.
     /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
     /// @param file_name [in] The file name of the texture.
     /// @param name [in] The internal memory allocation name of the texture.
-    /// @param data_transfer_queue [in] The Vulkan data transfer queue.
-    /// @param data_transfer_queue_family_index [in] The queue family index of the data transfer queue to use.
+    /// @param upload_batcher [in] The upload batcher which uploads the texture data. The texture can be used once its upload token is complete.
+    /// @param sampler_cache [in] The sampler cache which shares the sampler of the texture with all textures which use the same sampler state.
+    /// @param mipmap_generation [in] How the mip levels are generated. This is ignored for compressed texture files, which contain their mip levels.
+    /// @param streamed [in] Only the lowest mip levels are uploaded, the others are streamed in by a TextureStreamer.
+    /// @throws std::runtime_error if the file can't be loaded, or if the graphics card doesn't support the format of a compressed texture file.
     Texture(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, const std::string &file_name,
-            const std::string &name, const VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index);
+            const std::string &name, UploadBatcher &upload_batcher, SamplerCache &sampler_cache,
+            const MipmapGeneration mipmap_generation = MipmapGeneration::AUTOMATIC, const bool streamed = false);
+
+    /// @brief Creates a texture from a texture file which has already been decoded, e.g. on a worker thread.
+    /// @param device [in] The Vulkan device from which the texture will be created.
+    /// @param graphics_card [in] The graphics card.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param texture_file [in] The decoded texture file. Its data is copied by the upload batcher, so it can be destroyed afterwards.
+    /// @param name [in] The internal memory allocation name of the texture.
+    /// @param upload_batcher [in] The upload batcher which uploads the texture data. The texture can be used once its upload token is complete.
+    /// @param sampler_cache [in] The sampler cache which shares the sampler of the texture with all textures which use the same sampler state.
+    /// @param mipmap_generation [in] How the mip levels are generated. This is ignored for compressed texture files, which contain their mip levels.
+    /// Streamed textures always generate their mip levels on the CPU, because they keep the data of all levels.
+    /// @param streamed [in] Only the lowest mip levels are uploaded, the others are streamed in by a TextureStreamer.
+    /// @throws std::runtime_error if the graphics card doesn't support the format of a compressed texture file.
+    Texture(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, const TextureFile &texture_file,
+            const std::string &name, UploadBatcher &upload_batcher, SamplerCache &sampler_cache,
+            const MipmapGeneration mipmap_generation = MipmapGeneration::AUTOMATIC, const bool streamed = false);
 
     /// @brief Creates a texture from memory.
     /// @param device [in] The Vulkan device from which the texture will be created.
@@ -86,13 +192,34 @@ public:
     /// @param texture_data [in] The texture data.
     /// @param texture_size [in] The size of the texture.
     /// @param name [in] The internal memory allocation name of the texture.
-    /// @param data_transfer_queue [in] The Vulkan data transfer queue.
-    /// @param data_transfer_queue_family_index [in] The queue family index of the data transfer queue to use.
+    /// @param upload_batcher [in] The upload batcher which uploads the texture data. The texture can be used once its upload token is complete.
+    /// @param sampler_cache [in] The sampler cache which shares the sampler of the texture with all textures which use the same sampler state.
+    /// @param mipmap_generation [in] How the mip levels are generated.
     Texture(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, void *texture_data, const std::size_t texture_size,
-            const std::string &name, const VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index);
+            const std::string &name, UploadBatcher &upload_batcher, SamplerCache &sampler_cache,
+            const MipmapGeneration mipmap_generation = MipmapGeneration::AUTOMATIC);
 
     ~Texture();
 
+    /// @brief Generates all mip levels after the first one with a 2x2 box filter.
+    /// @param texture_data [in] The RGBA8 data of the first mip level.
+    /// @param texture_width [in] The width of the first mip level.
+    /// @param texture_height [in] The height of the first mip level.
+    /// @param mip_levels [in] The number of mip levels, including the first one.
+    /// @param mip_data [out] The data of all mip levels, one after another, starting with the first one.
+    /// @param regions [out] The copy regions of the mip levels.
+    static void generate_mip_levels_on_cpu(const void *texture_data, int texture_width, int texture_height, int mip_levels,
+                                           std::vector<std::uint8_t> &mip_data, std::vector<VkBufferImageCopy> &regions);
+
+    /// @brief Returns the sampler state of textures and texture packs. It doesn't depend on the texture, so all
+    /// textures with the same address mode can share one sampler, see SamplerCache.
+    /// @param device_features [in] The features of the graphics card, which decide whether anisotropic filtering is used.
+    /// @param graphics_card_properties [in] The properties of the graphics card, which limit the anisotropic filtering.
+    /// @param address_mode [in] The address mode of all texture coordinates.
+    [[nodiscard]] static VkSamplerCreateInfo make_sampler_create_info(const VkPhysicalDeviceFeatures &device_features,
+                                                                      const VkPhysicalDeviceProperties &graphics_card_properties,
+                                                                      VkSamplerAddressMode address_mode);
+
     [[nodiscard]] const std::string &get_name() const {
         return name;
     }
@@ -112,6 +239,68 @@ public:
     [[nodiscard]] const VkSampler get_sampler() const {
         return sampler;
     }
+
+    [[nodiscard]] int get_width() const {
+        return texture_width;
+    }
+
+    [[nodiscard]] int get_height() const {
+        return texture_height;
+    }
+
+    [[nodiscard]] std::uint32_t get_mip_levels() const {
+        return static_cast<std::uint32_t>(mip_levels);
+    }
+
+    [[nodiscard]] bool is_streamed() const {
+        return streamed;
+    }
+
+    /// @brief Returns the finest mip level in the image of the texture. This is 0 for textures which are not streamed.
+    [[nodiscard]] std::uint32_t get_resident_mip_level() const {
+        return resident_mip_level;
+    }
+
+    /// @brief Returns the mip level a streamed texture starts with. The levels from it on are always resident.
+    [[nodiscard]] std::uint32_t get_initial_mip_level() const {
+        return initial_mip_level;
+    }
+
+    /// @brief Returns the size of the data of the mip levels from a mip level on, which approximates their size in device memory.
+    /// @param first_mip_level [in] The first mip level. The texture must be streamed.
+    [[nodiscard]] VkDeviceSize get_mip_levels_size(std::uint32_t first_mip_level) const;
+
+    [[nodiscard]] bool is_residency_change_pending() const {
+        return pending_image != VK_NULL_HANDLE;
+    }
+
+    /// @brief Starts to change the mip levels in the image of a streamed texture. A new image with the mip levels from
+    /// a mip level on is created, and the data of its levels is uploaded. The texture keeps its current image until
+    /// the upload has finished, see finish_residency_change().
+    /// @param first_mip_level [in] The finest mip level which should be resident, at most the initial mip level.
+    /// @return false if a residency change is already pending, if the mip level is already resident, or if the image
+    /// couldn't be created, for example because device memory ran out.
+    bool begin_residency_change(std::uint32_t first_mip_level);
+
+    /// @brief Checks if the upload of a pending residency change has finished.
+    [[nodiscard]] bool is_residency_change_complete() const;
+
+    /// @brief Replaces the image and the image view of the texture with the ones of the pending residency change,
+    /// whose upload must have finished. Descriptors which use the old image view must be updated.
+    /// @return The old image, which must be destroyed with destroy_retired_image() once no frame uses it anymore.
+    [[nodiscard]] RetiredTextureImage finish_residency_change();
+
+    /// @brief Destroys an image which was replaced by a residency change.
+    static void destroy_retired_image(const RetiredTextureImage &retired_image);
+
+    [[nodiscard]] const VmaAllocationInfo &get_allocation_info() const {
+        return allocation_info;
+    }
+
+    /// @brief Returns the token of the batch which uploads the texture data.
+    [[nodiscard]] UploadToken get_upload_token() const {
+        return upload_token;
+    }
 };
 
 } // namespace inexor::vulkan_renderer
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/compressed_texture_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief The decoded data of a texture file. Decoding doesn't need the Vulkan device, so texture files can be decoded
+/// on worker threads and the textures be created from them afterwards.
+/// KTX2 and DDS files are loaded as a CompressedTextureFile, all other files are decoded by stb_image into RGBA8.
+class TextureFile {
+private:
+    struct PixelDeleter {
+        void operator()(std::uint8_t *pixels) const;
+    };
+
+    std::string file_name;
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    /// The RGBA8 texels of files which are decoded by stb_image.
+    std::unique_ptr<std::uint8_t, PixelDeleter> pixels;
+
+    std::optional<CompressedTextureFile> compressed_file;
+
+public:
+    /// @brief Loads and decodes a texture file.
+    /// @param file_name [in] The file name of the texture.
+    /// @throws std::runtime_error if the file can't be loaded.
+    explicit TextureFile(const std::string &file_name);
+
+    [[nodiscard]] const std::string &get_file_name() const {
+        return file_name;
+    }
+
+    [[nodiscard]] int get_width() const {
+        return width;
+    }
+
+    [[nodiscard]] int get_height() const {
+        return height;
+    }
+
+    /// @brief Returns the number of channels in the file. The decoded texels always have 4 channels.
+    [[nodiscard]] int get_channels() const {
+        return channels;
+    }
+
+    /// @brief Returns the RGBA8 texels, or nullptr if this is a compressed texture file.
+    [[nodiscard]] const std::uint8_t *get_pixels() const {
+        return pixels.get();
+    }
+
+    /// @brief Returns the size of the RGBA8 texels.
+    [[nodiscard]] std::size_t get_pixel_data_size() const {
+        return 4 * static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    }
+
+    /// @brief Returns the compressed texture file, if this is a KTX2 or DDS file.
+    [[nodiscard]] const std::optional<CompressedTextureFile> &get_compressed_file() const {
+        return compressed_file;
+    }
+};
+
+} // namespace inexor::vulkan_renderer
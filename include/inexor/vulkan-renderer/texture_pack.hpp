@@ -0,0 +1,228 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/sampler_cache.hpp"
+#include "inexor/vulkan-renderer/texture_file.hpp"
+#include "inexor/vulkan-renderer/upload_batcher.hpp"
+
+#include <glm/vec2.hpp>
+#include <spdlog/spdlog.h>
+#include <vma/vma_usage.h>
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief How the texture packer groups textures.
+struct TexturePackerSettings {
+    /// Textures with the same format, size and number of mip levels are packed into a texture array if there are at least this many of them.
+    std::uint32_t min_array_layers = 2;
+
+    /// The maximum number of layers of a pack. 256 is the lowest maxImageArrayLayers the Vulkan specification allows.
+    std::uint32_t max_layers = 256;
+
+    /// RGBA8 textures which are at most this many texels wide and high are packed into atlas pages if they don't fit into a texture array.
+    std::uint32_t max_atlas_texture_size = 256;
+
+    /// The width and height of the atlas pages.
+    std::uint32_t atlas_size = 2048;
+
+    /// The texels around every texture in an atlas page, which repeat its border so that linear filtering doesn't bleed into its neighbours.
+    std::uint32_t atlas_padding = 2;
+};
+
+/// @brief The push constants a draw uses to select its texture in a texture pack.
+/// The fragment shader samples the 2D array with vec3(uv_offset + fract(uv) * uv_scale, layer). Textures in atlas pages
+/// can't use the repeat address mode of the sampler, which is why the texture coordinates are wrapped with fract().
+struct TexturePackPushConstants {
+    glm::vec2 uv_offset = glm::vec2(0.0f);
+    glm::vec2 uv_scale = glm::vec2(1.0f);
+    std::uint32_t layer = 0;
+};
+
+/// @brief Where a texture is in the packs of a texture packer.
+struct TexturePackEntry {
+    std::uint32_t pack_index = 0;
+    TexturePackPushConstants push_constants;
+};
+
+/// @brief The place of a texture in a pack.
+struct TexturePlacement {
+    /// The index which add_texture() returned for the texture.
+    std::size_t texture_index = 0;
+
+    std::uint32_t layer = 0;
+
+    /// The position of the texture in an atlas page in texels, without the padding. Textures in arrays are at 0, 0.
+    std::uint32_t x = 0;
+    std::uint32_t y = 0;
+};
+
+/// @brief The format, the size and the textures of one pack.
+struct TexturePackLayout {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint32_t mip_levels = 1;
+    std::uint32_t layer_count = 0;
+
+    /// The layers are atlas pages which contain several textures, otherwise every layer is one texture.
+    bool atlas = false;
+
+    std::vector<TexturePlacement> placements;
+};
+
+/// @brief A 2D array image which contains several textures, with one image view and one sampler for all of them.
+/// All textures of a pack can be bound with one descriptor, and a draw selects its texture with TexturePackPushConstants.
+class TexturePack {
+private:
+    std::string name = "";
+
+    VkDevice device = VK_NULL_HANDLE;
+    SamplerCache *sampler_cache = nullptr;
+    VmaAllocator vma_allocator = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    VmaAllocationInfo allocation_info = {};
+
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView image_view = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    TexturePackLayout layout;
+
+    /// The token of the batch which uploads the textures.
+    UploadToken upload_token = 0;
+
+    /// @brief Copies the textures of an atlas into its pages.
+    void fill_atlas_pages(const std::vector<const TextureFile *> &texture_files, std::uint32_t padding, std::vector<std::uint8_t> &data,
+                          std::vector<VkBufferImageCopy> &regions) const;
+
+    /// @brief Copies the mip levels of the textures of an array into one buffer, one layer after another.
+    void fill_array_layers(const std::vector<const TextureFile *> &texture_files, std::vector<std::uint8_t> &data,
+                           std::vector<VkBufferImageCopy> &regions) const;
+
+    void create_image();
+
+    void create_image_view();
+
+    /// @brief Acquires the sampler of the pack from the sampler cache.
+    void create_sampler(VkPhysicalDevice graphics_card);
+
+public:
+    /// @brief Creates a texture pack and records the upload of its textures.
+    /// @param device [in] The Vulkan device.
+    /// @param graphics_card [in] The graphics card.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param layout [in] The layout of the pack, which was planned by a TexturePacker.
+    /// @param texture_files [in] The texture files, indexed by the texture indices of the placements.
+    /// @param atlas_padding [in] The padding around the textures in atlas pages.
+    /// @param name [in] The internal memory allocation name of the pack.
+    /// @param upload_batcher [in] The upload batcher which uploads the textures. The pack can be used once its upload token is complete.
+    /// @param sampler_cache [in] The sampler cache which shares the sampler of the pack.
+    /// @throws std::runtime_error if the graphics card doesn't support the format, or if the image can't be created.
+    TexturePack(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, const TexturePackLayout &layout,
+                const std::vector<const TextureFile *> &texture_files, std::uint32_t atlas_padding, const std::string &name,
+                UploadBatcher &upload_batcher, SamplerCache &sampler_cache);
+
+    TexturePack(const TexturePack &) = delete;
+    TexturePack(TexturePack &&other) noexcept;
+
+    TexturePack &operator=(const TexturePack &) = delete;
+    TexturePack &operator=(TexturePack &&) = delete;
+
+    ~TexturePack();
+
+    [[nodiscard]] const std::string &get_name() const {
+        return name;
+    }
+
+    [[nodiscard]] VkImage get_image() const {
+        return image;
+    }
+
+    /// @brief Returns the VK_IMAGE_VIEW_TYPE_2D_ARRAY view of all layers.
+    [[nodiscard]] VkImageView get_image_view() const {
+        return image_view;
+    }
+
+    [[nodiscard]] VkSampler get_sampler() const {
+        return sampler;
+    }
+
+    [[nodiscard]] const TexturePackLayout &get_layout() const {
+        return layout;
+    }
+
+    [[nodiscard]] const VmaAllocationInfo &get_allocation_info() const {
+        return allocation_info;
+    }
+
+    /// @brief Returns the token of the batch which uploads the textures.
+    [[nodiscard]] UploadToken get_upload_token() const {
+        return upload_token;
+    }
+};
+
+/// @brief Groups textures into texture packs, so that many materials can share one descriptor set.
+/// Textures with the same format, size and number of mip levels become the layers of a texture array. Small RGBA8
+/// textures with sizes of their own are packed into the pages of an atlas with a shelf packer. The atlas pages have
+/// only one mip level, because the mip levels of neighbouring textures would bleed into each other. All other textures
+/// are not packed and stay textures of their own.
+/// @note The packer only plans the packs, the textures are decoded and copied by create_packs().
+class TexturePacker {
+private:
+    TexturePackerSettings settings;
+
+    std::vector<const TextureFile *> texture_files;
+
+    std::vector<TexturePackLayout> layouts;
+    std::vector<std::optional<TexturePackEntry>> entries;
+
+    /// @brief Packs textures into the pages of atlases, the tallest ones first.
+    void pack_atlas_pages(std::vector<std::size_t> texture_indices);
+
+    /// @brief Adds the layout of a pack and the entries of its textures.
+    void add_layout(TexturePackLayout layout);
+
+public:
+    /// @param settings [in] How the textures are grouped.
+    explicit TexturePacker(const TexturePackerSettings &settings = {});
+
+    /// @brief Adds a texture to the packer.
+    /// @param texture_file [in] The decoded texture file.
+    /// @warning The texture file must live until the packs have been created.
+    /// @return The index of the texture, which identifies its entry.
+    std::size_t add_texture(const TextureFile &texture_file);
+
+    /// @brief Plans the packs of all textures which were added.
+    void pack();
+
+    [[nodiscard]] const std::vector<TexturePackLayout> &get_layouts() const {
+        return layouts;
+    }
+
+    /// @brief Returns where a texture is in the packs, or nothing if the texture was not packed.
+    /// @param texture_index [in] The index which add_texture() returned.
+    [[nodiscard]] const std::optional<TexturePackEntry> &get_entry(std::size_t texture_index) const {
+        assert(texture_index < entries.size());
+        return entries[texture_index];
+    }
+
+    /// @brief Creates the texture packs of all layouts, whose indices are the pack indices of the entries.
+    /// @param device [in] The Vulkan device.
+    /// @param graphics_card [in] The graphics card.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param name [in] The internal memory allocation name of the packs, which is followed by their index.
+    /// @param upload_batcher [in] The upload batcher which uploads the textures.
+    /// @param sampler_cache [in] The sampler cache which shares the samplers of the packs.
+    /// @throws std::runtime_error if a pack can't be created.
+    [[nodiscard]] std::vector<TexturePack> create_packs(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator,
+                                                        const std::string &name, UploadBatcher &upload_batcher, SamplerCache &sampler_cache) const;
+};
+
+} // namespace inexor::vulkan_renderer
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/frame_timeline.hpp"
+#include "inexor/vulkan-renderer/texture.hpp"
+
+#include <spdlog/spdlog.h>
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief The budget of the texture streamer and how fast it reacts.
+struct TextureStreamerSettings {
+    /// The device memory all streamed textures may use together. Their initial mip levels stay resident even if they don't fit.
+    VkDeviceSize budget = 256 * 1024 * 1024;
+
+    /// The number of frames which can use a texture image after it was replaced, so the old images are destroyed after that.
+    /// This is not needed if the streamer uses the frame timeline.
+    std::uint32_t frames_in_flight = 3;
+
+    /// The number of residency changes whose uploads may run at the same time.
+    std::uint32_t max_pending_changes = 4;
+
+    /// The number of frames the budget stays lowered after an eviction, so the evicted mip levels are not streamed in right away.
+    std::uint32_t eviction_cooldown = 300;
+};
+
+struct TextureStreamerStatistics {
+    /// The residency changes which made finer mip levels resident.
+    std::uint64_t loads = 0;
+
+    /// The residency changes which dropped mip levels.
+    std::uint64_t drops = 0;
+
+    /// The residency changes which could not be started, because the image could not be created.
+    std::uint64_t failed_changes = 0;
+
+    std::uint64_t evictions = 0;
+    VkDeviceSize evicted_bytes = 0;
+};
+
+/// @brief Streams the mip levels of textures in and out, so a large set of textures fits into a fixed budget of device memory.
+/// Streamed textures start with only their lowest mip levels resident. Every frame, the streamer selects the finest mip
+/// level every texture needs for its estimated size on the screen, see Camera::estimate_screen_size(). If these levels
+/// don't fit into the budget, the textures which are smallest on the screen get coarser levels first.
+/// A texture changes its mip levels by uploading them into a new image, which replaces the image and the image view of
+/// the texture once the upload has finished. The residency callback is called then, so the descriptors which use the
+/// old image views can be updated. The old images are destroyed once the frames which might use them have finished.
+/// With the frame timeline, their destruction is deferred until the queue which renders the frames has reached the
+/// value of the last frame which was submitted before the image was replaced.
+/// Under memory pressure, evict() lowers the budget for a while, so that finer mip levels are dropped.
+/// @note There is no sparse residency, so every residency change reallocates the image, and every texture keeps the
+/// data of all its mip levels in host memory.
+/// @note This class is not thread safe.
+class TextureStreamer {
+public:
+    /// @brief Called once textures have replaced their image views.
+    using ResidencyCallback = std::function<void()>;
+
+private:
+    struct StreamedTexture {
+        Texture *texture = nullptr;
+
+        /// The estimated size of the texture on the screen in pixels.
+        float screen_size = 0.0f;
+
+        /// The mip level which was selected for the screen size and the budget.
+        std::uint32_t selected_mip_level = 0;
+    };
+
+    struct RetiredImage {
+        RetiredTextureImage image;
+        std::uint64_t frame_index = 0;
+    };
+
+    TextureStreamerSettings settings;
+
+    /// The streamed textures, the ones which are largest on the screen first.
+    std::vector<StreamedTexture> textures;
+
+    std::deque<RetiredImage> retired_images;
+
+    /// The queue which renders the frames and its timeline, if the frame timeline is used.
+    VulkanFrameTimeline *frame_timeline = nullptr;
+    VkQueue frame_queue = VK_NULL_HANDLE;
+
+    ResidencyCallback residency_callback;
+
+    std::uint64_t frame_index = 0;
+
+    /// The lowered budget after an eviction, which applies until the frame index reaches the end of the cooldown.
+    VkDeviceSize eviction_budget = 0;
+    std::uint64_t eviction_end_frame_index = 0;
+
+    TextureStreamerStatistics statistics;
+
+    /// @brief Returns the mip level whose size matches the screen size of a texture, at most its initial mip level.
+    [[nodiscard]] static std::uint32_t calculate_mip_level(const StreamedTexture &texture);
+
+    /// @brief Selects the mip level of every texture, so that all textures fit into the budget.
+    void select_mip_levels(VkDeviceSize budget);
+
+    /// @brief Begins the residency changes of the textures whose selected mip level isn't resident.
+    void begin_residency_changes();
+
+public:
+    /// @brief Creates a texture streamer.
+    /// @param settings [in] The budget of the streamer and how fast it reacts.
+    explicit TextureStreamer(const TextureStreamerSettings &settings = {});
+
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    /// @brief Destroys the retired images. The device must be idle.
+    ~TextureStreamer();
+
+    /// @brief Defers the destruction of the replaced images with the timeline of the queue which renders the frames,
+    /// instead of counting frames.
+    /// @param frame_timeline [in] The frame timeline.
+    /// @param frame_queue [in] The queue which renders the frames.
+    void use_frame_timeline(VulkanFrameTimeline &frame_timeline, VkQueue frame_queue);
+
+    /// @brief Adds a texture which was created as a streamed texture. Its screen size is 0 until it is set.
+    /// @warning The texture must not be moved or destroyed before the streamer.
+    void add_texture(Texture &texture);
+
+    /// @brief Sets the estimated size of a texture on the screen in pixels, usually once per frame.
+    /// 0 means that the texture is not visible, so it only needs its initial mip levels.
+    void set_screen_size(const Texture &texture, float screen_size);
+
+    /// @brief Sets the function which is called once textures have replaced their image views.
+    void set_residency_callback(ResidencyCallback callback) {
+        residency_callback = std::move(callback);
+    }
+
+    /// @brief Destroys the retired images whose frames have finished, finishes the residency changes whose uploads
+    /// have finished, and begins new ones for the current screen sizes. This should be called once per frame,
+    /// after the frame was submitted.
+    void update();
+
+    /// @brief Lowers the budget for a while, so that the next update drops mip levels. This is meant to be an
+    /// eviction handler of the memory budget tracker.
+    /// @param bytes_to_free [in] The number of bytes which should be freed.
+    /// @return The number of bytes which will be freed, which is 0 if only the initial mip levels are resident.
+    VkDeviceSize evict(VkDeviceSize bytes_to_free);
+
+    /// @brief Returns the size of the resident mip levels of all textures.
+    [[nodiscard]] VkDeviceSize get_resident_size() const;
+
+    [[nodiscard]] const TextureStreamerStatistics &get_statistics() const {
+        return statistics;
+    }
+
+    /// @brief Logs the statistics of the streamer.
+    void log_statistics() const;
+};
+
+} // namespace inexor::vulkan_renderer
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "inexor/vulkan-renderer/thread_pool_statistics.hpp"
+
 #include <spdlog/spdlog.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <future>
@@ -14,22 +18,81 @@
 
 namespace inexor {
 
-// We should at least create 6 worker threads.
-// Most systems nowadays have at least 8 cores.
-constexpr unsigned int THREADPOOL_MIN_THREAD_COUNT = 6;
-
-// The maximum number of threads is not limitex here,
-// but should not exceede std::thread::hardware_concurrency();
-
 // std::thread::hardware_concurrency() might return 0 in some cases.
 // The function should be interpreted as a hint only! In that case,
 // let's use just 8 threads. In the worst case we generate more
 // threads than cpu cores are available, generating overhead.
 constexpr unsigned int THREADPOOL_BACKUP_CPU_CORE_COUNT = 8;
 
-// TODO: Minimum number of threads.
-// TODO: Maximum number of threads.
-// TODO: Method for changing the number of threads at runtime.
+// The auto-scaler parks one worker thread after the queues were empty for this number of frames.
+constexpr std::uint32_t THREADPOOL_AUTO_SCALING_PARK_FRAME_COUNT = 30;
+
+/// @brief The placement settings of the worker threads, see [threadpool] in renderer.toml.
+struct ThreadPoolSettings {
+    /// The number of worker threads, 0 means one thread for every available (physical) core.
+    std::size_t thread_count = 0;
+
+    /// The number of physical cores which are kept free for the main thread and the render thread.
+    /// The first cores in placement order are reserved.
+    std::size_t reserved_core_count = 0;
+
+    /// Pin every worker thread to one logical core (Linux only).
+    bool pin_threads = false;
+
+    /// Place worker threads on distinct physical cores before SMT siblings are used.
+    bool avoid_smt_siblings = true;
+
+    /// The logical cores the worker threads may run on, empty means all cores of the process.
+    std::vector<std::size_t> cpu_affinity;
+
+    /// Park worker threads while the queues stay empty and wake them up again on a backlog.
+    bool auto_scaling = false;
+
+    /// The number of worker threads the auto-scaler keeps active.
+    std::size_t min_active_thread_count = 1;
+};
+
+/// @brief The priority lanes of the threadpool.
+/// A task is only started if all lanes of higher priority are empty.
+enum class TaskPriority : std::size_t {
+    /// Work which the current frame is waiting on.
+    FRAME_CRITICAL = 0,
+    /// The default priority for tasks.
+    NORMAL,
+    /// Long running work like texture decoding or octree remeshing.
+    /// Background tasks will not be started once the frame budget is nearly used up.
+    BACKGROUND
+};
+
+constexpr std::size_t THREADPOOL_PRIORITY_LANE_COUNT = 3;
+
+// Background tasks will not be started anymore once this fraction of the frame budget has been used up.
+constexpr float THREADPOOL_DEFAULT_BACKGROUND_CUTOFF = 0.9f;
+
+/// @brief The measured time tasks of one priority lane spent waiting in the queue before they were started.
+struct TaskQueueLatency {
+    std::uint64_t task_count = 0;
+    std::chrono::nanoseconds average{0};
+    std::chrono::nanoseconds maximum{0};
+};
+
+// The number of queue depth samples which are kept by the threadpool, one sample is taken every frame.
+constexpr std::size_t THREADPOOL_QUEUE_DEPTH_SAMPLE_COUNT = 128;
+
+/// @brief A snapshot of the telemetry of the threadpool.
+struct ThreadPoolStatistics {
+    /// The counters of every worker thread.
+    std::vector<WorkerStatistics> workers;
+
+    /// The time tasks spent waiting in the queue, for every priority lane.
+    std::array<LatencyHistogramSnapshot, THREADPOOL_PRIORITY_LANE_COUNT> wait_latency;
+
+    /// The time tasks spent running, for every priority lane.
+    std::array<LatencyHistogramSnapshot, THREADPOOL_PRIORITY_LANE_COUNT> run_latency;
+
+    /// The number of queued tasks of every priority lane at the beginning of the last frames, oldest sample first.
+    std::vector<std::array<std::size_t, THREADPOOL_PRIORITY_LANE_COUNT>> queue_depth_samples;
+};
 
 /// @brief A C++17 threadpool implementation.
 class ThreadPool {
@@ -41,6 +104,10 @@ public:
     /// @warning You should not create too many threads because this increases overhead!
     ThreadPool(std::size_t thread_count = std::thread::hardware_concurrency());
 
+    /// @brief Creates the worker threads according to the placement settings.
+    /// @param settings [in] The thread count, reserved cores and CPU affinity of the worker threads.
+    ThreadPool(const ThreadPoolSettings &settings);
+
     // @brief The default destructor destroys all threads.
     ~ThreadPool();
 
@@ -51,13 +118,75 @@ public:
     ThreadPool &operator=(const ThreadPool &) = delete;
 
     /// @brief Spawns a new worker thread.
+    /// If pinning is enabled, the thread is pinned to the next core in placement order.
+    /// @warning Must not be called from a worker thread.
     void start_thread();
 
+    /// @brief Changes the number of worker threads while the threadpool is running.
+    /// When shrinking, the last worker threads finish their current task and are joined before this returns.
+    /// Queued tasks are not lost, they are run by the remaining worker threads.
+    /// @param thread_count [in] The new number of worker threads, at least 1.
+    /// @warning Must not be called from a worker thread.
+    void resize(std::size_t thread_count);
+
+    /// @brief Returns the number of worker threads.
+    [[nodiscard]] std::size_t get_thread_count();
+
+    /// @brief Returns the number of worker threads which are not parked by the auto-scaler.
+    [[nodiscard]] std::size_t get_active_thread_count();
+
+    /// @brief Enables or disables the auto-scaler.
+    /// The auto-scaler parks a worker thread whenever the queues stayed empty at the beginning of
+    /// THREADPOOL_AUTO_SCALING_PARK_FRAME_COUNT frames, and wakes one up whenever more tasks are queued than worker threads are active.
+    /// @param enabled [in] True if the auto-scaler should be enabled. If disabled, all worker threads are woken up.
+    /// @param min_active_thread_count [in] The number of worker threads which are never parked.
+    void set_auto_scaling(bool enabled, std::size_t min_active_thread_count = 1);
+
     /// @brief Executes a task from the tasklist.
     /// @note We only accept invokable arguments in the template.
+    /// @note The task will be queued with TaskPriority::NORMAL.
     template <typename F, typename... Args, typename = std::enable_if_t<std::is_invocable_v<F &&, Args &&...>>>
     auto execute(F, Args &&...);
 
+    /// @brief Executes a task from the tasklist of the given priority lane.
+    /// @param priority [in] The priority lane to queue the task in.
+    template <typename F, typename... Args, typename = std::enable_if_t<std::is_invocable_v<F &&, Args &&...>>>
+    auto execute_with_priority(TaskPriority priority, F, Args &&...);
+
+    /// @brief Marks the beginning of a new frame.
+    /// Background tasks will only be started until the given fraction of the frame budget has been used up.
+    /// @param frame_budget [in] The time which is available for the frame, 0 disables the frame budget.
+    void begin_frame(std::chrono::nanoseconds frame_budget);
+
+    /// @brief Sets the fraction of the frame budget after which no more background tasks will be started.
+    /// @param background_cutoff [in] A value between 0 and 1.
+    void set_background_cutoff(float background_cutoff);
+
+    /// @brief Checks if the frame budget is used up to the background cutoff.
+    /// @return True if background tasks should not be started (or continued) in the current frame.
+    [[nodiscard]] bool is_frame_budget_exhausted();
+
+    /// @brief Cooperative yield point for long running tasks.
+    /// Runs all pending frame-critical tasks on the calling thread, so a long task does not delay the frame.
+    /// @return True if the frame budget is exhausted, in which case a background task should
+    /// return early and queue the rest of its work again.
+    bool yield();
+
+    /// @brief Returns the measured queueing latency of a priority lane.
+    /// @param priority [in] The priority lane.
+    [[nodiscard]] TaskQueueLatency get_queue_latency(TaskPriority priority);
+
+    /// @brief Returns a snapshot of the worker counters, latency histograms and queue depth samples.
+    /// @note This is cheap enough to be called every frame, the worker threads are not interrupted.
+    [[nodiscard]] ThreadPoolStatistics get_statistics();
+
+    /// @brief Writes a summary of the threadpool statistics to the log.
+    void log_statistics();
+
+    /// @brief Enables logging of the threadpool statistics every N frames, see begin_frame.
+    /// @param frame_count [in] The number of frames between two log entries, 0 disables logging.
+    void set_statistics_log_interval(std::uint32_t frame_count);
+
 private:
     //_task_container_base and _task_container exist simply as a wrapper around a
     //  MoveConstructible - but not CopyConstructible - Callable object. Since an
@@ -71,6 +200,12 @@ private:
         virtual ~TaskContainerBase(){};
 
         virtual void operator()() = 0;
+
+        /// The point in time the task was queued, used to measure queueing latency.
+        std::chrono::steady_clock::time_point queue_time = std::chrono::steady_clock::now();
+
+        /// The priority lane the task was queued in.
+        std::size_t lane = 0;
     };
 
     //_task_container takes a typename F, which must be Callable and MoveConstructible.
@@ -98,32 +233,123 @@ private:
     /// @brief Returns a unique pointer to a Task container that wraps around a given function
     template <typename Task>
     static std::unique_ptr<TaskContainerBase> allocate_task_container(Task &&f) {
-        spdlog::debug("Allocating task container.");
-
         // in the construction of the _task_container, f must be std::forward'ed because
         //  it may not be CopyConstructible - the only requirement for an instantiation
         //  of a _task_container is that the parameter is of a MoveConstructible type.
         return std::make_unique<TaskContainer<Task>>(std::forward<Task>(f));
     }
 
+    /// @brief Accumulated queueing latency of one priority lane.
+    struct LaneLatency {
+        std::uint64_t task_count = 0;
+        std::chrono::nanoseconds total{0};
+        std::chrono::nanoseconds maximum{0};
+    };
+
+    /// @brief Checks if there is a task which may be started now.
+    /// @note tasklist_mutex must be locked by the caller.
+    [[nodiscard]] bool has_startable_task() const;
+
+    /// @brief Takes the next task from the highest priority lane which is not empty.
+    /// @note tasklist_mutex must be locked by the caller.
+    /// @return The next task, or nullptr if there is no task which may be started now.
+    std::unique_ptr<TaskContainerBase> take_next_task();
+
+    /// @brief Checks the frame budget.
+    /// @note tasklist_mutex must be locked by the caller.
+    [[nodiscard]] bool is_frame_budget_exhausted_locked() const;
+
+    /// @brief Runs a task and records its run time.
+    /// @return The run time of the task.
+    std::chrono::nanoseconds run_task(TaskContainerBase &task);
+
+    /// @brief Activates one parked worker thread if more tasks are queued than worker threads are active.
+    /// @note tasklist_mutex must be locked by the caller.
+    /// @return True if a worker thread was activated and parked_cv must be notified.
+    bool activate_worker_on_backlog();
+
+    /// @brief The main loop of a worker thread.
+    /// @param worker_index [in] The index of the worker thread in threads.
+    /// @param counters [in] The counters of the worker thread.
+    void run_worker(std::size_t worker_index, WorkerCounters *counters);
+
     // The threads.
     std::vector<std::thread> threads;
 
-    /// The tasklist contains the list of work that should be done.
-    std::queue<std::unique_ptr<TaskContainerBase>> tasklist;
+    /// The logical cores the worker threads may run on, in placement order.
+    /// Empty if the CPU affinity of the worker threads is not restricted.
+    std::vector<std::size_t> cpu_placement;
+
+    /// Pin every worker thread to one core of cpu_placement instead of all of them.
+    bool pin_threads = false;
+
+    /// The number of worker threads which should exist. Worker threads with a higher index retire.
+    std::size_t target_thread_count = 0;
+
+    /// The number of worker threads which may take tasks. Worker threads with a higher index are parked.
+    std::size_t active_thread_count = 0;
+
+    bool auto_scaling = false;
+
+    std::size_t min_active_thread_count = 1;
+
+    /// The number of frames which began with empty queues in a row.
+    std::uint32_t idle_frame_count = 0;
+
+    /// The counters of every worker thread, in the same order as threads.
+    /// The counters are heap allocated so their addresses stay the same when new threads are started.
+    std::vector<std::unique_ptr<WorkerCounters>> worker_counters;
+
+    /// The time tasks spent waiting in the queue, for every priority lane.
+    std::array<LatencyHistogram, THREADPOOL_PRIORITY_LANE_COUNT> wait_latency_histograms;
+
+    /// The time tasks spent running, for every priority lane.
+    std::array<LatencyHistogram, THREADPOOL_PRIORITY_LANE_COUNT> run_latency_histograms;
+
+    /// A ring buffer of queue depth samples, one sample is taken in every call of begin_frame.
+    std::array<std::array<std::size_t, THREADPOOL_PRIORITY_LANE_COUNT>, THREADPOOL_QUEUE_DEPTH_SAMPLE_COUNT> queue_depth_samples{};
+
+    /// The total number of queue depth samples which have been taken.
+    std::size_t queue_depth_sample_count = 0;
+
+    /// The number of frames between two log entries of the statistics, 0 means no logging.
+    std::uint32_t statistics_log_interval = 0;
+
+    /// The number of frames which began since the statistics were logged the last time.
+    std::uint32_t frames_since_statistics_log = 0;
+
+    /// The tasklists contain the list of work that should be done, one for every priority lane.
+    std::array<std::queue<std::unique_ptr<TaskContainerBase>>, THREADPOOL_PRIORITY_LANE_COUNT> tasklists;
+
+    /// The measured queueing latency of every priority lane.
+    std::array<LaneLatency, THREADPOOL_PRIORITY_LANE_COUNT> lane_latencies;
+
+    /// The point in time the current frame began.
+    std::chrono::steady_clock::time_point frame_start_time = std::chrono::steady_clock::now();
+
+    /// The time budget of the current frame, 0 means there is no frame budget.
+    std::chrono::nanoseconds frame_budget{0};
+
+    float background_cutoff = THREADPOOL_DEFAULT_BACKGROUND_CUTOFF;
 
     /// This mutex locks tasklist access.
     std::mutex tasklist_mutex;
 
     std::condition_variable tasklist_cv;
 
+    /// Parked worker threads wait on this condition variable, so they do not swallow notifications of tasklist_cv.
+    std::condition_variable parked_cv;
+
     std::atomic<bool> stop_threads = false;
 };
 
 template <typename F, typename... Args, typename>
 auto ThreadPool::execute(F function, Args &&... args) {
-    spdlog::warn("Executing task from task list.");
+    return execute_with_priority(TaskPriority::NORMAL, std::move(function), std::forward<Args>(args)...);
+}
 
+template <typename F, typename... Args, typename>
+auto ThreadPool::execute_with_priority(TaskPriority priority, F function, Args &&... args) {
     // Lock the task list so we can add the new task.
     std::unique_lock<std::mutex> queue_lock(tasklist_mutex, std::defer_lock);
 
@@ -133,8 +359,6 @@ auto ThreadPool::execute(F function, Args &&... args) {
     //
     std::future<std::invoke_result_t<F, Args...>> future = task_package.get_future();
 
-    spdlog::warn("Locking queue_lock.");
-
     //
     queue_lock.lock();
 
@@ -142,16 +366,20 @@ auto ThreadPool::execute(F function, Args &&... args) {
     // Since the packaged_task type is not CopyConstructible, the
     // function is not CopyConstructible either, hence the need
     // for a TaskContainer to wrap around it.
-    tasklist.emplace(allocate_task_container(std::move(task_package)));
+    tasklists[static_cast<std::size_t>(priority)].emplace(allocate_task_container(std::move(task_package)));
+
+    const bool worker_activated = activate_worker_on_backlog();
 
     //
     queue_lock.unlock();
 
-    spdlog::warn("Unlocking queue_lock.");
-
     //
     tasklist_cv.notify_one();
 
+    if (worker_activated) {
+        parked_cv.notify_all();
+    }
+
     //
     return std::move(future);
 }
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace inexor {
+
+// Bucket i of a latency histogram counts latencies in the range [2^(i-1), 2^i) nanoseconds.
+// The last bucket also contains all latencies which are longer than that (more than one second).
+constexpr std::size_t LATENCY_HISTOGRAM_BUCKET_COUNT = 32;
+
+/// @brief A copy of the buckets of a LatencyHistogram.
+struct LatencyHistogramSnapshot {
+    std::array<std::uint64_t, LATENCY_HISTOGRAM_BUCKET_COUNT> buckets{};
+
+    /// @brief Returns the number of latencies recorded in the histogram.
+    [[nodiscard]] std::uint64_t get_count() const;
+
+    /// @brief Estimates a percentile of the recorded latencies.
+    /// @param percentile [in] The percentile, between 0 and 1.
+    /// @return The upper bound of the bucket which contains the percentile.
+    [[nodiscard]] std::chrono::nanoseconds get_percentile(double percentile) const;
+};
+
+/// @brief A lock-free histogram of latencies with bucket sizes which are powers of two.
+/// Recording a latency costs one relaxed atomic increment.
+class LatencyHistogram {
+private:
+    std::array<std::atomic<std::uint64_t>, LATENCY_HISTOGRAM_BUCKET_COUNT> buckets{};
+
+public:
+    LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    /// @brief Records a latency.
+    /// @param latency [in] The latency to record.
+    void record(std::chrono::nanoseconds latency);
+
+    /// @brief Copies the current bucket values.
+    /// @note Latencies which are recorded concurrently might or might not be part of the snapshot.
+    [[nodiscard]] LatencyHistogramSnapshot get_snapshot() const;
+};
+
+/// @brief The counters of one worker thread.
+/// Every counter is only written by the worker thread itself, so relaxed atomics are sufficient.
+/// @note Aligned to a cache line so workers do not invalidate each other's counters.
+struct alignas(64) WorkerCounters {
+    std::atomic<std::uint64_t> busy_time_ns{0};
+    std::atomic<std::uint64_t> idle_time_ns{0};
+    std::atomic<std::uint64_t> tasks_run{0};
+};
+
+/// @brief A copy of the counters of one worker thread.
+struct WorkerStatistics {
+    std::chrono::nanoseconds busy_time{0};
+    std::chrono::nanoseconds idle_time{0};
+    std::uint64_t tasks_run = 0;
+};
+
+} // namespace inexor
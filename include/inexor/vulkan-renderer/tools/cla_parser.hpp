@@ -69,7 +69,31 @@ private:
         {CommandLineArgumentType::NONE, "-no_separate_data_queue"},
 
         // Disable debug markers (even if -renderdoc is specified)
-        {CommandLineArgumentType::NONE, "-no_vk_debug_markers"}
+        {CommandLineArgumentType::NONE, "-no_vk_debug_markers"},
+
+        // The number of threadpool worker threads.
+        {CommandLineArgumentType::UINT32, "-threads"},
+
+        // The number of CPU cores which are kept free of threadpool worker threads.
+        {CommandLineArgumentType::UINT32, "-reserved_cores"},
+
+        // Pin every threadpool worker thread to one CPU core (Linux only).
+        {CommandLineArgumentType::NONE, "-pin_threads"},
+
+        // The CPU cores the threadpool worker threads may run on, for example "0-3,6".
+        {CommandLineArgumentType::STRING, "-thread_affinity"},
+
+        // Log threadpool statistics every N frames.
+        {CommandLineArgumentType::UINT32, "-threadpool_stats"},
+
+        // Synchronise frames with timeline semaphores (VK_KHR_timeline_semaphore) instead of fences.
+        {CommandLineArgumentType::NONE, "-timeline_semaphores"},
+
+        // Stream allocation events and VMA statistics to vma-statistics/ instead of VMA's recording.
+        {CommandLineArgumentType::NONE, "-vma_statistics"},
+
+        // Stream the mip levels of the textures within a budget of N MiB of device memory.
+        {CommandLineArgumentType::UINT32, "-texture_streaming"}
 
         /// TODO: Add more command line argumetns here!
     };
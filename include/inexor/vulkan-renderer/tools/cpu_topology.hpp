@@ -0,0 +1,52 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace inexor::vulkan_renderer::tools {
+
+/// @brief A logical CPU core which the process is allowed to run on.
+struct CpuCore {
+    /// The index of the logical core, as used by the operating system.
+    std::size_t logical_id = 0;
+
+    /// The lowest logical index of all SMT siblings of this core.
+    /// Logical cores with the same physical_id share one physical core.
+    std::size_t physical_id = 0;
+};
+
+/// @brief Returns the logical CPU cores the process is allowed to run on.
+/// @note The SMT topology is only known on Linux. On other systems every logical core is treated as a physical core.
+/// @return The logical cores, or an empty list if the number of cores could not be determined.
+[[nodiscard]] std::vector<CpuCore> get_cpu_topology();
+
+/// @brief Orders logical cores for the placement of worker threads.
+/// @param cores [in] The logical cores to order.
+/// @param avoid_smt_siblings [in] If true, one logical core of every physical core comes first, followed by their SMT siblings.
+/// @return The logical core indices in placement order.
+[[nodiscard]] std::vector<std::size_t> get_cpu_placement_order(const std::vector<CpuCore> &cores, bool avoid_smt_siblings);
+
+/// @brief Parses a list of logical core indices like "0-3,6,8-9".
+/// @param cpu_list [in] The comma separated list of core indices and ranges.
+/// @return The core indices, or std::nullopt if the list is malformed or contains an index which is not below
+/// the number of logical cores of the system.
+[[nodiscard]] std::optional<std::vector<std::size_t>> parse_cpu_list(const std::string &cpu_list);
+
+/// @brief Returns if set_thread_affinity() is supported on this system.
+[[nodiscard]] constexpr bool is_thread_affinity_supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+/// @brief Restricts a thread to the given logical cores.
+/// @param thread [in] The thread.
+/// @param cpu_cores [in] The logical core indices the thread may run on.
+/// @return True if the affinity was set, false if it failed or is not supported on this system.
+bool set_thread_affinity(std::thread &thread, const std::vector<std::size_t> &cpu_cores);
+
+} // namespace inexor::vulkan_renderer::tools
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/gpu_memory_buffer.hpp"
+
+#include <spdlog/spdlog.h>
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief A sub-allocation of a uniform ring buffer.
+struct UniformRingAllocation {
+    /// The mapped memory of the sub-allocation.
+    void *data = nullptr;
+
+    /// The offset to pass to vkCmdBindDescriptorSets for a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor.
+    std::uint32_t dynamic_offset = 0;
+};
+
+/// @brief A persistently mapped uniform buffer which is split into regions, one per frame in flight.
+/// Every frame writes into its own region, so the CPU never overwrites data the GPU is still reading.
+/// Within a region, uniform data is sub-allocated by bumping an offset. The descriptor of the buffer
+/// is of type VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, so many draws can share one descriptor set
+/// and select their data with a dynamic offset.
+/// @warning A region must only be written to once the GPU has finished the frame which used it before.
+class UniformRingBuffer : public GPUMemoryBuffer {
+private:
+    /// The alignment of dynamic offsets, which is minUniformBufferOffsetAlignment of the graphics card.
+    VkDeviceSize offset_alignment = 0;
+
+    VkDeviceSize region_size = 0;
+    std::uint32_t region_count = 0;
+
+    /// The size of the uniform data one draw can read through the descriptor.
+    VkDeviceSize descriptor_range = 0;
+
+    std::uint32_t current_region = 0;
+
+    /// The number of bytes which have been allocated from the current region.
+    VkDeviceSize current_region_used = 0;
+
+    [[nodiscard]] static VkDeviceSize align_up(VkDeviceSize size, VkDeviceSize alignment) {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    [[nodiscard]] static VkDeviceSize get_offset_alignment(const VkPhysicalDevice graphics_card);
+
+public:
+    UniformRingBuffer(const UniformRingBuffer &) = delete;
+    UniformRingBuffer(UniformRingBuffer &&other) noexcept;
+
+    UniformRingBuffer &operator=(const UniformRingBuffer &) = delete;
+    UniformRingBuffer &operator=(UniformRingBuffer &&) noexcept = default;
+
+    /// @brief Creates a new uniform ring buffer.
+    /// @param device [in] The Vulkan device from which the buffer will be created.
+    /// @param graphics_card [in] The graphics card, which determines the alignment of the sub-allocations.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param name [in] The internal name of the buffer.
+    /// @param region_size [in] The size of one region in bytes. It is rounded up to the offset alignment.
+    /// @param region_count [in] The number of regions, one per frame in flight.
+    /// @param descriptor_range [in] The size of the uniform data one draw reads, like sizeof(UniformBufferObject).
+    UniformRingBuffer(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, const std::string &name,
+                      const VkDeviceSize region_size, const std::uint32_t region_count, const VkDeviceSize descriptor_range);
+
+    ~UniformRingBuffer() = default;
+
+    /// @brief Starts writing into a region and discards its previous sub-allocations.
+    /// @param region_index [in] The region of the frame which is about to be recorded or submitted.
+    void begin_region(std::uint32_t region_index);
+
+    /// @brief Sub-allocates memory from the current region.
+    /// @param size [in] The size in bytes, which must not exceed the descriptor range.
+    /// @return The mapped memory and the dynamic offset of the sub-allocation.
+    [[nodiscard]] UniformRingAllocation allocate(VkDeviceSize size);
+
+    /// @brief Copies uniform data into the current region.
+    /// @return The dynamic offset of the data.
+    template <typename T>
+    std::uint32_t push(const T &data) {
+        const UniformRingAllocation ring_allocation = allocate(sizeof(T));
+        std::memcpy(ring_allocation.data, &data, sizeof(T));
+        return ring_allocation.dynamic_offset;
+    }
+
+    /// @brief Makes the writes to the current region visible to the GPU, in case the memory is not host coherent.
+    void flush_region();
+
+    /// @brief Returns the dynamic offset of the first sub-allocation of a region.
+    [[nodiscard]] std::uint32_t get_region_offset(std::uint32_t region_index) const {
+        assert(region_index < region_count);
+        return static_cast<std::uint32_t>(region_index * region_size);
+    }
+
+    [[nodiscard]] VkDeviceSize get_descriptor_range() const {
+        return descriptor_range;
+    }
+
+    [[nodiscard]] std::uint32_t get_region_count() const {
+        return region_count;
+    }
+
+    [[nodiscard]] VkDeviceSize get_region_size() const {
+        return region_size;
+    }
+};
+
+} // namespace inexor::vulkan_renderer
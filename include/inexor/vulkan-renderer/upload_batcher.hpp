@@ -0,0 +1,264 @@
+#pragma once
+
+#include "inexor/vulkan-renderer/frame_timeline.hpp"
+#include "inexor/vulkan-renderer/gpu_memory_buffer.hpp"
+#include "inexor/vulkan-renderer/recycling_pools.hpp"
+
+#include <spdlog/spdlog.h>
+#include <vma/vma_usage.h>
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+/// @brief Identifies the batch an upload was recorded into. Batches complete in the order of their tokens.
+using UploadToken = std::uint64_t;
+
+struct UploadBatcherStatistics {
+    std::uint64_t submitted_batches = 0;
+    std::uint64_t uploads = 0;
+    std::uint64_t uploaded_bytes = 0;
+
+    /// The number of uploads which were larger than the staging ring and got a staging buffer of their own.
+    std::uint64_t dedicated_staging_buffers = 0;
+
+    /// How often an upload had to wait for a batch to finish because the staging ring was full.
+    std::uint64_t staging_ring_waits = 0;
+
+    /// The number of buffers and images whose ownership was transferred to the destination queue family.
+    std::uint64_t ownership_transfers = 0;
+};
+
+/// @brief Collects buffer and image uploads into one command buffer and submits them together with one fence.
+/// The data of every upload is copied into a persistently mapped staging ring right away, so the caller can free it.
+/// The copies are recorded into the open batch, which is submitted by flush(), usually once per frame or once after loading.
+/// Every upload returns the token of its batch, which can be used to check or wait for its completion.
+/// The staging memory of a batch is reused once the batch has finished.
+///
+/// The batches can run on a dedicated transfer queue while the graphics queue keeps rendering. In that case every upload
+/// ends with a release barrier to the destination queue family, and the batch signals a semaphore. Once the batch has
+/// finished, collect() submits the matching acquire barriers to the destination queue, waiting on that semaphore.
+/// The acquire is only submitted after the transfer has finished, so the destination queue never stalls on it, and
+/// every later submission to the destination queue sees the uploaded data.
+///
+/// Every submission signals a fence from the fence pool, unless the batcher uses the frame timeline. Then the
+/// submissions signal the timelines of their queues instead, and a batch has finished once its values are reached.
+/// @note This class is not thread safe. Without an ownership transfer, the queue must support graphics operations
+/// because of the image layout transitions.
+class UploadBatcher {
+private:
+    struct Batch {
+        UploadToken token = 0;
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+
+        /// The value of the queue's timeline which the transfer signals, if the frame timeline is used.
+        std::uint64_t transfer_value = 0;
+        bool transfer_pending = false;
+
+        /// The head of the staging ring at submission. All staging memory before it is free once the batch has finished.
+        VkDeviceSize staging_ring_end = 0;
+
+        /// The number of bytes of the staging ring the batch uses, including padding.
+        VkDeviceSize staging_ring_bytes = 0;
+
+        /// Staging buffers for uploads which do not fit into the staging ring.
+        std::vector<std::unique_ptr<GPUMemoryBuffer>> dedicated_staging_buffers;
+
+        bool has_buffer_uploads = false;
+
+        /// The barriers which hand the uploaded resources over to the destination queue family.
+        std::vector<VkBufferMemoryBarrier> buffer_releases;
+        std::vector<VkImageMemoryBarrier> image_releases;
+        std::vector<VkBufferMemoryBarrier> buffer_acquires;
+        std::vector<VkImageMemoryBarrier> image_acquires;
+
+        /// Signaled by the transfer, waited on by the acquire.
+        VkSemaphore transfer_semaphore = VK_NULL_HANDLE;
+
+        /// The command buffer and fence of the acquire, which is submitted to the destination queue.
+        VkCommandBuffer acquire_command_buffer = VK_NULL_HANDLE;
+        VkFence acquire_fence = VK_NULL_HANDLE;
+
+        /// The value of the destination queue's timeline which the acquire signals, if the frame timeline is used.
+        std::uint64_t acquire_value = 0;
+        bool acquire_pending = false;
+
+        /// Commands which are recorded into the acquire, after the acquire barriers.
+        std::vector<std::function<void(VkCommandBuffer)>> destination_commands;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator vma_allocator = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    std::uint32_t queue_family_index = 0;
+    CommandBufferRecycler *command_buffer_recycler = nullptr;
+
+    /// The queue which uses the uploaded resources. Ownership is only transferred if its family differs.
+    VkQueue destination_queue = VK_NULL_HANDLE;
+    std::uint32_t destination_queue_family_index = 0;
+    SemaphorePool *semaphore_pool = nullptr;
+
+    /// The submissions signal the timelines of their queues instead of fences, if this is set.
+    VulkanFrameTimeline *frame_timeline = nullptr;
+
+    std::unique_ptr<GPUMemoryBuffer> staging_ring;
+    VkDeviceSize staging_ring_size = 0;
+    VkDeviceSize staging_ring_head = 0;
+    VkDeviceSize staging_ring_tail = 0;
+    VkDeviceSize staging_ring_used = 0;
+
+    /// The batch which uploads are recorded into, if there is one.
+    std::unique_ptr<Batch> open_batch;
+
+    /// The submitted batches, oldest first.
+    std::deque<std::unique_ptr<Batch>> submitted_batches;
+
+    UploadToken next_token = 1;
+    UploadToken completed_token = 0;
+
+    UploadBatcherStatistics statistics;
+
+    [[nodiscard]] bool transfers_ownership() const {
+        return queue_family_index != destination_queue_family_index;
+    }
+
+    /// @brief Creates the staging ring.
+    void create_staging_ring();
+
+    /// @brief Returns the open batch, and begins a new one if necessary.
+    Batch &get_open_batch();
+
+    /// @brief Tries to allocate staging memory from the ring.
+    /// @return True if the memory was allocated, false if the ring is too full.
+    bool try_allocate_from_staging_ring(VkDeviceSize size, VkDeviceSize &offset);
+
+    /// @brief Copies data into staging memory.
+    /// @param size [in] The size of the data in bytes.
+    /// @param staging_buffer [out] The buffer the data was copied into.
+    /// @param staging_offset [out] The offset of the data in that buffer.
+    void stage(const void *data, VkDeviceSize size, VkBuffer &staging_buffer, VkDeviceSize &staging_offset);
+
+    /// @brief Submits to a queue, through the frame timeline if it is used, otherwise with a fence from the fence pool.
+    /// @param fence [out] The fence which is signaled by the submission, if the frame timeline is not used.
+    /// @param timeline_value [out] The value of the queue's timeline which is signaled by the submission, if the frame timeline is used.
+    void submit(VkQueue submit_queue, const VkSubmitInfo &submit_info, VkFence &fence, std::uint64_t &timeline_value);
+
+    /// @brief Checks if a submission has finished, without waiting.
+    [[nodiscard]] bool is_finished(VkQueue submit_queue, VkFence fence, std::uint64_t timeline_value);
+
+    /// @brief Waits until a submission has finished.
+    void wait_until_finished(VkQueue submit_queue, VkFence fence, std::uint64_t timeline_value);
+
+    /// @brief Waits for the oldest submitted batch and frees its resources.
+    void wait_for_oldest_batch();
+
+    /// @brief Frees the staging memory and the command buffer of a batch whose transfer has finished,
+    /// and submits its acquire to the destination queue if ownership is transferred.
+    void retire_transfer(Batch &batch);
+
+    /// @brief Frees the acquire resources of a batch whose acquire has finished, and completes its token.
+    void retire_acquire(Batch &batch);
+
+public:
+    /// @brief Creates an upload batcher and its staging ring.
+    /// @param device [in] The Vulkan device.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param queue [in] The queue the batches are submitted to.
+    /// @param queue_family_index [in] The queue family index of the queue.
+    /// @param command_buffer_recycler [in] The recycler the command buffers and fences are taken from.
+    /// @param staging_ring_size [in] The size of the staging ring in bytes.
+    UploadBatcher(const VkDevice device, const VmaAllocator vma_allocator, const VkQueue queue, const std::uint32_t queue_family_index,
+                  CommandBufferRecycler &command_buffer_recycler, const VkDeviceSize staging_ring_size);
+
+    /// @brief Creates an upload batcher which uploads on one queue, usually a dedicated transfer queue, for use on another one.
+    /// If both queues are of the same family, this is the same as the upload batcher above.
+    /// @param device [in] The Vulkan device.
+    /// @param vma_allocator [in] The Vulkan Memory Allocator library handle.
+    /// @param queue [in] The queue the batches are submitted to.
+    /// @param queue_family_index [in] The queue family index of the queue.
+    /// @param destination_queue [in] The queue which uses the uploaded resources, usually the graphics queue.
+    /// @param destination_queue_family_index [in] The queue family index of the destination queue.
+    /// @param command_buffer_recycler [in] The recycler the command buffers and fences are taken from.
+    /// @param semaphore_pool [in] The pool of the semaphores between the transfers and the acquires.
+    /// @param staging_ring_size [in] The size of the staging ring in bytes.
+    UploadBatcher(const VkDevice device, const VmaAllocator vma_allocator, const VkQueue queue, const std::uint32_t queue_family_index,
+                  const VkQueue destination_queue, const std::uint32_t destination_queue_family_index, CommandBufferRecycler &command_buffer_recycler,
+                  SemaphorePool &semaphore_pool, const VkDeviceSize staging_ring_size);
+
+    UploadBatcher(const UploadBatcher &) = delete;
+    UploadBatcher &operator=(const UploadBatcher &) = delete;
+
+    /// @brief Waits for all batches. An open batch is discarded, flush() it before if it is needed.
+    ~UploadBatcher();
+
+    /// @brief Signals the timelines of the queues instead of fences from now on.
+    /// @param frame_timeline [in] The frame timeline, which must track the queue and the destination queue.
+    /// @warning No batch may be pending, see wait_idle().
+    void use_frame_timeline(VulkanFrameTimeline &frame_timeline);
+
+    /// @brief Uploads data into a buffer. The buffer range is owned by the destination queue family afterwards.
+    /// @param buffer [in] The buffer, which must have VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+    /// @param buffer_offset [in] The offset in bytes at which the data is written.
+    /// @param data [in] The data, which is copied before this method returns.
+    /// @param size [in] The size of the data in bytes.
+    UploadToken upload_buffer(VkBuffer buffer, VkDeviceSize buffer_offset, const void *data, VkDeviceSize size);
+
+    /// @brief Uploads data into an image. The image is transitioned from VK_IMAGE_LAYOUT_UNDEFINED to
+    /// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL before the copy and to the final layout after it.
+    /// @param image [in] The image, which must have VK_IMAGE_USAGE_TRANSFER_DST_BIT.
+    /// @param subresource_range [in] The part of the image which is transitioned.
+    /// @param regions [in] The copy regions. Their buffer offsets are relative to the data.
+    /// @param data [in] The data, which is copied before this method returns.
+    /// @param size [in] The size of the data in bytes.
+    /// @param final_layout [in] The layout of the image after the upload. If this is VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    /// no transition is recorded after the copy, for example to generate mip levels with record().
+    UploadToken upload_image(VkImage image, const VkImageSubresourceRange &subresource_range, const std::vector<VkBufferImageCopy> &regions,
+                             const void *data, VkDeviceSize size, VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    /// @brief Records custom commands into the open batch, after all uploads which were recorded before.
+    /// @warning The commands run on the batcher's queue. This is not supported if ownership is transferred.
+    UploadToken record(const std::function<void(VkCommandBuffer)> &commands);
+
+    /// @brief Records custom commands which run on the destination queue, after all uploads of the open batch, for example
+    /// blits which the transfer queue doesn't support. Without an ownership transfer, this is the same as record().
+    /// Otherwise the commands are recorded into the acquire of the batch, after the acquire barriers, once the transfer has finished.
+    /// @warning The commands are called later, so they must not capture anything which might be gone by then.
+    UploadToken record_on_destination(std::function<void(VkCommandBuffer)> commands);
+
+    /// @brief Submits the open batch.
+    /// @return The token of the submitted batch, or the token of the last batch if there was nothing to submit.
+    UploadToken flush();
+
+    /// @brief Frees the resources of all batches which have finished, and submits their acquires, without waiting.
+    /// This should be called once per frame, before the frame is submitted to the destination queue.
+    void collect();
+
+    /// @brief Checks if the batch of a token has finished, including the acquire on the destination queue.
+    [[nodiscard]] bool is_complete(UploadToken token);
+
+    /// @brief Waits until the batch of a token has finished. The open batch is submitted if necessary.
+    void wait(UploadToken token);
+
+    /// @brief Submits the open batch and waits for all batches.
+    void wait_idle();
+
+    /// @brief Returns the size of the staging ring and of all dedicated staging buffers in bytes.
+    [[nodiscard]] VkDeviceSize get_staging_memory_size() const;
+
+    [[nodiscard]] std::uint32_t get_queue_family_index() const {
+        return queue_family_index;
+    }
+
+    [[nodiscard]] const UploadBatcherStatistics &get_statistics() const {
+        return statistics;
+    }
+};
+
+} // namespace inexor::vulkan_renderer
@@ -0,0 +1,414 @@
+#include "inexor/vulkan-renderer/allocation_statistics_stream.hpp"
+
+#include <array>
+#include <cassert>
+#include <functional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace inexor::vulkan_renderer {
+
+// The file starts with a header, which is followed by records. All values are little endian and unpadded.
+//
+// Header: char[8] "INXALLOC", u32 version, u32 heap count, per heap { u64 size, u32 flags },
+//         u32 memory type count, per memory type { u32 heap index, u32 property flags }.
+//
+// Every record starts with a u8 record type. 0 is a snapshot, all other values are the AllocationEventType + 1.
+//
+// Event:    u32 thread id, u32 frame index, f64 time, u64 handle, followed by
+//           CREATE_BUFFER: u32 flags, u64 size, u32 usage, u32 sharing mode, allocation create info.
+//           CREATE_IMAGE: u32 flags, image type, format, width, height, depth, mip levels, array layers, samples,
+//                         tiling, usage, sharing mode, initial layout, allocation create info.
+//           ALLOCATE_DEVICE_MEMORY, FREE_DEVICE_MEMORY: u32 memory type, u64 size.
+//           Allocation create info: u32 flags, usage, required flags, preferred flags, memory type bits, u64 pool.
+//
+// Snapshot: u32 frame index, f64 time, u64 dropped events, statistics of all memory,
+//           per heap { u64 block bytes, u64 allocation bytes, u64 usage, u64 budget, statistics },
+//           per memory type { statistics }.
+//           Statistics: u32 blocks, allocations, unused ranges, u64 used bytes, unused bytes,
+//                       allocation size min, avg, max, unused range size min, avg, max.
+
+namespace {
+
+constexpr char FILE_MAGIC[8] = {'I', 'N', 'X', 'A', 'L', 'L', 'O', 'C'};
+constexpr std::uint32_t FILE_VERSION = 1;
+
+constexpr std::uint8_t SNAPSHOT_RECORD = 0;
+
+/// The streams by allocator. The shared lock is held while an event is recorded, so a stream can't be destroyed meanwhile.
+std::shared_mutex registry_mutex;
+std::unordered_map<VmaAllocator, AllocationStatisticsStream *> registry;
+
+/// Lets recording skip the registry lock while no stream exists.
+std::atomic<std::size_t> registry_size = 0;
+
+template <typename T>
+void append(std::vector<std::uint8_t> &bytes, const T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    const auto *value_bytes = reinterpret_cast<const std::uint8_t *>(&value);
+    bytes.insert(bytes.end(), value_bytes, value_bytes + sizeof(T));
+}
+
+void append_allocation_create_info(std::vector<std::uint8_t> &bytes, const VmaAllocationCreateInfo &allocation_create_info) {
+    append<std::uint32_t>(bytes, allocation_create_info.flags);
+    append<std::uint32_t>(bytes, allocation_create_info.usage);
+    append<std::uint32_t>(bytes, allocation_create_info.requiredFlags);
+    append<std::uint32_t>(bytes, allocation_create_info.preferredFlags);
+    append<std::uint32_t>(bytes, allocation_create_info.memoryTypeBits);
+    append<std::uint64_t>(bytes, reinterpret_cast<std::uint64_t>(allocation_create_info.pool));
+}
+
+void append_stat_info(std::vector<std::uint8_t> &bytes, const VmaStatInfo &stat_info) {
+    append<std::uint32_t>(bytes, stat_info.blockCount);
+    append<std::uint32_t>(bytes, stat_info.allocationCount);
+    append<std::uint32_t>(bytes, stat_info.unusedRangeCount);
+    append<std::uint64_t>(bytes, stat_info.usedBytes);
+    append<std::uint64_t>(bytes, stat_info.unusedBytes);
+    append<std::uint64_t>(bytes, stat_info.allocationSizeMin);
+    append<std::uint64_t>(bytes, stat_info.allocationSizeAvg);
+    append<std::uint64_t>(bytes, stat_info.allocationSizeMax);
+    append<std::uint64_t>(bytes, stat_info.unusedRangeSizeMin);
+    append<std::uint64_t>(bytes, stat_info.unusedRangeSizeAvg);
+    append<std::uint64_t>(bytes, stat_info.unusedRangeSizeMax);
+}
+
+std::uint32_t get_thread_id() {
+    thread_local const auto thread_id = static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    return thread_id;
+}
+
+} // namespace
+
+AllocationStatisticsStream::AllocationStatisticsStream(const VmaAllocator vma_allocator, const AllocationStatisticsSettings &settings)
+    : vma_allocator(vma_allocator), settings(settings), events(settings.event_capacity) {
+    assert(vma_allocator);
+    assert(settings.event_capacity > 0);
+
+    file.open(settings.file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Error: Could not open allocation statistics file " + settings.file_name + "!");
+    }
+
+    const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+    vmaGetMemoryProperties(vma_allocator, &memory_properties);
+
+    std::vector<std::uint8_t> header;
+
+    header.insert(header.end(), std::begin(FILE_MAGIC), std::end(FILE_MAGIC));
+    append<std::uint32_t>(header, FILE_VERSION);
+
+    append<std::uint32_t>(header, memory_properties->memoryHeapCount);
+    for (std::uint32_t heap_index = 0; heap_index < memory_properties->memoryHeapCount; heap_index++) {
+        append<std::uint64_t>(header, memory_properties->memoryHeaps[heap_index].size);
+        append<std::uint32_t>(header, memory_properties->memoryHeaps[heap_index].flags);
+    }
+
+    append<std::uint32_t>(header, memory_properties->memoryTypeCount);
+    for (std::uint32_t type_index = 0; type_index < memory_properties->memoryTypeCount; type_index++) {
+        append<std::uint32_t>(header, memory_properties->memoryTypes[type_index].heapIndex);
+        append<std::uint32_t>(header, memory_properties->memoryTypes[type_index].propertyFlags);
+    }
+
+    write(header);
+
+    {
+        std::unique_lock<std::shared_mutex> lock(registry_mutex);
+
+        const bool inserted = registry.insert({vma_allocator, this}).second;
+        if (!inserted) {
+            throw std::runtime_error("Error: An allocation statistics stream is already attached to this allocator!");
+        }
+
+        registry_size.store(registry.size(), std::memory_order_release);
+    }
+
+    spdlog::debug("Writing allocation statistics to {}.", settings.file_name);
+
+    writer_thread = std::thread(&AllocationStatisticsStream::write_loop, this);
+}
+
+AllocationStatisticsStream::~AllocationStatisticsStream() {
+    {
+        // Once the stream is detached, no more events are recorded.
+        std::unique_lock<std::shared_mutex> lock(registry_mutex);
+
+        registry.erase(vma_allocator);
+        registry_size.store(registry.size(), std::memory_order_release);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        stop_writer = true;
+    }
+
+    writer_condition.notify_one();
+    writer_thread.join();
+
+    std::vector<std::uint8_t> bytes;
+
+    encode_events(bytes);
+    encode_snapshot(bytes);
+    write(bytes);
+
+    file.close();
+
+    const auto statistics = get_statistics();
+
+    spdlog::debug("Wrote {} allocation events and {} snapshots ({} bytes) to {}, {} events were dropped.", statistics.recorded_events,
+                  statistics.snapshots, statistics.written_bytes, settings.file_name, statistics.dropped_events);
+}
+
+const VmaDeviceMemoryCallbacks *AllocationStatisticsStream::get_device_memory_callbacks() {
+    static const VmaDeviceMemoryCallbacks device_memory_callbacks = {&AllocationStatisticsStream::on_allocate_device_memory,
+                                                                     &AllocationStatisticsStream::on_free_device_memory};
+    return &device_memory_callbacks;
+}
+
+void AllocationStatisticsStream::record(VmaAllocator vma_allocator, AllocationEvent &event) {
+    if (registry_size.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(registry_mutex);
+
+    auto stream = registry.find(vma_allocator);
+    if (stream != registry.end()) {
+        stream->second->record(event);
+    }
+}
+
+void AllocationStatisticsStream::record(AllocationEvent &event) {
+    event.thread_id = get_thread_id();
+    event.frame_index = frame_index.load(std::memory_order_relaxed);
+    event.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    std::lock_guard<std::mutex> lock(events_mutex);
+
+    if (event_count == events.size()) {
+        dropped_events.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    events[(first_event + event_count) % events.size()] = event;
+    event_count++;
+
+    recorded_events.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocationStatisticsStream::on_create_buffer(VmaAllocator vma_allocator, const VkBufferCreateInfo &buffer_create_info,
+                                                  const VmaAllocationCreateInfo &allocation_create_info, VmaAllocation allocation) {
+    AllocationEvent event;
+
+    event.type = AllocationEventType::CREATE_BUFFER;
+    event.handle = reinterpret_cast<std::uint64_t>(allocation);
+    event.buffer_create_info = buffer_create_info;
+    event.buffer_create_info.pNext = nullptr;
+    event.buffer_create_info.pQueueFamilyIndices = nullptr;
+    event.allocation_create_info = allocation_create_info;
+    event.allocation_create_info.pUserData = nullptr;
+
+    record(vma_allocator, event);
+}
+
+void AllocationStatisticsStream::on_destroy_buffer(VmaAllocator vma_allocator, VmaAllocation allocation) {
+    AllocationEvent event;
+
+    event.type = AllocationEventType::DESTROY_BUFFER;
+    event.handle = reinterpret_cast<std::uint64_t>(allocation);
+
+    record(vma_allocator, event);
+}
+
+void AllocationStatisticsStream::on_create_image(VmaAllocator vma_allocator, const VkImageCreateInfo &image_create_info,
+                                                 const VmaAllocationCreateInfo &allocation_create_info, VmaAllocation allocation) {
+    AllocationEvent event;
+
+    event.type = AllocationEventType::CREATE_IMAGE;
+    event.handle = reinterpret_cast<std::uint64_t>(allocation);
+    event.image_create_info = image_create_info;
+    event.image_create_info.pNext = nullptr;
+    event.image_create_info.pQueueFamilyIndices = nullptr;
+    event.allocation_create_info = allocation_create_info;
+    event.allocation_create_info.pUserData = nullptr;
+
+    record(vma_allocator, event);
+}
+
+void AllocationStatisticsStream::on_destroy_image(VmaAllocator vma_allocator, VmaAllocation allocation) {
+    AllocationEvent event;
+
+    event.type = AllocationEventType::DESTROY_IMAGE;
+    event.handle = reinterpret_cast<std::uint64_t>(allocation);
+
+    record(vma_allocator, event);
+}
+
+void VKAPI_CALL AllocationStatisticsStream::on_allocate_device_memory(VmaAllocator vma_allocator, std::uint32_t memory_type, VkDeviceMemory memory,
+                                                                      VkDeviceSize size) {
+    AllocationEvent event;
+
+    event.type = AllocationEventType::ALLOCATE_DEVICE_MEMORY;
+    event.handle = reinterpret_cast<std::uint64_t>(memory);
+    event.memory_type = memory_type;
+    event.size = size;
+
+    record(vma_allocator, event);
+}
+
+void VKAPI_CALL AllocationStatisticsStream::on_free_device_memory(VmaAllocator vma_allocator, std::uint32_t memory_type, VkDeviceMemory memory,
+                                                                  VkDeviceSize size) {
+    AllocationEvent event;
+
+    event.type = AllocationEventType::FREE_DEVICE_MEMORY;
+    event.handle = reinterpret_cast<std::uint64_t>(memory);
+    event.memory_type = memory_type;
+    event.size = size;
+
+    record(vma_allocator, event);
+}
+
+void AllocationStatisticsStream::write_loop() {
+    std::vector<std::uint8_t> bytes;
+
+    auto last_snapshot_time = std::chrono::steady_clock::now() - settings.snapshot_interval;
+
+    std::unique_lock<std::mutex> lock(writer_mutex);
+
+    while (!stop_writer) {
+        writer_condition.wait_for(lock, settings.write_interval, [&]() { return stop_writer; });
+
+        // The stream is not locked while the events are encoded and written.
+        lock.unlock();
+
+        bytes.clear();
+
+        encode_events(bytes);
+
+        const auto now = std::chrono::steady_clock::now();
+
+        if (now - last_snapshot_time >= settings.snapshot_interval) {
+            encode_snapshot(bytes);
+            last_snapshot_time = now;
+        }
+
+        write(bytes);
+
+        lock.lock();
+    }
+}
+
+void AllocationStatisticsStream::encode_events(std::vector<std::uint8_t> &bytes) {
+    std::vector<AllocationEvent> pending_events;
+
+    {
+        // Only the events are copied under the lock, so recording is never blocked by encoding.
+        std::lock_guard<std::mutex> lock(events_mutex);
+
+        pending_events.reserve(event_count);
+
+        for (std::size_t event_index = 0; event_index < event_count; event_index++) {
+            pending_events.push_back(events[(first_event + event_index) % events.size()]);
+        }
+
+        first_event = 0;
+        event_count = 0;
+    }
+
+    for (const auto &event : pending_events) {
+        append<std::uint8_t>(bytes, static_cast<std::uint8_t>(static_cast<std::uint8_t>(event.type) + 1));
+        append<std::uint32_t>(bytes, event.thread_id);
+        append<std::uint32_t>(bytes, event.frame_index);
+        append<double>(bytes, event.time);
+        append<std::uint64_t>(bytes, event.handle);
+
+        switch (event.type) {
+        case AllocationEventType::CREATE_BUFFER:
+            append<std::uint32_t>(bytes, event.buffer_create_info.flags);
+            append<std::uint64_t>(bytes, event.buffer_create_info.size);
+            append<std::uint32_t>(bytes, event.buffer_create_info.usage);
+            append<std::uint32_t>(bytes, event.buffer_create_info.sharingMode);
+            append_allocation_create_info(bytes, event.allocation_create_info);
+            break;
+        case AllocationEventType::CREATE_IMAGE:
+            append<std::uint32_t>(bytes, event.image_create_info.flags);
+            append<std::uint32_t>(bytes, event.image_create_info.imageType);
+            append<std::uint32_t>(bytes, event.image_create_info.format);
+            append<std::uint32_t>(bytes, event.image_create_info.extent.width);
+            append<std::uint32_t>(bytes, event.image_create_info.extent.height);
+            append<std::uint32_t>(bytes, event.image_create_info.extent.depth);
+            append<std::uint32_t>(bytes, event.image_create_info.mipLevels);
+            append<std::uint32_t>(bytes, event.image_create_info.arrayLayers);
+            append<std::uint32_t>(bytes, event.image_create_info.samples);
+            append<std::uint32_t>(bytes, event.image_create_info.tiling);
+            append<std::uint32_t>(bytes, event.image_create_info.usage);
+            append<std::uint32_t>(bytes, event.image_create_info.sharingMode);
+            append<std::uint32_t>(bytes, event.image_create_info.initialLayout);
+            append_allocation_create_info(bytes, event.allocation_create_info);
+            break;
+        case AllocationEventType::ALLOCATE_DEVICE_MEMORY:
+        case AllocationEventType::FREE_DEVICE_MEMORY:
+            append<std::uint32_t>(bytes, event.memory_type);
+            append<std::uint64_t>(bytes, event.size);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void AllocationStatisticsStream::encode_snapshot(std::vector<std::uint8_t> &bytes) {
+    const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+    vmaGetMemoryProperties(vma_allocator, &memory_properties);
+
+    // This traverses all memory blocks, which is why it's done on the writer thread, and only once per snapshot interval.
+    VmaStats stats = {};
+    vmaCalculateStats(vma_allocator, &stats);
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets = {};
+    vmaGetBudget(vma_allocator, budgets.data());
+
+    append<std::uint8_t>(bytes, SNAPSHOT_RECORD);
+    append<std::uint32_t>(bytes, frame_index.load(std::memory_order_relaxed));
+    append<double>(bytes, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
+    append<std::uint64_t>(bytes, dropped_events.load(std::memory_order_relaxed));
+
+    append_stat_info(bytes, stats.total);
+
+    for (std::uint32_t heap_index = 0; heap_index < memory_properties->memoryHeapCount; heap_index++) {
+        append<std::uint64_t>(bytes, budgets[heap_index].blockBytes);
+        append<std::uint64_t>(bytes, budgets[heap_index].allocationBytes);
+        append<std::uint64_t>(bytes, budgets[heap_index].usage);
+        append<std::uint64_t>(bytes, budgets[heap_index].budget);
+        append_stat_info(bytes, stats.memoryHeap[heap_index]);
+    }
+
+    for (std::uint32_t type_index = 0; type_index < memory_properties->memoryTypeCount; type_index++) {
+        append_stat_info(bytes, stats.memoryType[type_index]);
+    }
+
+    snapshots.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocationStatisticsStream::write(const std::vector<std::uint8_t> &bytes) {
+    if (bytes.empty()) {
+        return;
+    }
+
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    // This hands the data to the operating system, so it survives a crash of the application, but it doesn't wait for the disk.
+    file.flush();
+
+    written_bytes.fetch_add(bytes.size(), std::memory_order_relaxed);
+}
+
+AllocationStatisticsStreamStatistics AllocationStatisticsStream::get_statistics() const {
+    return {recorded_events.load(std::memory_order_relaxed), dropped_events.load(std::memory_order_relaxed), snapshots.load(std::memory_order_relaxed),
+            written_bytes.load(std::memory_order_relaxed)};
+}
+
+} // namespace inexor::vulkan_renderer
@@ -1,6 +1,8 @@
 #include "inexor/vulkan-renderer/application.hpp"
 #include "inexor/vulkan-renderer/debug_callback.hpp"
 
+#include <cmath>
+
 namespace inexor::vulkan_renderer {
 
 /// @brief Static callback for window resize events.
@@ -93,6 +95,17 @@ VkResult Application::load_toml_configuration_file(const std::string &file_name)
         spdlog::debug("{}", fragment_shader_file);
     }
 
+    thread_pool_settings.thread_count = toml::find<std::size_t>(renderer_configuration, "threadpool", "threads");
+    thread_pool_settings.reserved_core_count = toml::find<std::size_t>(renderer_configuration, "threadpool", "reserved_cores");
+    thread_pool_settings.pin_threads = toml::find<bool>(renderer_configuration, "threadpool", "pin_threads");
+    thread_pool_settings.avoid_smt_siblings = toml::find<bool>(renderer_configuration, "threadpool", "avoid_smt_siblings");
+    thread_pool_settings.cpu_affinity = toml::find<std::vector<std::size_t>>(renderer_configuration, "threadpool", "cpu_affinity");
+    thread_pool_settings.auto_scaling = toml::find<bool>(renderer_configuration, "threadpool", "auto_scaling");
+    thread_pool_settings.min_active_thread_count = toml::find<std::size_t>(renderer_configuration, "threadpool", "min_active_threads");
+
+    spdlog::debug("Threadpool: {} threads, {} reserved cores, pinning {}", thread_pool_settings.thread_count, thread_pool_settings.reserved_core_count,
+                  thread_pool_settings.pin_threads ? "enabled" : "disabled");
+
     // TODO: Load more info from TOML file.
 
     return VK_SUCCESS;
@@ -103,6 +116,8 @@ VkResult Application::load_textures() {
     assert(selected_graphics_card);
     assert(debug_marker_manager);
     assert(vma_allocator);
+    assert(thread_pool);
+    assert(sampler_cache);
 
     // TODO: Refactor! use key from TOML file as name!
     std::size_t texture_number = 1;
@@ -110,9 +125,27 @@ VkResult Application::load_textures() {
     // Insert the new texture into the list of textures.
     std::string texture_name = "unnamed texture";
 
+    // The texture files are decoded in parallel. The main thread waits for them, so the decoding must not be a background task,
+    // which might not be started while the frame budget is used up.
+    std::vector<std::future<TextureFile>> decoded_texture_files;
+
     for (const auto &texture_file : texture_files) {
-        textures.emplace_back(device, selected_graphics_card, vma_allocator, texture_file, texture_name, gpu_queue_manager->get_graphics_queue(),
-                              gpu_queue_manager->get_graphics_family_index().value());
+        decoded_texture_files.push_back(thread_pool->execute([texture_file]() { return TextureFile(texture_file); }));
+    }
+
+    // The textures are created in the order of the configuration, their uploads are recorded into the same batch.
+    for (auto &decoded_texture_file : decoded_texture_files) {
+        textures.emplace_back(device, selected_graphics_card, vma_allocator, decoded_texture_file.get(), texture_name, *transfer_upload_batcher,
+                              *sampler_cache, MipmapGeneration::AUTOMATIC, texture_streamer != nullptr);
+    }
+
+    // The textures are added once the vector isn't resized anymore, because the streamer keeps pointers to them.
+    if (texture_streamer) {
+        for (auto &texture : textures) {
+            if (texture.is_streamed()) {
+                texture_streamer->add_texture(texture);
+            }
+        }
     }
 
     return VK_SUCCESS;
@@ -163,20 +196,39 @@ VkResult Application::render_frame() {
     assert(gpu_queue_manager->get_graphics_queue());
     assert(gpu_queue_manager->get_present_queue());
 
-    vkWaitForFences(device, 1, &(*in_flight_fences[current_frame]), VK_TRUE, UINT64_MAX);
+    VkQueue graphics_queue = gpu_queue_manager->get_graphics_queue();
 
-    std::uint32_t image_index = 0;
-    VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, *image_available_semaphores[current_frame], VK_NULL_HANDLE, &image_index);
+    VkFence in_flight_fence = VK_NULL_HANDLE;
+    VkSemaphore image_available_semaphore = semaphore_manager->get_semaphore(image_available_semaphores[current_frame]);
+    VkSemaphore rendering_finished_semaphore = semaphore_manager->get_semaphore(rendering_finished_semaphores[current_frame]);
+
+    // The value of this frame on the graphics queue's timeline, if the frame timeline is enabled.
+    std::uint64_t frame_number = 0;
 
-    if (images_in_flight[image_index] != VK_NULL_HANDLE) {
-        vkWaitForFences(device, 1, &*images_in_flight[image_index], VK_TRUE, UINT64_MAX);
+    if (frame_timeline_enabled) {
+        // Wait for the frame which used the semaphores of this frame before. The uploads signal the timeline as well,
+        // so its value is remembered instead of being calculated from the current one.
+        if (in_flight_frame_numbers[current_frame] != 0) {
+            frame_timeline->wait_for_value(graphics_queue, in_flight_frame_numbers[current_frame]);
+        }
+    } else {
+        in_flight_fence = fence_manager->get_fence(in_flight_fences[current_frame]);
+        vkWaitForFences(device, 1, &in_flight_fence, VK_TRUE, UINT64_MAX);
     }
 
-    // Update the data which changes every frame!
-    update_uniform_buffers(current_frame);
+    std::uint32_t image_index = 0;
+    VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, image_available_semaphore, VK_NULL_HANDLE, &image_index);
+
+    if (frame_timeline_enabled) {
+        if (image_frame_numbers[image_index] != 0) {
+            frame_timeline->wait_for_value(graphics_queue, image_frame_numbers[image_index]);
+        }
+    } else if (images_in_flight[image_index] != VK_NULL_HANDLE) {
+        vkWaitForFences(device, 1, &images_in_flight[image_index], VK_TRUE, UINT64_MAX);
+    }
 
     // Mark the image as now being in use by this frame.
-    images_in_flight[image_index] = in_flight_fences[current_frame];
+    images_in_flight[image_index] = in_flight_fence;
 
     // Is it time to regenerate the swapchain because window has been resized or minimized?
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -194,6 +246,29 @@ VkResult Application::render_frame() {
         exit(-1);
     }
 
+    // Update the data which changes every frame!
+    // The previous submission which used this image has finished, so its region of the uniform ring buffer is free.
+    update_uniform_buffers(image_index);
+
+    // The command buffer still uses buffers which the memory defragmenter has moved, and it is no longer in use.
+    if (command_buffers_outdated[image_index]) {
+        if (record_command_buffer(image_index) != VK_SUCCESS) {
+            std::string error_message = "Error: Failed to record command buffer!";
+            display_error_message(error_message);
+            exit(-1);
+        }
+
+        command_buffers_outdated[image_index] = false;
+    }
+
+    // Uploads which were recorded since the last frame are submitted before the frame on the same queue, so the frame sees them.
+    upload_batcher->flush();
+    upload_batcher->collect();
+
+    // The streamed uploads keep running on the data transfer queue. Finished ones are acquired by the graphics queue before the frame.
+    transfer_upload_batcher->flush();
+    transfer_upload_batcher->collect();
+
     const VkPipelineStageFlags wait_stage_mask[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -203,20 +278,32 @@ VkResult Application::render_frame() {
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &command_buffers[image_index];
     submit_info.signalSemaphoreCount = 1;
-    submit_info.pWaitSemaphores = &*image_available_semaphores[current_frame];
-    submit_info.pSignalSemaphores = &*rendering_finished_semaphores[current_frame];
+    submit_info.pWaitSemaphores = &image_available_semaphore;
+    submit_info.pSignalSemaphores = &rendering_finished_semaphore;
 
-    vkResetFences(device, 1, &*in_flight_fences[current_frame]);
+    if (frame_timeline_enabled) {
+        // This signals the frame number on the graphics queue's timeline.
+        result = frame_timeline->submit(graphics_queue, submit_info, VK_NULL_HANDLE, frame_number);
+    } else {
+        vkResetFences(device, 1, &in_flight_fence);
+
+        result = vkQueueSubmit(graphics_queue, 1, &submit_info, in_flight_fence);
+    }
 
-    result = vkQueueSubmit(gpu_queue_manager->get_graphics_queue(), 1, &submit_info, *in_flight_fences[current_frame]);
     if (result != VK_SUCCESS) {
         return result;
     }
 
+    // The frame number is only known to be signaled once the frame has been submitted.
+    if (frame_timeline_enabled) {
+        in_flight_frame_numbers[current_frame] = frame_number;
+        image_frame_numbers[image_index] = frame_number;
+    }
+
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     present_info.pNext = nullptr;
     present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = &*rendering_finished_semaphores[current_frame];
+    present_info.pWaitSemaphores = &rendering_finished_semaphore;
     present_info.swapchainCount = 1;
     present_info.pSwapchains = &swapchain;
     present_info.pImageIndices = &image_index;
@@ -280,9 +367,25 @@ VkResult Application::load_octree_geometry() {
 
     const std::string octree_mesh_name = "unnamed octree";
 
-    // Create a mesh buffer for octree vertex geometry.
-    mesh_buffers.emplace_back(device, gpu_queue_manager->get_data_transfer_queue(), gpu_queue_manager->get_data_transfer_queue_family_index().value(),
-                              vma_allocator, octree_mesh_name, sizeof(OctreeVertex), octree_vertices.size(), octree_vertices.data());
+    if (!octree_mesh_arena) {
+        octree_mesh_arena = std::make_unique<MeshArena>(device, *upload_batcher, vma_allocator, "octree mesh arena", sizeof(OctreeVertex),
+                                                        OCTREE_MESH_ARENA_VERTEX_CAPACITY, 0);
+    }
+
+    // The octree geometry becomes a range of the arena's vertex buffer.
+    auto octree_mesh = octree_mesh_arena->add_mesh(octree_mesh_name, octree_vertices.data(), static_cast<std::uint32_t>(octree_vertices.size()));
+
+    if (!octree_mesh) {
+        spdlog::error("The octree mesh arena is full!");
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    octree_meshes.push_back(octree_mesh.value());
+
+    const auto arena_statistics = octree_mesh_arena->get_statistics();
+
+    spdlog::debug("Octree mesh arena: {} meshes, {:.1f}% of vertices used, fragmentation {:.2f}.", arena_statistics.mesh_count,
+                  arena_statistics.vertices.get_occupancy() * 100.0f, arena_statistics.vertices.get_fragmentation());
 
     return VK_SUCCESS;
 }
@@ -322,17 +425,55 @@ VkResult Application::check_application_specific_features() {
 VkResult Application::init() {
     spdlog::debug("Initialising vulkan-renderer.");
 
-    spdlog::debug("Initialising thread-pool with {} threads.", std::thread::hardware_concurrency());
+    // Load the configuration from the TOML file.
+    VkResult result = load_toml_configuration_file("configuration/renderer.toml");
+
+    vulkan_error_check(result);
+
+    // The command line arguments override the threadpool settings of the TOML file.
+    std::optional<std::uint32_t> thread_count = get_command_line_argument_uint32("-threads");
 
-    // TOOD: Implement -threads <N> command line argument.
+    if (thread_count.has_value()) {
+        thread_pool_settings.thread_count = thread_count.value();
+    }
+
+    std::optional<std::uint32_t> reserved_core_count = get_command_line_argument_uint32("-reserved_cores");
+
+    if (reserved_core_count.has_value()) {
+        thread_pool_settings.reserved_core_count = reserved_core_count.value();
+    }
+
+    std::optional<bool> pin_threads = is_command_line_argument_specified("-pin_threads");
+
+    if (pin_threads.has_value() && pin_threads.value()) {
+        thread_pool_settings.pin_threads = true;
+    }
+
+    // The user can specify with "-thread_affinity <list>" which cores to use, for example "-thread_affinity 2-7,10".
+    std::optional<std::string> thread_affinity = get_command_line_argument_string("-thread_affinity");
+
+    if (thread_affinity.has_value()) {
+        auto cpu_affinity = tools::parse_cpu_list(thread_affinity.value());
+
+        if (cpu_affinity.has_value()) {
+            thread_pool_settings.cpu_affinity = cpu_affinity.value();
+        } else {
+            spdlog::error("Invalid CPU core list '{}' for -thread_affinity!", thread_affinity.value());
+        }
+    }
+
+    spdlog::debug("Initialising thread-pool.");
 
     // Initialise Inexor thread-pool.
-    thread_pool = std::make_shared<ThreadPool>();
+    thread_pool = std::make_shared<ThreadPool>(thread_pool_settings);
 
-    // Load the configuration from the TOML file.
-    VkResult result = load_toml_configuration_file("configuration/renderer.toml");
+    // The user can specify with "-threadpool_stats <frames>" how often the threadpool statistics should be logged.
+    std::optional<std::uint32_t> threadpool_statistics_interval = get_command_line_argument_uint32("-threadpool_stats");
 
-    vulkan_error_check(result);
+    if (threadpool_statistics_interval.has_value()) {
+        spdlog::debug("Logging threadpool statistics every {} frames.", threadpool_statistics_interval.value());
+        thread_pool->set_statistics_log_interval(threadpool_statistics_interval.value());
+    }
 
     spdlog::debug("Creating window.");
 
@@ -546,7 +687,33 @@ VkResult Application::init() {
         enable_debug_marker_device_extension = false;
     }
 
-    result = create_physical_device(selected_graphics_card, enable_debug_marker_device_extension);
+    spdlog::debug("Checking for -timeline_semaphores command line argument.");
+
+    std::optional<bool> use_timeline_semaphores = is_command_line_argument_specified("-timeline_semaphores");
+
+    if (use_timeline_semaphores.has_value() && use_timeline_semaphores.value()) {
+        if (availability_checks_manager->has_device_extension(selected_graphics_card, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) &&
+            VulkanFrameTimeline::is_supported(selected_graphics_card)) {
+            spdlog::debug("Frames will be synchronised with timeline semaphores.");
+            frame_timeline_enabled = true;
+        } else {
+            spdlog::warn("Timeline semaphores are not supported by this graphics card, frames will be synchronised with fences.");
+        }
+    }
+
+    VkPhysicalDeviceProperties graphics_card_properties;
+    vkGetPhysicalDeviceProperties(selected_graphics_card, &graphics_card_properties);
+
+    // VMA needs Vulkan 1.1 to query the budget.
+    if (availability_checks_manager->has_device_extension(selected_graphics_card, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) &&
+        graphics_card_properties.apiVersion >= VK_API_VERSION_1_1) {
+        spdlog::debug("The memory budget will be queried with VK_EXT_memory_budget.");
+        memory_budget_enabled = true;
+    } else {
+        spdlog::debug("VK_EXT_memory_budget is not supported, the memory budget will be estimated from the heap sizes.");
+    }
+
+    result = create_physical_device(selected_graphics_card, enable_debug_marker_device_extension, frame_timeline_enabled, memory_budget_enabled);
     vulkan_error_check(result);
 
     result = check_application_specific_features();
@@ -556,12 +723,58 @@ VkResult Application::init() {
     result = initialise_debug_marker_manager(enable_debug_marker_device_extension);
     vulkan_error_check(result);
 
+    spdlog::debug("Checking for -vma_statistics command line argument.");
+
+    std::optional<bool> enable_vma_statistics = is_command_line_argument_specified("-vma_statistics");
+
+    if (enable_vma_statistics.has_value() && enable_vma_statistics.value()) {
+        spdlog::debug("Allocation statistics will be streamed to the vma-statistics folder.");
+        allocation_statistics_enabled = true;
+    }
+
     result = create_vma_allocator();
     vulkan_error_check(result);
 
+    spdlog::debug("Checking for -texture_streaming command line argument.");
+
+    std::optional<std::uint32_t> texture_streaming_budget = get_command_line_argument_uint32("-texture_streaming");
+
+    if (texture_streaming_budget.has_value()) {
+        TextureStreamerSettings texture_streamer_settings;
+        texture_streamer_settings.budget = static_cast<VkDeviceSize>(texture_streaming_budget.value()) * 1024 * 1024;
+        texture_streamer_settings.frames_in_flight = MAX_FRAMES_IN_FLIGHT;
+
+        spdlog::debug("Texture streaming is enabled with a budget of {} MiB.", texture_streaming_budget.value());
+        texture_streamer = std::make_unique<TextureStreamer>(texture_streamer_settings);
+    }
+
+    if (GPUMemoryBuffer::decide_memory_placement(vma_allocator) == MemoryPlacement::HOST_VISIBLE_DIRECT) {
+        spdlog::debug("Static meshes are written directly into device local, host visible memory.");
+    } else {
+        spdlog::debug("Static meshes are uploaded into device local memory through staging buffers.");
+    }
+
+    memory_budget_tracker = std::make_unique<MemoryBudgetTracker>(vma_allocator);
+
     result = gpu_queue_manager->setup_queues(device);
     vulkan_error_check(result);
 
+    fence_pool = std::make_unique<FencePool>(device);
+    semaphore_pool = std::make_unique<SemaphorePool>(device);
+    command_buffer_recycler = std::make_unique<CommandBufferRecycler>(device, *fence_pool);
+    sampler_cache = std::make_unique<SamplerCache>(device);
+
+    // The uploads include image layout transitions, so they are submitted to the graphics queue.
+    upload_batcher = std::make_unique<UploadBatcher>(device, vma_allocator, gpu_queue_manager->get_graphics_queue(),
+                                                     gpu_queue_manager->get_graphics_family_index().value(), *command_buffer_recycler,
+                                                     UPLOAD_BATCHER_STAGING_RING_SIZE);
+
+    // Without a distinct data transfer queue, both queues are the same and no ownership is transferred.
+    transfer_upload_batcher = std::make_unique<UploadBatcher>(
+        device, vma_allocator, gpu_queue_manager->get_data_transfer_queue(), gpu_queue_manager->get_data_transfer_queue_family_index().value(),
+        gpu_queue_manager->get_graphics_queue(), gpu_queue_manager->get_graphics_family_index().value(), *command_buffer_recycler, *semaphore_pool,
+        UPLOAD_BATCHER_STAGING_RING_SIZE);
+
     result = create_swapchain();
     vulkan_error_check(result);
 
@@ -606,15 +819,97 @@ VkResult Application::init() {
     result = load_octree_geometry();
     vulkan_error_check(result);
 
+    // The providers are only called by the memory budget tracker's update, once everything they report on exists.
+    memory_budget_tracker->add_usage_provider(MemoryTag::MESHES, [&]() {
+        VkDeviceSize mesh_memory_size = octree_mesh_arena ? octree_mesh_arena->get_memory_size() : 0;
+        for (const auto &mesh_buffer : mesh_buffers) {
+            mesh_memory_size += mesh_buffer.get_memory_size();
+        }
+        return mesh_memory_size;
+    });
+
+    memory_budget_tracker->add_usage_provider(MemoryTag::TEXTURES, [&]() {
+        VkDeviceSize texture_memory_size = 0;
+        for (const auto &texture : textures) {
+            texture_memory_size += texture.get_allocation_info().size;
+        }
+        return texture_memory_size;
+    });
+
+    if (texture_streamer) {
+        // Dropping mip levels only relieves the heap the streamed textures are allocated from, not the host visible heaps.
+        std::optional<std::uint32_t> texture_heap_index;
+
+        const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+        vmaGetMemoryProperties(vma_allocator, &memory_properties);
+
+        for (const auto &texture : textures) {
+            if (texture.is_streamed()) {
+                texture_heap_index = memory_properties->memoryTypes[texture.get_allocation_info().memoryType].heapIndex;
+                break;
+            }
+        }
+
+        // The dropped mip levels are streamed in again once the budget isn't lowered anymore.
+        memory_budget_tracker->add_eviction_handler(
+            MemoryTag::TEXTURES, [&, texture_heap_index](std::uint32_t heap_index, MemoryPressure, VkDeviceSize bytes_to_free) -> VkDeviceSize {
+                if (heap_index != texture_heap_index) {
+                    return 0;
+                }
+                return texture_streamer->evict(bytes_to_free);
+            });
+
+        // The descriptor sets and command buffers are updated once the previous submission of their swapchain image has finished.
+        texture_streamer->set_residency_callback([&]() {
+            texture_descriptors_outdated.assign(texture_descriptors_outdated.size(), true);
+            command_buffers_outdated.assign(command_buffers_outdated.size(), true);
+        });
+    }
+
+    memory_budget_tracker->add_usage_provider(MemoryTag::UNIFORMS, [&]() { return uniform_ring_buffer->get_allocation_info().size; });
+
+    memory_budget_tracker->add_usage_provider(MemoryTag::STAGING, [&]() {
+        return upload_batcher->get_staging_memory_size() + transfer_upload_batcher->get_staging_memory_size();
+    });
+
+    // All textures and meshes which were loaded so far are uploaded in one submission.
+    spdlog::debug("Uploading {} bytes of textures and meshes.",
+                  upload_batcher->get_statistics().uploaded_bytes + transfer_upload_batcher->get_statistics().uploaded_bytes);
+    transfer_upload_batcher->flush();
+    upload_batcher->wait_idle();
+    transfer_upload_batcher->wait_idle();
+
     result = record_command_buffers();
     vulkan_error_check(result);
 
+    // The copies of the moved buffers are submitted with the uploads on the graphics queue, before the next frame.
+    memory_defragmenter = std::make_unique<MemoryDefragmenter>(device, vma_allocator, *upload_batcher);
+
+    memory_defragmenter->add_buffer_provider([&](std::vector<GPUMemoryBuffer *> &buffers) { octree_mesh_arena->get_gpu_memory_buffers(buffers); });
+
+    memory_defragmenter->set_relocation_callback([&]() { command_buffers_outdated.assign(command_buffers_outdated.size(), true); });
+
     result = fence_manager->init(device, debug_marker_manager);
     vulkan_error_check(result);
 
     result = semaphore_manager->init(device, debug_marker_manager);
     vulkan_error_check(result);
 
+    if (frame_timeline_enabled) {
+        result = frame_timeline->init(device, {gpu_queue_manager->get_graphics_queue(), gpu_queue_manager->get_data_transfer_queue()});
+        vulkan_error_check(result);
+
+        // The uploads signal the timelines of their queues instead of fences, and the old buffers and images are kept
+        // until the graphics queue's timeline shows that the frames which use them have finished.
+        upload_batcher->use_frame_timeline(*frame_timeline);
+        transfer_upload_batcher->use_frame_timeline(*frame_timeline);
+        memory_defragmenter->use_frame_timeline(*frame_timeline, gpu_queue_manager->get_graphics_queue());
+
+        if (texture_streamer) {
+            texture_streamer->use_frame_timeline(*frame_timeline, gpu_queue_manager->get_graphics_queue());
+        }
+    }
+
     result = create_synchronisation_objects();
     vulkan_error_check(result);
 
@@ -631,7 +926,7 @@ VkResult Application::init() {
     return recreate_swapchain();
 }
 
-VkResult Application::update_uniform_buffers(const std::size_t current_image) {
+VkResult Application::update_uniform_buffers(const std::uint32_t image_index) {
     float time = time_step.get_time_step_since_initialisation();
 
     UniformBufferObject ubo = {};
@@ -643,8 +938,13 @@ VkResult Application::update_uniform_buffers(const std::size_t current_image) {
     ubo.proj = game_camera.matrices.perspective;
     ubo.proj[1][1] *= -1;
 
-    // TODO: Don't use vector of uniform buffers.
-    uniform_buffers[0].update(&ubo, sizeof(ubo));
+    uniform_ring_buffer->begin_region(image_index);
+
+    // The command buffers expect the matrices at the start of the region.
+    [[maybe_unused]] const std::uint32_t dynamic_offset = uniform_ring_buffer->push(ubo);
+    assert(dynamic_offset == uniform_ring_buffer->get_region_offset(image_index));
+
+    uniform_ring_buffer->flush_region();
 
     return VK_SUCCESS;
 }
@@ -692,9 +992,41 @@ void Application::run() {
     spdlog::debug("Running Application.");
 
     while (!glfwWindowShouldClose(window)) {
+        // Background tasks of the threadpool must not delay the frame.
+        thread_pool->begin_frame(THREADPOOL_FRAME_BUDGET);
+
         glfwPollEvents();
         render_frame();
 
+        // Query the memory budget and evict resources if a heap is running out of memory.
+        memory_budget_tracker->update();
+
+        // Move a few buffers to compact device local memory, if it has become fragmented.
+        memory_defragmenter->update();
+
+        // Stream the mip levels of the textures in and out, depending on their size on the screen.
+        // Only the first texture is used, by the octree, whose bounding sphere is the default cube.
+        if (texture_streamer) {
+            const glm::vec3 octree_center = world::DEFAULT_CUBE_POSITION + glm::vec3(world::DEFAULT_CUBE_SIZE * 0.5f);
+            const float octree_radius = world::DEFAULT_CUBE_SIZE * 0.5f * std::sqrt(3.0f);
+
+            texture_streamer->set_screen_size(textures[0], game_camera.estimate_screen_size(octree_center, octree_radius, static_cast<float>(window_height)));
+            texture_streamer->update();
+        }
+
+        if (allocation_statistics_stream) {
+            allocation_statistics_stream->next_frame();
+        }
+
+        // Resume everything which waits for a fence, like coroutines which wait for an upload.
+        // Errors like VK_ERROR_DEVICE_LOST are passed to the callbacks as well, so the waiting coroutines can fail.
+        vulkan_error_check(fence_manager->poll_fence_callbacks());
+
+        // Run deferred deletions and uploads of finished frames.
+        if (frame_timeline_enabled) {
+            frame_timeline->run_completed_tasks();
+        }
+
         // TODO: Run this in a separated thread?
         // TODO: Merge into one update_game_data() method?
         update_keyboard_input();
@@ -1,5 +1,8 @@
 #include "inexor/vulkan-renderer/camera.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace inexor::vulkan_renderer {
 void Camera::update_view_matrix() {
     glm::mat4 rot_m = glm::mat4(1.0f);
@@ -32,6 +35,19 @@ float Camera::get_far_clip() {
     return z_far;
 }
 
+float Camera::estimate_screen_size(const glm::vec3 &center, const float radius, const float viewport_height) const {
+    const float distance = glm::length(glm::vec3(matrices.view * glm::vec4(center, 1.0f)));
+
+    if (distance <= radius) {
+        return viewport_height;
+    }
+
+    // The projected radius relative to half of the viewport height.
+    const float projected_radius = radius / (distance * std::tan(glm::radians(fov) * 0.5f));
+
+    return std::min(projected_radius, 1.0f) * viewport_height;
+}
+
 void Camera::set_perspective(float fov, float aspect, float z_near, float z_far) {
     this->fov = fov;
     this->z_near = z_near;
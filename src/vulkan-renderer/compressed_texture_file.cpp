@@ -0,0 +1,354 @@
+#include "inexor/vulkan-renderer/compressed_texture_file.hpp"
+
+#include "inexor/vulkan-renderer/tools/file.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+namespace inexor::vulkan_renderer {
+
+namespace {
+
+constexpr std::array<std::uint8_t, 12> KTX2_IDENTIFIER{0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// The header, the index and one entry of the level index of a KTX2 file.
+constexpr std::size_t KTX2_HEADER_SIZE = 80;
+constexpr std::size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+// The magic number, the header and the optional DX10 header of a DDS file.
+constexpr std::size_t DDS_HEADER_SIZE = 4 + 124;
+constexpr std::size_t DDS_DX10_HEADER_SIZE = 20;
+
+// The fields of the header which are only valid if their flag is set.
+constexpr std::uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr std::uint32_t DDSD_DEPTH = 0x800000;
+
+constexpr std::uint32_t DDS_CAPS2_CUBEMAP = 0x200;
+constexpr std::uint32_t DDS_RESOURCE_DIMENSION_TEXTURE2D = 3;
+constexpr std::uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+// The DXGI formats of the BC formats in the DX10 header.
+constexpr std::uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+constexpr std::uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+constexpr std::uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+constexpr std::uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+constexpr std::uint32_t DXGI_FORMAT_BC5_UNORM = 83;
+constexpr std::uint32_t DXGI_FORMAT_BC5_SNORM = 84;
+constexpr std::uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+constexpr std::uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+
+constexpr std::uint32_t make_four_cc(const char a, const char b, const char c, const char d) {
+    return static_cast<std::uint32_t>(a) | (static_cast<std::uint32_t>(b) << 8) | (static_cast<std::uint32_t>(c) << 16) |
+           (static_cast<std::uint32_t>(d) << 24);
+}
+
+/// @brief Reads a little endian value from the file data.
+template <typename T>
+T read(const std::vector<char> &file_data, const std::size_t offset) {
+    assert(offset + sizeof(T) <= file_data.size());
+
+    T value;
+    std::memcpy(&value, file_data.data() + offset, sizeof(T));
+    return value;
+}
+
+/// @brief Returns the number of mip levels of a full mip chain, which ends with a 1x1 level.
+std::uint32_t get_max_level_count(const std::uint32_t width, const std::uint32_t height) {
+    std::uint32_t max_level_count = 1;
+    while ((std::max(width, height) >> max_level_count) > 0) {
+        max_level_count++;
+    }
+    return max_level_count;
+}
+
+bool ends_with(const std::string &file_name, const std::string &extension) {
+    if (file_name.size() < extension.size()) {
+        return false;
+    }
+
+    return std::equal(extension.rbegin(), extension.rend(), file_name.rbegin(),
+                      [](const char a, const char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+}
+
+} // namespace
+
+CompressedTextureFile::CompressedTextureFile(const std::string &file_name) : file_name(file_name) {
+    assert(!file_name.empty());
+
+    tools::File file;
+
+    if (!file.load_file(file_name)) {
+        throw std::runtime_error("Error: Could not load compressed texture file " + file_name + "!");
+    }
+
+    if (ends_with(file_name, ".ktx2")) {
+        load_ktx2(file.get_file_data());
+    } else if (ends_with(file_name, ".dds")) {
+        load_dds(file.get_file_data());
+    } else {
+        throw std::runtime_error("Error: " + file_name + " is neither a KTX2 nor a DDS file!");
+    }
+
+    spdlog::debug("Compressed texture {}: width: {}, height: {}, format: {}, mip levels: {}.", file_name, width, height,
+                  static_cast<std::uint32_t>(format), mip_levels.size());
+}
+
+bool CompressedTextureFile::is_compressed_texture_file(const std::string &file_name) {
+    return ends_with(file_name, ".ktx2") || ends_with(file_name, ".dds");
+}
+
+bool CompressedTextureFile::get_block_info(const VkFormat format, CompressedBlockInfo &block_info) {
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        block_info = {4, 4, 8};
+        return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        block_info = {4, 4, 16};
+        return true;
+    default:
+        break;
+    }
+
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+        // The ASTC formats come in pairs of UNORM and SRGB, ordered by their block size. Every block has 16 bytes.
+        constexpr std::array<std::array<std::uint32_t, 2>, 14> ASTC_BLOCK_SIZES{
+            {{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}}};
+
+        const auto &block_size = ASTC_BLOCK_SIZES[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+
+        block_info = {block_size[0], block_size[1], 16};
+        return true;
+    }
+
+    return false;
+}
+
+bool CompressedTextureFile::is_format_supported(const VkPhysicalDevice graphics_card, const VkFormat format) {
+    assert(graphics_card);
+
+    VkPhysicalDeviceFeatures device_features;
+    vkGetPhysicalDeviceFeatures(graphics_card, &device_features);
+
+    const bool is_astc_format = format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+
+    if (is_astc_format ? device_features.textureCompressionASTC_LDR != VK_TRUE : device_features.textureCompressionBC != VK_TRUE) {
+        return false;
+    }
+
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(graphics_card, format, &format_properties);
+
+    const VkFormatFeatureFlags required_features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    return (format_properties.optimalTilingFeatures & required_features) == required_features;
+}
+
+void CompressedTextureFile::load_ktx2(const std::vector<char> &file_data) {
+    if (file_data.size() < KTX2_HEADER_SIZE || std::memcmp(file_data.data(), KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) != 0) {
+        throw std::runtime_error("Error: " + file_name + " is not a KTX2 file!");
+    }
+
+    format = static_cast<VkFormat>(read<std::uint32_t>(file_data, 12));
+    width = read<std::uint32_t>(file_data, 20);
+    height = read<std::uint32_t>(file_data, 24);
+
+    const auto depth = read<std::uint32_t>(file_data, 28);
+    const auto layer_count = read<std::uint32_t>(file_data, 32);
+    const auto face_count = read<std::uint32_t>(file_data, 36);
+    const auto supercompression_scheme = read<std::uint32_t>(file_data, 44);
+
+    // A level count of 0 asks the loader to generate the mip levels, which can't be done for compressed formats.
+    const auto level_count = std::max(read<std::uint32_t>(file_data, 40), 1u);
+
+    if (supercompression_scheme != 0) {
+        throw std::runtime_error("Error: " + file_name + " is supercompressed, which is not supported!");
+    }
+
+    if (width == 0 || height == 0 || depth != 0 || layer_count > 1 || face_count != 1) {
+        throw std::runtime_error("Error: " + file_name + " is not a 2D texture!");
+    }
+
+    if (level_count > get_max_level_count(width, height)) {
+        throw std::runtime_error("Error: " + file_name + " has more mip levels than its size allows!");
+    }
+
+    if (file_data.size() < KTX2_HEADER_SIZE + level_count * KTX2_LEVEL_INDEX_ENTRY_SIZE) {
+        throw std::runtime_error("Error: The level index of " + file_name + " is truncated!");
+    }
+
+    std::vector<std::uint64_t> level_offsets(level_count);
+    std::vector<std::uint64_t> level_sizes(level_count);
+
+    for (std::uint32_t level = 0; level < level_count; level++) {
+        const std::size_t entry_offset = KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+
+        level_offsets[level] = read<std::uint64_t>(file_data, entry_offset);
+        level_sizes[level] = read<std::uint64_t>(file_data, entry_offset + 8);
+    }
+
+    copy_mip_levels(file_data, level_offsets, level_sizes);
+}
+
+void CompressedTextureFile::load_dds(const std::vector<char> &file_data) {
+    if (file_data.size() < DDS_HEADER_SIZE || read<std::uint32_t>(file_data, 0) != make_four_cc('D', 'D', 'S', ' ')) {
+        throw std::runtime_error("Error: " + file_name + " is not a DDS file!");
+    }
+
+    const auto flags = read<std::uint32_t>(file_data, 8);
+
+    height = read<std::uint32_t>(file_data, 12);
+    width = read<std::uint32_t>(file_data, 16);
+
+    // Writers may leave garbage in the depth and the mip level count if their flags are not set.
+    const auto depth = (flags & DDSD_DEPTH) != 0 ? read<std::uint32_t>(file_data, 24) : 1u;
+    const auto level_count = (flags & DDSD_MIPMAPCOUNT) != 0 ? std::max(read<std::uint32_t>(file_data, 28), 1u) : 1u;
+    const auto four_cc = read<std::uint32_t>(file_data, 84);
+    const auto caps2 = read<std::uint32_t>(file_data, 112);
+
+    if (width == 0 || height == 0 || depth > 1 || (caps2 & DDS_CAPS2_CUBEMAP) != 0) {
+        throw std::runtime_error("Error: " + file_name + " is not a 2D texture!");
+    }
+
+    // The level count must be checked before the level sizes are calculated, which shift the size by the level.
+    if (level_count > get_max_level_count(width, height)) {
+        throw std::runtime_error("Error: " + file_name + " has more mip levels than its size allows!");
+    }
+
+    std::size_t data_offset = DDS_HEADER_SIZE;
+
+    if (four_cc == make_four_cc('D', 'X', '1', '0')) {
+        if (file_data.size() < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE) {
+            throw std::runtime_error("Error: The DX10 header of " + file_name + " is truncated!");
+        }
+
+        const auto dxgi_format = read<std::uint32_t>(file_data, DDS_HEADER_SIZE);
+        const auto resource_dimension = read<std::uint32_t>(file_data, DDS_HEADER_SIZE + 4);
+        const auto misc_flag = read<std::uint32_t>(file_data, DDS_HEADER_SIZE + 8);
+        const auto array_size = read<std::uint32_t>(file_data, DDS_HEADER_SIZE + 12);
+
+        if (resource_dimension != DDS_RESOURCE_DIMENSION_TEXTURE2D || (misc_flag & DDS_RESOURCE_MISC_TEXTURECUBE) != 0 || array_size > 1) {
+            throw std::runtime_error("Error: " + file_name + " is not a 2D texture!");
+        }
+
+        switch (dxgi_format) {
+        case DXGI_FORMAT_BC1_UNORM:
+            format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+            break;
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+            format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+            break;
+        case DXGI_FORMAT_BC3_UNORM:
+            format = VK_FORMAT_BC3_UNORM_BLOCK;
+            break;
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            format = VK_FORMAT_BC3_SRGB_BLOCK;
+            break;
+        case DXGI_FORMAT_BC5_UNORM:
+            format = VK_FORMAT_BC5_UNORM_BLOCK;
+            break;
+        case DXGI_FORMAT_BC5_SNORM:
+            format = VK_FORMAT_BC5_SNORM_BLOCK;
+            break;
+        case DXGI_FORMAT_BC7_UNORM:
+            format = VK_FORMAT_BC7_UNORM_BLOCK;
+            break;
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            format = VK_FORMAT_BC7_SRGB_BLOCK;
+            break;
+        default:
+            throw std::runtime_error("Error: DXGI format " + std::to_string(dxgi_format) + " of " + file_name + " is not supported!");
+        }
+
+        data_offset += DDS_DX10_HEADER_SIZE;
+    } else if (four_cc == make_four_cc('D', 'X', 'T', '1')) {
+        format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    } else if (four_cc == make_four_cc('D', 'X', 'T', '5')) {
+        format = VK_FORMAT_BC3_UNORM_BLOCK;
+    } else if (four_cc == make_four_cc('A', 'T', 'I', '2') || four_cc == make_four_cc('B', 'C', '5', 'U')) {
+        format = VK_FORMAT_BC5_UNORM_BLOCK;
+    } else {
+        throw std::runtime_error("Error: The pixel format of " + file_name + " is not supported!");
+    }
+
+    CompressedBlockInfo block_info;
+    const bool is_block_format = get_block_info(format, block_info);
+    assert(is_block_format);
+
+    // The mip levels of a DDS file follow each other without padding, largest level first.
+    std::vector<std::uint64_t> level_offsets(level_count);
+    std::vector<std::uint64_t> level_sizes(level_count);
+
+    for (std::uint32_t level = 0; level < level_count; level++) {
+        const std::uint64_t blocks_x = (std::max(width >> level, 1u) + block_info.width - 1) / block_info.width;
+        const std::uint64_t blocks_y = (std::max(height >> level, 1u) + block_info.height - 1) / block_info.height;
+
+        level_offsets[level] = data_offset;
+        level_sizes[level] = blocks_x * blocks_y * block_info.size;
+
+        data_offset += level_sizes[level];
+    }
+
+    copy_mip_levels(file_data, level_offsets, level_sizes);
+}
+
+void CompressedTextureFile::copy_mip_levels(const std::vector<char> &file_data, const std::vector<std::uint64_t> &level_offsets,
+                                            const std::vector<std::uint64_t> &level_sizes) {
+    assert(level_offsets.size() == level_sizes.size());
+
+    CompressedBlockInfo block_info;
+
+    if (!get_block_info(format, block_info)) {
+        throw std::runtime_error("Error: Format " + std::to_string(format) + " of " + file_name + " is not a supported block compressed format!");
+    }
+
+    if (level_offsets.size() > get_max_level_count(width, height)) {
+        throw std::runtime_error("Error: " + file_name + " has more mip levels than its size allows!");
+    }
+
+    mip_levels.clear();
+    data.clear();
+
+    for (std::size_t level = 0; level < level_offsets.size(); level++) {
+        const std::uint32_t level_width = std::max(width >> level, 1u);
+        const std::uint32_t level_height = std::max(height >> level, 1u);
+
+        const std::uint64_t blocks_x = (level_width + block_info.width - 1) / block_info.width;
+        const std::uint64_t blocks_y = (level_height + block_info.height - 1) / block_info.height;
+
+        if (level_sizes[level] != blocks_x * blocks_y * block_info.size) {
+            throw std::runtime_error("Error: Mip level " + std::to_string(level) + " of " + file_name + " has the wrong size!");
+        }
+
+        if (level_offsets[level] > file_data.size() || level_sizes[level] > file_data.size() - level_offsets[level]) {
+            throw std::runtime_error("Error: Mip level " + std::to_string(level) + " of " + file_name + " is truncated!");
+        }
+
+        CompressedMipLevel mip_level;
+
+        mip_level.offset = data.size();
+        mip_level.size = level_sizes[level];
+        mip_level.width = level_width;
+        mip_level.height = level_height;
+
+        const auto *level_data = reinterpret_cast<const std::uint8_t *>(file_data.data()) + level_offsets[level];
+        data.insert(data.end(), level_data, level_data + level_sizes[level]);
+
+        mip_levels.push_back(mip_level);
+    }
+}
+
+} // namespace inexor::vulkan_renderer
@@ -142,6 +142,23 @@ void Descriptor::create_descriptor_sets() {
     spdlog::debug("Created descriptor sets for descriptor {} successfully.", name);
 }
 
+void Descriptor::update_image_descriptor(const std::uint32_t set_index, const std::uint32_t binding, const VkDescriptorImageInfo &image_info) {
+    assert(set_index < descriptor_sets.size());
+    assert(binding < descriptor_set_layout_bindings.size());
+
+    VkWriteDescriptorSet write_descriptor_set = {};
+
+    write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_descriptor_set.dstSet = descriptor_sets[set_index];
+    write_descriptor_set.dstBinding = binding;
+    write_descriptor_set.dstArrayElement = 0;
+    write_descriptor_set.descriptorType = descriptor_set_layout_bindings[binding].descriptorType;
+    write_descriptor_set.descriptorCount = 1;
+    write_descriptor_set.pImageInfo = &image_info;
+
+    vkUpdateDescriptorSets(device, 1, &write_descriptor_set, 0, nullptr);
+}
+
 Descriptor::~Descriptor() {
     assert(device);
 
@@ -1,28 +1,48 @@
 #include "inexor/vulkan-renderer/fence_manager.hpp"
 
+#include <algorithm>
+#include <utility>
+
 namespace inexor::vulkan_renderer {
 
-VkResult VulkanFenceManager::init(const VkDevice &device, const std::shared_ptr<VulkanDebugMarkerManager> debug_marker_manager) {
+VkResult VulkanFenceManager::init(const VkDevice &device, const std::shared_ptr<VulkanDebugMarkerManager> debug_marker_manager,
+                                  const PFN_vkGetFenceStatus get_fence_status) {
     assert(device);
     assert(debug_marker_manager);
+    assert(get_fence_status);
 
-    spdlog::debug("Initialising semaphore manager.");
+    spdlog::debug("Initialising fence manager.");
 
     this->device = device;
     this->debug_marker_manager = debug_marker_manager;
+    this->get_fence_status = get_fence_status;
 
     fence_manager_initialised = true;
 
     return VK_SUCCESS;
 }
 
-bool VulkanFenceManager::does_fence_exist(const std::string &fence_name) {
+bool VulkanFenceManager::does_fence_exist(const HashedName &fence_name) {
     assert(fence_manager_initialised);
     assert(!fence_name.empty());
 
     return does_key_exist(fence_name);
 }
 
+VkResult VulkanFenceManager::create_vulkan_fence(bool create_as_signaled, VkFence &fence) {
+    VkFenceCreateInfo fence_create_info = {};
+
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_create_info.pNext = nullptr;
+
+    if (create_as_signaled) {
+        // Create this fence in a signaled state!
+        fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    }
+
+    return vkCreateFence(device, &fence_create_info, nullptr, &fence);
+}
+
 std::optional<std::shared_ptr<VkFence>> VulkanFenceManager::create_fence(const std::string &fence_name, bool create_as_signaled) {
     assert(fence_manager_initialised);
     assert(!fence_name.empty());
@@ -34,19 +54,9 @@ std::optional<std::shared_ptr<VkFence>> VulkanFenceManager::create_fence(const s
         return std::nullopt;
     }
 
-    VkFenceCreateInfo fence_create_info = {};
-
-    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_create_info.pNext = nullptr;
-
-    if (create_as_signaled) {
-        // Create this fence in a signaled state!
-        fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    }
-
     std::shared_ptr<VkFence> new_fence = std::make_shared<VkFence>();
 
-    VkResult result = vkCreateFence(device, &fence_create_info, nullptr, &(*new_fence));
+    VkResult result = create_vulkan_fence(create_as_signaled, *new_fence);
     if (result != VK_SUCCESS) {
         vulkan_error_check(result);
         return std::nullopt;
@@ -58,18 +68,117 @@ std::optional<std::shared_ptr<VkFence>> VulkanFenceManager::create_fence(const s
     return new_fence;
 }
 
-std::optional<std::shared_ptr<VkFence>> VulkanFenceManager::get_fence(const std::string &fence_name) {
+std::optional<std::shared_ptr<VkFence>> VulkanFenceManager::get_fence(const HashedName &fence_name) {
     assert(fence_manager_initialised);
     assert(!fence_name.empty());
 
     if (!does_key_exist(fence_name)) {
-        spdlog::error("Vulkan fence '{}' does not exists!", fence_name);
+        spdlog::error("Vulkan fence '{}' does not exists!", get_key_name(fence_name));
         return std::nullopt;
     }
 
     return get_entry(fence_name);
 }
 
+std::optional<FenceHandle> VulkanFenceManager::create_fence_handle(const std::string &debug_name, bool create_as_signaled) {
+    assert(fence_manager_initialised);
+    assert(device);
+
+    VkFence new_fence = VK_NULL_HANDLE;
+
+    VkResult result = create_vulkan_fence(create_as_signaled, new_fence);
+    if (result != VK_SUCCESS) {
+        vulkan_error_check(result);
+        return std::nullopt;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(fences_mutex);
+
+    return fences.insert(new_fence, debug_name);
+}
+
+VkFence VulkanFenceManager::get_fence(FenceHandle fence_handle) {
+    std::shared_lock<std::shared_mutex> lock(fences_mutex);
+
+    const VkFence *fence = fences.get(fence_handle);
+
+    if (fence == nullptr) {
+        spdlog::error("Vulkan fence handle {} is stale!", fence_handle.get_value());
+        return VK_NULL_HANDLE;
+    }
+
+    return *fence;
+}
+
+void VulkanFenceManager::destroy_fence(FenceHandle fence_handle) {
+    assert(device);
+
+    std::unique_lock<std::shared_mutex> lock(fences_mutex);
+
+    const VkFence *fence = fences.get(fence_handle);
+
+    if (fence == nullptr) {
+        spdlog::error("Vulkan fence handle {} is stale!", fence_handle.get_value());
+        return;
+    }
+
+    vkDestroyFence(device, *fence, nullptr);
+
+    fences.erase(fence_handle);
+}
+
+void VulkanFenceManager::add_fence_callback(VkFence fence, std::function<void(VkResult)> callback) {
+    assert(fence_manager_initialised);
+    assert(fence);
+    assert(callback);
+
+    std::lock_guard<std::mutex> lock(fence_callbacks_mutex);
+
+    fence_callbacks.push_back({fence, std::move(callback)});
+}
+
+VkResult VulkanFenceManager::poll_fence_callbacks() {
+    assert(fence_manager_initialised);
+    assert(device);
+
+    std::vector<std::pair<std::function<void(VkResult)>, VkResult>> finished_callbacks;
+
+    {
+        std::lock_guard<std::mutex> lock(fence_callbacks_mutex);
+
+        std::vector<FenceCallback> pending_callbacks;
+
+        for (auto &fence_callback : fence_callbacks) {
+            const VkResult result = get_fence_status(device, fence_callback.fence);
+
+            if (result == VK_NOT_READY) {
+                pending_callbacks.push_back(std::move(fence_callback));
+            } else {
+                finished_callbacks.emplace_back(std::move(fence_callback.callback), result);
+            }
+        }
+
+        fence_callbacks = std::move(pending_callbacks);
+    }
+
+    VkResult first_error = VK_SUCCESS;
+
+    // The callbacks are called without holding the lock, so they can register new callbacks.
+    for (auto &[callback, result] : finished_callbacks) {
+        if (result != VK_SUCCESS) {
+            spdlog::error("vkGetFenceStatus failed for a fence with callbacks: {}", get_error_description_text(result));
+
+            if (first_error == VK_SUCCESS) {
+                first_error = result;
+            }
+        }
+
+        callback(result);
+    }
+
+    return first_error;
+}
+
 void VulkanFenceManager::shutdown_fences() {
     assert(device);
     assert(fence_manager_initialised);
@@ -87,6 +196,14 @@ void VulkanFenceManager::shutdown_fences() {
     }
 
     delete_all_entries();
+
+    std::unique_lock<std::shared_mutex> fences_lock(fences_mutex);
+
+    for (auto fence : fences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+
+    fences.clear();
 }
 
 } // namespace inexor::vulkan_renderer
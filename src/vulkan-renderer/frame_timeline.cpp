@@ -0,0 +1,256 @@
+#include "inexor/vulkan-renderer/frame_timeline.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace inexor::vulkan_renderer {
+
+bool VulkanFrameTimeline::is_supported(const VkPhysicalDevice &graphics_card) {
+    assert(graphics_card);
+
+    VkPhysicalDeviceProperties graphics_card_properties;
+    vkGetPhysicalDeviceProperties(graphics_card, &graphics_card_properties);
+
+    // vkGetPhysicalDeviceFeatures2 is part of Vulkan 1.1.
+    if (graphics_card_properties.apiVersion < VK_API_VERSION_1_1) {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_features = {};
+    timeline_semaphore_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2 graphics_card_features = {};
+    graphics_card_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    graphics_card_features.pNext = &timeline_semaphore_features;
+
+    vkGetPhysicalDeviceFeatures2(graphics_card, &graphics_card_features);
+
+    return timeline_semaphore_features.timelineSemaphore == VK_TRUE;
+}
+
+VkResult VulkanFrameTimeline::init(const VkDevice &device, const std::vector<VkQueue> &queues) {
+    assert(device);
+    assert(!frame_timeline_initialised);
+
+    spdlog::debug("Initialising frame timeline.");
+
+    this->device = device;
+
+    vkGetSemaphoreCounterValueKHR = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+    vkWaitSemaphoresKHR = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+
+    if (vkGetSemaphoreCounterValueKHR == nullptr || vkWaitSemaphoresKHR == nullptr) {
+        spdlog::error("VK_KHR_timeline_semaphore is not enabled!");
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    for (const auto queue : queues) {
+        assert(queue);
+
+        // The graphics queue might be used for data transfer as well.
+        if (queue_timelines.find(queue) != queue_timelines.end()) {
+            continue;
+        }
+
+        VkSemaphoreTypeCreateInfoKHR semaphore_type_create_info = {};
+        semaphore_type_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+        semaphore_type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+        semaphore_type_create_info.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphore_create_info = {};
+        semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_create_info.pNext = &semaphore_type_create_info;
+
+        QueueTimeline queue_timeline;
+
+        VkResult result = vkCreateSemaphore(device, &semaphore_create_info, nullptr, &queue_timeline.semaphore);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        queue_timelines.insert({queue, queue_timeline});
+    }
+
+    frame_timeline_initialised = true;
+
+    return VK_SUCCESS;
+}
+
+VulkanFrameTimeline::QueueTimeline &VulkanFrameTimeline::get_queue_timeline(VkQueue queue) {
+    auto queue_timeline = queue_timelines.find(queue);
+
+    if (queue_timeline == queue_timelines.end()) {
+        throw std::runtime_error("Error: The queue is not tracked by the frame timeline!");
+    }
+
+    return queue_timeline->second;
+}
+
+std::uint64_t VulkanFrameTimeline::get_completed_value_locked(VkQueue queue) {
+    std::uint64_t completed_value = 0;
+
+    VkResult result = vkGetSemaphoreCounterValueKHR(device, get_queue_timeline(queue).semaphore, &completed_value);
+    vulkan_error_check(result);
+
+    return completed_value;
+}
+
+VkResult VulkanFrameTimeline::submit(VkQueue queue, const VkSubmitInfo &submit_info, VkFence fence, std::uint64_t &signaled_value) {
+    assert(frame_timeline_initialised);
+    assert(submit_info.pNext == nullptr);
+
+    std::lock_guard<std::mutex> lock(frame_timeline_mutex);
+
+    QueueTimeline &queue_timeline = get_queue_timeline(queue);
+
+    std::vector<VkSemaphore> signal_semaphores(submit_info.pSignalSemaphores, submit_info.pSignalSemaphores + submit_info.signalSemaphoreCount);
+    signal_semaphores.push_back(queue_timeline.semaphore);
+
+    // The values of binary semaphores are ignored.
+    std::vector<std::uint64_t> wait_semaphore_values(submit_info.waitSemaphoreCount, 0);
+    std::vector<std::uint64_t> signal_semaphore_values(signal_semaphores.size(), 0);
+    signal_semaphore_values.back() = queue_timeline.last_submitted_value + 1;
+
+    VkTimelineSemaphoreSubmitInfoKHR timeline_submit_info = {};
+    timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timeline_submit_info.waitSemaphoreValueCount = static_cast<std::uint32_t>(wait_semaphore_values.size());
+    timeline_submit_info.pWaitSemaphoreValues = wait_semaphore_values.data();
+    timeline_submit_info.signalSemaphoreValueCount = static_cast<std::uint32_t>(signal_semaphore_values.size());
+    timeline_submit_info.pSignalSemaphoreValues = signal_semaphore_values.data();
+
+    VkSubmitInfo timeline_submit = submit_info;
+    timeline_submit.pNext = &timeline_submit_info;
+    timeline_submit.signalSemaphoreCount = static_cast<std::uint32_t>(signal_semaphores.size());
+    timeline_submit.pSignalSemaphores = signal_semaphores.data();
+
+    // The values must be signaled in increasing order, which is why the queue is submitted to under the lock.
+    VkResult result = vkQueueSubmit(queue, 1, &timeline_submit, fence);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    queue_timeline.last_submitted_value++;
+    signaled_value = queue_timeline.last_submitted_value;
+
+    return VK_SUCCESS;
+}
+
+std::uint64_t VulkanFrameTimeline::get_last_submitted_value(VkQueue queue) {
+    assert(frame_timeline_initialised);
+
+    std::lock_guard<std::mutex> lock(frame_timeline_mutex);
+
+    return get_queue_timeline(queue).last_submitted_value;
+}
+
+std::uint64_t VulkanFrameTimeline::get_completed_value(VkQueue queue) {
+    assert(frame_timeline_initialised);
+
+    std::lock_guard<std::mutex> lock(frame_timeline_mutex);
+
+    return get_completed_value_locked(queue);
+}
+
+VkResult VulkanFrameTimeline::wait_for_value(VkQueue queue, std::uint64_t value, std::uint64_t timeout) {
+    assert(frame_timeline_initialised);
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+
+    {
+        std::lock_guard<std::mutex> lock(frame_timeline_mutex);
+
+        QueueTimeline &queue_timeline = get_queue_timeline(queue);
+
+        // Waiting for a value which was never submitted would never return.
+        assert(value <= queue_timeline.last_submitted_value);
+
+        semaphore = queue_timeline.semaphore;
+    }
+
+    VkSemaphoreWaitInfoKHR semaphore_wait_info = {};
+    semaphore_wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    semaphore_wait_info.semaphoreCount = 1;
+    semaphore_wait_info.pSemaphores = &semaphore;
+    semaphore_wait_info.pValues = &value;
+
+    // The lock is not held while waiting, so other threads can keep submitting.
+    return vkWaitSemaphoresKHR(device, &semaphore_wait_info, timeout);
+}
+
+void VulkanFrameTimeline::defer_until(VkQueue queue, std::uint64_t value, std::function<void()> task) {
+    assert(frame_timeline_initialised);
+    assert(task);
+
+    std::lock_guard<std::mutex> lock(frame_timeline_mutex);
+
+    deferred_tasks.push_back({queue, value, std::move(task)});
+}
+
+std::size_t VulkanFrameTimeline::run_completed_tasks() {
+    assert(frame_timeline_initialised);
+
+    std::vector<std::function<void()>> completed_tasks;
+
+    {
+        std::lock_guard<std::mutex> lock(frame_timeline_mutex);
+
+        if (deferred_tasks.empty()) {
+            return 0;
+        }
+
+        // Query every counter only once.
+        std::unordered_map<VkQueue, std::uint64_t> completed_values;
+
+        for (const auto &queue_timeline : queue_timelines) {
+            completed_values[queue_timeline.first] = get_completed_value_locked(queue_timeline.first);
+        }
+
+        auto pending_tasks_end = std::partition(deferred_tasks.begin(), deferred_tasks.end(), [&](const DeferredTask &deferred_task) {
+            return deferred_task.value > completed_values.at(deferred_task.queue);
+        });
+
+        for (auto deferred_task = pending_tasks_end; deferred_task != deferred_tasks.end(); deferred_task++) {
+            completed_tasks.push_back(std::move(deferred_task->task));
+        }
+
+        deferred_tasks.erase(pending_tasks_end, deferred_tasks.end());
+    }
+
+    // The tasks are run without holding the lock, so they can defer new tasks.
+    for (auto &task : completed_tasks) {
+        task();
+    }
+
+    return completed_tasks.size();
+}
+
+void VulkanFrameTimeline::shutdown() {
+    if (!frame_timeline_initialised) {
+        return;
+    }
+
+    spdlog::debug("Shutting down frame timeline.");
+
+    std::vector<DeferredTask> remaining_tasks;
+
+    {
+        std::lock_guard<std::mutex> lock(frame_timeline_mutex);
+        remaining_tasks = std::move(deferred_tasks);
+        deferred_tasks.clear();
+    }
+
+    // The device is idle, so every deferred task can run now.
+    for (auto &deferred_task : remaining_tasks) {
+        deferred_task.task();
+    }
+
+    for (const auto &queue_timeline : queue_timelines) {
+        vkDestroySemaphore(device, queue_timeline.second.semaphore, nullptr);
+    }
+
+    queue_timelines.clear();
+
+    frame_timeline_initialised = false;
+}
+
+} // namespace inexor::vulkan_renderer
@@ -1,45 +1,49 @@
 #include "inexor/vulkan-renderer/gpu_memory_buffer.hpp"
 
+#include "inexor/vulkan-renderer/allocation_statistics_stream.hpp"
+
 namespace inexor::vulkan_renderer {
 
 GPUMemoryBuffer::GPUMemoryBuffer(GPUMemoryBuffer &&other) noexcept
-    : name(std::move(name)), device(std::exchange(other.device, nullptr)), buffer(std::exchange(other.buffer, nullptr)),
+    : name(std::move(other.name)), device(std::exchange(other.device, nullptr)), vma_allocator(other.vma_allocator),
+      buffer(std::exchange(other.buffer, nullptr)), buffer_size(other.buffer_size), buffer_usage(other.buffer_usage),
       allocation(std::exchange(other.allocation, nullptr)), allocation_info(std::move(other.allocation_info)),
-      allocation_create_info(std::move(other.allocation_create_info)) {}
-
-GPUMemoryBuffer::GPUMemoryBuffer(const VkDevice &device, const VmaAllocator &vma_allocator, const std::string &name, const VkDeviceSize &size,
-                                 const VkBufferUsageFlags &buffer_usage, const VmaMemoryUsage &memory_usage)
-    : device(device), vma_allocator(vma_allocator), name(name), buffer_size(size) {
-    assert(device);
-    assert(vma_allocator);
-    assert(!name.empty());
-
-    spdlog::debug("Creating GPU memory buffer of size {} for '{}'.", size, name);
+      allocation_create_info(std::move(other.allocation_create_info)), memory_placement(other.memory_placement) {}
 
+VkResult GPUMemoryBuffer::create_buffer(const VkBufferUsageFlags &buffer_usage) {
     VkBufferCreateInfo create_info = {};
 
     create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    create_info.size = size;
+    create_info.size = buffer_size;
     create_info.usage = buffer_usage;
     create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    allocation_create_info.usage = memory_usage;
+    this->buffer_usage = buffer_usage;
 
 #if VMA_RECORDING_ENABLED
-    allocation_create_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT;
+    allocation_create_info.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT;
     allocation_create_info.pUserData = this->name.data();
 #else
-    allocation_create_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    allocation_create_info.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
 #endif
 
     // TODO: Should we create this buffer as mapped?
     // TODO: Is it good to have memory mapped all the time?
     // TODO: When should memory be mapped / unmapped?
 
-    if (vmaCreateBuffer(vma_allocator, &create_info, &allocation_create_info, &buffer, &allocation, &allocation_info)) {
-        throw std::runtime_error("Error: GPU memory buffer allocation for " + name + " failed!");
+    VkResult result = vmaCreateBuffer(vma_allocator, &create_info, &allocation_create_info, &buffer, &allocation, &allocation_info);
+    if (result != VK_SUCCESS) {
+        return result;
     }
 
+    AllocationStatisticsStream::on_create_buffer(vma_allocator, create_info, allocation_create_info, allocation);
+
+    assign_debug_name();
+
+    return VK_SUCCESS;
+}
+
+void GPUMemoryBuffer::assign_debug_name() {
     // Try to find the Vulkan debug marker function.
     auto *vkDebugMarkerSetObjectNameEXT = reinterpret_cast<PFN_vkDebugMarkerSetObjectNameEXT>(vkGetDeviceProcAddr(device, "vkDebugMarkerSetObjectNameEXT"));
 
@@ -59,6 +63,109 @@ GPUMemoryBuffer::GPUMemoryBuffer(const VkDevice &device, const VmaAllocator &vma
     }
 }
 
+GPUMemoryBuffer::GPUMemoryBuffer(const VkDevice &device, const VmaAllocator &vma_allocator, const std::string &name, const VkDeviceSize &size,
+                                 const VkBufferUsageFlags &buffer_usage, const VmaMemoryUsage &memory_usage)
+    : device(device), vma_allocator(vma_allocator), name(name), buffer_size(size) {
+    assert(device);
+    assert(vma_allocator);
+    assert(!name.empty());
+
+    spdlog::debug("Creating GPU memory buffer of size {} for '{}'.", size, name);
+
+    allocation_create_info.usage = memory_usage;
+
+    if (create_buffer(buffer_usage) != VK_SUCCESS) {
+        throw std::runtime_error("Error: GPU memory buffer allocation for " + name + " failed!");
+    }
+}
+
+GPUMemoryBuffer::GPUMemoryBuffer(const VkDevice &device, const VmaAllocator &vma_allocator, const std::string &name, const VkDeviceSize &size,
+                                 const VkBufferUsageFlags &buffer_usage, const MemoryPlacement memory_placement)
+    : device(device), vma_allocator(vma_allocator), name(name), buffer_size(size), memory_placement(memory_placement) {
+    assert(device);
+    assert(vma_allocator);
+    assert(!name.empty());
+
+    if (memory_placement == MemoryPlacement::AUTOMATIC) {
+        this->memory_placement = decide_memory_placement(vma_allocator);
+    }
+
+    if (this->memory_placement == MemoryPlacement::HOST_VISIBLE_DIRECT) {
+        spdlog::debug("Creating device local, host visible GPU memory buffer of size {} for '{}'.", size, name);
+
+        allocation_create_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        allocation_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+        if (create_buffer(buffer_usage) == VK_SUCCESS) {
+            return;
+        }
+
+        // The host visible part of device local memory can be small, so only a decision of our own is revised.
+        if (memory_placement != MemoryPlacement::AUTOMATIC) {
+            throw std::runtime_error("Error: GPU memory buffer allocation for " + name + " in device local, host visible memory failed!");
+        }
+
+        spdlog::warn("No device local, host visible memory left for '{}', falling back to staging.", name);
+
+        allocation_create_info = {};
+        this->memory_placement = MemoryPlacement::DEVICE_LOCAL_STAGED;
+    }
+
+    spdlog::debug("Creating device local GPU memory buffer of size {} for '{}'.", size, name);
+
+    allocation_create_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    // The data is copied into the buffer from a staging buffer.
+    if (create_buffer(buffer_usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT) != VK_SUCCESS) {
+        throw std::runtime_error("Error: GPU memory buffer allocation for " + name + " failed!");
+    }
+}
+
+MemoryPlacement GPUMemoryBuffer::decide_memory_placement(const VmaAllocator &vma_allocator) {
+    assert(vma_allocator);
+
+    const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+    vmaGetMemoryProperties(vma_allocator, &memory_properties);
+
+    // Find the largest device local memory heap, which is where static data should be.
+    std::uint32_t largest_heap_index = VK_MAX_MEMORY_HEAPS;
+    VkDeviceSize largest_heap_size = 0;
+
+    for (std::uint32_t heap_index = 0; heap_index < memory_properties->memoryHeapCount; heap_index++) {
+        const VkMemoryHeap &memory_heap = memory_properties->memoryHeaps[heap_index];
+
+        if ((memory_heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && memory_heap.size > largest_heap_size) {
+            largest_heap_index = heap_index;
+            largest_heap_size = memory_heap.size;
+        }
+    }
+
+    // If the CPU can write into that heap, like on integrated graphics cards or with resizable BAR, a staging copy is a waste.
+    // The small host visible window of device local memory which many discrete graphics cards have is a separate heap.
+    const VkMemoryPropertyFlags direct_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+    for (std::uint32_t type_index = 0; type_index < memory_properties->memoryTypeCount; type_index++) {
+        const VkMemoryType &memory_type = memory_properties->memoryTypes[type_index];
+
+        if (memory_type.heapIndex == largest_heap_index && (memory_type.propertyFlags & direct_flags) == direct_flags) {
+            return MemoryPlacement::HOST_VISIBLE_DIRECT;
+        }
+    }
+
+    return MemoryPlacement::DEVICE_LOCAL_STAGED;
+}
+
+void GPUMemoryBuffer::update(const void *data, const std::size_t data_size, const VkDeviceSize offset) {
+    assert(data);
+    assert(allocation_info.pMappedData);
+    assert(offset + data_size <= buffer_size);
+
+    std::memcpy(static_cast<std::uint8_t *>(allocation_info.pMappedData) + offset, data, data_size);
+
+    // This does nothing if the memory is host coherent.
+    vmaFlushAllocation(vma_allocator, allocation, offset, data_size);
+}
+
 GPUMemoryBuffer::GPUMemoryBuffer(const VkDevice &device, const VmaAllocator &vma_allocator, const std::string &name, const VkDeviceSize &buffer_size,
                                  void *data, const std::size_t data_size, const VkBufferUsageFlags &buffer_usage, const VmaMemoryUsage &memory_usage)
     : GPUMemoryBuffer(device, vma_allocator, name, buffer_size, buffer_usage, memory_usage) {
@@ -73,7 +180,44 @@ GPUMemoryBuffer::GPUMemoryBuffer(const VkDevice &device, const VmaAllocator &vma
     std::memcpy(allocation_info.pMappedData, data, data_size);
 }
 
+VkBuffer GPUMemoryBuffer::rebind(const VkDeviceMemory memory, const VkDeviceSize offset) {
+    assert(memory);
+
+    VkBufferCreateInfo create_info = {};
+
+    create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    create_info.size = buffer_size;
+    create_info.usage = buffer_usage;
+    create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer new_buffer = VK_NULL_HANDLE;
+
+    if (vkCreateBuffer(device, &create_info, nullptr, &new_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkCreateBuffer failed while moving GPU memory buffer " + name + "!");
+    }
+
+    // The allocation is not bound through VMA, because VMA must not be asked about it until the defragmentation has ended.
+    if (vkBindBufferMemory(device, new_buffer, memory, offset) != VK_SUCCESS) {
+        vkDestroyBuffer(device, new_buffer, nullptr);
+        throw std::runtime_error("Error: vkBindBufferMemory failed while moving GPU memory buffer " + name + "!");
+    }
+
+    VkBuffer old_buffer = std::exchange(buffer, new_buffer);
+
+    assign_debug_name();
+
+    return old_buffer;
+}
+
+void GPUMemoryBuffer::refresh_allocation_info() {
+    vmaGetAllocationInfo(vma_allocator, allocation, &allocation_info);
+}
+
 GPUMemoryBuffer::~GPUMemoryBuffer() {
+    if (allocation != nullptr) {
+        AllocationStatisticsStream::on_destroy_buffer(vma_allocator, allocation);
+    }
+
     vmaDestroyBuffer(vma_allocator, buffer, allocation);
 }
 
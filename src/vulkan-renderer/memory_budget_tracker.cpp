@@ -0,0 +1,186 @@
+#include "inexor/vulkan-renderer/memory_budget_tracker.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace inexor::vulkan_renderer {
+
+namespace {
+
+const char *get_pressure_name(MemoryPressure pressure) {
+    switch (pressure) {
+    case MemoryPressure::SOFT:
+        return "soft";
+    case MemoryPressure::HARD:
+        return "hard";
+    default:
+        return "none";
+    }
+}
+
+} // namespace
+
+MemoryBudgetTracker::MemoryBudgetTracker(const VmaAllocator vma_allocator, const MemoryBudgetThresholds &thresholds) : vma_allocator(vma_allocator) {
+    assert(vma_allocator);
+
+    set_thresholds(thresholds);
+
+    const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+    vmaGetMemoryProperties(vma_allocator, &memory_properties);
+
+    heap_budgets.resize(memory_properties->memoryHeapCount);
+}
+
+const char *MemoryBudgetTracker::get_tag_name(MemoryTag tag) {
+    switch (tag) {
+    case MemoryTag::MESHES:
+        return "meshes";
+    case MemoryTag::TEXTURES:
+        return "textures";
+    case MemoryTag::UNIFORMS:
+        return "uniforms";
+    case MemoryTag::STAGING:
+        return "staging";
+    default:
+        return "unknown";
+    }
+}
+
+void MemoryBudgetTracker::set_thresholds(const MemoryBudgetThresholds &thresholds) {
+    assert(thresholds.soft > 0.0f);
+    assert(thresholds.soft <= thresholds.hard);
+
+    this->thresholds = thresholds;
+}
+
+void MemoryBudgetTracker::add_usage_provider(MemoryTag tag, UsageProvider provider) {
+    assert(tag != MemoryTag::COUNT);
+    assert(provider);
+
+    usage_providers[static_cast<std::size_t>(tag)].push_back(std::move(provider));
+}
+
+void MemoryBudgetTracker::add_eviction_handler(MemoryTag tag, EvictionHandler handler) {
+    assert(tag != MemoryTag::COUNT);
+    assert(handler);
+
+    eviction_handlers[static_cast<std::size_t>(tag)].push_back(std::move(handler));
+}
+
+void MemoryBudgetTracker::update() {
+    // VMA only queries VK_EXT_memory_budget again when the frame index changes.
+    vmaSetCurrentFrameIndex(vma_allocator, ++frame_index);
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets = {};
+    vmaGetBudget(vma_allocator, budgets.data());
+
+    for (std::size_t tag = 0; tag < TAG_COUNT; tag++) {
+        tag_usages[tag] = 0;
+
+        for (const auto &usage_provider : usage_providers[tag]) {
+            tag_usages[tag] += usage_provider();
+        }
+    }
+
+    for (std::uint32_t heap_index = 0; heap_index < heap_budgets.size(); heap_index++) {
+        HeapBudget &heap_budget = heap_budgets[heap_index];
+
+        const VkDeviceSize previous_usage = heap_budget.usage;
+
+        heap_budget.usage = budgets[heap_index].usage;
+        heap_budget.budget = budgets[heap_index].budget;
+        heap_budget.block_bytes = budgets[heap_index].blockBytes;
+        heap_budget.allocation_bytes = budgets[heap_index].allocationBytes;
+
+        // The memory the eviction handlers promised is freed once the GPU is done with it, which lowers the usage.
+        if (heap_budget.usage < previous_usage) {
+            heap_budget.pending_eviction_bytes -= std::min(heap_budget.pending_eviction_bytes, previous_usage - heap_budget.usage);
+        }
+
+        const MemoryPressure previous_pressure = heap_budget.pressure;
+
+        if (heap_budget.budget == 0) {
+            heap_budget.pressure = MemoryPressure::NONE;
+            heap_budget.pending_eviction_bytes = 0;
+            continue;
+        }
+
+        const auto soft_limit = static_cast<VkDeviceSize>(static_cast<double>(heap_budget.budget) * thresholds.soft);
+        const auto hard_limit = static_cast<VkDeviceSize>(static_cast<double>(heap_budget.budget) * thresholds.hard);
+
+        if (heap_budget.usage > hard_limit) {
+            heap_budget.pressure = MemoryPressure::HARD;
+        } else if (heap_budget.usage > soft_limit) {
+            heap_budget.pressure = MemoryPressure::SOFT;
+        } else {
+            heap_budget.pressure = MemoryPressure::NONE;
+        }
+
+        if (heap_budget.pressure != previous_pressure) {
+            spdlog::warn("Memory heap {} uses {} of {} bytes ({:.1f}%), the memory pressure changed from {} to {}.", heap_index, heap_budget.usage,
+                         heap_budget.budget, 100.0 * static_cast<double>(heap_budget.usage) / static_cast<double>(heap_budget.budget),
+                         get_pressure_name(previous_pressure), get_pressure_name(heap_budget.pressure));
+        }
+
+        if (heap_budget.pressure == MemoryPressure::NONE) {
+            heap_budget.pending_eviction_bytes = 0;
+            continue;
+        }
+
+        // Free enough memory to get back below the soft threshold, so eviction does not start again right away.
+        // The bytes which were promised by earlier calls are not asked for again, otherwise the handlers would free them once per frame.
+        const VkDeviceSize bytes_over_soft_limit = heap_budget.usage - soft_limit;
+
+        if (bytes_over_soft_limit > heap_budget.pending_eviction_bytes) {
+            heap_budget.pending_eviction_bytes += evict(heap_index, heap_budget.pressure, bytes_over_soft_limit - heap_budget.pending_eviction_bytes);
+        }
+    }
+}
+
+VkDeviceSize MemoryBudgetTracker::evict(std::uint32_t heap_index, MemoryPressure pressure, VkDeviceSize bytes_to_free) {
+    std::array<std::size_t, TAG_COUNT> tags;
+    std::iota(tags.begin(), tags.end(), 0);
+
+    // The subsystem which uses the most memory is asked first.
+    std::stable_sort(tags.begin(), tags.end(), [&](std::size_t lhs, std::size_t rhs) { return tag_usages[lhs] > tag_usages[rhs]; });
+
+    VkDeviceSize freed_bytes = 0;
+
+    for (const auto tag : tags) {
+        for (const auto &eviction_handler : eviction_handlers[tag]) {
+            if (freed_bytes >= bytes_to_free) {
+                return freed_bytes;
+            }
+
+            const VkDeviceSize handler_freed_bytes = eviction_handler(heap_index, pressure, bytes_to_free - freed_bytes);
+
+            if (handler_freed_bytes > 0) {
+                spdlog::debug("Evicted {} bytes of {} from memory heap {}.", handler_freed_bytes, get_tag_name(static_cast<MemoryTag>(tag)), heap_index);
+            }
+
+            freed_bytes += handler_freed_bytes;
+        }
+    }
+
+    if (freed_bytes < bytes_to_free && pressure == MemoryPressure::HARD) {
+        spdlog::warn("The eviction handlers could only free {} of {} bytes of memory heap {}.", freed_bytes, bytes_to_free, heap_index);
+    }
+
+    return freed_bytes;
+}
+
+void MemoryBudgetTracker::log_statistics() const {
+    for (std::uint32_t heap_index = 0; heap_index < heap_budgets.size(); heap_index++) {
+        const HeapBudget &heap_budget = heap_budgets[heap_index];
+
+        spdlog::debug("Memory heap {}: usage {} bytes, budget {} bytes, {} bytes in blocks, {} bytes in allocations.", heap_index, heap_budget.usage,
+                      heap_budget.budget, heap_budget.block_bytes, heap_budget.allocation_bytes);
+    }
+
+    for (std::size_t tag = 0; tag < TAG_COUNT; tag++) {
+        spdlog::debug("Memory usage of {}: {} bytes.", get_tag_name(static_cast<MemoryTag>(tag)), tag_usages[tag]);
+    }
+}
+
+} // namespace inexor::vulkan_renderer
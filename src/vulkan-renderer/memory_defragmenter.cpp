@@ -0,0 +1,323 @@
+#include "inexor/vulkan-renderer/memory_defragmenter.hpp"
+
+#include "inexor/vulkan-renderer/error_handling.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+namespace inexor::vulkan_renderer {
+
+MemoryDefragmenter::MemoryDefragmenter(const VkDevice device, const VmaAllocator vma_allocator, UploadBatcher &upload_batcher,
+                                       const MemoryDefragmenterSettings &settings)
+    : device(device), vma_allocator(vma_allocator), upload_batcher(upload_batcher), settings(settings) {
+    assert(device);
+    assert(vma_allocator);
+    assert(settings.frames_in_flight > 0);
+    assert(settings.max_allocations_per_pass > 0);
+    assert(settings.min_bytes_per_pass <= settings.max_bytes_per_pass);
+
+    bytes_per_pass = std::clamp(settings.initial_bytes_per_pass, settings.min_bytes_per_pass, settings.max_bytes_per_pass);
+}
+
+MemoryDefragmenter::~MemoryDefragmenter() {
+    finish();
+}
+
+void MemoryDefragmenter::add_buffer_provider(BufferProvider provider) {
+    assert(provider);
+
+    buffer_providers.push_back(std::move(provider));
+}
+
+void MemoryDefragmenter::use_frame_timeline(VulkanFrameTimeline &frame_timeline, VkQueue frame_queue) {
+    assert(frame_timeline.is_initialised());
+    assert(frame_queue);
+    assert(pass_context == VK_NULL_HANDLE);
+
+    this->frame_timeline = &frame_timeline;
+    this->frame_queue = frame_queue;
+}
+
+bool MemoryDefragmenter::are_pass_frames_finished() {
+    if (frame_timeline != nullptr) {
+        return frame_timeline->get_completed_value(frame_queue) >= pass_frame_value;
+    }
+
+    return frame_index >= pass_frame_index + settings.frames_in_flight;
+}
+
+float MemoryDefragmenter::calculate_fragmentation() const {
+    const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+    vmaGetMemoryProperties(vma_allocator, &memory_properties);
+
+    VmaStats stats = {};
+    vmaCalculateStats(vma_allocator, &stats);
+
+    VkDeviceSize unused_bytes = 0;
+    VkDeviceSize largest_unused_ranges = 0;
+
+    for (std::uint32_t heap_index = 0; heap_index < memory_properties->memoryHeapCount; heap_index++) {
+        if ((memory_properties->memoryHeaps[heap_index].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0) {
+            continue;
+        }
+
+        unused_bytes += stats.memoryHeap[heap_index].unusedBytes;
+        largest_unused_ranges += stats.memoryHeap[heap_index].unusedRangeSizeMax;
+    }
+
+    if (unused_bytes == 0) {
+        return 0.0f;
+    }
+
+    return 1.0f - static_cast<float>(static_cast<double>(largest_unused_ranges) / static_cast<double>(unused_bytes));
+}
+
+void MemoryDefragmenter::update() {
+    frame_index++;
+
+    if (pass_context != VK_NULL_HANDLE) {
+        // The frames which were recorded before the buffers were replaced might still read the old buffers.
+        if (!are_pass_frames_finished() || !upload_batcher.is_complete(pass_copy_token)) {
+            return;
+        }
+
+        end_pass();
+    }
+
+    if (!run_active) {
+        if (frame_index < last_check_frame_index + settings.check_interval) {
+            return;
+        }
+
+        last_check_frame_index = frame_index;
+
+        const float fragmentation = calculate_fragmentation();
+        if (fragmentation < settings.fragmentation_threshold) {
+            return;
+        }
+
+        spdlog::debug("Device local memory is {:.1f}% fragmented, starting defragmentation.", 100.0f * fragmentation);
+
+        run_active = true;
+        statistics.runs++;
+        statistics.fragmentation_before = fragmentation;
+    }
+
+    begin_pass();
+}
+
+void MemoryDefragmenter::begin_pass() {
+    assert(pass_context == VK_NULL_HANDLE);
+
+    const auto pass_start = std::chrono::steady_clock::now();
+
+    std::vector<GPUMemoryBuffer *> buffers;
+
+    for (const auto &buffer_provider : buffer_providers) {
+        buffer_provider(buffers);
+    }
+
+    std::vector<VmaAllocation> allocations;
+    std::unordered_map<VmaAllocation, GPUMemoryBuffer *> buffers_by_allocation;
+
+    for (auto *buffer : buffers) {
+        assert(buffer);
+
+        // Host visible buffers are written by the CPU at any time, so their data can't be copied on the GPU.
+        if (buffer->get_memory_placement() != MemoryPlacement::DEVICE_LOCAL_STAGED) {
+            continue;
+        }
+
+        allocations.push_back(buffer->get_allocation());
+        buffers_by_allocation[buffer->get_allocation()] = buffer;
+    }
+
+    if (allocations.empty()) {
+        end_run();
+        return;
+    }
+
+    VmaDefragmentationInfo2 defragmentation_info = {};
+
+    defragmentation_info.flags = VMA_DEFRAGMENTATION_FLAG_INCREMENTAL;
+    defragmentation_info.allocationCount = static_cast<std::uint32_t>(allocations.size());
+    defragmentation_info.pAllocations = allocations.data();
+
+    // Everything is copied by the GPU, VMA must not move anything with memcpy.
+    defragmentation_info.maxCpuBytesToMove = 0;
+    defragmentation_info.maxCpuAllocationsToMove = 0;
+    defragmentation_info.maxGpuBytesToMove = bytes_per_pass;
+    defragmentation_info.maxGpuAllocationsToMove = settings.max_allocations_per_pass;
+
+    pass_statistics = {};
+
+    VkResult result = vmaDefragmentationBegin(vma_allocator, &defragmentation_info, &pass_statistics, &pass_context);
+
+    // An incremental defragmentation returns VK_NOT_READY, the moves are planned by the first pass.
+    if (result != VK_NOT_READY) {
+        if (result != VK_SUCCESS) {
+            spdlog::error("vmaDefragmentationBegin failed: {}", get_error_description_text(result));
+        }
+
+        vmaDefragmentationEnd(vma_allocator, pass_context);
+        pass_context = VK_NULL_HANDLE;
+
+        end_run();
+        return;
+    }
+
+    // There is room for as many moves as VMA may plan, so every planned move is processed by this pass.
+    std::vector<VmaDefragmentationPassMoveInfo> moves(settings.max_allocations_per_pass);
+
+    VmaDefragmentationPassInfo pass_info = {};
+
+    pass_info.moveCount = static_cast<std::uint32_t>(moves.size());
+    pass_info.pMoves = moves.data();
+
+    result = vmaBeginDefragmentationPass(vma_allocator, pass_context, &pass_info);
+
+    if (result != VK_SUCCESS || pass_info.moveCount == 0) {
+        if (result != VK_SUCCESS) {
+            spdlog::error("vmaBeginDefragmentationPass failed: {}", get_error_description_text(result));
+        }
+
+        end_pass();
+        end_run();
+        return;
+    }
+
+    struct BufferCopy {
+        VkBuffer source = VK_NULL_HANDLE;
+        VkBuffer destination = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+    };
+
+    std::vector<BufferCopy> buffer_copies;
+
+    for (std::uint32_t move_index = 0; move_index < pass_info.moveCount; move_index++) {
+        const VmaDefragmentationPassMoveInfo &move = moves[move_index];
+
+        GPUMemoryBuffer *buffer = buffers_by_allocation.at(move.allocation);
+
+        // The source range stays valid until the pass has ended, so the old buffer can still be read.
+        VkBuffer old_buffer = buffer->rebind(move.memory, move.offset);
+
+        buffer_copies.push_back({old_buffer, buffer->get_buffer(), buffer->get_buffer_size()});
+
+        moved_buffers.push_back(buffer);
+        old_buffers.push_back(old_buffer);
+    }
+
+    pass_copy_token = upload_batcher.record([&](VkCommandBuffer command_buffer) {
+        // Uploads into the old buffers which were recorded before must have finished.
+        VkMemoryBarrier memory_barrier = {};
+
+        memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+        for (const auto &buffer_copy : buffer_copies) {
+            VkBufferCopy copy_region = {};
+            copy_region.size = buffer_copy.size;
+
+            vkCmdCopyBuffer(command_buffer, buffer_copy.source, buffer_copy.destination, 1, &copy_region);
+        }
+
+        // The frames read the moved vertices and indices, and later uploads write into the new buffers.
+        memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memory_barrier.dstAccessMask =
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                             &memory_barrier, 0, nullptr, 0, nullptr);
+    });
+
+    pass_frame_index = frame_index;
+
+    // The frames which are submitted from now on are recorded with the new buffers, see the relocation callback.
+    if (frame_timeline != nullptr) {
+        pass_frame_value = frame_timeline->get_last_submitted_value(frame_queue);
+    }
+
+    if (relocation_callback) {
+        relocation_callback();
+    }
+
+    // Most of the time is spent by VMA planning the moves, which grows with the number of bytes it may move.
+    const auto pass_duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pass_start);
+
+    if (pass_duration > settings.time_budget) {
+        bytes_per_pass = std::max(bytes_per_pass / 2, settings.min_bytes_per_pass);
+    } else if (pass_duration < settings.time_budget / 2) {
+        bytes_per_pass = std::min(bytes_per_pass * 2, settings.max_bytes_per_pass);
+    }
+
+    spdlog::trace("Defragmentation pass moves {} buffers in {} us.", pass_info.moveCount, pass_duration.count());
+}
+
+void MemoryDefragmenter::end_pass() {
+    assert(pass_context != VK_NULL_HANDLE);
+
+    // The source ranges are given back to VMA, and memory blocks which became empty are freed.
+    VkResult result = vmaEndDefragmentationPass(vma_allocator, pass_context);
+    if (result < VK_SUCCESS) {
+        spdlog::error("vmaEndDefragmentationPass failed: {}", get_error_description_text(result));
+    }
+
+    result = vmaDefragmentationEnd(vma_allocator, pass_context);
+    if (result < VK_SUCCESS) {
+        spdlog::error("vmaDefragmentationEnd failed: {}", get_error_description_text(result));
+    }
+
+    pass_context = VK_NULL_HANDLE;
+
+    for (auto old_buffer : old_buffers) {
+        vkDestroyBuffer(device, old_buffer, nullptr);
+    }
+
+    for (auto *moved_buffer : moved_buffers) {
+        moved_buffer->refresh_allocation_info();
+    }
+
+    statistics.passes++;
+    statistics.allocations_moved += pass_statistics.allocationsMoved;
+    statistics.bytes_moved += pass_statistics.bytesMoved;
+    statistics.bytes_freed += pass_statistics.bytesFreed;
+    statistics.blocks_freed += pass_statistics.deviceMemoryBlocksFreed;
+
+    old_buffers.clear();
+    moved_buffers.clear();
+}
+
+void MemoryDefragmenter::end_run() {
+    if (!run_active) {
+        return;
+    }
+
+    run_active = false;
+    last_check_frame_index = frame_index;
+
+    statistics.fragmentation_after = calculate_fragmentation();
+
+    spdlog::debug("Defragmentation finished, device local memory is {:.1f}% fragmented instead of {:.1f}%.", 100.0f * statistics.fragmentation_after,
+                  100.0f * statistics.fragmentation_before);
+}
+
+void MemoryDefragmenter::finish() {
+    if (pass_context != VK_NULL_HANDLE) {
+        upload_batcher.wait(pass_copy_token);
+        end_pass();
+    }
+
+    end_run();
+}
+
+void MemoryDefragmenter::log_statistics() const {
+    spdlog::debug("Memory defragmenter: {} runs, {} passes, {} allocations moved, {} bytes moved, {} bytes in {} memory blocks freed.", statistics.runs,
+                  statistics.passes, statistics.allocations_moved, statistics.bytes_moved, statistics.bytes_freed, statistics.blocks_freed);
+}
+
+} // namespace inexor::vulkan_renderer
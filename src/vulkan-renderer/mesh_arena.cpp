@@ -0,0 +1,250 @@
+#include "inexor/vulkan-renderer/mesh_arena.hpp"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace inexor::vulkan_renderer {
+
+MeshArena::MeshArena(const VkDevice device, UploadBatcher &upload_batcher, const VmaAllocator vma_allocator, const std::string &name,
+                     const VkDeviceSize vertex_stride, const std::uint32_t vertex_capacity, const std::uint32_t index_capacity,
+                     const MemoryPlacement memory_placement)
+    : name(name), device(device), vma_allocator(vma_allocator), upload_batcher(&upload_batcher), vertex_stride(vertex_stride),
+      memory_placement(memory_placement), vertex_allocator(vertex_capacity), index_allocator(index_capacity) {
+    assert(device);
+    assert(vma_allocator);
+    assert(!name.empty());
+    assert(vertex_stride > 0);
+    assert(vertex_capacity > 0);
+
+    spdlog::debug("Creating mesh arena '{}' for {} vertices of {} bytes and {} indices.", name, vertex_capacity, vertex_stride, index_capacity);
+
+    vertex_buffer = create_vertex_buffer();
+
+    // Keep an automatic fallback to staging, so both buffers and the buffers of defragmentation use the same placement.
+    this->memory_placement = vertex_buffer->get_memory_placement();
+
+    index_buffer = create_index_buffer();
+}
+
+std::unique_ptr<GPUMemoryBuffer> MeshArena::create_vertex_buffer() const {
+    // The buffers are copied into new buffers during defragmentation, so they are a transfer source as well.
+    return std::make_unique<GPUMemoryBuffer>(device, vma_allocator, name + " vertices", vertex_stride * vertex_allocator.get_capacity(),
+                                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                             memory_placement);
+}
+
+std::unique_ptr<GPUMemoryBuffer> MeshArena::create_index_buffer() const {
+    if (index_allocator.get_capacity() == 0) {
+        return nullptr;
+    }
+
+    return std::make_unique<GPUMemoryBuffer>(device, vma_allocator, name + " indices", sizeof(std::uint32_t) * index_allocator.get_capacity(),
+                                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                             memory_placement);
+}
+
+void MeshArena::upload(GPUMemoryBuffer &target_buffer, const VkDeviceSize target_offset, const void *data, const VkDeviceSize data_size) {
+    // The CPU can write into device local memory directly, so no staging copy is needed.
+    if (target_buffer.get_memory_placement() == MemoryPlacement::HOST_VISIBLE_DIRECT) {
+        target_buffer.update(data, static_cast<std::size_t>(data_size), target_offset);
+        return;
+    }
+
+    upload_batcher->upload_buffer(target_buffer.get_buffer(), target_offset, data, data_size);
+}
+
+std::optional<MeshArena::MeshHandle> MeshArena::add_mesh(const std::string &mesh_name, const void *vertices, const std::uint32_t vertex_count,
+                                                         const std::uint32_t *indices, const std::uint32_t index_count) {
+    assert(vertices);
+    assert(vertex_count > 0);
+    assert((indices == nullptr) == (index_count == 0));
+
+    if (index_count > 0 && !index_buffer) {
+        throw std::runtime_error("Error: Mesh " + mesh_name + " has indices, but mesh arena " + name + " has no index buffer!");
+    }
+
+    ArenaMesh mesh;
+
+    mesh.vertex_allocation = vertex_allocator.allocate(vertex_count);
+
+    if (!mesh.vertex_allocation.is_valid()) {
+        spdlog::warn("Mesh arena '{}' has no free range for {} vertices of mesh '{}'.", name, vertex_count, mesh_name);
+        return std::nullopt;
+    }
+
+    if (index_count > 0) {
+        mesh.index_allocation = index_allocator.allocate(index_count);
+
+        if (!mesh.index_allocation.is_valid()) {
+            spdlog::warn("Mesh arena '{}' has no free range for {} indices of mesh '{}'.", name, index_count, mesh_name);
+            vertex_allocator.free(mesh.vertex_allocation);
+            return std::nullopt;
+        }
+    }
+
+    mesh.range.first_vertex = mesh.vertex_allocation.offset;
+    mesh.range.vertex_count = vertex_count;
+    mesh.range.first_index = mesh.index_allocation.is_valid() ? mesh.index_allocation.offset : 0;
+    mesh.range.index_count = index_count;
+
+    spdlog::debug("Uploading mesh '{}' to mesh arena '{}' at vertex {} and index {}.", mesh_name, name, mesh.range.first_vertex, mesh.range.first_index);
+
+    upload(*vertex_buffer, vertex_stride * mesh.range.first_vertex, vertices, vertex_stride * vertex_count);
+
+    if (index_count > 0) {
+        upload(*index_buffer, sizeof(std::uint32_t) * mesh.range.first_index, indices, sizeof(std::uint32_t) * index_count);
+    }
+
+    return meshes.insert(mesh, mesh_name);
+}
+
+void MeshArena::remove_mesh(MeshHandle mesh) {
+    const ArenaMesh *arena_mesh = meshes.get(mesh);
+    assert(arena_mesh);
+
+    vertex_allocator.free(arena_mesh->vertex_allocation);
+
+    if (arena_mesh->index_allocation.is_valid()) {
+        index_allocator.free(arena_mesh->index_allocation);
+    }
+
+    meshes.erase(mesh);
+}
+
+const MeshRange &MeshArena::get_mesh_range(MeshHandle mesh) const {
+    const ArenaMesh *arena_mesh = meshes.get(mesh);
+
+    if (arena_mesh == nullptr) {
+        throw std::runtime_error("Error: Mesh arena " + name + " does not contain the mesh!");
+    }
+
+    return arena_mesh->range;
+}
+
+void MeshArena::bind(VkCommandBuffer command_buffer) const {
+    assert(command_buffer);
+
+    const VkBuffer vertex_buffers[] = {vertex_buffer->get_buffer()};
+    const VkDeviceSize offsets[] = {0};
+
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+
+    if (index_buffer) {
+        vkCmdBindIndexBuffer(command_buffer, index_buffer->get_buffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+}
+
+void MeshArena::draw(VkCommandBuffer command_buffer, MeshHandle mesh, const std::uint32_t instance_count) const {
+    assert(command_buffer);
+
+    const MeshRange &range = get_mesh_range(mesh);
+
+    if (range.index_count > 0) {
+        vkCmdDrawIndexed(command_buffer, range.index_count, instance_count, range.first_index, static_cast<std::int32_t>(range.first_vertex), 0);
+    } else {
+        vkCmdDraw(command_buffer, range.vertex_count, instance_count, range.first_vertex, 0);
+    }
+}
+
+std::uint32_t MeshArena::defragment() {
+    const auto vertex_statistics = vertex_allocator.get_statistics();
+    const auto index_statistics = index_allocator.get_statistics();
+
+    // Nothing to do if all free space is contiguous already.
+    if (vertex_statistics.free_block_count <= 1 && index_statistics.free_block_count <= 1) {
+        return 0;
+    }
+
+    spdlog::debug("Defragmenting mesh arena '{}' with {} meshes.", name, meshes.size());
+
+    // A fresh allocator hands out ranges from the start of its address space, so the meshes end up packed.
+    OffsetAllocator new_vertex_allocator(vertex_allocator.get_capacity());
+    OffsetAllocator new_index_allocator(index_allocator.get_capacity());
+
+    std::vector<VkBufferCopy> vertex_copies;
+    std::vector<VkBufferCopy> index_copies;
+
+    // Ranges in one buffer may not overlap in vkCmdCopyBuffer, so the meshes are copied into new buffers.
+    auto new_vertex_buffer = create_vertex_buffer();
+    auto new_index_buffer = create_index_buffer();
+
+    std::vector<std::pair<MeshHandle, MeshRange>> moved_meshes;
+
+    meshes.for_each([&](MeshHandle mesh_handle, ArenaMesh &mesh) {
+        const MeshRange old_range = mesh.range;
+
+        mesh.vertex_allocation = new_vertex_allocator.allocate(old_range.vertex_count);
+        assert(mesh.vertex_allocation.is_valid());
+
+        mesh.range.first_vertex = mesh.vertex_allocation.offset;
+        vertex_copies.push_back({vertex_stride * old_range.first_vertex, vertex_stride * mesh.range.first_vertex, vertex_stride * old_range.vertex_count});
+
+        if (old_range.index_count > 0) {
+            mesh.index_allocation = new_index_allocator.allocate(old_range.index_count);
+            assert(mesh.index_allocation.is_valid());
+
+            mesh.range.first_index = mesh.index_allocation.offset;
+            index_copies.push_back({sizeof(std::uint32_t) * old_range.first_index, sizeof(std::uint32_t) * mesh.range.first_index,
+                                    sizeof(std::uint32_t) * old_range.index_count});
+        }
+
+        if (mesh.range.first_vertex != old_range.first_vertex || mesh.range.first_index != old_range.first_index) {
+            moved_meshes.emplace_back(mesh_handle, mesh.range);
+        }
+    });
+
+    if (!vertex_copies.empty() || !index_copies.empty()) {
+        // The copies are recorded after the uploads of the open batch, which might write into the old buffers.
+        const UploadToken copy_token = upload_batcher->record([&](VkCommandBuffer command_buffer) {
+            VkMemoryBarrier memory_barrier = {};
+
+            memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0,
+                                 nullptr);
+
+            if (!vertex_copies.empty()) {
+                vkCmdCopyBuffer(command_buffer, vertex_buffer->get_buffer(), new_vertex_buffer->get_buffer(), static_cast<std::uint32_t>(vertex_copies.size()),
+                                vertex_copies.data());
+            }
+
+            if (!index_copies.empty()) {
+                vkCmdCopyBuffer(command_buffer, index_buffer->get_buffer(), new_index_buffer->get_buffer(), static_cast<std::uint32_t>(index_copies.size()),
+                                index_copies.data());
+            }
+        });
+
+        // The old buffers are destroyed below, so the copies have to be finished.
+        upload_batcher->wait(copy_token);
+    }
+
+    vertex_buffer = std::move(new_vertex_buffer);
+    index_buffer = std::move(new_index_buffer);
+    vertex_allocator = std::move(new_vertex_allocator);
+    index_allocator = std::move(new_index_allocator);
+
+    if (relocation_callback) {
+        for (const auto &moved_mesh : moved_meshes) {
+            relocation_callback(moved_mesh.first, moved_mesh.second);
+        }
+    }
+
+    spdlog::debug("Moved {} meshes of mesh arena '{}'.", moved_meshes.size(), name);
+
+    return static_cast<std::uint32_t>(moved_meshes.size());
+}
+
+MeshArenaStatistics MeshArena::get_statistics() const {
+    MeshArenaStatistics statistics;
+
+    statistics.mesh_count = static_cast<std::uint32_t>(meshes.size());
+    statistics.vertices = vertex_allocator.get_statistics();
+    statistics.indices = index_allocator.get_statistics();
+
+    return statistics;
+}
+
+} // namespace inexor::vulkan_renderer
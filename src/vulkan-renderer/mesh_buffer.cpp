@@ -3,18 +3,33 @@
 namespace inexor::vulkan_renderer {
 MeshBuffer::MeshBuffer(MeshBuffer &&other) noexcept
     : name(std::move(other.name)), vertex_buffer(std::move(other.vertex_buffer)), index_buffer(std::move(other.index_buffer)),
-      number_of_vertices(other.number_of_vertices), number_of_indices(other.number_of_indices) {}
+      number_of_vertices(other.number_of_vertices), number_of_indices(other.number_of_indices), index_buffer_available(other.index_buffer_available) {}
+
+void MeshBuffer::upload(const VkDevice device, VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index,
+                        CommandBufferRecycler &command_buffer_recycler, const VmaAllocator vma_allocator, const std::string &name,
+                        GPUMemoryBuffer &target_buffer, void *data, const std::size_t data_size) {
+    // The CPU can write into device local memory directly, so no staging copy is needed.
+    if (target_buffer.get_memory_placement() == MemoryPlacement::HOST_VISIBLE_DIRECT) {
+        target_buffer.update(data, data_size);
+        return;
+    }
+
+    StagingBuffer staging_buffer(device, vma_allocator, data_transfer_queue, data_transfer_queue_family_index, command_buffer_recycler, name, data_size,
+                                 data, data_size);
+
+    staging_buffer.upload_data_to_gpu(target_buffer);
+}
 
 MeshBuffer::MeshBuffer(const VkDevice device, VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index,
-                       const VmaAllocator vma_allocator, const std::string &name, const VkDeviceSize size_of_vertex_structure,
-                       const std::size_t number_of_vertices, void *vertices, const VkDeviceSize size_of_index_structure, const std::size_t number_of_indices,
-                       void *indices)
+                       CommandBufferRecycler &command_buffer_recycler, const VmaAllocator vma_allocator, const std::string &name,
+                       const VkDeviceSize size_of_vertex_structure, const std::size_t number_of_vertices, void *vertices,
+                       const VkDeviceSize size_of_index_structure, const std::size_t number_of_indices, void *indices,
+                       const MemoryPlacement memory_placement)
 
     // It's no problem to create the vertex buffer and index buffer before the corresponding staging buffers are created!.
-    : vertex_buffer(device, vma_allocator, name, size_of_vertex_structure * number_of_vertices,
-                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY),
-      index_buffer(GPUMemoryBuffer(device, vma_allocator, name, size_of_index_structure * number_of_vertices,
-                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY)) {
+    : name(name), vertex_buffer(device, vma_allocator, name, size_of_vertex_structure * number_of_vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                memory_placement),
+      number_of_vertices(static_cast<std::uint32_t>(number_of_vertices)), number_of_indices(static_cast<std::uint32_t>(number_of_indices)) {
     assert(device);
     assert(vma_allocator);
     assert(!name.empty());
@@ -32,33 +47,29 @@ MeshBuffer::MeshBuffer(const VkDevice device, VkQueue data_transfer_queue, const
         spdlog::warn("Always use an index buffer if possible! Not using an index buffer decreases performance drastically!");
     }
 
-    VkDeviceSize vertices_memory_size = number_of_vertices * size_of_vertex_structure;
-
-    StagingBuffer staging_buffer_for_vertices(device, vma_allocator, data_transfer_queue, data_transfer_queue_family_index, name, vertex_buffer_size, vertices,
-                                              vertices_memory_size);
-
-    staging_buffer_for_vertices.upload_data_to_gpu(vertex_buffer);
+    upload(device, data_transfer_queue, data_transfer_queue_family_index, command_buffer_recycler, vma_allocator, name, vertex_buffer, vertices,
+           vertex_buffer_size);
 
     if (number_of_indices > 0) {
-        VkDeviceSize indices_memory_size = number_of_indices * size_of_index_structure;
-
-        StagingBuffer staging_buffer_for_indices(device, vma_allocator, data_transfer_queue, data_transfer_queue_family_index, name, index_buffer_size, indices,
-                                                 indices_memory_size);
+        // The index buffer uses the placement the vertex buffer got, so an automatic fallback applies to both.
+        index_buffer.emplace(device, vma_allocator, name, index_buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, vertex_buffer.get_memory_placement());
+        index_buffer_available = true;
 
-        staging_buffer_for_indices.upload_data_to_gpu(index_buffer.value());
+        upload(device, data_transfer_queue, data_transfer_queue_family_index, command_buffer_recycler, vma_allocator, name, index_buffer.value(), indices,
+               index_buffer_size);
     } else {
         spdlog::warn("No index buffer created for mesh {}", name);
     }
 }
 
 MeshBuffer::MeshBuffer(const VkDevice device, VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index,
-                       const VmaAllocator vma_allocator, const std::string &name, const VkDeviceSize size_of_vertex_structure,
-                       const std::size_t number_of_vertices, void *vertices)
+                       CommandBufferRecycler &command_buffer_recycler, const VmaAllocator vma_allocator, const std::string &name,
+                       const VkDeviceSize size_of_vertex_structure, const std::size_t number_of_vertices, void *vertices,
+                       const MemoryPlacement memory_placement)
     // It's no problem to create the vertex buffer and index buffer before the corresponding staging buffers are created!.
-    : vertex_buffer(device, vma_allocator, name, size_of_vertex_structure * number_of_vertices,
-                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY),
-      index_buffer(std::nullopt), number_of_vertices(static_cast<std::uint32_t>(number_of_vertices)),
-      number_of_indices(static_cast<std::uint32_t>(number_of_indices)) {
+    : name(name), vertex_buffer(device, vma_allocator, name, size_of_vertex_structure * number_of_vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                memory_placement),
+      index_buffer(std::nullopt), number_of_vertices(static_cast<std::uint32_t>(number_of_vertices)), number_of_indices(0) {
     assert(device);
     assert(vma_allocator);
     assert(!name.empty());
@@ -72,12 +83,8 @@ MeshBuffer::MeshBuffer(const VkDevice device, VkQueue data_transfer_queue, const
     spdlog::warn("Creating a vertex buffer without an index buffer!");
     spdlog::warn("Always use an index buffer if possible. The performance will decrease drastically otherwise!");
 
-    VkDeviceSize vertices_memory_size = size_of_vertex_structure * number_of_vertices;
-
-    StagingBuffer staging_buffer_for_vertices(device, vma_allocator, data_transfer_queue, data_transfer_queue_family_index, name, size_of_vertex_buffer,
-                                              vertices, vertices_memory_size);
-
-    staging_buffer_for_vertices.upload_data_to_gpu(vertex_buffer);
+    upload(device, data_transfer_queue, data_transfer_queue_family_index, command_buffer_recycler, vma_allocator, name, vertex_buffer, vertices,
+           size_of_vertex_buffer);
 }
 
 MeshBuffer::~MeshBuffer() {}
@@ -0,0 +1,315 @@
+#include "inexor/vulkan-renderer/offset_allocator.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace inexor::vulkan_renderer {
+
+namespace {
+
+/// @brief Returns the index of the highest set bit. The value must not be 0.
+std::uint32_t find_highest_set_bit(std::uint64_t value) {
+    assert(value != 0);
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return static_cast<std::uint32_t>(index);
+#else
+    return 63 - static_cast<std::uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+/// @brief Returns the index of the lowest set bit. The value must not be 0.
+std::uint32_t find_lowest_set_bit(std::uint32_t value) {
+    assert(value != 0);
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return static_cast<std::uint32_t>(index);
+#else
+    return static_cast<std::uint32_t>(__builtin_ctz(value));
+#endif
+}
+
+} // namespace
+
+OffsetAllocator::OffsetAllocator(std::uint32_t capacity) : capacity(capacity) {
+    reset();
+}
+
+void OffsetAllocator::map_size(std::uint64_t size, std::uint32_t &first_level, std::uint32_t &second_level) {
+    // Small sizes have one size class each.
+    if (size < SECOND_LEVEL_COUNT) {
+        first_level = 0;
+        second_level = static_cast<std::uint32_t>(size);
+        return;
+    }
+
+    const std::uint32_t highest_bit = find_highest_set_bit(size);
+
+    first_level = highest_bit - SECOND_LEVEL_LOG2 + 1;
+    second_level = static_cast<std::uint32_t>(size >> (highest_bit - SECOND_LEVEL_LOG2)) - SECOND_LEVEL_COUNT;
+}
+
+void OffsetAllocator::map_size_round_up(std::uint64_t size, std::uint32_t &first_level, std::uint32_t &second_level) {
+    // Every block in the next size class is at least as large as the requested size.
+    if (size >= SECOND_LEVEL_COUNT) {
+        size += (std::uint64_t(1) << (find_highest_set_bit(size) - SECOND_LEVEL_LOG2)) - 1;
+    }
+
+    map_size(size, first_level, second_level);
+}
+
+std::uint32_t OffsetAllocator::create_node(std::uint32_t offset, std::uint32_t size) {
+    std::uint32_t node_index = 0;
+
+    if (!unused_nodes.empty()) {
+        node_index = unused_nodes.back();
+        unused_nodes.pop_back();
+        nodes[node_index] = Node();
+    } else {
+        node_index = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+
+    nodes[node_index].offset = offset;
+    nodes[node_index].size = size;
+
+    return node_index;
+}
+
+void OffsetAllocator::release_node(std::uint32_t node_index) {
+    unused_nodes.push_back(node_index);
+}
+
+void OffsetAllocator::insert_free_node(std::uint32_t node_index) {
+    std::uint32_t first_level = 0;
+    std::uint32_t second_level = 0;
+    map_size(nodes[node_index].size, first_level, second_level);
+
+    const std::uint32_t size_class = first_level * SECOND_LEVEL_COUNT + second_level;
+
+    Node &node = nodes[node_index];
+    node.used = false;
+    node.previous_free = NO_NODE;
+    node.next_free = free_list_heads[size_class];
+
+    if (node.next_free != NO_NODE) {
+        nodes[node.next_free].previous_free = node_index;
+    }
+
+    free_list_heads[size_class] = node_index;
+
+    first_level_bitmap |= 1u << first_level;
+    second_level_bitmaps[first_level] |= 1u << second_level;
+
+    free_block_count++;
+}
+
+void OffsetAllocator::remove_free_node(std::uint32_t node_index) {
+    Node &node = nodes[node_index];
+
+    if (node.previous_free != NO_NODE) {
+        nodes[node.previous_free].next_free = node.next_free;
+    }
+
+    if (node.next_free != NO_NODE) {
+        nodes[node.next_free].previous_free = node.previous_free;
+    }
+
+    if (node.previous_free == NO_NODE) {
+        // The node is the head of its free list.
+        std::uint32_t first_level = 0;
+        std::uint32_t second_level = 0;
+        map_size(node.size, first_level, second_level);
+
+        const std::uint32_t size_class = first_level * SECOND_LEVEL_COUNT + second_level;
+
+        free_list_heads[size_class] = node.next_free;
+
+        if (free_list_heads[size_class] == NO_NODE) {
+            second_level_bitmaps[first_level] &= ~(1u << second_level);
+
+            if (second_level_bitmaps[first_level] == 0) {
+                first_level_bitmap &= ~(1u << first_level);
+            }
+        }
+    }
+
+    node.previous_free = NO_NODE;
+    node.next_free = NO_NODE;
+
+    free_block_count--;
+}
+
+OffsetAllocation OffsetAllocator::allocate(std::uint32_t size) {
+    assert(size > 0);
+
+    if (size > capacity - used) {
+        return {};
+    }
+
+    std::uint32_t first_level = 0;
+    std::uint32_t second_level = 0;
+    map_size_round_up(size, first_level, second_level);
+
+    std::uint32_t node_index = NO_NODE;
+
+    // Find the first non-empty size class which is large enough, using the bitmaps.
+    std::uint32_t second_level_bitmap = (first_level < FIRST_LEVEL_COUNT) ? second_level_bitmaps[first_level] & (~0u << second_level) : 0;
+
+    if (second_level_bitmap == 0) {
+        const std::uint32_t first_level_mask = (first_level + 1 < 32) ? (~0u << (first_level + 1)) : 0;
+        const std::uint32_t first_level_candidates = first_level_bitmap & first_level_mask;
+
+        if (first_level_candidates != 0) {
+            first_level = find_lowest_set_bit(first_level_candidates);
+            second_level_bitmap = second_level_bitmaps[first_level];
+        }
+    }
+
+    if (second_level_bitmap != 0) {
+        second_level = find_lowest_set_bit(second_level_bitmap);
+        node_index = free_list_heads[first_level * SECOND_LEVEL_COUNT + second_level];
+    } else {
+        // The size class of the requested size might still contain a block which is large enough.
+        map_size(size, first_level, second_level);
+
+        for (std::uint32_t candidate = free_list_heads[first_level * SECOND_LEVEL_COUNT + second_level]; candidate != NO_NODE;
+             candidate = nodes[candidate].next_free) {
+            if (nodes[candidate].size >= size) {
+                node_index = candidate;
+                break;
+            }
+        }
+
+        if (node_index == NO_NODE) {
+            return {};
+        }
+    }
+
+    assert(node_index != NO_NODE);
+
+    remove_free_node(node_index);
+
+    // Return the remainder of the block to the free lists.
+    if (nodes[node_index].size > size) {
+        const std::uint32_t remainder_index = create_node(nodes[node_index].offset + size, nodes[node_index].size - size);
+
+        Node &node = nodes[node_index];
+        Node &remainder = nodes[remainder_index];
+
+        remainder.previous_physical = node_index;
+        remainder.next_physical = node.next_physical;
+
+        if (node.next_physical != NO_NODE) {
+            nodes[node.next_physical].previous_physical = remainder_index;
+        }
+
+        node.next_physical = remainder_index;
+        node.size = size;
+
+        insert_free_node(remainder_index);
+    }
+
+    nodes[node_index].used = true;
+
+    used += size;
+    allocation_count++;
+
+    return {nodes[node_index].offset, node_index};
+}
+
+void OffsetAllocator::free(OffsetAllocation allocation) {
+    assert(allocation.is_valid());
+    assert(allocation.node < nodes.size());
+    assert(nodes[allocation.node].used);
+
+    std::uint32_t node_index = allocation.node;
+
+    used -= nodes[node_index].size;
+    allocation_count--;
+
+    nodes[node_index].used = false;
+
+    // Merge with the previous block if it is free.
+    const std::uint32_t previous_index = nodes[node_index].previous_physical;
+
+    if (previous_index != NO_NODE && !nodes[previous_index].used) {
+        remove_free_node(previous_index);
+
+        Node &previous = nodes[previous_index];
+        previous.size += nodes[node_index].size;
+        previous.next_physical = nodes[node_index].next_physical;
+
+        if (previous.next_physical != NO_NODE) {
+            nodes[previous.next_physical].previous_physical = previous_index;
+        }
+
+        release_node(node_index);
+        node_index = previous_index;
+    }
+
+    // Merge with the next block if it is free.
+    const std::uint32_t next_index = nodes[node_index].next_physical;
+
+    if (next_index != NO_NODE && !nodes[next_index].used) {
+        remove_free_node(next_index);
+
+        Node &node = nodes[node_index];
+        node.size += nodes[next_index].size;
+        node.next_physical = nodes[next_index].next_physical;
+
+        if (node.next_physical != NO_NODE) {
+            nodes[node.next_physical].previous_physical = node_index;
+        }
+
+        release_node(next_index);
+    }
+
+    insert_free_node(node_index);
+}
+
+void OffsetAllocator::reset() {
+    used = 0;
+    allocation_count = 0;
+    free_block_count = 0;
+
+    nodes.clear();
+    unused_nodes.clear();
+
+    first_level_bitmap = 0;
+    second_level_bitmaps.fill(0);
+    free_list_heads.fill(NO_NODE);
+
+    if (capacity > 0) {
+        insert_free_node(create_node(0, capacity));
+    }
+}
+
+OffsetAllocatorStatistics OffsetAllocator::get_statistics() const {
+    OffsetAllocatorStatistics statistics;
+
+    statistics.capacity = capacity;
+    statistics.used = used;
+    statistics.allocation_count = allocation_count;
+    statistics.free_block_count = free_block_count;
+
+    // The largest free block is in the highest non-empty size class.
+    if (first_level_bitmap != 0) {
+        const std::uint32_t first_level = find_highest_set_bit(first_level_bitmap);
+        const std::uint32_t second_level = find_highest_set_bit(second_level_bitmaps[first_level]);
+
+        for (std::uint32_t node_index = free_list_heads[first_level * SECOND_LEVEL_COUNT + second_level]; node_index != NO_NODE;
+             node_index = nodes[node_index].next_free) {
+            if (nodes[node_index].size > statistics.largest_free_block) {
+                statistics.largest_free_block = nodes[node_index].size;
+            }
+        }
+    }
+
+    return statistics;
+}
+
+} // namespace inexor::vulkan_renderer
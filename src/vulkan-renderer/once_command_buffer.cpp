@@ -3,37 +3,23 @@
 namespace inexor::vulkan_renderer {
 
 OnceCommandBuffer::OnceCommandBuffer(OnceCommandBuffer &&other) noexcept
-    : device(other.device), command_pool(std::exchange(other.command_pool, nullptr)), command_buffer(std::exchange(other.command_buffer, nullptr)),
+    : device(other.device), command_buffer_recycler(other.command_buffer_recycler), command_buffer(std::exchange(other.command_buffer, nullptr)),
       data_transfer_queue(other.data_transfer_queue), data_transfer_queue_family_index(other.data_transfer_queue_family_index),
-      recording_started(other.recording_started), command_buffer_created(other.command_buffer_created) {}
-
-OnceCommandBuffer::OnceCommandBuffer(const VkDevice device, const VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index)
-    : device(device), data_transfer_queue(data_transfer_queue), data_transfer_queue_family_index(data_transfer_queue_family_index) {
+      command_buffer_created(std::exchange(other.command_buffer_created, false)), recording_started(std::exchange(other.recording_started, false)) {}
 
+OnceCommandBuffer::OnceCommandBuffer(const VkDevice device, const VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index,
+                                     CommandBufferRecycler &command_buffer_recycler)
+    : device(device), command_buffer_recycler(&command_buffer_recycler), data_transfer_queue(data_transfer_queue),
+      data_transfer_queue_family_index(data_transfer_queue_family_index) {
     assert(device);
     assert(data_transfer_queue);
-
-    spdlog::debug("Creating command pool for rendering.");
-
-    VkCommandPoolCreateInfo command_pool_create_info = {};
-
-    command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    command_pool_create_info.pNext = nullptr;
-    command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    command_pool_create_info.queueFamilyIndex = data_transfer_queue_family_index;
-
-    if (vkCreateCommandPool(device, &command_pool_create_info, nullptr, &command_pool) != VK_SUCCESS) {
-        throw std::runtime_error("Error: vkCreateCommandPool failed for once command buffer!");
-    }
 }
 
 OnceCommandBuffer::~OnceCommandBuffer() {
-    assert(device);
-
-    // TODO(Hanni): Is there no other way to do this?
-    // We are using the move constructor, so command_pool will be std::exchanged
-    // but it is also required in the destructor here.
-    vkDestroyCommandPool(device, command_pool, nullptr);
+    // Return a command buffer which was never submitted.
+    if (command_buffer_created) {
+        command_buffer_recycler->release(data_transfer_queue_family_index, command_buffer);
+    }
 
     command_buffer_created = false;
     recording_started = false;
@@ -41,23 +27,12 @@ OnceCommandBuffer::~OnceCommandBuffer() {
 
 void OnceCommandBuffer::create_command_buffer() {
     assert(device);
-    assert(command_pool);
+    assert(command_buffer_recycler);
     assert(data_transfer_queue);
     assert(!recording_started);
     assert(!command_buffer_created);
 
-    // TODO: Rename all "allocation_info" variables in the engine to "alloc_info".
-    VkCommandBufferAllocateInfo command_buffer_alloc_info = {};
-
-    command_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    command_buffer_alloc_info.pNext = nullptr;
-    command_buffer_alloc_info.commandBufferCount = 1;
-    command_buffer_alloc_info.commandPool = command_pool;
-    command_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-    if (vkAllocateCommandBuffers(device, &command_buffer_alloc_info, &command_buffer) != VK_SUCCESS) {
-        throw std::runtime_error("Error: vkAllocateCommandBuffers failed for once command buffer!");
-    }
+    command_buffer = command_buffer_recycler->acquire(data_transfer_queue_family_index);
 
     // TODO: Set object name using Vulkan debug markers.
 
@@ -66,7 +41,6 @@ void OnceCommandBuffer::create_command_buffer() {
 
 void OnceCommandBuffer::start_recording() {
     assert(device);
-    assert(command_pool);
     assert(data_transfer_queue);
     assert(command_buffer_created);
     assert(!recording_started);
@@ -93,7 +67,6 @@ void OnceCommandBuffer::start_recording() {
 
 void OnceCommandBuffer::end_recording_and_submit_command() {
     assert(device);
-    assert(command_pool);
     assert(command_buffer);
     assert(data_transfer_queue);
     assert(command_buffer_created);
@@ -115,19 +88,26 @@ void OnceCommandBuffer::end_recording_and_submit_command() {
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &command_buffer;
 
-    if (vkQueueSubmit(data_transfer_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+    FencePool &fence_pool = command_buffer_recycler->get_fence_pool();
+
+    // Wait for this submission only, instead of waiting until the queue is idle.
+    VkFence submission_fence = fence_pool.acquire();
+
+    if (vkQueueSubmit(data_transfer_queue, 1, &submit_info, submission_fence) != VK_SUCCESS) {
+        fence_pool.release(submission_fence);
         throw std::runtime_error("Error: vkQueueSubmit failed for once command buffer!");
     }
 
-    // TODO: Refactor! Introduce proper synchronisation using VkFence!
-    if (vkQueueWaitIdle(data_transfer_queue) != VK_SUCCESS) {
-        throw std::runtime_error("Error: vkQueueWaitIdle failed for once command buffer!");
+    if (vkWaitForFences(device, 1, &submission_fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkWaitForFences failed for once command buffer!");
     }
 
-    spdlog::debug("Destroying once command buffer.");
+    fence_pool.release(submission_fence);
+
+    spdlog::debug("Recycling once command buffer.");
 
-    // Because we destroy the command buffer after submission, we have to allocate it every time.
-    vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+    command_buffer_recycler->release(data_transfer_queue_family_index, command_buffer);
+    command_buffer = VK_NULL_HANDLE;
 
     command_buffer_created = false;
 
@@ -0,0 +1,284 @@
+#include "inexor/vulkan-renderer/recycling_pools.hpp"
+
+#include <functional>
+
+namespace inexor::vulkan_renderer {
+
+namespace {
+
+/// @brief Runs callbacks when the thread which added them exits.
+class ThreadExitCallbacks {
+private:
+    std::vector<std::function<void()>> callbacks;
+
+public:
+    ~ThreadExitCallbacks() {
+        for (const auto &callback : callbacks) {
+            callback();
+        }
+    }
+
+    void add(std::function<void()> callback) {
+        callbacks.push_back(std::move(callback));
+    }
+};
+
+thread_local ThreadExitCallbacks thread_exit_callbacks;
+
+} // namespace
+
+FencePool::FencePool(const VkDevice device) : device(device) {
+    assert(device);
+}
+
+FencePool::~FencePool() {
+    assert(free_fences.size() == fences.size());
+
+    for (auto fence : fences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+}
+
+VkFence FencePool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(fence_pool_mutex);
+
+        if (!free_fences.empty()) {
+            VkFence fence = free_fences.back();
+            free_fences.pop_back();
+
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return fence;
+        }
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    VkFenceCreateInfo fence_create_info = {};
+
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_create_info.pNext = nullptr;
+    fence_create_info.flags = 0;
+
+    VkFence fence = VK_NULL_HANDLE;
+
+    if (vkCreateFence(device, &fence_create_info, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkCreateFence failed for fence pool!");
+    }
+
+    std::lock_guard<std::mutex> lock(fence_pool_mutex);
+
+    fences.push_back(fence);
+
+    return fence;
+}
+
+void FencePool::release(VkFence fence) {
+    assert(fence);
+
+    if (vkResetFences(device, 1, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkResetFences failed for fence pool!");
+    }
+
+    std::lock_guard<std::mutex> lock(fence_pool_mutex);
+
+    free_fences.push_back(fence);
+}
+
+RecyclingPoolStatistics FencePool::get_statistics() const {
+    return {hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed)};
+}
+
+SemaphorePool::SemaphorePool(const VkDevice device) : device(device) {
+    assert(device);
+}
+
+SemaphorePool::~SemaphorePool() {
+    assert(free_semaphores.size() == semaphores.size());
+
+    for (auto semaphore : semaphores) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+}
+
+VkSemaphore SemaphorePool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(semaphore_pool_mutex);
+
+        if (!free_semaphores.empty()) {
+            VkSemaphore semaphore = free_semaphores.back();
+            free_semaphores.pop_back();
+
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return semaphore;
+        }
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    VkSemaphoreCreateInfo semaphore_create_info = {};
+
+    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_create_info.pNext = nullptr;
+    semaphore_create_info.flags = 0;
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+
+    if (vkCreateSemaphore(device, &semaphore_create_info, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkCreateSemaphore failed for semaphore pool!");
+    }
+
+    std::lock_guard<std::mutex> lock(semaphore_pool_mutex);
+
+    semaphores.push_back(semaphore);
+
+    return semaphore;
+}
+
+void SemaphorePool::release(VkSemaphore semaphore) {
+    assert(semaphore);
+
+    // Binary semaphores can't be reset. A semaphore is unsignaled again once a wait operation on it has finished.
+    std::lock_guard<std::mutex> lock(semaphore_pool_mutex);
+
+    free_semaphores.push_back(semaphore);
+}
+
+RecyclingPoolStatistics SemaphorePool::get_statistics() const {
+    return {hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed)};
+}
+
+CommandBufferRecycler::CommandBufferRecycler(const VkDevice device, FencePool &fence_pool) : device(device), fence_pool(fence_pool) {
+    assert(device);
+}
+
+CommandBufferRecycler::~CommandBufferRecycler() {
+    std::lock_guard<std::mutex> lock(command_pools->command_pools_mutex);
+
+    spdlog::debug("Destroying {} command pools of command buffer recycler ({} hits, {} misses).",
+                  command_pools->thread_command_pools.size() + command_pools->retired_command_pools.size(), hits.load(), misses.load());
+
+    // Destroying a command pool frees all of its command buffers.
+    for (auto &thread_command_pool : command_pools->thread_command_pools) {
+        vkDestroyCommandPool(device, thread_command_pool.second.command_pool, nullptr);
+    }
+
+    for (auto &retired_command_pool : command_pools->retired_command_pools) {
+        vkDestroyCommandPool(device, retired_command_pool.second.command_pool, nullptr);
+    }
+
+    // Threads which exit later find no command pools to hand back.
+    command_pools->thread_command_pools.clear();
+    command_pools->retired_command_pools.clear();
+}
+
+void CommandBufferRecycler::retire_thread_command_pools(CommandPools &command_pools, std::thread::id thread_id) {
+    std::lock_guard<std::mutex> lock(command_pools.command_pools_mutex);
+
+    auto thread_command_pool = command_pools.thread_command_pools.lower_bound({thread_id, 0});
+
+    // The thread has released all its command buffers, so another thread can take over the pool.
+    while (thread_command_pool != command_pools.thread_command_pools.end() && thread_command_pool->first.first == thread_id) {
+        command_pools.retired_command_pools.emplace(thread_command_pool->first.second, std::move(thread_command_pool->second));
+        thread_command_pool = command_pools.thread_command_pools.erase(thread_command_pool);
+    }
+}
+
+CommandBufferRecycler::ThreadCommandPool &CommandBufferRecycler::get_thread_command_pool(std::uint32_t queue_family_index) {
+    std::lock_guard<std::mutex> lock(command_pools->command_pools_mutex);
+
+    const std::thread::id thread_id = std::this_thread::get_id();
+
+    auto &thread_command_pools = command_pools->thread_command_pools;
+
+    // A thread whose first command pool this is hands its pools back when it exits.
+    auto first_thread_command_pool = thread_command_pools.lower_bound({thread_id, 0});
+    const bool first_command_pool = first_thread_command_pool == thread_command_pools.end() || first_thread_command_pool->first.first != thread_id;
+
+    auto &thread_command_pool = thread_command_pools[{thread_id, queue_family_index}];
+
+    if (thread_command_pool.command_pool != VK_NULL_HANDLE) {
+        return thread_command_pool;
+    }
+
+    if (first_command_pool) {
+        thread_exit_callbacks.add([weak_command_pools = std::weak_ptr<CommandPools>(command_pools), thread_id]() {
+            if (auto command_pools = weak_command_pools.lock()) {
+                retire_thread_command_pools(*command_pools, thread_id);
+            }
+        });
+    }
+
+    auto retired_command_pool = command_pools->retired_command_pools.find(queue_family_index);
+
+    if (retired_command_pool != command_pools->retired_command_pools.end()) {
+        thread_command_pool = std::move(retired_command_pool->second);
+        command_pools->retired_command_pools.erase(retired_command_pool);
+    } else {
+        VkCommandPoolCreateInfo command_pool_create_info = {};
+
+        command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        command_pool_create_info.pNext = nullptr;
+
+        // The command buffers are short-lived and reset individually.
+        command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        command_pool_create_info.queueFamilyIndex = queue_family_index;
+
+        if (vkCreateCommandPool(device, &command_pool_create_info, nullptr, &thread_command_pool.command_pool) != VK_SUCCESS) {
+            throw std::runtime_error("Error: vkCreateCommandPool failed for command buffer recycler!");
+        }
+
+        command_pool_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return thread_command_pool;
+}
+
+VkCommandBuffer CommandBufferRecycler::acquire(std::uint32_t queue_family_index) {
+    // Only the calling thread uses this command pool, so no lock is needed from here on.
+    ThreadCommandPool &thread_command_pool = get_thread_command_pool(queue_family_index);
+
+    if (!thread_command_pool.free_command_buffers.empty()) {
+        VkCommandBuffer command_buffer = thread_command_pool.free_command_buffers.back();
+        thread_command_pool.free_command_buffers.pop_back();
+
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return command_buffer;
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    VkCommandBufferAllocateInfo command_buffer_alloc_info = {};
+
+    command_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_alloc_info.pNext = nullptr;
+    command_buffer_alloc_info.commandBufferCount = 1;
+    command_buffer_alloc_info.commandPool = thread_command_pool.command_pool;
+    command_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+
+    if (vkAllocateCommandBuffers(device, &command_buffer_alloc_info, &command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkAllocateCommandBuffers failed for command buffer recycler!");
+    }
+
+    return command_buffer;
+}
+
+void CommandBufferRecycler::release(std::uint32_t queue_family_index, VkCommandBuffer command_buffer) {
+    assert(command_buffer);
+
+    ThreadCommandPool &thread_command_pool = get_thread_command_pool(queue_family_index);
+
+    if (vkResetCommandBuffer(command_buffer, 0) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkResetCommandBuffer failed for command buffer recycler!");
+    }
+
+    thread_command_pool.free_command_buffers.push_back(command_buffer);
+}
+
+RecyclingPoolStatistics CommandBufferRecycler::get_statistics() const {
+    return {hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed)};
+}
+
+} // namespace inexor::vulkan_renderer
@@ -29,7 +29,8 @@ VkResult VulkanRenderer::create_window_surface(const VkInstance &instance, GLFWw
     return glfwCreateWindowSurface(instance, window, nullptr, &surface);
 }
 
-VkResult VulkanRenderer::create_physical_device(const VkPhysicalDevice &graphics_card, const bool enable_debug_markers) {
+VkResult VulkanRenderer::create_physical_device(const VkPhysicalDevice &graphics_card, const bool enable_debug_markers, const bool enable_timeline_semaphores,
+                                                const bool enable_memory_budget) {
     assert(graphics_card);
 
     spdlog::debug("Creating physical device (graphics card interface).");
@@ -39,6 +40,13 @@ VkResult VulkanRenderer::create_physical_device(const VkPhysicalDevice &graphics
     // Enable anisotropic filtering.
     used_features.samplerAnisotropy = VK_TRUE;
 
+    VkPhysicalDeviceFeatures available_features;
+    vkGetPhysicalDeviceFeatures(graphics_card, &available_features);
+
+    // Block compressed textures are used if the graphics card supports them.
+    used_features.textureCompressionBC = available_features.textureCompressionBC;
+    used_features.textureCompressionASTC_LDR = available_features.textureCompressionASTC_LDR;
+
     // Our wishlist of device extensions that we would like to enable.
     std::vector<const char *> device_extensions_wishlist = {
         // Since we actually want a window to draw on, we need this swapchain extension.
@@ -50,6 +58,14 @@ VkResult VulkanRenderer::create_physical_device(const VkPhysicalDevice &graphics
         device_extensions_wishlist.push_back(VK_EXT_DEBUG_MARKER_EXTENSION_NAME);
     }
 
+    if (enable_timeline_semaphores) {
+        device_extensions_wishlist.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+
+    if (enable_memory_budget) {
+        device_extensions_wishlist.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
     // The actual list of enabled device extensions.
     std::vector<const char *> enabled_device_extensions;
 
@@ -67,12 +83,17 @@ VkResult VulkanRenderer::create_physical_device(const VkPhysicalDevice &graphics
         }
     }
 
+    // The extension alone is not enough, the feature must be enabled as well.
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_features = {};
+    timeline_semaphore_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    timeline_semaphore_features.timelineSemaphore = VK_TRUE;
+
     VkDeviceCreateInfo device_create_info = {};
 
     auto queues_to_create = gpu_queue_manager->get_queues_to_create();
 
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    device_create_info.pNext = nullptr;
+    device_create_info.pNext = enable_timeline_semaphores ? &timeline_semaphore_features : nullptr;
     device_create_info.flags = 0;
     device_create_info.queueCreateInfoCount = static_cast<std::uint32_t>(queues_to_create.size());
     device_create_info.pQueueCreateInfos = queues_to_create.data();
@@ -130,7 +151,10 @@ VkResult VulkanRenderer::create_command_pool() {
 }
 
 VkResult VulkanRenderer::create_uniform_buffers() {
-    uniform_buffers.emplace_back(device, vma_allocator, std::string("matrices uniform buffer"), sizeof(UniformBufferObject));
+    // The command buffers are recorded once per swapchain image, and the command buffer of an image is only
+    // submitted again once its previous submission has finished. One region per image is therefore safe to write.
+    uniform_ring_buffer = std::make_unique<UniformRingBuffer>(device, selected_graphics_card, vma_allocator, std::string("matrices uniform ring buffer"),
+                                                              UNIFORM_RING_BUFFER_REGION_SIZE, number_of_images_in_swapchain, sizeof(UniformBufferObject));
 
     return VK_SUCCESS;
 }
@@ -274,24 +298,39 @@ VkResult VulkanRenderer::create_vma_allocator() {
 
     allocator_info.physicalDevice = selected_graphics_card;
     allocator_info.device = device;
+    allocator_info.instance = vkinstance->get_instance();
+
+    if (memory_budget_enabled) {
+        // VMA queries the budget with vkGetPhysicalDeviceMemoryProperties2, which is core in Vulkan 1.1.
+        allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        allocator_info.vulkanApiVersion = VK_API_VERSION_1_1;
+    }
+
+    if (allocation_statistics_enabled) {
+        // The stream records the same calls as VMA's recording, without writing and flushing a line on every call.
+        allocator_info.pDeviceMemoryCallbacks = AllocationStatisticsStream::get_device_memory_callbacks();
+    } else {
 #if VMA_RECORDING_ENABLED
-    allocator_info.pRecordSettings = &vma_record_settings;
+        allocator_info.pRecordSettings = &vma_record_settings;
 #endif
-    allocator_info.instance = vkinstance->get_instance();
+    }
 
     // Create an instance of Vulkan memory allocator.
     VkResult result = vmaCreateAllocator(&allocator_info, &vma_allocator);
     vulkan_error_check(result);
 
+    if (allocation_statistics_enabled) {
+        allocation_statistics_stream = std::make_unique<AllocationStatisticsStream>(vma_allocator);
+    }
+
     return VK_SUCCESS;
 }
 
-VkResult VulkanRenderer::record_command_buffers() {
+VkResult VulkanRenderer::record_command_buffer(const std::uint32_t image_index) {
     assert(debug_marker_manager);
     assert(window_width > 0);
     assert(window_height > 0);
-
-    spdlog::debug("Recording command buffers.");
+    assert(image_index < number_of_images_in_swapchain);
 
     VkCommandBufferBeginInfo command_buffer_begin_info = {};
 
@@ -335,59 +374,85 @@ VkResult VulkanRenderer::record_command_buffers() {
     scissor.extent.width = window_width;
     scissor.extent.height = window_height;
 
-    for (std::size_t i = 0; i < number_of_images_in_swapchain; i++) {
-        spdlog::debug("Recording command buffer #{}.", i);
+    spdlog::debug("Recording command buffer #{}.", image_index);
 
-        // TODO: Fix debug marker regions in RenderDoc.
-        // Start binding the region with Vulkan debug markers.
-        debug_marker_manager->bind_region(command_buffers[i], "Beginning of rendering.", DEBUG_MARKER_GREEN);
+    // Every command buffer uses the descriptor set of its swapchain image, which is not in use while the command buffer isn't.
+    if (texture_descriptors_outdated[image_index]) {
+        descriptor_image_info.imageView = textures[0].get_image_view();
+        descriptor_image_info.sampler = textures[0].get_sampler();
 
-        VkResult result = vkBeginCommandBuffer(command_buffers[i], &command_buffer_begin_info);
-        if (VK_SUCCESS != result)
-            return result;
+        descriptors[0].update_image_descriptor(image_index, 1, descriptor_image_info);
 
-        // Update only the necessary parts of VkRenderPassBeginInfo.
-        render_pass_begin_info.framebuffer = frame_buffers[i];
+        texture_descriptors_outdated[image_index] = false;
+    }
+
+    // TODO: Fix debug marker regions in RenderDoc.
+    // Start binding the region with Vulkan debug markers.
+    debug_marker_manager->bind_region(command_buffers[image_index], "Beginning of rendering.", DEBUG_MARKER_GREEN);
 
-        vkCmdBeginRenderPass(command_buffers[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    VkResult result = vkBeginCommandBuffer(command_buffers[image_index], &command_buffer_begin_info);
+    if (VK_SUCCESS != result)
+        return result;
 
-        // ----------------------------------------------------------------------------------------------------------------
-        // Begin of render pass.
-        {
-            vkCmdSetViewport(command_buffers[i], 0, 1, &viewport);
+    // Update only the necessary parts of VkRenderPassBeginInfo.
+    render_pass_begin_info.framebuffer = frame_buffers[image_index];
 
-            vkCmdSetScissor(command_buffers[i], 0, 1, &scissor);
+    vkCmdBeginRenderPass(command_buffers[image_index], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
 
-            // TODO: Render skybox!
+    // ----------------------------------------------------------------------------------------------------------------
+    // Begin of render pass.
+    {
+        vkCmdSetViewport(command_buffers[image_index], 0, 1, &viewport);
 
-            vkCmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        vkCmdSetScissor(command_buffers[image_index], 0, 1, &scissor);
 
-            vkCmdBindDescriptorSets(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, descriptors[0].get_descriptor_sets_data(), 0,
-                                    nullptr);
+        // TODO: Render skybox!
 
-            VkBuffer vertexBuffers[] = {mesh_buffers[0].get_vertex_buffer()};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(command_buffers[i], 0, 1, vertexBuffers, offsets);
+        vkCmdBindPipeline(command_buffers[image_index], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
-            vkCmdDraw(command_buffers[i], mesh_buffers[0].get_vertex_count(), 1, 0, 0);
+        // The matrices are the first uniform data in the image's region of the uniform ring buffer.
+        const std::uint32_t dynamic_offset = uniform_ring_buffer->get_region_offset(image_index);
 
-            // TODO: This does not specify the order of rendering!
-            // gltf_model_manager->render_all_models(command_buffers[i], pipeline_layout, i);
+        vkCmdBindDescriptorSets(command_buffers[image_index], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1,
+                                descriptors[0].get_descriptor_sets_data() + image_index, 1, &dynamic_offset);
 
-            // TODO: Draw imgui user interface.
+        // All octree meshes share the buffers of the arena, so they are bound only once.
+        octree_mesh_arena->bind(command_buffers[image_index]);
+
+        for (const auto &octree_mesh : octree_meshes) {
+            octree_mesh_arena->draw(command_buffers[image_index], octree_mesh);
         }
-        // End of render pass.
-        // ----------------------------------------------------------------------------------------------------------------
 
-        vkCmdEndRenderPass(command_buffers[i]);
+        // TODO: This does not specify the order of rendering!
+        // gltf_model_manager->render_all_models(command_buffers[image_index], pipeline_layout, image_index);
+
+        // TODO: Draw imgui user interface.
+    }
+    // End of render pass.
+    // ----------------------------------------------------------------------------------------------------------------
+
+    vkCmdEndRenderPass(command_buffers[image_index]);
+
+    result = vkEndCommandBuffer(command_buffers[image_index]);
+    if (VK_SUCCESS != result)
+        return result;
+
+    debug_marker_manager->end_region(command_buffers[image_index]);
 
-        result = vkEndCommandBuffer(command_buffers[i]);
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRenderer::record_command_buffers() {
+    spdlog::debug("Recording command buffers.");
+
+    for (std::uint32_t i = 0; i < number_of_images_in_swapchain; i++) {
+        VkResult result = record_command_buffer(i);
         if (VK_SUCCESS != result)
             return result;
-
-        debug_marker_manager->end_region(command_buffers[i]);
     }
 
+    command_buffers_outdated.assign(number_of_images_in_swapchain, false);
+
     return VK_SUCCESS;
 }
 
@@ -411,11 +476,25 @@ VkResult VulkanRenderer::create_synchronisation_objects() {
         std::string rendering_finished_semaphore_name = "rendering_finished_semaphores_" + std::to_string(i);
         std::string in_flight_fence_name = "in_flight_fences_" + std::to_string(i);
 
-        auto in_flight_fence = fence_manager->create_fence(in_flight_fence_name, true);
-        auto new_image_available_semaphore = semaphore_manager->create_semaphore(image_available_semaphore_name);
-        auto new_rendering_finished_semaphore = semaphore_manager->create_semaphore(rendering_finished_semaphore_name);
+        // The fences and semaphores are looked up every frame, so they are referenced by handle instead of by name.
+        auto new_image_available_semaphore = semaphore_manager->create_semaphore_handle(image_available_semaphore_name);
+        auto new_rendering_finished_semaphore = semaphore_manager->create_semaphore_handle(rendering_finished_semaphore_name);
+
+        if (!new_image_available_semaphore || !new_rendering_finished_semaphore) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        // The frame timeline replaces the fences.
+        if (!frame_timeline_enabled) {
+            auto in_flight_fence = fence_manager->create_fence_handle(in_flight_fence_name, true);
+
+            if (!in_flight_fence) {
+                return VK_ERROR_INITIALIZATION_FAILED;
+            }
+
+            in_flight_fences.push_back(in_flight_fence.value());
+        }
 
-        in_flight_fences.push_back(in_flight_fence.value());
         image_available_semaphores.push_back(new_image_available_semaphore.value());
         rendering_finished_semaphores.push_back(new_rendering_finished_semaphore.value());
     }
@@ -425,6 +504,12 @@ VkResult VulkanRenderer::create_synchronisation_objects() {
     // Note: Images in flight do not need to be initialised!
     images_in_flight.resize(number_of_images_in_swapchain, VK_NULL_HANDLE);
 
+    image_frame_numbers.clear();
+    image_frame_numbers.resize(number_of_images_in_swapchain, 0);
+
+    in_flight_frame_numbers.clear();
+    in_flight_frame_numbers.resize(MAX_FRAMES_IN_FLIGHT, 0);
+
     return VK_SUCCESS;
 }
 
@@ -878,7 +963,7 @@ VkResult VulkanRenderer::create_descriptor_pool() {
     descriptors.emplace_back(device, number_of_images_in_swapchain, std::string("unnamed descriptor"));
 
     // Create the descriptor pool.
-    descriptors[0].create_descriptor_pool({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER});
+    descriptors[0].create_descriptor_pool({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER});
 
     return VK_SUCCESS;
 }
@@ -887,7 +972,7 @@ VkResult VulkanRenderer::create_descriptor_set_layouts() {
     std::vector<VkDescriptorSetLayoutBinding> descriptor_set_layout_bindings(2);
 
     descriptor_set_layout_bindings[0].binding = 0;
-    descriptor_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptor_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptor_set_layout_bindings[0].descriptorCount = 1;
     descriptor_set_layout_bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     descriptor_set_layout_bindings[0].pImmutableSamplers = nullptr;
@@ -911,15 +996,15 @@ VkResult VulkanRenderer::create_descriptor_writes() {
     // Link the matrices uniform buffer to the descriptor set so the shader can access it.
 
     // We can do better than this, but therefore RAII refactoring needs to be done..
-    uniform_buffer_info.buffer = uniform_buffers[0].get_buffer();
+    uniform_buffer_info.buffer = uniform_ring_buffer->get_buffer();
     uniform_buffer_info.offset = 0;
-    uniform_buffer_info.range = sizeof(UniformBufferObject);
+    uniform_buffer_info.range = uniform_ring_buffer->get_descriptor_range();
 
     descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptor_writes[0].dstSet = 0;
     descriptor_writes[0].dstBinding = 0;
     descriptor_writes[0].dstArrayElement = 0;
-    descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptor_writes[0].descriptorCount = 1;
     descriptor_writes[0].pBufferInfo = &uniform_buffer_info;
 
@@ -940,6 +1025,8 @@ VkResult VulkanRenderer::create_descriptor_writes() {
 
     descriptors[0].create_descriptor_sets();
 
+    texture_descriptors_outdated.assign(number_of_images_in_swapchain, false);
+
     return VK_SUCCESS;
 }
 
@@ -1646,13 +1733,57 @@ VkResult VulkanRenderer::shutdown_vulkan() {
 
     cleanup_swapchain();
 
+    if (memory_budget_tracker) {
+        spdlog::debug("Memory budget at shutdown:");
+        memory_budget_tracker->log_statistics();
+        memory_budget_tracker.reset();
+    }
+
+    // The pending defragmentation pass is ended before the buffers it moves are destroyed.
+    if (memory_defragmenter) {
+        memory_defragmenter->log_statistics();
+        memory_defragmenter.reset();
+    }
+
+    // The retired images of the streamed textures are destroyed before the textures.
+    if (texture_streamer) {
+        texture_streamer->log_statistics();
+        texture_streamer.reset();
+    }
+
     // TODO(yeetari): Remove once this class is RAII-ified
     shaders.clear();
     textures.clear();
-    uniform_buffers.clear();
+    uniform_ring_buffer.reset();
     mesh_buffers.clear();
+    octree_meshes.clear();
+    octree_mesh_arena.reset();
     descriptors.clear();
 
+    // The textures release their samplers, so the sampler cache is destroyed after them.
+    if (sampler_cache) {
+        const auto sampler_cache_statistics = sampler_cache->get_statistics();
+
+        spdlog::debug("Sampler cache: {} hits, {} misses.", sampler_cache_statistics.hits, sampler_cache_statistics.misses);
+        sampler_cache.reset();
+    }
+
+    spdlog::debug("Destroying recycling pools.");
+    if (fence_pool && semaphore_pool) {
+        const auto fence_pool_statistics = fence_pool->get_statistics();
+        const auto semaphore_pool_statistics = semaphore_pool->get_statistics();
+
+        spdlog::debug("Fence pool: {} hits, {} misses.", fence_pool_statistics.hits, fence_pool_statistics.misses);
+        spdlog::debug("Semaphore pool: {} hits, {} misses.", semaphore_pool_statistics.hits, semaphore_pool_statistics.misses);
+    }
+
+    // The upload batchers and the command buffer recycler use the recycling pools, so they must be destroyed first.
+    upload_batcher.reset();
+    transfer_upload_batcher.reset();
+    command_buffer_recycler.reset();
+    semaphore_pool.reset();
+    fence_pool.reset();
+
     spdlog::debug("Destroying swapchain images.");
     if (swapchain_images.size() > 0) {
         for (auto image : swapchain_images) {
@@ -1665,6 +1796,9 @@ VkResult VulkanRenderer::shutdown_vulkan() {
         swapchain_images.clear();
     }
 
+    spdlog::debug("Destroying frame timeline.");
+    frame_timeline->shutdown();
+
     spdlog::debug("Destroying semaphores.");
     semaphore_manager->shutdown_semaphores();
 
@@ -1677,6 +1811,9 @@ VkResult VulkanRenderer::shutdown_vulkan() {
         surface = VK_NULL_HANDLE;
     }
 
+    // The last snapshot of the statistics is taken before the allocator is destroyed.
+    allocation_statistics_stream.reset();
+
     vmaDestroyAllocator(vma_allocator);
 
     spdlog::debug("Destroying Vulkan pipeline cache.");
@@ -1716,6 +1853,8 @@ VkResult VulkanRenderer::shutdown_vulkan() {
     spdlog::debug("------------------------------------------------------------------------------------------------------------");
 
     images_in_flight.clear();
+    image_frame_numbers.clear();
+    in_flight_frame_numbers.clear();
     in_flight_fences.clear();
     image_available_semaphores.clear();
     rendering_finished_semaphores.clear();
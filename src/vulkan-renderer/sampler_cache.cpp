@@ -0,0 +1,118 @@
+#include "inexor/vulkan-renderer/sampler_cache.hpp"
+
+#include <functional>
+#include <tuple>
+
+namespace inexor::vulkan_renderer {
+
+namespace {
+
+/// Every field of the sampler state, without sType and pNext.
+auto tie_sampler_state(const VkSamplerCreateInfo &create_info) {
+    return std::tie(create_info.flags, create_info.magFilter, create_info.minFilter, create_info.mipmapMode, create_info.addressModeU,
+                    create_info.addressModeV, create_info.addressModeW, create_info.mipLodBias, create_info.anisotropyEnable, create_info.maxAnisotropy,
+                    create_info.compareEnable, create_info.compareOp, create_info.minLod, create_info.maxLod, create_info.borderColor,
+                    create_info.unnormalizedCoordinates);
+}
+
+template <typename T>
+void hash_combine(std::size_t &seed, const T &value) {
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+} // namespace
+
+std::size_t SamplerCache::CreateInfoHash::operator()(const VkSamplerCreateInfo &create_info) const {
+    std::size_t seed = 0;
+
+    std::apply([&](const auto &... fields) { (hash_combine(seed, fields), ...); }, tie_sampler_state(create_info));
+
+    return seed;
+}
+
+bool SamplerCache::CreateInfoEqual::operator()(const VkSamplerCreateInfo &lhs, const VkSamplerCreateInfo &rhs) const {
+    return tie_sampler_state(lhs) == tie_sampler_state(rhs);
+}
+
+SamplerCache::SamplerCache(const VkDevice device, const PFN_vkCreateSampler create_sampler, const PFN_vkDestroySampler destroy_sampler)
+    : device(device), create_sampler(create_sampler), destroy_sampler(destroy_sampler) {
+    assert(device);
+    assert(create_sampler);
+    assert(destroy_sampler);
+}
+
+SamplerCache::~SamplerCache() {
+    if (!cached_samplers.empty()) {
+        spdlog::warn("Destroying {} samplers which have not been released.", cached_samplers.size());
+    }
+
+    for (const auto &cached_sampler : cached_samplers) {
+        destroy_sampler(device, cached_sampler.first, nullptr);
+    }
+}
+
+VkSampler SamplerCache::acquire(const VkSamplerCreateInfo &create_info) {
+    assert(create_info.pNext == nullptr);
+
+    std::lock_guard<std::mutex> lock(sampler_cache_mutex);
+
+    const auto sampler = samplers.find(create_info);
+
+    if (sampler != samplers.end()) {
+        cached_samplers.at(sampler->second).reference_count++;
+        hits++;
+        return sampler->second;
+    }
+
+    VkSamplerCreateInfo key = create_info;
+    key.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    key.pNext = nullptr;
+
+    VkSampler new_sampler = VK_NULL_HANDLE;
+
+    if (create_sampler(device, &key, nullptr, &new_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkCreateSampler failed for sampler cache!");
+    }
+
+    misses++;
+
+    samplers.emplace(key, new_sampler);
+    cached_samplers.emplace(new_sampler, CachedSampler{key, 1});
+
+    spdlog::debug("Sampler cache created a new sampler, it contains {} samplers now.", cached_samplers.size());
+
+    return new_sampler;
+}
+
+void SamplerCache::release(const VkSampler sampler) {
+    assert(sampler);
+
+    std::lock_guard<std::mutex> lock(sampler_cache_mutex);
+
+    const auto cached_sampler = cached_samplers.find(sampler);
+    assert(cached_sampler != cached_samplers.end());
+    assert(cached_sampler->second.reference_count > 0);
+
+    if (--cached_sampler->second.reference_count > 0) {
+        return;
+    }
+
+    samplers.erase(cached_sampler->second.create_info);
+    cached_samplers.erase(cached_sampler);
+
+    destroy_sampler(device, sampler, nullptr);
+}
+
+SamplerCacheStatistics SamplerCache::get_statistics() const {
+    std::lock_guard<std::mutex> lock(sampler_cache_mutex);
+
+    SamplerCacheStatistics statistics;
+
+    statistics.hits = hits;
+    statistics.misses = misses;
+    statistics.samplers = cached_samplers.size();
+
+    return statistics;
+}
+
+} // namespace inexor::vulkan_renderer
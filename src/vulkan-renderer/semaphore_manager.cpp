@@ -19,7 +19,7 @@ VkResult VulkanSemaphoreManager::init(const VkDevice &device, const std::shared_
     return VK_SUCCESS;
 }
 
-bool VulkanSemaphoreManager::does_semaphore_exist(const std::string &semaphore_name) {
+bool VulkanSemaphoreManager::does_semaphore_exist(const HashedName &semaphore_name) {
     assert(semaphore_manager_initialised);
     assert(!semaphore_name.empty());
 
@@ -27,6 +27,19 @@ bool VulkanSemaphoreManager::does_semaphore_exist(const std::string &semaphore_n
     return does_key_exist(semaphore_name);
 }
 
+VkResult VulkanSemaphoreManager::create_vulkan_semaphore(VkSemaphore &semaphore) {
+    VkSemaphoreCreateInfo semaphore_create_info = {};
+
+    // So far, there is nothing to fill into this structure.
+    // This may change in the future!
+    // https://www.khronos.org/registry/vulkan/specs/1.2-extensions/man/html/VkSemaphoreCreateInfo.html
+    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_create_info.pNext = nullptr;
+    semaphore_create_info.flags = 0;
+
+    return vkCreateSemaphore(device, &semaphore_create_info, nullptr, &semaphore);
+}
+
 std::optional<std::shared_ptr<VkSemaphore>> VulkanSemaphoreManager::create_semaphore(const std::string &semaphore_name) {
     assert(device);
     assert(semaphore_manager_initialised);
@@ -38,20 +51,10 @@ std::optional<std::shared_ptr<VkSemaphore>> VulkanSemaphoreManager::create_semap
         return std::nullopt;
     }
 
-    VkSemaphoreCreateInfo semaphore_create_info = {};
-
-    // So far, there is nothing to fill into this structure.
-    // This may change in the future!
-    // https://www.khronos.org/registry/vulkan/specs/1.2-extensions/man/html/VkSemaphoreCreateInfo.html
-    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    semaphore_create_info.pNext = nullptr;
-    semaphore_create_info.flags = 0;
-
     // The new Vulkan semaphore which will be created.
     std::shared_ptr<VkSemaphore> new_semaphore = std::make_shared<VkSemaphore>();
 
-    // TODO: Does that work?
-    VkResult result = vkCreateSemaphore(device, &semaphore_create_info, nullptr, &(*new_semaphore));
+    VkResult result = create_vulkan_semaphore(*new_semaphore);
     if (result != VK_SUCCESS) {
         vulkan_error_check(result);
         return std::nullopt;
@@ -63,12 +66,12 @@ std::optional<std::shared_ptr<VkSemaphore>> VulkanSemaphoreManager::create_semap
     return new_semaphore;
 }
 
-std::optional<std::shared_ptr<VkSemaphore>> VulkanSemaphoreManager::get_semaphore(const std::string &semaphore_name) {
+std::optional<std::shared_ptr<VkSemaphore>> VulkanSemaphoreManager::get_semaphore(const HashedName &semaphore_name) {
     assert(semaphore_manager_initialised);
     assert(!semaphore_name.empty());
 
     if (!does_key_exist(semaphore_name)) {
-        spdlog::error("Semaphore '{}' does not exist!", semaphore_name);
+        spdlog::error("Semaphore '{}' does not exist!", get_key_name(semaphore_name));
         return std::nullopt;
     }
 
@@ -76,6 +79,53 @@ std::optional<std::shared_ptr<VkSemaphore>> VulkanSemaphoreManager::get_semaphor
     return get_entry(semaphore_name);
 }
 
+std::optional<SemaphoreHandle> VulkanSemaphoreManager::create_semaphore_handle(const std::string &debug_name) {
+    assert(device);
+    assert(semaphore_manager_initialised);
+
+    VkSemaphore new_semaphore = VK_NULL_HANDLE;
+
+    VkResult result = create_vulkan_semaphore(new_semaphore);
+    if (result != VK_SUCCESS) {
+        vulkan_error_check(result);
+        return std::nullopt;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(semaphores_mutex);
+
+    return semaphores.insert(new_semaphore, debug_name);
+}
+
+VkSemaphore VulkanSemaphoreManager::get_semaphore(SemaphoreHandle semaphore_handle) {
+    std::shared_lock<std::shared_mutex> lock(semaphores_mutex);
+
+    const VkSemaphore *semaphore = semaphores.get(semaphore_handle);
+
+    if (semaphore == nullptr) {
+        spdlog::error("Semaphore handle {} is stale!", semaphore_handle.get_value());
+        return VK_NULL_HANDLE;
+    }
+
+    return *semaphore;
+}
+
+void VulkanSemaphoreManager::destroy_semaphore(SemaphoreHandle semaphore_handle) {
+    assert(device);
+
+    std::unique_lock<std::shared_mutex> lock(semaphores_mutex);
+
+    const VkSemaphore *semaphore = semaphores.get(semaphore_handle);
+
+    if (semaphore == nullptr) {
+        spdlog::error("Semaphore handle {} is stale!", semaphore_handle.get_value());
+        return;
+    }
+
+    vkDestroySemaphore(device, *semaphore, nullptr);
+
+    semaphores.erase(semaphore_handle);
+}
+
 void VulkanSemaphoreManager::shutdown_semaphores() {
     assert(device);
     assert(semaphore_manager_initialised);
@@ -94,6 +144,14 @@ void VulkanSemaphoreManager::shutdown_semaphores() {
 
     // Call template base class method.
     delete_all_entries();
+
+    std::unique_lock<std::shared_mutex> semaphores_lock(semaphores_mutex);
+
+    for (auto semaphore : semaphores) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+
+    semaphores.clear();
 }
 
 } // namespace inexor::vulkan_renderer
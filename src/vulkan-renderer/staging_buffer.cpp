@@ -7,16 +7,17 @@ StagingBuffer::StagingBuffer(StagingBuffer &&other) noexcept
       GPUMemoryBuffer(std::move(other)) {}
 
 StagingBuffer::StagingBuffer(const VkDevice device, const VmaAllocator vma_allocator, const VkQueue data_transfer_queue,
-                             const std::uint32_t data_transfer_queueu_family_index, const std::string &name, const VkDeviceSize buffer_size, void *data,
-                             const std::size_t data_size)
+                             const std::uint32_t data_transfer_queueu_family_index, CommandBufferRecycler &command_buffer_recycler, const std::string &name,
+                             const VkDeviceSize buffer_size, void *data, const std::size_t data_size)
     : GPUMemoryBuffer(device, vma_allocator, name, buffer_size, data, data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY),
-      data_transfer_queue(data_transfer_queue), command_buffer_for_copying(device, data_transfer_queue, data_transfer_queueu_family_index) {}
+      data_transfer_queue(data_transfer_queue),
+      command_buffer_for_copying(device, data_transfer_queue, data_transfer_queueu_family_index, command_buffer_recycler) {}
 
-void StagingBuffer::upload_data_to_gpu(const GPUMemoryBuffer &target_buffer) {
+void StagingBuffer::upload_data_to_gpu(const GPUMemoryBuffer &target_buffer, const VkDeviceSize target_offset) {
     VkBufferCopy vertex_buffer_copy = {};
 
     vertex_buffer_copy.srcOffset = 0;
-    vertex_buffer_copy.dstOffset = 0;
+    vertex_buffer_copy.dstOffset = target_offset;
     vertex_buffer_copy.size = buffer_size;
 
     VkCommandBufferBeginInfo buffer_copy_begin_info = {};
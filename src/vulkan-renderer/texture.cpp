@@ -1,83 +1,82 @@
 #include "inexor/vulkan-renderer/texture.hpp"
 
-// stb single-file public domain libraries for C/C++
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include "inexor/vulkan-renderer/allocation_statistics_stream.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace inexor::vulkan_renderer {
 
 Texture::Texture(Texture &&other) noexcept
     : name(std::move(other.name)), file_name(std::move(other.file_name)), texture_width(other.texture_width), texture_height(other.texture_height),
-      texture_channels(other.texture_channels), mip_levels(other.mip_levels), device(other.device), graphics_card(other.graphics_card),
-      data_transfer_queue(other.data_transfer_queue), vma_allocator(other.vma_allocator), allocation(std::exchange(other.allocation, nullptr)),
-      allocation_info(other.allocation_info), image(std::exchange(other.image, nullptr)), image_view(std::exchange(other.image_view, nullptr)),
-      sampler(std::exchange(other.sampler, nullptr)), texture_image_format(other.texture_image_format),
-      copy_command_buffer(std::move(other.copy_command_buffer)) {}
+      texture_channels(other.texture_channels), mip_levels(other.mip_levels), mipmap_generation(other.mipmap_generation), device(other.device),
+      graphics_card(other.graphics_card),
+      upload_batcher(other.upload_batcher), sampler_cache(other.sampler_cache), upload_token(other.upload_token), vma_allocator(other.vma_allocator),
+      allocation(std::exchange(other.allocation, nullptr)), allocation_info(other.allocation_info), image(std::exchange(other.image, nullptr)),
+      image_view(std::exchange(other.image_view, nullptr)), sampler(std::exchange(other.sampler, nullptr)), texture_image_format(other.texture_image_format),
+      streamed(other.streamed), resident_mip_level(other.resident_mip_level), initial_mip_level(other.initial_mip_level),
+      streaming_data(std::move(other.streaming_data)), streaming_regions(std::move(other.streaming_regions)),
+      pending_image(std::exchange(other.pending_image, nullptr)), pending_allocation(std::exchange(other.pending_allocation, nullptr)),
+      pending_allocation_info(other.pending_allocation_info), pending_image_view(std::exchange(other.pending_image_view, nullptr)),
+      pending_mip_level(other.pending_mip_level), pending_upload_token(other.pending_upload_token) {}
 
 Texture::Texture(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, void *texture_data,
-                 const std::size_t texture_size, const std::string &name, const VkQueue data_transfer_queue,
-                 const std::uint32_t data_transfer_queue_family_index)
-    : name(name), file_name(file_name), device(device), graphics_card(graphics_card), data_transfer_queue(data_transfer_queue), vma_allocator(vma_allocator),
-      copy_command_buffer(device, data_transfer_queue, data_transfer_queue_family_index) {
+                 const std::size_t texture_size, const std::string &name, UploadBatcher &upload_batcher, SamplerCache &sampler_cache,
+                 const MipmapGeneration mipmap_generation)
+    : name(name), file_name(file_name), mipmap_generation(mipmap_generation), device(device), graphics_card(graphics_card), upload_batcher(&upload_batcher),
+      sampler_cache(&sampler_cache), vma_allocator(vma_allocator) {
 
     create_texture(texture_data, texture_size);
 }
 
 Texture::Texture(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, const std::string &file_name,
-                 const std::string &name, const VkQueue data_transfer_queue, const std::uint32_t data_transfer_queue_family_index)
-    : name(name), file_name(file_name), device(device), graphics_card(graphics_card), data_transfer_queue(data_transfer_queue),
-      data_transfer_queue_family_index(data_transfer_queue_family_index), vma_allocator(vma_allocator),
-      copy_command_buffer(device, data_transfer_queue, data_transfer_queue_family_index) {
+                 const std::string &name, UploadBatcher &upload_batcher, SamplerCache &sampler_cache, const MipmapGeneration mipmap_generation,
+                 const bool streamed)
+    : Texture(device, graphics_card, vma_allocator, TextureFile(file_name), name, upload_batcher, sampler_cache, mipmap_generation, streamed) {}
+
+Texture::Texture(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, const TextureFile &texture_file,
+                 const std::string &name, UploadBatcher &upload_batcher, SamplerCache &sampler_cache, const MipmapGeneration mipmap_generation,
+                 const bool streamed)
+    : name(name), file_name(texture_file.get_file_name()), texture_width(texture_file.get_width()), texture_height(texture_file.get_height()),
+      texture_channels(texture_file.get_channels()), mipmap_generation(mipmap_generation), device(device), graphics_card(graphics_card),
+      upload_batcher(&upload_batcher), sampler_cache(&sampler_cache), vma_allocator(vma_allocator), streamed(streamed) {
     assert(device);
     assert(vma_allocator);
-    assert(!file_name.empty());
     assert(!name.empty());
-    assert(data_transfer_queue);
 
-    spdlog::debug("Loading texture file {}.", file_name);
+    if (texture_file.get_compressed_file()) {
+        const CompressedTextureFile &compressed_file = *texture_file.get_compressed_file();
 
-    // Load the texture file using stb_image library.
-    // Force stb_image to load an alpha channel as well.
-    stbi_uc *texture_data = stbi_load(file_name.c_str(), &texture_width, &texture_height, &texture_channels, STBI_rgb_alpha);
+        if (!CompressedTextureFile::is_format_supported(graphics_card, compressed_file.get_format())) {
+            throw std::runtime_error("Error: The graphics card does not support the format of texture file " + file_name + "!");
+        }
 
-    if (texture_data == nullptr) {
-        throw std::runtime_error("Error: Could not load texture file " + file_name + " using stbi_load!");
+        create_compressed_texture(compressed_file);
+        return;
     }
 
-    spdlog::debug("Texture dimensions: width: {}, height: {}, channels: {}.", texture_width, texture_height, texture_channels);
-
-    // Calculate the memory size of the texture.
-    // We need 4 times the size since we have 4 channels: red, green, blue and alpha channel.
-    VkDeviceSize texture_memory_size = 4 * texture_width * texture_height;
-
-    create_texture(texture_data, texture_memory_size);
-
-    // We can discard the texture data since we copied it already to GPU memory.
-    stbi_image_free(texture_data);
+    // The upload batcher copies the texels into its staging memory, the texture file can be discarded afterwards.
+    create_texture(texture_file.get_pixels(), texture_file.get_pixel_data_size());
 }
 
-void Texture::create_texture(void *texture_data, const std::size_t texture_size) {
-
-    // For now, we will not generate mip-maps automatically.
-    // TODO: Generate mip-maps automatically!
-    mip_levels = 1;
-
-    StagingBuffer texture_staging_buffer(device, vma_allocator, data_transfer_queue, data_transfer_queue_family_index, name, texture_size, texture_data,
-                                         texture_size);
+VkResult Texture::create_image(const VkImageUsageFlags usage, const std::uint32_t first_mip_level, VkImage &image, VmaAllocation &allocation,
+                               VmaAllocationInfo &allocation_info) {
+    assert(first_mip_level < static_cast<std::uint32_t>(mip_levels));
 
     VkImageCreateInfo image_create_info = {};
 
     image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     image_create_info.imageType = VK_IMAGE_TYPE_2D;
-    image_create_info.extent.width = texture_width;
-    image_create_info.extent.height = texture_height;
+    image_create_info.extent.width = std::max(texture_width >> first_mip_level, 1);
+    image_create_info.extent.height = std::max(texture_height >> first_mip_level, 1);
     image_create_info.extent.depth = 1;
-    image_create_info.mipLevels = 1;
+    image_create_info.mipLevels = mip_levels - first_mip_level;
     image_create_info.arrayLayers = 1;
     image_create_info.format = texture_image_format;
     image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
     image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    image_create_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    image_create_info.usage = usage;
     image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
     image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -91,19 +90,156 @@ void Texture::create_texture(void *texture_data, const std::size_t texture_size)
     allocation_create_info.pUserData = this->name.data();
 #endif
 
-    spdlog::debug("Creating image for texture {}.", name);
+    spdlog::debug("Creating image for texture {} from mip level {} on.", name, first_mip_level);
+
+    const VkResult result = vmaCreateImage(vma_allocator, &image_create_info, &allocation_create_info, &image, &allocation, &allocation_info);
+
+    if (result == VK_SUCCESS) {
+        AllocationStatisticsStream::on_create_image(vma_allocator, image_create_info, allocation_create_info, allocation);
+    }
+
+    return result;
+}
 
-    if (vmaCreateImage(vma_allocator, &image_create_info, &allocation_create_info, &image, &allocation, &allocation_info) != VK_SUCCESS) {
+void Texture::create_image(const VkImageUsageFlags usage) {
+    if (create_image(usage, resident_mip_level, image, allocation, allocation_info) != VK_SUCCESS) {
         throw std::runtime_error("Error: vmaCreateImage failed for texture " + name + " !");
     }
+}
+
+std::uint32_t Texture::calculate_initial_mip_level() const {
+    std::uint32_t mip_level = 0;
+
+    while (static_cast<int>(mip_level) + 1 < mip_levels &&
+           std::max(texture_width >> mip_level, texture_height >> mip_level) > TEXTURE_STREAMING_INITIAL_SIZE) {
+        mip_level++;
+    }
+
+    return mip_level;
+}
+
+UploadToken Texture::upload_mip_levels(const VkImage image, const std::uint32_t first_mip_level, const std::uint8_t *data, const std::size_t size,
+                                       const std::vector<VkBufferImageCopy> &regions) {
+    assert(data);
+    assert(first_mip_level < regions.size());
+
+    VkImageSubresourceRange subresource_range = {};
 
-    copy_command_buffer.create_command_buffer();
+    subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource_range.baseMipLevel = 0;
+    subresource_range.levelCount = mip_levels - first_mip_level;
+    subresource_range.baseArrayLayer = 0;
+    subresource_range.layerCount = 1;
 
-    copy_command_buffer.start_recording();
+    // The levels are stored one after another, so the uploaded data starts with the first level, and the levels of the image are shifted.
+    const VkDeviceSize data_offset = regions[first_mip_level].bufferOffset;
 
-    spdlog::debug("Transitioning image layout of texture {} to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL.", name);
+    std::vector<VkBufferImageCopy> image_regions(regions.begin() + first_mip_level, regions.end());
+
+    for (auto &region : image_regions) {
+        region.bufferOffset -= data_offset;
+        region.imageSubresource.mipLevel -= first_mip_level;
+    }
+
+    return upload_batcher->upload_image(image, subresource_range, image_regions, data + data_offset, size - static_cast<std::size_t>(data_offset));
+}
+
+VkDeviceSize Texture::get_mip_levels_size(const std::uint32_t first_mip_level) const {
+    assert(streamed);
+    assert(first_mip_level < streaming_regions.size());
+
+    return streaming_data.size() - streaming_regions[first_mip_level].bufferOffset;
+}
+
+bool Texture::begin_residency_change(const std::uint32_t first_mip_level) {
+    assert(streamed);
+    assert(first_mip_level <= initial_mip_level);
+
+    if (pending_image != VK_NULL_HANDLE || first_mip_level == resident_mip_level) {
+        return false;
+    }
+
+    // The texture keeps its current mip levels if device memory has run out.
+    if (create_image(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, first_mip_level, pending_image, pending_allocation,
+                     pending_allocation_info) != VK_SUCCESS) {
+        spdlog::debug("Could not create image for mip level {} of texture {}.", first_mip_level, name);
+        return false;
+    }
+
+    if (create_image_view(pending_image, first_mip_level, pending_image_view) != VK_SUCCESS) {
+        destroy_retired_image({device, vma_allocator, std::exchange(pending_image, nullptr), std::exchange(pending_allocation, nullptr), VK_NULL_HANDLE});
+        pending_image_view = VK_NULL_HANDLE;
+        return false;
+    }
+
+    pending_mip_level = first_mip_level;
+    pending_upload_token = upload_mip_levels(pending_image, first_mip_level, streaming_data.data(), streaming_data.size(), streaming_regions);
+
+    return true;
+}
+
+bool Texture::is_residency_change_complete() const {
+    return pending_image != VK_NULL_HANDLE && upload_batcher->is_complete(pending_upload_token);
+}
 
-    transition_image_layout(image, texture_image_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+RetiredTextureImage Texture::finish_residency_change() {
+    assert(is_residency_change_complete());
+
+    spdlog::debug("Texture {} changed its resident mip levels from {} to {}.", name, resident_mip_level, pending_mip_level);
+
+    RetiredTextureImage retired_image{device, vma_allocator, image, allocation, image_view};
+
+    image = std::exchange(pending_image, nullptr);
+    allocation = std::exchange(pending_allocation, nullptr);
+    allocation_info = pending_allocation_info;
+    image_view = std::exchange(pending_image_view, nullptr);
+    resident_mip_level = pending_mip_level;
+
+    return retired_image;
+}
+
+void Texture::destroy_retired_image(const RetiredTextureImage &retired_image) {
+    if (retired_image.allocation != nullptr) {
+        AllocationStatisticsStream::on_destroy_image(retired_image.vma_allocator, retired_image.allocation);
+    }
+
+    vkDestroyImageView(retired_image.device, retired_image.image_view, nullptr);
+    vmaDestroyImage(retired_image.vma_allocator, retired_image.image, retired_image.allocation);
+}
+
+void Texture::create_texture(const void *texture_data, const std::size_t texture_size) {
+    mip_levels = 1;
+
+    if (mipmap_generation != MipmapGeneration::NONE && texture_width > 0 && texture_height > 0) {
+        // Every mip level has half the size of the previous one, down to 1x1.
+        mip_levels = static_cast<int>(std::floor(std::log2(std::max(texture_width, texture_height)))) + 1;
+    }
+
+    // A texture with one mip level has nothing to stream.
+    streamed = streamed && mip_levels > 1;
+
+    if (streamed) {
+        resident_mip_level = initial_mip_level = calculate_initial_mip_level();
+    }
+
+    const bool blit_mip_levels = !streamed && mip_levels > 1 && mipmap_generation == MipmapGeneration::AUTOMATIC && supports_linear_blit();
+
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    if (blit_mip_levels) {
+        // Every mip level is the source of the blit into the next one.
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    create_image(usage);
+
+    VkImageSubresourceRange subresource_range = {};
+
+    subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource_range.baseMipLevel = 0;
+    subresource_range.levelCount = mip_levels;
+    subresource_range.baseArrayLayer = 0;
+    subresource_range.layerCount = 1;
 
     VkBufferImageCopy buffer_image_region = {};
 
@@ -117,69 +253,223 @@ void Texture::create_texture(void *texture_data, const std::size_t texture_size)
     buffer_image_region.imageOffset = {0, 0, 0};
     buffer_image_region.imageExtent = {static_cast<uint32_t>(texture_width), static_cast<uint32_t>(texture_height), 1};
 
-    vkCmdCopyBufferToImage(copy_command_buffer.get_command_buffer(), texture_staging_buffer.get_buffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
-                           &buffer_image_region);
-                           
-    spdlog::debug("Transitioning image layout of texture {} to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.", name);
+    spdlog::debug("Recording upload of texture {} with {} mip levels.", name, mip_levels);
+
+    // The copy is submitted together with the other uploads of the batch.
+    if (mip_levels == 1) {
+        upload_token = upload_batcher->upload_image(image, subresource_range, {buffer_image_region}, texture_data, texture_size);
+    } else if (blit_mip_levels) {
+        // All mip levels stay in the transfer layout, so the blits can read and write them.
+        upload_batcher->upload_image(image, subresource_range, {buffer_image_region}, texture_data, texture_size, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        // The blits need a graphics queue, so they run after the acquire if the upload ran on a transfer queue.
+        upload_token = upload_batcher->record_on_destination(
+            [image = image, width = texture_width, height = texture_height, levels = static_cast<std::uint32_t>(mip_levels)](VkCommandBuffer command_buffer) {
+                record_mip_level_blits(command_buffer, image, width, height, levels);
+            });
+    } else {
+        assert(texture_size == 4 * static_cast<std::size_t>(texture_width) * static_cast<std::size_t>(texture_height));
+
+        std::vector<std::uint8_t> mip_data;
+        std::vector<VkBufferImageCopy> regions;
+
+        generate_mip_levels_on_cpu(texture_data, texture_width, texture_height, mip_levels, mip_data, regions);
+
+        upload_token = upload_mip_levels(image, resident_mip_level, mip_data.data(), mip_data.size(), regions);
+
+        // The finer mip levels are uploaded again whenever they are streamed in.
+        if (streamed) {
+            streaming_data = std::move(mip_data);
+            streaming_regions = std::move(regions);
+        }
+    }
+
+    create_texture_image_view();
+
+    create_texture_sampler();
+}
+
+void Texture::create_compressed_texture(const CompressedTextureFile &texture_file) {
+    texture_width = static_cast<int>(texture_file.get_width());
+    texture_height = static_cast<int>(texture_file.get_height());
+    texture_image_format = texture_file.get_format();
+    mip_levels = static_cast<int>(texture_file.get_mip_levels().size());
+
+    // A texture with one mip level has nothing to stream.
+    streamed = streamed && mip_levels > 1;
 
-    copy_command_buffer.end_recording_and_submit_command();
+    if (streamed) {
+        resident_mip_level = initial_mip_level = calculate_initial_mip_level();
+    }
+
+    create_image(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+
+    std::vector<VkBufferImageCopy> regions;
+
+    for (std::size_t mip_level = 0; mip_level < texture_file.get_mip_levels().size(); mip_level++) {
+        const CompressedMipLevel &level = texture_file.get_mip_levels()[mip_level];
+
+        VkBufferImageCopy region = {};
+
+        // The extent is given in texels, the blocks at the right and bottom border may be partially outside of the image.
+        region.bufferOffset = level.offset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = static_cast<std::uint32_t>(mip_level);
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {level.width, level.height, 1};
+
+        regions.push_back(region);
+    }
+
+    spdlog::debug("Recording upload of compressed texture {} with {} mip levels.", name, mip_levels);
+
+    upload_token = upload_mip_levels(image, resident_mip_level, texture_file.get_data().data(), texture_file.get_data().size(), regions);
 
-    transition_image_layout(image, texture_image_format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // The finer mip levels are uploaded again whenever they are streamed in.
+    if (streamed) {
+        streaming_data = texture_file.get_data();
+        streaming_regions = std::move(regions);
+    }
 
     create_texture_image_view();
 
     create_texture_sampler();
 }
 
-void Texture::transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout) {
+bool Texture::supports_linear_blit() const {
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(graphics_card, texture_image_format, &format_properties);
+
+    const VkFormatFeatureFlags required_features =
+        VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    return (format_properties.optimalTilingFeatures & required_features) == required_features;
+}
+
+void Texture::generate_mip_levels_on_cpu(const void *texture_data, const int texture_width, const int texture_height, const int mip_levels,
+                                         std::vector<std::uint8_t> &mip_data, std::vector<VkBufferImageCopy> &regions) {
+    // The texture is always loaded with 4 channels.
+    constexpr std::size_t TEXEL_SIZE = 4;
+
+    std::size_t mip_data_size = 0;
+
+    for (int mip_level = 0; mip_level < mip_levels; mip_level++) {
+        mip_data_size += TEXEL_SIZE * std::max(texture_width >> mip_level, 1) * std::max(texture_height >> mip_level, 1);
+    }
+
+    mip_data.resize(mip_data_size);
+    regions.clear();
+
+    const std::size_t first_level_size = TEXEL_SIZE * texture_width * texture_height;
+    std::memcpy(mip_data.data(), texture_data, first_level_size);
 
+    std::size_t source_offset = 0;
+    std::size_t destination_offset = first_level_size;
+
+    for (int mip_level = 0; mip_level < mip_levels; mip_level++) {
+        const int width = std::max(texture_width >> mip_level, 1);
+        const int height = std::max(texture_height >> mip_level, 1);
+
+        VkBufferImageCopy region = {};
+
+        region.bufferOffset = mip_level == 0 ? 0 : destination_offset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = mip_level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), 1};
+
+        if (mip_level == 0) {
+            regions.push_back(region);
+            continue;
+        }
+
+        const int source_width = std::max(texture_width >> (mip_level - 1), 1);
+        const int source_height = std::max(texture_height >> (mip_level - 1), 1);
+
+        const std::uint8_t *source = mip_data.data() + source_offset;
+        std::uint8_t *destination = mip_data.data() + destination_offset;
+
+        for (int y = 0; y < height; y++) {
+            // Odd sizes repeat the last row or column of the source level.
+            const int y0 = std::min(2 * y, source_height - 1);
+            const int y1 = std::min(2 * y + 1, source_height - 1);
+
+            for (int x = 0; x < width; x++) {
+                const int x0 = std::min(2 * x, source_width - 1);
+                const int x1 = std::min(2 * x + 1, source_width - 1);
+
+                for (std::size_t channel = 0; channel < TEXEL_SIZE; channel++) {
+                    const int sum = source[(y0 * source_width + x0) * TEXEL_SIZE + channel] + source[(y0 * source_width + x1) * TEXEL_SIZE + channel] +
+                                    source[(y1 * source_width + x0) * TEXEL_SIZE + channel] + source[(y1 * source_width + x1) * TEXEL_SIZE + channel];
+
+                    destination[(y * width + x) * TEXEL_SIZE + channel] = static_cast<std::uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+
+        regions.push_back(region);
+
+        source_offset = destination_offset;
+        destination_offset += TEXEL_SIZE * width * height;
+    }
+}
+
+void Texture::record_mip_level_blits(VkCommandBuffer command_buffer, VkImage image, std::int32_t width, std::int32_t height, std::uint32_t mip_levels) {
     VkImageMemoryBarrier barrier = {};
 
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = old_layout;
-    barrier.newLayout = new_layout;
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
     barrier.subresourceRange.levelCount = 1;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
-    VkPipelineStageFlags source_stage = 0;
-    VkPipelineStageFlags destination_stage = 0;
+    for (std::uint32_t mip_level = 1; mip_level < mip_levels; mip_level++) {
+        // The previous level has been written by the copy or by the last blit.
+        barrier.subresourceRange.baseMipLevel = mip_level - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-    if (VK_IMAGE_LAYOUT_UNDEFINED == old_layout && VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL == new_layout) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-        source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL == old_layout && VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL == new_layout) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        const std::int32_t source_width = std::max(width >> (mip_level - 1), 1);
+        const std::int32_t source_height = std::max(height >> (mip_level - 1), 1);
 
-        source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        throw std::runtime_error("Error: unsupported layout transition!");
-    }
+        VkImageBlit blit = {};
 
-    spdlog::debug("Recording pipeline barrier for image layer transition");
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip_level - 1, 0, 1};
+        blit.srcOffsets[1] = {source_width, source_height, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip_level, 0, 1};
+        blit.dstOffsets[1] = {std::max(width >> mip_level, 1), std::max(height >> mip_level, 1), 1};
 
-    OnceCommandBuffer command_buffer_for_image_transition(device, data_transfer_queue, data_transfer_queue_family_index);
+        vkCmdBlitImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
 
-    command_buffer_for_image_transition.create_command_buffer();
+        // The previous level is finished once the blit has read it.
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    command_buffer_for_image_transition.start_recording();
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
 
-    vkCmdPipelineBarrier(command_buffer_for_image_transition.get_command_buffer(), source_stage, destination_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    // The last level is only written.
+    barrier.subresourceRange.baseMipLevel = mip_levels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    command_buffer_for_image_transition.end_recording_and_submit_command();
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
-void Texture::create_texture_image_view() {
+VkResult Texture::create_image_view(const VkImage image, const std::uint32_t first_mip_level, VkImageView &image_view) const {
     VkImageViewCreateInfo image_view_create_info = {};
 
     image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -190,13 +480,17 @@ void Texture::create_texture_image_view() {
 
     image_view_create_info.components = {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A};
     image_view_create_info.subresourceRange.baseMipLevel = 0;
-    image_view_create_info.subresourceRange.levelCount = mip_levels;
+    image_view_create_info.subresourceRange.levelCount = mip_levels - first_mip_level;
     image_view_create_info.subresourceRange.baseArrayLayer = 0;
     image_view_create_info.subresourceRange.layerCount = 1;
 
     spdlog::debug("Creating image view for texture {}.", name);
 
-    if (vkCreateImageView(device, &image_view_create_info, nullptr, &image_view) != VK_SUCCESS) {
+    return vkCreateImageView(device, &image_view_create_info, nullptr, &image_view);
+}
+
+void Texture::create_texture_image_view() {
+    if (create_image_view(image, resident_mip_level, image_view) != VK_SUCCESS) {
         throw std::runtime_error("Error: vkCreateImageView failed for texture " + name + " !");
     }
 
@@ -205,25 +499,17 @@ void Texture::create_texture_image_view() {
     spdlog::debug("Image view created successfully.");
 }
 
-void Texture::create_texture_sampler() {
+VkSamplerCreateInfo Texture::make_sampler_create_info(const VkPhysicalDeviceFeatures &device_features,
+                                                     const VkPhysicalDeviceProperties &graphics_card_properties,
+                                                     const VkSamplerAddressMode address_mode) {
     VkSamplerCreateInfo sampler_create_info = {};
 
     sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     sampler_create_info.magFilter = VK_FILTER_LINEAR;
     sampler_create_info.minFilter = VK_FILTER_LINEAR;
-    sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-
-    // These two fields specify if anisotropic filtering should be used.
-    // There is no reason not to use this unless performance is a concern.
-    // The maxAnisotropy field limits the amount of texel samples that can
-    // be used to calculate the final color. A lower value results in better
-    // performance, but lower quality results. There is no graphics hardware
-    // available today that will use more than 16 samples, because the difference
-    // is negligible beyond that point.
-    sampler_create_info.anisotropyEnable = VK_TRUE;
-    sampler_create_info.maxAnisotropy = 16;
+    sampler_create_info.addressModeU = address_mode;
+    sampler_create_info.addressModeV = address_mode;
+    sampler_create_info.addressModeW = address_mode;
 
     // The borderColor field specifies which color is returned when sampling beyond
     // the image with clamp to border addressing mode. It is possible to return black,
@@ -243,14 +529,15 @@ void Texture::create_texture_sampler() {
     sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     sampler_create_info.mipLodBias = 0.0f;
     sampler_create_info.minLod = 0.0f;
-    sampler_create_info.maxLod = 0.0f;
 
-    VkPhysicalDeviceFeatures device_features;
-    vkGetPhysicalDeviceFeatures(graphics_card, &device_features);
-
-    VkPhysicalDeviceProperties graphics_card_properties;
-    vkGetPhysicalDeviceProperties(graphics_card, &graphics_card_properties);
+    // The image view limits the mip levels, so the sampler doesn't depend on the number of mip levels and can be shared by all textures.
+    sampler_create_info.maxLod = VK_LOD_CLAMP_NONE;
 
+    // These two fields specify if anisotropic filtering should be used.
+    // There is no reason not to use this unless performance is a concern.
+    // The maxAnisotropy field limits the amount of texel samples that can
+    // be used to calculate the final color. A lower value results in better
+    // performance, but lower quality results.
     if (VK_TRUE == device_features.samplerAnisotropy) {
         // Anisotropic filtering is available.
         sampler_create_info.maxAnisotropy = graphics_card_properties.limits.maxSamplerAnisotropy;
@@ -261,21 +548,39 @@ void Texture::create_texture_sampler() {
         sampler_create_info.anisotropyEnable = VK_FALSE;
     }
 
-    spdlog::debug("Creating image sampler for texture {}.", name);
+    return sampler_create_info;
+}
 
-    if (vkCreateSampler(device, &sampler_create_info, nullptr, &sampler) != VK_SUCCESS) {
-        throw std::runtime_error("Error: vkCreateSampler failed for texture " + name + " !");
-    }
+void Texture::create_texture_sampler() {
+    VkPhysicalDeviceFeatures device_features;
+    vkGetPhysicalDeviceFeatures(graphics_card, &device_features);
 
-    // TODO: Vulkan debug markers!
+    VkPhysicalDeviceProperties graphics_card_properties;
+    vkGetPhysicalDeviceProperties(graphics_card, &graphics_card_properties);
+
+    spdlog::debug("Acquiring image sampler for texture {}.", name);
+
+    const VkSamplerCreateInfo sampler_create_info = make_sampler_create_info(device_features, graphics_card_properties, VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
-    spdlog::debug("Image sampler created successfully.");
+    sampler = sampler_cache->acquire(sampler_create_info);
 }
 
 Texture::~Texture() {
-    vkDestroySampler(device, sampler, nullptr);
+    if (sampler != VK_NULL_HANDLE) {
+        sampler_cache->release(sampler);
+    }
+
+    if (allocation != nullptr) {
+        AllocationStatisticsStream::on_destroy_image(vma_allocator, allocation);
+    }
+
     vmaDestroyImage(vma_allocator, image, allocation);
     vkDestroyImageView(device, image_view, nullptr);
+
+    // A pending residency change is only destroyed at shutdown, when the device is idle.
+    if (pending_image != VK_NULL_HANDLE) {
+        destroy_retired_image({device, vma_allocator, pending_image, pending_allocation, pending_image_view});
+    }
 }
 
 } // namespace inexor::vulkan_renderer
@@ -0,0 +1,42 @@
+#include "inexor/vulkan-renderer/texture_file.hpp"
+
+#include <spdlog/spdlog.h>
+
+// stb single-file public domain libraries for C/C++
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cassert>
+#include <stdexcept>
+
+namespace inexor::vulkan_renderer {
+
+void TextureFile::PixelDeleter::operator()(std::uint8_t *pixels) const {
+    stbi_image_free(pixels);
+}
+
+TextureFile::TextureFile(const std::string &file_name) : file_name(file_name) {
+    assert(!file_name.empty());
+
+    spdlog::debug("Loading texture file {}.", file_name);
+
+    if (CompressedTextureFile::is_compressed_texture_file(file_name)) {
+        compressed_file.emplace(file_name);
+
+        width = static_cast<int>(compressed_file->get_width());
+        height = static_cast<int>(compressed_file->get_height());
+        return;
+    }
+
+    // Load the texture file using stb_image library.
+    // Force stb_image to load an alpha channel as well.
+    pixels.reset(stbi_load(file_name.c_str(), &width, &height, &channels, STBI_rgb_alpha));
+
+    if (!pixels) {
+        throw std::runtime_error("Error: Could not load texture file " + file_name + " using stbi_load!");
+    }
+
+    spdlog::debug("Texture dimensions: width: {}, height: {}, channels: {}.", width, height, channels);
+}
+
+} // namespace inexor::vulkan_renderer
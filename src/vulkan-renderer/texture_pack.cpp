@@ -0,0 +1,425 @@
+#include "inexor/vulkan-renderer/texture_pack.hpp"
+
+#include "inexor/vulkan-renderer/allocation_statistics_stream.hpp"
+#include "inexor/vulkan-renderer/compressed_texture_file.hpp"
+#include "inexor/vulkan-renderer/texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace inexor::vulkan_renderer {
+
+namespace {
+
+/// The decoded texture files always have 4 channels.
+constexpr std::size_t TEXEL_SIZE = 4;
+
+std::uint32_t calculate_mip_levels(const std::uint32_t width, const std::uint32_t height) {
+    // Every mip level has half the size of the previous one, down to 1x1.
+    return static_cast<std::uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+} // namespace
+
+TexturePack::TexturePack(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, const TexturePackLayout &layout,
+                         const std::vector<const TextureFile *> &texture_files, const std::uint32_t atlas_padding, const std::string &name,
+                         UploadBatcher &upload_batcher, SamplerCache &sampler_cache)
+    : name(name), device(device), sampler_cache(&sampler_cache), vma_allocator(vma_allocator), layout(layout) {
+    assert(device);
+    assert(graphics_card);
+    assert(vma_allocator);
+    assert(!name.empty());
+    assert(layout.layer_count > 0);
+    assert(!layout.placements.empty());
+
+    if (layout.format != VK_FORMAT_R8G8B8A8_UNORM && !CompressedTextureFile::is_format_supported(graphics_card, layout.format)) {
+        throw std::runtime_error("Error: The graphics card does not support the format of texture pack " + name + "!");
+    }
+
+    create_image();
+
+    std::vector<std::uint8_t> data;
+    std::vector<VkBufferImageCopy> regions;
+
+    if (layout.atlas) {
+        fill_atlas_pages(texture_files, atlas_padding, data, regions);
+    } else {
+        fill_array_layers(texture_files, data, regions);
+    }
+
+    VkImageSubresourceRange subresource_range = {};
+
+    subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource_range.baseMipLevel = 0;
+    subresource_range.levelCount = layout.mip_levels;
+    subresource_range.baseArrayLayer = 0;
+    subresource_range.layerCount = layout.layer_count;
+
+    spdlog::debug("Recording upload of texture pack {} with {} textures in {} layers.", name, layout.placements.size(), layout.layer_count);
+
+    upload_token = upload_batcher.upload_image(image, subresource_range, regions, data.data(), data.size());
+
+    create_image_view();
+
+    create_sampler(graphics_card);
+}
+
+TexturePack::TexturePack(TexturePack &&other) noexcept
+    : name(std::move(other.name)), device(other.device), sampler_cache(other.sampler_cache), vma_allocator(other.vma_allocator),
+      allocation(std::exchange(other.allocation, nullptr)), allocation_info(other.allocation_info), image(std::exchange(other.image, nullptr)),
+      image_view(std::exchange(other.image_view, nullptr)), sampler(std::exchange(other.sampler, nullptr)), layout(std::move(other.layout)),
+      upload_token(other.upload_token) {}
+
+void TexturePack::fill_atlas_pages(const std::vector<const TextureFile *> &texture_files, const std::uint32_t padding, std::vector<std::uint8_t> &data,
+                                   std::vector<VkBufferImageCopy> &regions) const {
+    const std::size_t page_size = TEXEL_SIZE * layout.width * layout.height;
+
+    data.assign(page_size * layout.layer_count, 0);
+
+    for (const auto &placement : layout.placements) {
+        assert(placement.texture_index < texture_files.size());
+
+        const TextureFile &texture_file = *texture_files[placement.texture_index];
+        const std::uint8_t *pixels = texture_file.get_pixels();
+        assert(pixels);
+
+        const int width = texture_file.get_width();
+        const int height = texture_file.get_height();
+        const int border = static_cast<int>(padding);
+
+        std::uint8_t *page = data.data() + page_size * placement.layer;
+
+        // The padding repeats the border texels of the texture.
+        for (int y = -border; y < height + border; y++) {
+            const int source_y = std::clamp(y, 0, height - 1);
+            const std::size_t destination_y = static_cast<std::size_t>(static_cast<int>(placement.y) + y);
+
+            for (int x = -border; x < width + border; x++) {
+                const int source_x = std::clamp(x, 0, width - 1);
+                const std::size_t destination_x = static_cast<std::size_t>(static_cast<int>(placement.x) + x);
+
+                std::memcpy(page + (destination_y * layout.width + destination_x) * TEXEL_SIZE,
+                            pixels + (static_cast<std::size_t>(source_y) * width + source_x) * TEXEL_SIZE, TEXEL_SIZE);
+            }
+        }
+    }
+
+    regions.clear();
+
+    for (std::uint32_t layer = 0; layer < layout.layer_count; layer++) {
+        VkBufferImageCopy region = {};
+
+        region.bufferOffset = page_size * layer;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = layer;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {layout.width, layout.height, 1};
+
+        regions.push_back(region);
+    }
+}
+
+void TexturePack::fill_array_layers(const std::vector<const TextureFile *> &texture_files, std::vector<std::uint8_t> &data,
+                                    std::vector<VkBufferImageCopy> &regions) const {
+    data.clear();
+    regions.clear();
+
+    for (const auto &placement : layout.placements) {
+        assert(placement.texture_index < texture_files.size());
+
+        const TextureFile &texture_file = *texture_files[placement.texture_index];
+
+        // The layers follow each other. The levels of compressed textures are multiples of their block size, so every layer stays aligned.
+        const VkDeviceSize layer_offset = data.size();
+
+        if (texture_file.get_compressed_file()) {
+            const CompressedTextureFile &compressed_file = *texture_file.get_compressed_file();
+
+            data.insert(data.end(), compressed_file.get_data().begin(), compressed_file.get_data().end());
+
+            for (std::size_t mip_level = 0; mip_level < compressed_file.get_mip_levels().size(); mip_level++) {
+                const CompressedMipLevel &level = compressed_file.get_mip_levels()[mip_level];
+
+                VkBufferImageCopy region = {};
+
+                region.bufferOffset = layer_offset + level.offset;
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel = static_cast<std::uint32_t>(mip_level);
+                region.imageSubresource.baseArrayLayer = placement.layer;
+                region.imageSubresource.layerCount = 1;
+                region.imageExtent = {level.width, level.height, 1};
+
+                regions.push_back(region);
+            }
+
+            continue;
+        }
+
+        std::vector<std::uint8_t> mip_data;
+        std::vector<VkBufferImageCopy> mip_regions;
+
+        Texture::generate_mip_levels_on_cpu(texture_file.get_pixels(), texture_file.get_width(), texture_file.get_height(),
+                                            static_cast<int>(layout.mip_levels), mip_data, mip_regions);
+
+        data.insert(data.end(), mip_data.begin(), mip_data.end());
+
+        for (auto region : mip_regions) {
+            region.bufferOffset += layer_offset;
+            region.imageSubresource.baseArrayLayer = placement.layer;
+
+            regions.push_back(region);
+        }
+    }
+}
+
+void TexturePack::create_image() {
+    VkImageCreateInfo image_create_info = {};
+
+    image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_create_info.imageType = VK_IMAGE_TYPE_2D;
+    image_create_info.extent.width = layout.width;
+    image_create_info.extent.height = layout.height;
+    image_create_info.extent.depth = 1;
+    image_create_info.mipLevels = layout.mip_levels;
+    image_create_info.arrayLayers = layout.layer_count;
+    image_create_info.format = layout.format;
+    image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_create_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocation_create_info = {};
+    allocation_create_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+#if VMA_RECORDING_ENABLED
+    allocation_create_info.flags = VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT;
+    allocation_create_info.pUserData = this->name.data();
+#endif
+
+    spdlog::debug("Creating image for texture pack {}.", name);
+
+    if (vmaCreateImage(vma_allocator, &image_create_info, &allocation_create_info, &image, &allocation, &allocation_info) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vmaCreateImage failed for texture pack " + name + " !");
+    }
+
+    AllocationStatisticsStream::on_create_image(vma_allocator, image_create_info, allocation_create_info, allocation);
+}
+
+void TexturePack::create_image_view() {
+    VkImageViewCreateInfo image_view_create_info = {};
+
+    image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    image_view_create_info.image = image;
+    image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    image_view_create_info.format = layout.format;
+    image_view_create_info.components = {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A};
+    image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_view_create_info.subresourceRange.baseMipLevel = 0;
+    image_view_create_info.subresourceRange.levelCount = layout.mip_levels;
+    image_view_create_info.subresourceRange.baseArrayLayer = 0;
+    image_view_create_info.subresourceRange.layerCount = layout.layer_count;
+
+    if (vkCreateImageView(device, &image_view_create_info, nullptr, &image_view) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkCreateImageView failed for texture pack " + name + " !");
+    }
+}
+
+void TexturePack::create_sampler(const VkPhysicalDevice graphics_card) {
+    // The textures in atlas pages are wrapped by the shader, the repeat address mode would sample the opposite border of the page.
+    const VkSamplerAddressMode address_mode = layout.atlas ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+    VkPhysicalDeviceFeatures device_features;
+    vkGetPhysicalDeviceFeatures(graphics_card, &device_features);
+
+    VkPhysicalDeviceProperties graphics_card_properties;
+    vkGetPhysicalDeviceProperties(graphics_card, &graphics_card_properties);
+
+    sampler = sampler_cache->acquire(Texture::make_sampler_create_info(device_features, graphics_card_properties, address_mode));
+}
+
+TexturePack::~TexturePack() {
+    if (sampler != VK_NULL_HANDLE) {
+        sampler_cache->release(sampler);
+    }
+
+    vkDestroyImageView(device, image_view, nullptr);
+
+    if (allocation != nullptr) {
+        AllocationStatisticsStream::on_destroy_image(vma_allocator, allocation);
+    }
+
+    vmaDestroyImage(vma_allocator, image, allocation);
+}
+
+TexturePacker::TexturePacker(const TexturePackerSettings &settings) : settings(settings) {
+    assert(settings.min_array_layers > 0);
+    assert(settings.max_layers > 0);
+    assert(settings.max_atlas_texture_size + 2 * settings.atlas_padding <= settings.atlas_size);
+}
+
+std::size_t TexturePacker::add_texture(const TextureFile &texture_file) {
+    assert(texture_file.get_width() > 0);
+    assert(texture_file.get_height() > 0);
+
+    texture_files.push_back(&texture_file);
+
+    return texture_files.size() - 1;
+}
+
+void TexturePacker::add_layout(TexturePackLayout layout) {
+    const auto pack_index = static_cast<std::uint32_t>(layouts.size());
+
+    for (const auto &placement : layout.placements) {
+        TexturePackEntry entry;
+
+        entry.pack_index = pack_index;
+        entry.push_constants.layer = placement.layer;
+
+        if (layout.atlas) {
+            const TextureFile &texture_file = *texture_files[placement.texture_index];
+
+            entry.push_constants.uv_offset = glm::vec2(placement.x, placement.y) / glm::vec2(layout.width, layout.height);
+            entry.push_constants.uv_scale = glm::vec2(texture_file.get_width(), texture_file.get_height()) / glm::vec2(layout.width, layout.height);
+        }
+
+        entries[placement.texture_index] = entry;
+    }
+
+    layouts.push_back(std::move(layout));
+}
+
+void TexturePacker::pack_atlas_pages(std::vector<std::size_t> texture_indices) {
+    if (texture_indices.empty()) {
+        return;
+    }
+
+    // The textures on a shelf have similar heights if the tallest ones are packed first.
+    std::stable_sort(texture_indices.begin(), texture_indices.end(),
+                     [&](const std::size_t lhs, const std::size_t rhs) { return texture_files[lhs]->get_height() > texture_files[rhs]->get_height(); });
+
+    TexturePackLayout layout;
+
+    layout.format = VK_FORMAT_R8G8B8A8_UNORM;
+    layout.width = settings.atlas_size;
+    layout.height = settings.atlas_size;
+    layout.atlas = true;
+
+    std::uint32_t layer = 0;
+    std::uint32_t shelf_x = 0;
+    std::uint32_t shelf_y = 0;
+    std::uint32_t shelf_height = 0;
+
+    for (const auto texture_index : texture_indices) {
+        const std::uint32_t width = static_cast<std::uint32_t>(texture_files[texture_index]->get_width()) + 2 * settings.atlas_padding;
+        const std::uint32_t height = static_cast<std::uint32_t>(texture_files[texture_index]->get_height()) + 2 * settings.atlas_padding;
+
+        // The texture starts a new shelf if it doesn't fit onto the current one, and a new page if the new shelf doesn't fit.
+        if (shelf_x + width > settings.atlas_size) {
+            shelf_x = 0;
+            shelf_y += shelf_height;
+            shelf_height = 0;
+        }
+
+        if (shelf_y + height > settings.atlas_size) {
+            layer++;
+            shelf_x = 0;
+            shelf_y = 0;
+            shelf_height = 0;
+        }
+
+        if (layer == settings.max_layers) {
+            layout.layer_count = layer;
+            add_layout(layout);
+
+            layout.placements.clear();
+            layer = 0;
+        }
+
+        layout.placements.push_back({texture_index, layer, shelf_x + settings.atlas_padding, shelf_y + settings.atlas_padding});
+
+        shelf_x += width;
+        shelf_height = std::max(shelf_height, height);
+    }
+
+    layout.layer_count = layer + 1;
+    add_layout(std::move(layout));
+}
+
+void TexturePacker::pack() {
+    layouts.clear();
+    entries.assign(texture_files.size(), std::nullopt);
+
+    // Textures with the same format, size and number of mip levels can be layers of the same array.
+    std::map<std::tuple<VkFormat, std::uint32_t, std::uint32_t, std::uint32_t>, std::vector<std::size_t>> groups;
+
+    for (std::size_t texture_index = 0; texture_index < texture_files.size(); texture_index++) {
+        const TextureFile &texture_file = *texture_files[texture_index];
+
+        const auto width = static_cast<std::uint32_t>(texture_file.get_width());
+        const auto height = static_cast<std::uint32_t>(texture_file.get_height());
+
+        if (texture_file.get_compressed_file()) {
+            const CompressedTextureFile &compressed_file = *texture_file.get_compressed_file();
+            const auto mip_levels = static_cast<std::uint32_t>(compressed_file.get_mip_levels().size());
+
+            groups[{compressed_file.get_format(), width, height, mip_levels}].push_back(texture_index);
+        } else {
+            groups[{VK_FORMAT_R8G8B8A8_UNORM, width, height, calculate_mip_levels(width, height)}].push_back(texture_index);
+        }
+    }
+
+    std::vector<std::size_t> atlas_textures;
+
+    for (const auto &group : groups) {
+        const auto &[format, width, height, mip_levels] = group.first;
+        const std::vector<std::size_t> &texture_indices = group.second;
+
+        if (texture_indices.size() >= settings.min_array_layers) {
+            for (std::size_t first = 0; first < texture_indices.size(); first += settings.max_layers) {
+                TexturePackLayout layout;
+
+                layout.format = format;
+                layout.width = width;
+                layout.height = height;
+                layout.mip_levels = mip_levels;
+                layout.layer_count = static_cast<std::uint32_t>(std::min<std::size_t>(settings.max_layers, texture_indices.size() - first));
+
+                for (std::uint32_t layer = 0; layer < layout.layer_count; layer++) {
+                    layout.placements.push_back({texture_indices[first + layer], layer, 0, 0});
+                }
+
+                add_layout(std::move(layout));
+            }
+        } else if (format == VK_FORMAT_R8G8B8A8_UNORM && width <= settings.max_atlas_texture_size && height <= settings.max_atlas_texture_size) {
+            atlas_textures.insert(atlas_textures.end(), texture_indices.begin(), texture_indices.end());
+        }
+    }
+
+    pack_atlas_pages(std::move(atlas_textures));
+
+    const auto packed_textures = std::count_if(entries.begin(), entries.end(), [](const auto &entry) { return entry.has_value(); });
+
+    spdlog::debug("Packed {} of {} textures into {} texture packs.", packed_textures, texture_files.size(), layouts.size());
+}
+
+std::vector<TexturePack> TexturePacker::create_packs(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator,
+                                                     const std::string &name, UploadBatcher &upload_batcher, SamplerCache &sampler_cache) const {
+    std::vector<TexturePack> packs;
+    packs.reserve(layouts.size());
+
+    for (std::size_t pack_index = 0; pack_index < layouts.size(); pack_index++) {
+        packs.emplace_back(device, graphics_card, vma_allocator, layouts[pack_index], texture_files, settings.atlas_padding,
+                           name + " " + std::to_string(pack_index), upload_batcher, sampler_cache);
+    }
+
+    return packs;
+}
+
+} // namespace inexor::vulkan_renderer
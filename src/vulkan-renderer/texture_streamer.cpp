@@ -0,0 +1,211 @@
+#include "inexor/vulkan-renderer/texture_streamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace inexor::vulkan_renderer {
+
+TextureStreamer::TextureStreamer(const TextureStreamerSettings &settings) : settings(settings) {
+    assert(settings.frames_in_flight > 0);
+    assert(settings.max_pending_changes > 0);
+}
+
+TextureStreamer::~TextureStreamer() {
+    for (const auto &retired_image : retired_images) {
+        Texture::destroy_retired_image(retired_image.image);
+    }
+}
+
+void TextureStreamer::use_frame_timeline(VulkanFrameTimeline &frame_timeline, VkQueue frame_queue) {
+    assert(frame_timeline.is_initialised());
+    assert(frame_queue);
+
+    this->frame_timeline = &frame_timeline;
+    this->frame_queue = frame_queue;
+}
+
+void TextureStreamer::add_texture(Texture &texture) {
+    assert(texture.is_streamed());
+
+    StreamedTexture streamed_texture;
+
+    streamed_texture.texture = &texture;
+    streamed_texture.selected_mip_level = texture.get_initial_mip_level();
+
+    textures.push_back(streamed_texture);
+}
+
+void TextureStreamer::set_screen_size(const Texture &texture, const float screen_size) {
+    auto streamed_texture = std::find_if(textures.begin(), textures.end(), [&](const StreamedTexture &entry) { return entry.texture == &texture; });
+    assert(streamed_texture != textures.end());
+
+    streamed_texture->screen_size = std::max(screen_size, 0.0f);
+}
+
+std::uint32_t TextureStreamer::calculate_mip_level(const StreamedTexture &texture) {
+    const std::uint32_t initial_mip_level = texture.texture->get_initial_mip_level();
+
+    if (texture.screen_size <= 0.0f) {
+        return initial_mip_level;
+    }
+
+    // Every mip level has half the size of the previous one, so the level whose size matches the screen size is found with log2.
+    const float texture_size = static_cast<float>(std::max(texture.texture->get_width(), texture.texture->get_height()));
+    const float mip_level = std::floor(std::log2(texture_size / texture.screen_size));
+
+    return static_cast<std::uint32_t>(std::clamp(mip_level, 0.0f, static_cast<float>(initial_mip_level)));
+}
+
+void TextureStreamer::select_mip_levels(const VkDeviceSize budget) {
+    // The textures which are largest on the screen get their mip levels first.
+    std::stable_sort(textures.begin(), textures.end(), [](const StreamedTexture &lhs, const StreamedTexture &rhs) { return lhs.screen_size > rhs.screen_size; });
+
+    // The initial mip levels are always resident.
+    VkDeviceSize size = 0;
+
+    for (auto &texture : textures) {
+        texture.selected_mip_level = texture.texture->get_initial_mip_level();
+        size += texture.texture->get_mip_levels_size(texture.selected_mip_level);
+    }
+
+    for (auto &texture : textures) {
+        const VkDeviceSize initial_size = texture.texture->get_mip_levels_size(texture.selected_mip_level);
+
+        // If the mip level doesn't fit into the budget, the next coarser one is tried.
+        for (std::uint32_t mip_level = calculate_mip_level(texture); mip_level < texture.selected_mip_level; mip_level++) {
+            const VkDeviceSize mip_levels_size = texture.texture->get_mip_levels_size(mip_level);
+
+            if (size - initial_size + mip_levels_size <= budget) {
+                size += mip_levels_size - initial_size;
+                texture.selected_mip_level = mip_level;
+                break;
+            }
+        }
+    }
+}
+
+void TextureStreamer::begin_residency_changes() {
+    std::uint32_t pending_changes = 0;
+
+    for (const auto &texture : textures) {
+        if (texture.texture->is_residency_change_pending()) {
+            pending_changes++;
+        }
+    }
+
+    // Drops free memory, so they are started before the loads. The loads of the textures which are largest on the screen come first.
+    for (const bool drops : {true, false}) {
+        for (const auto &texture : textures) {
+            if (pending_changes >= settings.max_pending_changes) {
+                return;
+            }
+
+            const std::uint32_t resident_mip_level = texture.texture->get_resident_mip_level();
+
+            if (texture.texture->is_residency_change_pending() || texture.selected_mip_level == resident_mip_level ||
+                drops != (texture.selected_mip_level > resident_mip_level)) {
+                continue;
+            }
+
+            if (!texture.texture->begin_residency_change(texture.selected_mip_level)) {
+                statistics.failed_changes++;
+                continue;
+            }
+
+            pending_changes++;
+
+            if (drops) {
+                statistics.drops++;
+            } else {
+                statistics.loads++;
+            }
+        }
+    }
+}
+
+void TextureStreamer::update() {
+    frame_index++;
+
+    // The frames which were recorded before an image was replaced might still use it.
+    while (!retired_images.empty() && frame_index > retired_images.front().frame_index + settings.frames_in_flight) {
+        Texture::destroy_retired_image(retired_images.front().image);
+        retired_images.pop_front();
+    }
+
+    bool residency_changed = false;
+
+    for (auto &texture : textures) {
+        if (!texture.texture->is_residency_change_complete()) {
+            continue;
+        }
+
+        const RetiredTextureImage retired_image = texture.texture->finish_residency_change();
+
+        // The frames which are submitted from now on use the new image, see the residency callback.
+        if (frame_timeline != nullptr) {
+            frame_timeline->defer_until(frame_queue, frame_timeline->get_last_submitted_value(frame_queue),
+                                        [retired_image]() { Texture::destroy_retired_image(retired_image); });
+        } else {
+            retired_images.push_back({retired_image, frame_index});
+        }
+
+        residency_changed = true;
+    }
+
+    if (residency_changed && residency_callback) {
+        residency_callback();
+    }
+
+    const VkDeviceSize budget = frame_index < eviction_end_frame_index ? std::min(settings.budget, eviction_budget) : settings.budget;
+
+    select_mip_levels(budget);
+    begin_residency_changes();
+}
+
+VkDeviceSize TextureStreamer::evict(const VkDeviceSize bytes_to_free) {
+    const VkDeviceSize resident_size = get_resident_size();
+
+    VkDeviceSize initial_size = 0;
+
+    for (const auto &texture : textures) {
+        initial_size += texture.texture->get_mip_levels_size(texture.texture->get_initial_mip_level());
+    }
+
+    // The mip levels of an earlier eviction might not be dropped yet, so the bytes to free come on top of its lowered budget.
+    const VkDeviceSize current_budget = frame_index < eviction_end_frame_index ? std::min(eviction_budget, resident_size) : resident_size;
+
+    if (current_budget <= initial_size) {
+        return 0;
+    }
+
+    const VkDeviceSize evicted_bytes = std::min(bytes_to_free, current_budget - initial_size);
+
+    // The mip levels are dropped by the next update, and their memory is freed once the frames which use them have finished.
+    eviction_budget = current_budget - evicted_bytes;
+    eviction_end_frame_index = frame_index + settings.eviction_cooldown;
+
+    statistics.evictions++;
+    statistics.evicted_bytes += evicted_bytes;
+
+    spdlog::debug("Texture streamer evicts {} bytes, the budget is lowered to {} bytes for {} frames.", evicted_bytes, eviction_budget,
+                  settings.eviction_cooldown);
+
+    return evicted_bytes;
+}
+
+VkDeviceSize TextureStreamer::get_resident_size() const {
+    VkDeviceSize resident_size = 0;
+
+    for (const auto &texture : textures) {
+        resident_size += texture.texture->get_mip_levels_size(texture.texture->get_resident_mip_level());
+    }
+
+    return resident_size;
+}
+
+void TextureStreamer::log_statistics() const {
+    spdlog::debug("Texture streamer: {} loads, {} drops, {} failed residency changes, {} evictions of {} bytes, {} bytes resident.", statistics.loads,
+                  statistics.drops, statistics.failed_changes, statistics.evictions, statistics.evicted_bytes, get_resident_size());
+}
+
+} // namespace inexor::vulkan_renderer
@@ -1,40 +1,122 @@
 #include "inexor/vulkan-renderer/thread_pool.hpp"
 
+#include "inexor/vulkan-renderer/tools/cpu_topology.hpp"
+
+#include <algorithm>
+#include <cassert>
+
 namespace inexor {
 
-ThreadPool::ThreadPool(std::size_t thread_count) {
-    // Try to estimate the number of CPU cores available on the system.
-    std::size_t number_of_cpu_cores = std::thread::hardware_concurrency();
+namespace {
+
+/// @brief Returns the default settings with the given number of threads.
+ThreadPoolSettings make_thread_pool_settings(const std::size_t thread_count) {
+    ThreadPoolSettings settings;
+    settings.thread_count = thread_count;
+    return settings;
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t thread_count) : ThreadPool(make_thread_pool_settings(thread_count)) {}
+
+ThreadPool::ThreadPool(const ThreadPoolSettings &settings)
+    : pin_threads(settings.pin_threads), auto_scaling(settings.auto_scaling), min_active_thread_count(std::max<std::size_t>(settings.min_active_thread_count, 1)) {
+    // The logical cores the process is allowed to run on.
+    auto cpu_cores = vulkan_renderer::tools::get_cpu_topology();
 
     // Yes, this might be the case because std::thread::hardware_concurrency() is only a hint!
-    if (number_of_cpu_cores == 0) {
+    if (cpu_cores.empty()) {
         spdlog::warn("Number of CPU cores could not be determined!");
 
-        // Let's just use the standard number of threads then.
-        number_of_cpu_cores = THREADPOOL_BACKUP_CPU_CORE_COUNT;
+        // Let's just use the standard number of threads then, without any placement.
+        const std::size_t thread_count = settings.thread_count > 0 ? settings.thread_count : THREADPOOL_BACKUP_CPU_CORE_COUNT;
+
+        spdlog::warn("Using {} threads!", thread_count);
+
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            start_thread();
+        }
+        return;
+    }
+
+    const auto is_core_allowed = [&](const vulkan_renderer::tools::CpuCore &core) {
+        return std::find(settings.cpu_affinity.begin(), settings.cpu_affinity.end(), core.logical_id) != settings.cpu_affinity.end();
+    };
+
+    if (!settings.cpu_affinity.empty()) {
+        if (std::any_of(cpu_cores.begin(), cpu_cores.end(), is_core_allowed)) {
+            cpu_cores.erase(std::remove_if(cpu_cores.begin(), cpu_cores.end(), [&](const auto &core) { return !is_core_allowed(core); }), cpu_cores.end());
+        } else {
+            spdlog::warn("None of the CPU cores in the threadpool affinity list is available, ignoring it!");
+        }
+    }
+
+    auto placement_order = vulkan_renderer::tools::get_cpu_placement_order(cpu_cores, settings.avoid_smt_siblings);
+
+    const auto get_physical_id = [&](std::size_t logical_id) {
+        return std::find_if(cpu_cores.begin(), cpu_cores.end(), [&](const auto &core) { return core.logical_id == logical_id; })->physical_id;
+    };
+
+    // The physical cores in placement order.
+    std::vector<std::size_t> physical_cores;
+
+    for (const auto logical_id : placement_order) {
+        const auto physical_id = get_physical_id(logical_id);
+
+        if (std::find(physical_cores.begin(), physical_cores.end(), physical_id) == physical_cores.end()) {
+            physical_cores.push_back(physical_id);
+        }
+    }
+
+    spdlog::debug("Number of CPU cores: {} logical, {} physical", cpu_cores.size(), physical_cores.size());
+
+    std::size_t reserved_core_count = settings.reserved_core_count;
 
-        spdlog::warn("Using {} threads!", number_of_cpu_cores);
-    } else {
-        spdlog::debug("Number of CPU cores: {}", number_of_cpu_cores);
+    if (reserved_core_count >= physical_cores.size()) {
+        spdlog::warn("Can't reserve {} of {} CPU cores for other threads!", reserved_core_count, physical_cores.size());
+        reserved_core_count = physical_cores.size() - 1;
     }
 
-    spdlog::debug("Constructing threads.");
+    // Reserve the first physical cores in placement order, including their SMT siblings.
+    if (reserved_core_count > 0) {
+        const std::vector<std::size_t> reserved_cores(physical_cores.begin(), physical_cores.begin() + reserved_core_count);
+
+        placement_order.erase(std::remove_if(placement_order.begin(), placement_order.end(),
+                                             [&](std::size_t logical_id) {
+                                                 return std::find(reserved_cores.begin(), reserved_cores.end(), get_physical_id(logical_id)) !=
+                                                        reserved_cores.end();
+                                             }),
+                              placement_order.end());
+
+        physical_cores.erase(physical_cores.begin(), physical_cores.begin() + reserved_core_count);
+    }
 
-    if (thread_count < THREADPOOL_MIN_THREAD_COUNT) {
-        spdlog::warn("The desired number of threads to create is too small for the engine to run!");
-        spdlog::warn("Creating {} threads ", THREADPOOL_MIN_THREAD_COUNT);
+    std::size_t thread_count = settings.thread_count;
 
-        // Let's just use the minimum number of threads then.
-        thread_count = THREADPOOL_MIN_THREAD_COUNT;
+    if (thread_count == 0) {
+        thread_count = settings.avoid_smt_siblings ? physical_cores.size() : placement_order.size();
     }
 
     // If the number of threads exceedes the number of cpu cores,
     // the rise of thread management overhead decreases performance!
-    if (thread_count > number_of_cpu_cores) {
+    if (thread_count > placement_order.size()) {
         spdlog::warn("Creating more threads than CPU cores are available!");
         spdlog::warn("This might decrease performance as thread management overhead increases!");
     }
 
+    // Only restrict the worker threads if the placement was configured.
+    if (settings.pin_threads || reserved_core_count > 0 || !settings.cpu_affinity.empty()) {
+        if (vulkan_renderer::tools::is_thread_affinity_supported()) {
+            cpu_placement = std::move(placement_order);
+        } else if (settings.pin_threads || !settings.cpu_affinity.empty()) {
+            // The default core reservation is silently skipped, only an explicit placement is worth a warning.
+            spdlog::warn("Setting the CPU affinity of threads is not supported on this system, the threadpool placement is ignored!");
+        }
+    }
+
+    spdlog::debug("Constructing {} threads.", thread_count);
+
     for (std::size_t i = 0; i < thread_count; ++i) {
         start_thread();
     }
@@ -47,6 +129,7 @@ ThreadPool::~ThreadPool() {
 
     // Notify all worker threads about program stop.
     tasklist_cv.notify_all();
+    parked_cv.notify_all();
 
     for (std::thread &thread : threads) {
         thread.join();
@@ -56,50 +139,435 @@ ThreadPool::~ThreadPool() {
 }
 
 void ThreadPool::start_thread() {
-    // TODO: Do we need additional locks here?
     // spdlog::debug("Starting new worker thread.");
 
+    WorkerCounters *counters = nullptr;
+
+    const std::size_t worker_index = threads.size();
+
+    {
+        // The counters are read by get_statistics, which locks the tasklist mutex as well.
+        std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+        worker_counters.push_back(std::make_unique<WorkerCounters>());
+        counters = worker_counters.back().get();
+
+        // A new worker thread is always active, the auto-scaler might park it later.
+        target_thread_count = worker_index + 1;
+        active_thread_count = worker_index + 1;
+    }
+
+    // Growing the pool activates the parked worker threads as well, which must be woken up.
+    parked_cv.notify_all();
+
     // Start waiting for threads.
     // Working threads listen for new tasks through ThreadPool's condition_variable.
-    threads.emplace_back(
+    threads.emplace_back(&ThreadPool::run_worker, this, worker_index, counters);
 
-        std::thread([&]() {
-            // Lock the queue so we can see which tasks are to ne done.
-            std::unique_lock<std::mutex> queue_lock(tasklist_mutex, std::defer_lock);
+    if (!cpu_placement.empty()) {
+        if (pin_threads) {
+            // Every thread gets its own core, until all cores are used.
+            vulkan_renderer::tools::set_thread_affinity(threads.back(), {cpu_placement[worker_index % cpu_placement.size()]});
+        } else {
+            vulkan_renderer::tools::set_thread_affinity(threads.back(), cpu_placement);
+        }
+    }
+}
 
-            while (true) {
-                // Lock the queue
-                queue_lock.lock();
+void ThreadPool::run_worker(std::size_t worker_index, WorkerCounters *counters) {
+    // Lock the queue so we can see which tasks are to ne done.
+    std::unique_lock<std::mutex> queue_lock(tasklist_mutex, std::defer_lock);
 
-                // spdlog::debug("Waiting for work!.");
+    while (true) {
+        const auto idle_start_time = std::chrono::steady_clock::now();
 
-                // Use the conditional variable to wait for new tasks.
-                tasklist_cv.wait(queue_lock, [&]() -> bool { return !tasklist.empty() || stop_threads; });
+        // Lock the queue
+        queue_lock.lock();
 
-                // spdlog::debug("Starting a new task!.");
+        // A parked worker thread waits until the auto-scaler activates it again.
+        // During shutdown, parked worker threads help to finish the remaining tasks.
+        parked_cv.wait(queue_lock, [&]() -> bool { return worker_index < active_thread_count || worker_index >= target_thread_count || stop_threads; });
 
-                // Check if we should finish the task.
-                if (stop_threads && tasklist.empty()) {
-                    return;
-                }
+        // spdlog::debug("Waiting for work!.");
 
-                // To initialise the task, we must move the unique pointer
-                // from the queue to the loal stakc. Since a unique pointer
-                // cannot be copie, it must be explicitly moved. This transfers
-                // ownershp of the pointed-to object to *this.
-                auto temp_task = std::move(tasklist.front());
+        // Use the conditional variable to wait for new tasks.
+        // Only active worker threads wait on tasklist_cv, so notify_one always reaches a worker thread which takes the task.
+        tasklist_cv.wait(queue_lock, [&]() -> bool {
+            return has_startable_task() || stop_threads || worker_index >= target_thread_count || worker_index >= active_thread_count;
+        });
 
-                // Remove the task from the task list.
-                tasklist.pop();
+        // The worker thread was retired by resize.
+        if (worker_index >= target_thread_count) {
+            return;
+        }
 
-                queue_lock.unlock();
+        // The worker thread was parked by the auto-scaler.
+        if (worker_index >= active_thread_count && !stop_threads) {
+            queue_lock.unlock();
+            counters->idle_time_ns.fetch_add(static_cast<std::uint64_t>((std::chrono::steady_clock::now() - idle_start_time).count()),
+                                             std::memory_order_relaxed);
+            continue;
+        }
 
-                // Run the task!
-                (*temp_task)();
+        // spdlog::debug("Starting a new task!.");
 
-                // spdlog::debug("Task is done!");
+        // To initialise the task, we must move the unique pointer
+        // from the queue to the loal stakc. Since a unique pointer
+        // cannot be copie, it must be explicitly moved. This transfers
+        // ownershp of the pointed-to object to *this.
+        auto temp_task = take_next_task();
+
+        if (!temp_task) {
+            // Check if we should finish the task.
+            if (stop_threads) {
+                return;
             }
-        }));
+
+            // The frame budget was used up in the meantime, so the background task must wait.
+            queue_lock.unlock();
+            counters->idle_time_ns.fetch_add(static_cast<std::uint64_t>((std::chrono::steady_clock::now() - idle_start_time).count()),
+                                             std::memory_order_relaxed);
+            continue;
+        }
+
+        queue_lock.unlock();
+
+        const auto idle_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - idle_start_time);
+
+        // Run the task!
+        const auto busy_time = run_task(*temp_task);
+
+        counters->idle_time_ns.fetch_add(static_cast<std::uint64_t>(idle_time.count()), std::memory_order_relaxed);
+        counters->busy_time_ns.fetch_add(static_cast<std::uint64_t>(busy_time.count()), std::memory_order_relaxed);
+        counters->tasks_run.fetch_add(1, std::memory_order_relaxed);
+
+        // spdlog::debug("Task is done!");
+    }
+}
+
+void ThreadPool::resize(std::size_t thread_count) {
+    assert(thread_count > 0);
+    assert(std::none_of(threads.begin(), threads.end(), [](const std::thread &thread) { return thread.get_id() == std::this_thread::get_id(); }));
+
+    if (thread_count == 0) {
+        spdlog::error("The threadpool needs at least one worker thread!");
+        return;
+    }
+
+    spdlog::debug("Resizing threadpool from {} to {} threads.", threads.size(), thread_count);
+
+    while (threads.size() < thread_count) {
+        start_thread();
+    }
+
+    if (threads.size() == thread_count) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+        target_thread_count = thread_count;
+        active_thread_count = std::min(active_thread_count, thread_count);
+    }
+
+    // Wake up the retired worker threads, wherever they are waiting.
+    tasklist_cv.notify_all();
+    parked_cv.notify_all();
+
+    // The retired worker threads finish their current task first.
+    for (std::size_t i = thread_count; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    threads.erase(threads.begin() + thread_count, threads.end());
+
+    std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+    worker_counters.erase(worker_counters.begin() + thread_count, worker_counters.end());
+}
+
+std::size_t ThreadPool::get_thread_count() {
+    std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+    return target_thread_count;
+}
+
+std::size_t ThreadPool::get_active_thread_count() {
+    std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+    return active_thread_count;
+}
+
+void ThreadPool::set_auto_scaling(bool enabled, std::size_t min_active_thread_count) {
+    {
+        std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+        auto_scaling = enabled;
+        this->min_active_thread_count = std::max<std::size_t>(min_active_thread_count, 1);
+        idle_frame_count = 0;
+
+        if (!enabled) {
+            active_thread_count = target_thread_count;
+        }
+    }
+
+    parked_cv.notify_all();
+}
+
+bool ThreadPool::activate_worker_on_backlog() {
+    if (!auto_scaling || active_thread_count >= target_thread_count) {
+        return false;
+    }
+
+    std::size_t queued_task_count = 0;
+
+    for (const auto &tasklist : tasklists) {
+        queued_task_count += tasklist.size();
+    }
+
+    if (queued_task_count <= active_thread_count) {
+        return false;
+    }
+
+    active_thread_count++;
+    idle_frame_count = 0;
+
+    return true;
+}
+
+std::chrono::nanoseconds ThreadPool::run_task(TaskContainerBase &task) {
+    const auto start_time = std::chrono::steady_clock::now();
+
+    task();
+
+    const auto run_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time);
+
+    run_latency_histograms[task.lane].record(run_time);
+
+    return run_time;
+}
+
+void ThreadPool::begin_frame(std::chrono::nanoseconds frame_budget) {
+    bool log_statistics_now = false;
+    bool worker_parked = false;
+
+    {
+        std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+        frame_start_time = std::chrono::steady_clock::now();
+        this->frame_budget = frame_budget;
+
+        auto &sample = queue_depth_samples[queue_depth_sample_count % THREADPOOL_QUEUE_DEPTH_SAMPLE_COUNT];
+
+        for (std::size_t lane = 0; lane < THREADPOOL_PRIORITY_LANE_COUNT; lane++) {
+            sample[lane] = tasklists[lane].size();
+        }
+
+        queue_depth_sample_count++;
+
+        if (auto_scaling) {
+            const bool queues_empty = std::all_of(tasklists.begin(), tasklists.end(), [](const auto &tasklist) { return tasklist.empty(); });
+
+            idle_frame_count = queues_empty ? idle_frame_count + 1 : 0;
+
+            if (idle_frame_count >= THREADPOOL_AUTO_SCALING_PARK_FRAME_COUNT && active_thread_count > min_active_thread_count) {
+                active_thread_count--;
+                idle_frame_count = 0;
+                worker_parked = true;
+            }
+        }
+
+        if (statistics_log_interval > 0 && ++frames_since_statistics_log >= statistics_log_interval) {
+            frames_since_statistics_log = 0;
+            log_statistics_now = true;
+        }
+    }
+
+    if (log_statistics_now) {
+        log_statistics();
+    }
+
+    // Background tasks which were held back in the last frame may be started again.
+    // This also moves a parked worker thread from tasklist_cv to parked_cv.
+    tasklist_cv.notify_all();
+
+    if (worker_parked) {
+        spdlog::trace("Threadpool auto-scaler parked a worker thread, {} active.", get_active_thread_count());
+    }
+}
+
+void ThreadPool::set_background_cutoff(float background_cutoff) {
+    assert(background_cutoff >= 0.0f && background_cutoff <= 1.0f);
+
+    std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+    this->background_cutoff = background_cutoff;
+}
+
+bool ThreadPool::is_frame_budget_exhausted() {
+    std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+    return is_frame_budget_exhausted_locked();
+}
+
+bool ThreadPool::is_frame_budget_exhausted_locked() const {
+    if (frame_budget.count() == 0) {
+        return false;
+    }
+
+    auto time_used = std::chrono::steady_clock::now() - frame_start_time;
+
+    return time_used >= std::chrono::duration_cast<std::chrono::nanoseconds>(frame_budget * background_cutoff);
+}
+
+bool ThreadPool::has_startable_task() const {
+    if (!tasklists[static_cast<std::size_t>(TaskPriority::FRAME_CRITICAL)].empty() || !tasklists[static_cast<std::size_t>(TaskPriority::NORMAL)].empty()) {
+        return true;
+    }
+
+    // During shutdown we finish all background work regardless of the frame budget.
+    return !tasklists[static_cast<std::size_t>(TaskPriority::BACKGROUND)].empty() && (stop_threads || !is_frame_budget_exhausted_locked());
+}
+
+std::unique_ptr<ThreadPool::TaskContainerBase> ThreadPool::take_next_task() {
+    if (!has_startable_task()) {
+        return nullptr;
+    }
+
+    for (std::size_t lane = 0; lane < THREADPOOL_PRIORITY_LANE_COUNT; lane++) {
+        if (tasklists[lane].empty()) {
+            continue;
+        }
+
+        auto task = std::move(tasklists[lane].front());
+        tasklists[lane].pop();
+
+        auto queue_latency = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - task->queue_time);
+
+        task->lane = lane;
+        wait_latency_histograms[lane].record(queue_latency);
+
+        lane_latencies[lane].task_count++;
+        lane_latencies[lane].total += queue_latency;
+        lane_latencies[lane].maximum = std::max(lane_latencies[lane].maximum, queue_latency);
+
+        return task;
+    }
+
+    return nullptr;
+}
+
+bool ThreadPool::yield() {
+    std::unique_lock<std::mutex> queue_lock(tasklist_mutex);
+
+    auto &frame_critical_tasks = tasklists[static_cast<std::size_t>(TaskPriority::FRAME_CRITICAL)];
+
+    while (!frame_critical_tasks.empty()) {
+        // Frame-critical tasks are always startable, so this will never be nullptr.
+        auto task = take_next_task();
+
+        queue_lock.unlock();
+
+        run_task(*task);
+
+        queue_lock.lock();
+    }
+
+    return is_frame_budget_exhausted_locked();
+}
+
+TaskQueueLatency ThreadPool::get_queue_latency(TaskPriority priority) {
+    std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+    const auto &lane_latency = lane_latencies[static_cast<std::size_t>(priority)];
+
+    TaskQueueLatency latency;
+
+    latency.task_count = lane_latency.task_count;
+    latency.maximum = lane_latency.maximum;
+
+    if (lane_latency.task_count > 0) {
+        latency.average = lane_latency.total / lane_latency.task_count;
+    }
+
+    return latency;
+}
+
+ThreadPoolStatistics ThreadPool::get_statistics() {
+    ThreadPoolStatistics statistics;
+
+    for (std::size_t lane = 0; lane < THREADPOOL_PRIORITY_LANE_COUNT; lane++) {
+        statistics.wait_latency[lane] = wait_latency_histograms[lane].get_snapshot();
+        statistics.run_latency[lane] = run_latency_histograms[lane].get_snapshot();
+    }
+
+    std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+    statistics.workers.reserve(worker_counters.size());
+
+    for (const auto &counters : worker_counters) {
+        WorkerStatistics worker;
+
+        worker.busy_time = std::chrono::nanoseconds(counters->busy_time_ns.load(std::memory_order_relaxed));
+        worker.idle_time = std::chrono::nanoseconds(counters->idle_time_ns.load(std::memory_order_relaxed));
+        worker.tasks_run = counters->tasks_run.load(std::memory_order_relaxed);
+
+        statistics.workers.push_back(worker);
+    }
+
+    const std::size_t sample_count = std::min(queue_depth_sample_count, THREADPOOL_QUEUE_DEPTH_SAMPLE_COUNT);
+
+    statistics.queue_depth_samples.reserve(sample_count);
+
+    for (std::size_t i = queue_depth_sample_count - sample_count; i < queue_depth_sample_count; i++) {
+        statistics.queue_depth_samples.push_back(queue_depth_samples[i % THREADPOOL_QUEUE_DEPTH_SAMPLE_COUNT]);
+    }
+
+    return statistics;
+}
+
+void ThreadPool::log_statistics() {
+    const auto statistics = get_statistics();
+
+    constexpr std::array<const char *, THREADPOOL_PRIORITY_LANE_COUNT> lane_names = {"frame-critical", "normal", "background"};
+
+    for (std::size_t lane = 0; lane < THREADPOOL_PRIORITY_LANE_COUNT; lane++) {
+        const auto &wait_latency = statistics.wait_latency[lane];
+        const auto &run_latency = statistics.run_latency[lane];
+
+        std::size_t queue_depth = 0;
+
+        if (!statistics.queue_depth_samples.empty()) {
+            queue_depth = statistics.queue_depth_samples.back()[lane];
+        }
+
+        spdlog::debug("Threadpool lane {}: {} tasks, {} queued, wait p50 < {} us, p99 < {} us, run p50 < {} us, p99 < {} us.", lane_names[lane],
+                      run_latency.get_count(), queue_depth, wait_latency.get_percentile(0.5).count() / 1000.0,
+                      wait_latency.get_percentile(0.99).count() / 1000.0, run_latency.get_percentile(0.5).count() / 1000.0,
+                      run_latency.get_percentile(0.99).count() / 1000.0);
+    }
+
+    for (std::size_t i = 0; i < statistics.workers.size(); i++) {
+        const auto &worker = statistics.workers[i];
+
+        const auto total_time = worker.busy_time + worker.idle_time;
+
+        double utilisation = 0.0;
+
+        if (total_time.count() > 0) {
+            utilisation = 100.0 * static_cast<double>(worker.busy_time.count()) / static_cast<double>(total_time.count());
+        }
+
+        spdlog::debug("Threadpool worker {}: {} tasks, {:.1f}% busy.", i, worker.tasks_run, utilisation);
+    }
+}
+
+void ThreadPool::set_statistics_log_interval(std::uint32_t frame_count) {
+    std::lock_guard<std::mutex> queue_lock(tasklist_mutex);
+
+    statistics_log_interval = frame_count;
+    frames_since_statistics_log = 0;
 }
 
 } // namespace inexor
@@ -0,0 +1,67 @@
+#include "inexor/vulkan-renderer/thread_pool_statistics.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace inexor {
+
+std::uint64_t LatencyHistogramSnapshot::get_count() const {
+    std::uint64_t count = 0;
+
+    for (const auto bucket : buckets) {
+        count += bucket;
+    }
+
+    return count;
+}
+
+std::chrono::nanoseconds LatencyHistogramSnapshot::get_percentile(double percentile) const {
+    assert(percentile >= 0.0 && percentile <= 1.0);
+
+    const std::uint64_t count = get_count();
+
+    if (count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    const auto wanted_count = static_cast<std::uint64_t>(percentile * static_cast<double>(count));
+
+    std::uint64_t accumulated_count = 0;
+
+    for (std::size_t i = 0; i < buckets.size(); i++) {
+        accumulated_count += buckets[i];
+
+        if (accumulated_count >= wanted_count && accumulated_count > 0) {
+            // The upper bound of bucket i is 2^i nanoseconds.
+            return std::chrono::nanoseconds(std::uint64_t(1) << i);
+        }
+    }
+
+    return std::chrono::nanoseconds(std::uint64_t(1) << (buckets.size() - 1));
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+    auto value = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(latency.count(), 0));
+
+    // The bucket index is the number of significant bits of the latency.
+    std::size_t bucket_index = 0;
+
+    while (value != 0 && bucket_index < LATENCY_HISTOGRAM_BUCKET_COUNT - 1) {
+        value >>= 1;
+        bucket_index++;
+    }
+
+    buckets[bucket_index].fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyHistogramSnapshot LatencyHistogram::get_snapshot() const {
+    LatencyHistogramSnapshot snapshot;
+
+    for (std::size_t i = 0; i < buckets.size(); i++) {
+        snapshot.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+} // namespace inexor
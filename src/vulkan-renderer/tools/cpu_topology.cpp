@@ -0,0 +1,217 @@
+#include "inexor/vulkan-renderer/tools/cpu_topology.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <fstream>
+#include <set>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace inexor::vulkan_renderer::tools {
+
+namespace {
+
+/// @brief Returns the number of logical core indices which can be used.
+std::size_t get_cpu_index_limit() {
+#ifdef __linux__
+    // The cores which are configured, not only the ones the process may run on, because the affinity can be restricted to any of them.
+    const long configured_cores = sysconf(_SC_NPROCESSORS_CONF);
+
+    if (configured_cores > 0) {
+        return std::min(static_cast<std::size_t>(configured_cores), static_cast<std::size_t>(CPU_SETSIZE));
+    }
+
+    return CPU_SETSIZE;
+#else
+    // The number of cores might be unknown, so the limit is the same as CPU_SETSIZE on Linux.
+    const std::size_t hardware_threads = std::thread::hardware_concurrency();
+
+    return hardware_threads > 0 ? hardware_threads : 1024;
+#endif
+}
+
+/// @brief Parses a logical core index, which must only consist of digits.
+std::optional<std::size_t> parse_cpu_index(const std::string &cpu_index, const std::size_t cpu_index_limit) {
+    if (cpu_index.empty() || !std::all_of(cpu_index.begin(), cpu_index.end(), [](const char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+        return std::nullopt;
+    }
+
+    try {
+        const std::size_t index = std::stoul(cpu_index);
+
+        if (index >= cpu_index_limit) {
+            return std::nullopt;
+        }
+
+        return index;
+    } catch (const std::out_of_range &) {
+        return std::nullopt;
+    }
+}
+
+} // namespace
+
+std::vector<CpuCore> get_cpu_topology() {
+    std::vector<CpuCore> cores;
+
+#ifdef __linux__
+    cpu_set_t allowed_cores;
+    CPU_ZERO(&allowed_cores);
+
+    if (sched_getaffinity(0, sizeof(allowed_cores), &allowed_cores) == 0) {
+        for (std::size_t i = 0; i < CPU_SETSIZE; i++) {
+            if (!CPU_ISSET(i, &allowed_cores)) {
+                continue;
+            }
+
+            CpuCore core;
+            core.logical_id = i;
+            core.physical_id = i;
+
+            // The list of SMT siblings contains the core itself, so the lowest index identifies the physical core.
+            std::ifstream siblings_file("/sys/devices/system/cpu/cpu" + std::to_string(i) + "/topology/thread_siblings_list");
+
+            std::string siblings_list;
+
+            if (siblings_file && std::getline(siblings_file, siblings_list)) {
+                auto siblings = parse_cpu_list(siblings_list);
+
+                if (siblings && !siblings->empty()) {
+                    core.physical_id = *std::min_element(siblings->begin(), siblings->end());
+                }
+            }
+
+            cores.push_back(core);
+        }
+    }
+#endif
+
+    if (cores.empty()) {
+        // This might return 0, in which case the list of cores stays empty.
+        const std::size_t core_count = std::thread::hardware_concurrency();
+
+        for (std::size_t i = 0; i < core_count; i++) {
+            cores.push_back({i, i});
+        }
+    }
+
+    return cores;
+}
+
+std::vector<std::size_t> get_cpu_placement_order(const std::vector<CpuCore> &cores, bool avoid_smt_siblings) {
+    std::vector<CpuCore> sorted_cores = cores;
+
+    std::sort(sorted_cores.begin(), sorted_cores.end(), [](const CpuCore &lhs, const CpuCore &rhs) { return lhs.logical_id < rhs.logical_id; });
+
+    std::vector<std::size_t> placement_order;
+    placement_order.reserve(sorted_cores.size());
+
+    if (!avoid_smt_siblings) {
+        for (const auto &core : sorted_cores) {
+            placement_order.push_back(core.logical_id);
+        }
+        return placement_order;
+    }
+
+    std::vector<std::size_t> smt_siblings;
+    std::set<std::size_t> used_physical_cores;
+
+    for (const auto &core : sorted_cores) {
+        if (used_physical_cores.insert(core.physical_id).second) {
+            placement_order.push_back(core.logical_id);
+        } else {
+            smt_siblings.push_back(core.logical_id);
+        }
+    }
+
+    placement_order.insert(placement_order.end(), smt_siblings.begin(), smt_siblings.end());
+
+    return placement_order;
+}
+
+std::optional<std::vector<std::size_t>> parse_cpu_list(const std::string &cpu_list) {
+    const std::size_t cpu_index_limit = get_cpu_index_limit();
+
+    std::vector<std::size_t> cpu_cores;
+
+    std::size_t position = 0;
+
+    while (position < cpu_list.size()) {
+        std::size_t end = cpu_list.find(',', position);
+
+        if (end == std::string::npos) {
+            end = cpu_list.size();
+        }
+
+        const std::string entry = cpu_list.substr(position, end - position);
+
+        position = end + 1;
+
+        if (entry.empty()) {
+            continue;
+        }
+
+        const std::size_t separator = entry.find('-');
+
+        if (separator == std::string::npos) {
+            const auto cpu_index = parse_cpu_index(entry, cpu_index_limit);
+
+            if (!cpu_index) {
+                return std::nullopt;
+            }
+
+            cpu_cores.push_back(*cpu_index);
+            continue;
+        }
+
+        // Both ends of a range must be valid indices, so a range like "0--1" can't expand to every std::size_t.
+        const auto first = parse_cpu_index(entry.substr(0, separator), cpu_index_limit);
+        const auto last = parse_cpu_index(entry.substr(separator + 1), cpu_index_limit);
+
+        if (!first || !last || *first > *last) {
+            return std::nullopt;
+        }
+
+        for (std::size_t i = *first; i <= *last; i++) {
+            cpu_cores.push_back(i);
+        }
+    }
+
+    return cpu_cores;
+}
+
+bool set_thread_affinity(std::thread &thread, const std::vector<std::size_t> &cpu_cores) {
+    assert(!cpu_cores.empty());
+
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    for (const auto cpu_core : cpu_cores) {
+        if (cpu_core < CPU_SETSIZE) {
+            CPU_SET(cpu_core, &cpu_set);
+        }
+    }
+
+    const int result = pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+
+    if (result != 0) {
+        spdlog::warn("Could not set the CPU affinity of a thread (error code {})!", result);
+        return false;
+    }
+
+    return true;
+#else
+    spdlog::warn("Setting the CPU affinity of threads is not supported on this system!");
+    return false;
+#endif
+}
+
+} // namespace inexor::vulkan_renderer::tools
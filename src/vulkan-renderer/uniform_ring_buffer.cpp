@@ -0,0 +1,65 @@
+#include "inexor/vulkan-renderer/uniform_ring_buffer.hpp"
+
+namespace inexor::vulkan_renderer {
+
+UniformRingBuffer::UniformRingBuffer(UniformRingBuffer &&other) noexcept
+    : GPUMemoryBuffer(std::move(other)), offset_alignment(other.offset_alignment), region_size(other.region_size), region_count(other.region_count),
+      descriptor_range(other.descriptor_range), current_region(other.current_region), current_region_used(other.current_region_used) {}
+
+VkDeviceSize UniformRingBuffer::get_offset_alignment(const VkPhysicalDevice graphics_card) {
+    assert(graphics_card);
+
+    VkPhysicalDeviceProperties graphics_card_properties;
+    vkGetPhysicalDeviceProperties(graphics_card, &graphics_card_properties);
+
+    // The Vulkan specification guarantees this is a power of two.
+    return graphics_card_properties.limits.minUniformBufferOffsetAlignment;
+}
+
+UniformRingBuffer::UniformRingBuffer(const VkDevice device, const VkPhysicalDevice graphics_card, const VmaAllocator vma_allocator, const std::string &name,
+                                     const VkDeviceSize region_size, const std::uint32_t region_count, const VkDeviceSize descriptor_range)
+    : GPUMemoryBuffer(device, vma_allocator, name, align_up(region_size, get_offset_alignment(graphics_card)) * region_count,
+                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU),
+      offset_alignment(get_offset_alignment(graphics_card)), region_size(align_up(region_size, offset_alignment)), region_count(region_count),
+      descriptor_range(descriptor_range) {
+    assert(region_count > 0);
+    assert(descriptor_range > 0);
+    assert(descriptor_range <= this->region_size);
+    assert(allocation_info.pMappedData);
+
+    spdlog::debug("Created uniform ring buffer '{}' with {} regions of {} bytes.", name, region_count, this->region_size);
+}
+
+void UniformRingBuffer::begin_region(std::uint32_t region_index) {
+    assert(region_index < region_count);
+
+    current_region = region_index;
+    current_region_used = 0;
+}
+
+UniformRingAllocation UniformRingBuffer::allocate(VkDeviceSize size) {
+    assert(size > 0);
+    assert(size <= descriptor_range);
+
+    // The descriptor always reads descriptor_range bytes, so they have to fit into the region.
+    if (current_region_used + descriptor_range > region_size) {
+        throw std::runtime_error("Error: Region " + std::to_string(current_region) + " of uniform ring buffer " + name + " is full!");
+    }
+
+    const VkDeviceSize offset = current_region * region_size + current_region_used;
+
+    current_region_used += align_up(size, offset_alignment);
+
+    return {static_cast<std::uint8_t *>(allocation_info.pMappedData) + offset, static_cast<std::uint32_t>(offset)};
+}
+
+void UniformRingBuffer::flush_region() {
+    if (current_region_used == 0) {
+        return;
+    }
+
+    // This does nothing if the memory is host coherent.
+    vmaFlushAllocation(vma_allocator, allocation, current_region * region_size, current_region_used);
+}
+
+} // namespace inexor::vulkan_renderer
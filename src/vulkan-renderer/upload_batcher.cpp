@@ -0,0 +1,618 @@
+#include "inexor/vulkan-renderer/upload_batcher.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace inexor::vulkan_renderer {
+
+namespace {
+
+// The offsets of buffer to image copies must be a multiple of 4 and of the texel block size, which is at most 16.
+constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+VkDeviceSize align_up(VkDeviceSize size, VkDeviceSize alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+UploadBatcher::UploadBatcher(const VkDevice device, const VmaAllocator vma_allocator, const VkQueue queue, const std::uint32_t queue_family_index,
+                             CommandBufferRecycler &command_buffer_recycler, const VkDeviceSize staging_ring_size)
+    : device(device), vma_allocator(vma_allocator), queue(queue), queue_family_index(queue_family_index),
+      command_buffer_recycler(&command_buffer_recycler), destination_queue(queue), destination_queue_family_index(queue_family_index),
+      staging_ring_size(align_up(staging_ring_size, STAGING_ALIGNMENT)) {
+    assert(device);
+    assert(vma_allocator);
+    assert(queue);
+    assert(staging_ring_size > 0);
+
+    spdlog::debug("Creating upload batcher with a staging ring of {} bytes.", this->staging_ring_size);
+
+    create_staging_ring();
+}
+
+UploadBatcher::UploadBatcher(const VkDevice device, const VmaAllocator vma_allocator, const VkQueue queue, const std::uint32_t queue_family_index,
+                             const VkQueue destination_queue, const std::uint32_t destination_queue_family_index,
+                             CommandBufferRecycler &command_buffer_recycler, SemaphorePool &semaphore_pool, const VkDeviceSize staging_ring_size)
+    : device(device), vma_allocator(vma_allocator), queue(queue), queue_family_index(queue_family_index),
+      command_buffer_recycler(&command_buffer_recycler), destination_queue(destination_queue),
+      destination_queue_family_index(destination_queue_family_index), semaphore_pool(&semaphore_pool),
+      staging_ring_size(align_up(staging_ring_size, STAGING_ALIGNMENT)) {
+    assert(device);
+    assert(vma_allocator);
+    assert(queue);
+    assert(destination_queue);
+    assert(staging_ring_size > 0);
+
+    if (transfers_ownership()) {
+        spdlog::debug("Creating upload batcher from queue family {} to queue family {} with a staging ring of {} bytes.", queue_family_index,
+                      destination_queue_family_index, this->staging_ring_size);
+    } else {
+        spdlog::debug("Creating upload batcher with a staging ring of {} bytes.", this->staging_ring_size);
+    }
+
+    create_staging_ring();
+}
+
+void UploadBatcher::create_staging_ring() {
+    // CPU_ONLY memory is always host coherent, so the staging ring never needs to be flushed.
+    staging_ring = std::make_unique<GPUMemoryBuffer>(device, vma_allocator, "upload batcher staging ring", this->staging_ring_size,
+                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+}
+
+UploadBatcher::~UploadBatcher() {
+    while (!submitted_batches.empty()) {
+        wait_for_oldest_batch();
+    }
+
+    if (open_batch) {
+        spdlog::warn("Discarding upload batch {} which was never submitted.", open_batch->token);
+
+        // The command buffer is still recording, resetting it discards the commands.
+        command_buffer_recycler->release(queue_family_index, open_batch->command_buffer);
+    }
+
+    spdlog::debug("Upload batcher: {} batches, {} uploads, {} bytes, {} dedicated staging buffers, {} waits for the staging ring.",
+                  statistics.submitted_batches, statistics.uploads, statistics.uploaded_bytes, statistics.dedicated_staging_buffers,
+                  statistics.staging_ring_waits);
+}
+
+UploadBatcher::Batch &UploadBatcher::get_open_batch() {
+    if (open_batch) {
+        return *open_batch;
+    }
+
+    open_batch = std::make_unique<Batch>();
+    open_batch->token = next_token++;
+    open_batch->command_buffer = command_buffer_recycler->acquire(queue_family_index);
+
+    VkCommandBufferBeginInfo command_buffer_begin_info = {};
+
+    command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(open_batch->command_buffer, &command_buffer_begin_info) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkBeginCommandBuffer failed for upload batcher!");
+    }
+
+    return *open_batch;
+}
+
+bool UploadBatcher::try_allocate_from_staging_ring(VkDeviceSize size, VkDeviceSize &offset) {
+    if (staging_ring_used == 0) {
+        // Start at the beginning when the ring is empty, so the largest contiguous block is available.
+        staging_ring_head = 0;
+        staging_ring_tail = 0;
+    }
+
+    Batch &batch = get_open_batch();
+
+    const VkDeviceSize aligned_head = align_up(staging_ring_head, STAGING_ALIGNMENT);
+
+    if (staging_ring_head >= staging_ring_tail && (staging_ring_used == 0 || staging_ring_head != staging_ring_tail)) {
+        // The free memory is at the end of the ring and at its beginning, before the tail.
+        if (aligned_head + size <= staging_ring_size) {
+            offset = aligned_head;
+
+            batch.staging_ring_bytes += aligned_head + size - staging_ring_head;
+            staging_ring_used += aligned_head + size - staging_ring_head;
+            staging_ring_head = aligned_head + size;
+            return true;
+        }
+
+        // Wrap around and skip the rest of the ring.
+        if (size <= staging_ring_tail) {
+            offset = 0;
+
+            batch.staging_ring_bytes += staging_ring_size - staging_ring_head + size;
+            staging_ring_used += staging_ring_size - staging_ring_head + size;
+            staging_ring_head = size;
+            return true;
+        }
+
+        return false;
+    }
+
+    // The ring has wrapped around, the free memory is between the head and the tail.
+    if (staging_ring_head < staging_ring_tail && aligned_head + size <= staging_ring_tail) {
+        offset = aligned_head;
+
+        batch.staging_ring_bytes += aligned_head + size - staging_ring_head;
+        staging_ring_used += aligned_head + size - staging_ring_head;
+        staging_ring_head = aligned_head + size;
+        return true;
+    }
+
+    return false;
+}
+
+void UploadBatcher::stage(const void *data, VkDeviceSize size, VkBuffer &staging_buffer, VkDeviceSize &staging_offset) {
+    assert(data);
+    assert(size > 0);
+
+    statistics.uploads++;
+    statistics.uploaded_bytes += size;
+
+    if (size > staging_ring_size) {
+        // The data can never fit into the ring, so it gets a staging buffer which lives as long as the batch.
+        Batch &batch = get_open_batch();
+
+        batch.dedicated_staging_buffers.push_back(std::make_unique<GPUMemoryBuffer>(device, vma_allocator, "upload batcher dedicated staging buffer",
+                                                                                    size, const_cast<void *>(data), static_cast<std::size_t>(size),
+                                                                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY));
+
+        statistics.dedicated_staging_buffers++;
+
+        staging_buffer = batch.dedicated_staging_buffers.back()->get_buffer();
+        staging_offset = 0;
+        return;
+    }
+
+    VkDeviceSize offset = 0;
+
+    while (!try_allocate_from_staging_ring(size, offset)) {
+        statistics.staging_ring_waits++;
+
+        if (submitted_batches.empty()) {
+            // The open batch uses the rest of the ring, so it has to be submitted first.
+            flush();
+        }
+
+        wait_for_oldest_batch();
+    }
+
+    std::memcpy(static_cast<std::uint8_t *>(staging_ring->get_allocation_info().pMappedData) + offset, data, static_cast<std::size_t>(size));
+
+    staging_buffer = staging_ring->get_buffer();
+    staging_offset = offset;
+}
+
+UploadToken UploadBatcher::upload_buffer(VkBuffer buffer, VkDeviceSize buffer_offset, const void *data, VkDeviceSize size) {
+    assert(buffer);
+
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    VkDeviceSize staging_offset = 0;
+
+    // Staging might submit the open batch, so the batch is looked up afterwards.
+    stage(data, size, staging_buffer, staging_offset);
+
+    Batch &batch = get_open_batch();
+
+    VkBufferCopy buffer_copy = {};
+
+    buffer_copy.srcOffset = staging_offset;
+    buffer_copy.dstOffset = buffer_offset;
+    buffer_copy.size = size;
+
+    vkCmdCopyBuffer(batch.command_buffer, staging_buffer, buffer, 1, &buffer_copy);
+
+    if (transfers_ownership()) {
+        VkBufferMemoryBarrier buffer_barrier = {};
+
+        buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        buffer_barrier.srcQueueFamilyIndex = queue_family_index;
+        buffer_barrier.dstQueueFamilyIndex = destination_queue_family_index;
+        buffer_barrier.buffer = buffer;
+        buffer_barrier.offset = buffer_offset;
+        buffer_barrier.size = size;
+
+        // The access masks of the release and the acquire only apply to their own queue.
+        buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        buffer_barrier.dstAccessMask = 0;
+        batch.buffer_releases.push_back(buffer_barrier);
+
+        buffer_barrier.srcAccessMask = 0;
+        buffer_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+        batch.buffer_acquires.push_back(buffer_barrier);
+
+        statistics.ownership_transfers++;
+    } else {
+        batch.has_buffer_uploads = true;
+    }
+
+    return batch.token;
+}
+
+UploadToken UploadBatcher::upload_image(VkImage image, const VkImageSubresourceRange &subresource_range, const std::vector<VkBufferImageCopy> &regions,
+                                        const void *data, VkDeviceSize size, VkImageLayout final_layout) {
+    assert(image);
+    assert(!regions.empty());
+
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    VkDeviceSize staging_offset = 0;
+
+    stage(data, size, staging_buffer, staging_offset);
+
+    Batch &batch = get_open_batch();
+
+    VkImageMemoryBarrier barrier = {};
+
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = subresource_range;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    std::vector<VkBufferImageCopy> staged_regions(regions);
+
+    for (auto &region : staged_regions) {
+        region.bufferOffset += staging_offset;
+    }
+
+    vkCmdCopyBufferToImage(batch.command_buffer, staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<std::uint32_t>(staged_regions.size()),
+                           staged_regions.data());
+
+    if (transfers_ownership()) {
+        // The layout transition is part of the ownership transfer. The release and the acquire must describe the same transition.
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = final_layout;
+        barrier.srcQueueFamilyIndex = queue_family_index;
+        barrier.dstQueueFamilyIndex = destination_queue_family_index;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        batch.image_releases.push_back(barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = final_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+                                                                                     : VK_ACCESS_SHADER_READ_BIT;
+        batch.image_acquires.push_back(barrier);
+
+        statistics.ownership_transfers++;
+    } else if (final_layout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = final_layout;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                             &barrier);
+    }
+
+    return batch.token;
+}
+
+UploadToken UploadBatcher::record(const std::function<void(VkCommandBuffer)> &commands) {
+    assert(commands);
+    assert(!transfers_ownership());
+
+    Batch &batch = get_open_batch();
+
+    commands(batch.command_buffer);
+
+    return batch.token;
+}
+
+UploadToken UploadBatcher::record_on_destination(std::function<void(VkCommandBuffer)> commands) {
+    assert(commands);
+
+    if (!transfers_ownership()) {
+        return record(commands);
+    }
+
+    Batch &batch = get_open_batch();
+
+    batch.destination_commands.push_back(std::move(commands));
+
+    return batch.token;
+}
+
+UploadToken UploadBatcher::flush() {
+    if (!open_batch) {
+        return next_token - 1;
+    }
+
+    std::unique_ptr<Batch> batch = std::move(open_batch);
+
+    if (batch->has_buffer_uploads) {
+        // Make the buffer copies visible to the draws of later submissions.
+        VkMemoryBarrier memory_barrier = {};
+
+        memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+
+        vkCmdPipelineBarrier(batch->command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+    }
+
+    if (!batch->buffer_releases.empty() || !batch->image_releases.empty()) {
+        vkCmdPipelineBarrier(batch->command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                             static_cast<std::uint32_t>(batch->buffer_releases.size()), batch->buffer_releases.data(),
+                             static_cast<std::uint32_t>(batch->image_releases.size()), batch->image_releases.data());
+    }
+
+    if (vkEndCommandBuffer(batch->command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkEndCommandBuffer failed for upload batcher!");
+    }
+
+    batch->staging_ring_end = staging_ring_head;
+
+    VkSubmitInfo submit_info = {};
+
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch->command_buffer;
+
+    if (transfers_ownership()) {
+        batch->transfer_semaphore = semaphore_pool->acquire();
+
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &batch->transfer_semaphore;
+    }
+
+    submit(queue, submit_info, batch->fence, batch->transfer_value);
+    batch->transfer_pending = true;
+
+    statistics.submitted_batches++;
+
+    const UploadToken token = batch->token;
+
+    submitted_batches.push_back(std::move(batch));
+
+    return token;
+}
+
+void UploadBatcher::submit(VkQueue submit_queue, const VkSubmitInfo &submit_info, VkFence &fence, std::uint64_t &timeline_value) {
+    if (frame_timeline != nullptr) {
+        if (frame_timeline->submit(submit_queue, submit_info, VK_NULL_HANDLE, timeline_value) != VK_SUCCESS) {
+            throw std::runtime_error("Error: Submitting to the frame timeline failed for upload batcher!");
+        }
+        return;
+    }
+
+    fence = command_buffer_recycler->get_fence_pool().acquire();
+
+    if (vkQueueSubmit(submit_queue, 1, &submit_info, fence) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkQueueSubmit failed for upload batcher!");
+    }
+}
+
+bool UploadBatcher::is_finished(VkQueue submit_queue, VkFence fence, std::uint64_t timeline_value) {
+    if (frame_timeline != nullptr) {
+        return frame_timeline->get_completed_value(submit_queue) >= timeline_value;
+    }
+
+    return vkGetFenceStatus(device, fence) == VK_SUCCESS;
+}
+
+void UploadBatcher::wait_until_finished(VkQueue submit_queue, VkFence fence, std::uint64_t timeline_value) {
+    if (frame_timeline != nullptr) {
+        if (frame_timeline->wait_for_value(submit_queue, timeline_value) != VK_SUCCESS) {
+            throw std::runtime_error("Error: Waiting for the frame timeline failed for upload batcher!");
+        }
+        return;
+    }
+
+    if (vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkWaitForFences failed for upload batcher!");
+    }
+}
+
+void UploadBatcher::use_frame_timeline(VulkanFrameTimeline &frame_timeline) {
+    assert(frame_timeline.is_initialised());
+    assert(submitted_batches.empty());
+
+    this->frame_timeline = &frame_timeline;
+}
+
+void UploadBatcher::retire_transfer(Batch &batch) {
+    if (batch.fence != VK_NULL_HANDLE) {
+        command_buffer_recycler->get_fence_pool().release(batch.fence);
+    }
+
+    command_buffer_recycler->release(queue_family_index, batch.command_buffer);
+    batch.fence = VK_NULL_HANDLE;
+    batch.command_buffer = VK_NULL_HANDLE;
+    batch.transfer_pending = false;
+
+    // Batches finish in order, so all staging memory before the end of this batch is free now.
+    // A batch without staging memory must not move the tail, because the ring might have been rewound since its submission.
+    if (batch.staging_ring_bytes > 0) {
+        staging_ring_tail = batch.staging_ring_end;
+        staging_ring_used -= batch.staging_ring_bytes;
+    }
+
+    batch.dedicated_staging_buffers.clear();
+
+    if (batch.transfer_semaphore == VK_NULL_HANDLE) {
+        completed_token = batch.token;
+        return;
+    }
+
+    batch.acquire_command_buffer = command_buffer_recycler->acquire(destination_queue_family_index);
+
+    VkCommandBufferBeginInfo command_buffer_begin_info = {};
+
+    command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(batch.acquire_command_buffer, &command_buffer_begin_info) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkBeginCommandBuffer failed for upload batcher!");
+    }
+
+    VkPipelineStageFlags acquire_stage_mask = 0;
+
+    if (!batch.buffer_acquires.empty()) {
+        acquire_stage_mask |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    }
+
+    for (const auto &image_acquire : batch.image_acquires) {
+        acquire_stage_mask |=
+            image_acquire.newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+
+    if (!batch.destination_commands.empty()) {
+        // The commands may use anything the batch uploaded. The transfer has finished, so this doesn't stall the destination queue.
+        acquire_stage_mask |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+
+    vkCmdPipelineBarrier(batch.acquire_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, acquire_stage_mask, 0, 0, nullptr,
+                         static_cast<std::uint32_t>(batch.buffer_acquires.size()), batch.buffer_acquires.data(),
+                         static_cast<std::uint32_t>(batch.image_acquires.size()), batch.image_acquires.data());
+
+    for (const auto &commands : batch.destination_commands) {
+        commands(batch.acquire_command_buffer);
+    }
+
+    batch.destination_commands.clear();
+
+    if (vkEndCommandBuffer(batch.acquire_command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Error: vkEndCommandBuffer failed for upload batcher!");
+    }
+
+    // The semaphore is signaled already, so waiting on it does not stall the destination queue.
+    const VkPipelineStageFlags wait_stage_mask = acquire_stage_mask;
+
+    VkSubmitInfo submit_info = {};
+
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &batch.transfer_semaphore;
+    submit_info.pWaitDstStageMask = &wait_stage_mask;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch.acquire_command_buffer;
+
+    submit(destination_queue, submit_info, batch.acquire_fence, batch.acquire_value);
+    batch.acquire_pending = true;
+}
+
+void UploadBatcher::retire_acquire(Batch &batch) {
+    if (batch.acquire_fence != VK_NULL_HANDLE) {
+        command_buffer_recycler->get_fence_pool().release(batch.acquire_fence);
+    }
+
+    command_buffer_recycler->release(destination_queue_family_index, batch.acquire_command_buffer);
+
+    // The acquire which waited on the semaphore has finished, so the semaphore is unsignaled again.
+    semaphore_pool->release(batch.transfer_semaphore);
+
+    batch.acquire_fence = VK_NULL_HANDLE;
+    batch.acquire_command_buffer = VK_NULL_HANDLE;
+    batch.transfer_semaphore = VK_NULL_HANDLE;
+    batch.acquire_pending = false;
+
+    completed_token = batch.token;
+}
+
+void UploadBatcher::wait_for_oldest_batch() {
+    assert(!submitted_batches.empty());
+
+    Batch &batch = *submitted_batches.front();
+
+    if (batch.transfer_pending) {
+        wait_until_finished(queue, batch.fence, batch.transfer_value);
+        retire_transfer(batch);
+    }
+
+    if (batch.acquire_pending) {
+        wait_until_finished(destination_queue, batch.acquire_fence, batch.acquire_value);
+        retire_acquire(batch);
+    }
+
+    submitted_batches.pop_front();
+}
+
+void UploadBatcher::collect() {
+    // The transfers finish in order, and their staging memory has to be freed in order.
+    for (auto &batch : submitted_batches) {
+        if (!batch->transfer_pending) {
+            continue;
+        }
+
+        if (!is_finished(queue, batch->fence, batch->transfer_value)) {
+            break;
+        }
+
+        retire_transfer(*batch);
+    }
+
+    while (!submitted_batches.empty()) {
+        Batch &batch = *submitted_batches.front();
+
+        if (batch.transfer_pending) {
+            break;
+        }
+
+        if (batch.acquire_pending) {
+            if (!is_finished(destination_queue, batch.acquire_fence, batch.acquire_value)) {
+                break;
+            }
+
+            retire_acquire(batch);
+        }
+
+        submitted_batches.pop_front();
+    }
+}
+
+VkDeviceSize UploadBatcher::get_staging_memory_size() const {
+    VkDeviceSize staging_memory_size = staging_ring_size;
+
+    auto add_dedicated_staging_buffers = [&](const Batch &batch) {
+        for (const auto &dedicated_staging_buffer : batch.dedicated_staging_buffers) {
+            staging_memory_size += dedicated_staging_buffer->get_allocation_info().size;
+        }
+    };
+
+    if (open_batch) {
+        add_dedicated_staging_buffers(*open_batch);
+    }
+
+    for (const auto &batch : submitted_batches) {
+        add_dedicated_staging_buffers(*batch);
+    }
+
+    return staging_memory_size;
+}
+
+bool UploadBatcher::is_complete(UploadToken token) {
+    collect();
+    return token <= completed_token;
+}
+
+void UploadBatcher::wait(UploadToken token) {
+    if (open_batch && token >= open_batch->token) {
+        flush();
+    }
+
+    while (token > completed_token && !submitted_batches.empty()) {
+        wait_for_oldest_batch();
+    }
+}
+
+void UploadBatcher::wait_idle() {
+    flush();
+
+    while (!submitted_batches.empty()) {
+        wait_for_oldest_batch();
+    }
+}
+
+} // namespace inexor::vulkan_renderer
@@ -0,0 +1,110 @@
+#include "inexor/vulkan-renderer/coroutine_task.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+std::atomic<VkResult> fence_status = VK_NOT_READY;
+
+VKAPI_ATTR VkResult VKAPI_CALL get_fake_fence_status(VkDevice, VkFence) {
+    return fence_status.load();
+}
+
+// The device and the fence are never dereferenced by the fake function.
+const VkDevice FAKE_DEVICE = reinterpret_cast<VkDevice>(static_cast<std::uintptr_t>(1));
+const VkFence FAKE_FENCE = reinterpret_cast<VkFence>(static_cast<std::uintptr_t>(1));
+
+/// Stands in for decoding a texture file on a worker thread.
+inexor::Task<int> decode_texture(inexor::ThreadPool &thread_pool, const std::thread::id main_thread_id) {
+    co_await inexor::schedule_on(thread_pool, inexor::TaskPriority::BACKGROUND);
+
+    EXPECT_NE(std::this_thread::get_id(), main_thread_id);
+
+    co_return 42;
+}
+
+/// Stands in for the decode, upload and fence wait chain of a texture loader.
+inexor::Task<int> load_texture(inexor::ThreadPool &thread_pool, inexor::vulkan_renderer::VulkanFenceManager &fence_manager,
+                               const std::thread::id main_thread_id) {
+    const int texture = co_await decode_texture(thread_pool, main_thread_id);
+
+    co_await inexor::vulkan_renderer::wait_for_fence(fence_manager, FAKE_FENCE, thread_pool);
+
+    EXPECT_NE(std::this_thread::get_id(), main_thread_id);
+
+    co_return texture + 1;
+}
+
+/// Polls the fences like the render loop until the task is done.
+VkResult poll_until_done(inexor::vulkan_renderer::VulkanFenceManager &fence_manager, const inexor::Task<int> &task) {
+    VkResult first_error = VK_SUCCESS;
+
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+    while (!task.is_done() && std::chrono::steady_clock::now() < timeout) {
+        const VkResult result = fence_manager.poll_fence_callbacks();
+
+        if (first_error == VK_SUCCESS) {
+            first_error = result;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return first_error;
+}
+
+} // namespace
+
+namespace inexor::vulkan_renderer {
+
+TEST(CoroutineTask, LoaderChainResumesOnThreadPoolOnceFenceIsSignaled) {
+    ThreadPool thread_pool(2);
+
+    VulkanFenceManager fence_manager;
+    ASSERT_EQ(fence_manager.init(FAKE_DEVICE, std::make_shared<VulkanDebugMarkerManager>(), get_fake_fence_status), VK_SUCCESS);
+
+    fence_status = VK_NOT_READY;
+
+    auto task = load_texture(thread_pool, fence_manager, std::this_thread::get_id());
+    task.start();
+
+    // The task can't finish while the fence is not signaled.
+    for (int frame = 0; frame < 50; frame++) {
+        EXPECT_EQ(fence_manager.poll_fence_callbacks(), VK_SUCCESS);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_FALSE(task.is_done());
+
+    fence_status = VK_SUCCESS;
+
+    EXPECT_EQ(poll_until_done(fence_manager, task), VK_SUCCESS);
+    ASSERT_TRUE(task.is_done());
+    EXPECT_EQ(task.get(), 43);
+}
+
+TEST(CoroutineTask, LostDeviceFailsTheFenceWait) {
+    ThreadPool thread_pool(2);
+
+    VulkanFenceManager fence_manager;
+    ASSERT_EQ(fence_manager.init(FAKE_DEVICE, std::make_shared<VulkanDebugMarkerManager>(), get_fake_fence_status), VK_SUCCESS);
+
+    fence_status = VK_ERROR_DEVICE_LOST;
+
+    auto task = load_texture(thread_pool, fence_manager, std::this_thread::get_id());
+    task.start();
+
+    EXPECT_EQ(poll_until_done(fence_manager, task), VK_ERROR_DEVICE_LOST);
+    ASSERT_TRUE(task.is_done());
+    EXPECT_THROW(static_cast<void>(task.get()), std::runtime_error);
+}
+
+} // namespace inexor::vulkan_renderer
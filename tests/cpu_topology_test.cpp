@@ -0,0 +1,31 @@
+#include "inexor/vulkan-renderer/tools/cpu_topology.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace inexor::vulkan_renderer::tools {
+
+TEST(CpuTopology, ParsesCoreIndicesAndRanges) {
+    // Every system has a core 0, so these lists are valid everywhere.
+    EXPECT_EQ(parse_cpu_list("0"), std::vector<std::size_t>{0});
+    EXPECT_EQ(parse_cpu_list("0-0,0"), (std::vector<std::size_t>{0, 0}));
+    EXPECT_EQ(parse_cpu_list("0,,0"), (std::vector<std::size_t>{0, 0}));
+}
+
+TEST(CpuTopology, RejectsMalformedCoreLists) {
+    // std::stoul would accept a sign or whitespace, and "0--1" would expand to every std::size_t.
+    for (const std::string cpu_list : {"0--1", "-1", "+0", " 0", "0-", "-0", "0-+0", "a", "0x1", "1-0"}) {
+        EXPECT_FALSE(parse_cpu_list(cpu_list).has_value()) << cpu_list;
+    }
+}
+
+TEST(CpuTopology, RejectsCoreIndicesBeyondTheSystem) {
+    for (const std::string cpu_list : {"99999999", "0-99999999", "18446744073709551616", "0-18446744073709551615"}) {
+        EXPECT_FALSE(parse_cpu_list(cpu_list).has_value()) << cpu_list;
+    }
+}
+
+} // namespace inexor::vulkan_renderer::tools
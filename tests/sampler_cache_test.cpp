@@ -0,0 +1,112 @@
+#include "inexor/vulkan-renderer/sampler_cache.hpp"
+#include "inexor/vulkan-renderer/texture.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+std::uint64_t created_samplers = 0;
+std::uint64_t destroyed_samplers = 0;
+
+VKAPI_ATTR VkResult VKAPI_CALL create_fake_sampler(VkDevice, const VkSamplerCreateInfo *, const VkAllocationCallbacks *, VkSampler *sampler) {
+    created_samplers++;
+    *sampler = reinterpret_cast<VkSampler>(static_cast<std::uintptr_t>(created_samplers));
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL destroy_fake_sampler(VkDevice, VkSampler, const VkAllocationCallbacks *) {
+    destroyed_samplers++;
+}
+
+/// A graphics card with 16x anisotropic filtering.
+VkPhysicalDeviceFeatures make_device_features() {
+    VkPhysicalDeviceFeatures device_features = {};
+    device_features.samplerAnisotropy = VK_TRUE;
+    return device_features;
+}
+
+VkPhysicalDeviceProperties make_graphics_card_properties() {
+    VkPhysicalDeviceProperties graphics_card_properties = {};
+    graphics_card_properties.limits.maxSamplerAnisotropy = 16.0f;
+    return graphics_card_properties;
+}
+
+} // namespace
+
+namespace inexor::vulkan_renderer {
+
+TEST(SamplerCache, TexturesWithTheSameAddressModeShareOneSampler) {
+    constexpr std::size_t TEXTURE_COUNT = 64;
+
+    const VkPhysicalDeviceFeatures device_features = make_device_features();
+    const VkPhysicalDeviceProperties graphics_card_properties = make_graphics_card_properties();
+
+    created_samplers = 0;
+    destroyed_samplers = 0;
+
+    // The device is never dereferenced by the fake functions.
+    VkDevice device = reinterpret_cast<VkDevice>(static_cast<std::uintptr_t>(1));
+
+    {
+        SamplerCache sampler_cache(device, create_fake_sampler, destroy_fake_sampler);
+
+        // Texture::create_texture_sampler() takes the sampler state of every texture from this function. It has no
+        // parameter for the mip levels, which are limited by the image view, so the sampler doesn't clamp them.
+        const VkSamplerCreateInfo sampler_create_info =
+            Texture::make_sampler_create_info(device_features, graphics_card_properties, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+
+        EXPECT_EQ(sampler_create_info.maxLod, VK_LOD_CLAMP_NONE);
+        EXPECT_EQ(sampler_create_info.maxAnisotropy, 16.0f);
+
+        std::vector<VkSampler> samplers;
+
+        for (std::size_t texture = 0; texture < TEXTURE_COUNT; texture++) {
+            samplers.push_back(sampler_cache.acquire(sampler_create_info));
+        }
+
+        EXPECT_EQ(created_samplers, 1u);
+        EXPECT_EQ(sampler_cache.get_statistics().samplers, 1u);
+        EXPECT_EQ(sampler_cache.get_statistics().hits, TEXTURE_COUNT - 1);
+
+        for (const auto sampler : samplers) {
+            EXPECT_EQ(sampler, samplers.front());
+        }
+
+        // A different state, like the one of texture atlas pages, gets a sampler of its own, see TexturePack::create_sampler().
+        const VkSampler clamped_sampler =
+            sampler_cache.acquire(Texture::make_sampler_create_info(device_features, graphics_card_properties, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE));
+
+        EXPECT_NE(clamped_sampler, samplers.front());
+        EXPECT_EQ(created_samplers, 2u);
+
+        sampler_cache.release(clamped_sampler);
+        EXPECT_EQ(destroyed_samplers, 1u);
+
+        // The shared sampler is destroyed when the last texture releases it.
+        for (const auto sampler : samplers) {
+            EXPECT_EQ(destroyed_samplers, 1u);
+            sampler_cache.release(sampler);
+        }
+
+        EXPECT_EQ(destroyed_samplers, 2u);
+        EXPECT_EQ(sampler_cache.get_statistics().samplers, 0u);
+    }
+
+    EXPECT_EQ(destroyed_samplers, 2u);
+}
+
+TEST(SamplerCache, SamplersOnlyUseAnisotropicFilteringIfTheGraphicsCardSupportsIt) {
+    VkPhysicalDeviceFeatures device_features = make_device_features();
+    device_features.samplerAnisotropy = VK_FALSE;
+
+    const VkSamplerCreateInfo sampler_create_info =
+        Texture::make_sampler_create_info(device_features, make_graphics_card_properties(), VK_SAMPLER_ADDRESS_MODE_REPEAT);
+
+    EXPECT_EQ(sampler_create_info.anisotropyEnable, VK_FALSE);
+    EXPECT_EQ(sampler_create_info.maxAnisotropy, 1.0f);
+}
+
+} // namespace inexor::vulkan_renderer
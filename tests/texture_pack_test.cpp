@@ -0,0 +1,344 @@
+#include "inexor/vulkan-renderer/texture_pack.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t DDSD_CAPS = 0x1;
+constexpr std::uint32_t DDSD_HEIGHT = 0x2;
+constexpr std::uint32_t DDSD_WIDTH = 0x4;
+constexpr std::uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr std::uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr std::uint32_t DDPF_FOURCC = 0x4;
+constexpr std::uint32_t DDSCAPS_TEXTURE = 0x1000;
+
+template <typename T>
+void write_at(std::vector<char> &bytes, const std::size_t offset, const T value) {
+    for (std::size_t byte = 0; byte < sizeof(T); byte++) {
+        bytes[offset + byte] = static_cast<char>((static_cast<std::uint64_t>(value) >> (8 * byte)) & 0xFF);
+    }
+}
+
+/// @brief Writes an uncompressed 32 bit TGA file, which stb_image decodes into RGBA8.
+void write_tga(const std::string &file_name, const std::uint16_t width, const std::uint16_t height) {
+    std::vector<char> bytes(18 + 4 * static_cast<std::size_t>(width) * height, 0);
+
+    write_at<std::uint8_t>(bytes, 2, 2); // Uncompressed true color
+    write_at<std::uint16_t>(bytes, 12, width);
+    write_at<std::uint16_t>(bytes, 14, height);
+    write_at<std::uint8_t>(bytes, 16, 32);
+    write_at<std::uint8_t>(bytes, 17, 0x28); // 8 alpha bits, top left origin
+
+    std::ofstream file(file_name, std::ios::binary);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+/// @brief Writes a DDS file with BC1 (DXT1) or BC3 (DXT5) blocks.
+void write_dds(const std::string &file_name, const char *four_cc, const std::uint32_t width, const std::uint32_t height,
+               const std::uint32_t mip_levels) {
+    const std::size_t block_size = std::string(four_cc) == "DXT1" ? 8 : 16;
+
+    std::size_t data_size = 0;
+
+    for (std::uint32_t level = 0; level < mip_levels; level++) {
+        const std::size_t blocks_x = (std::max(width >> level, 1u) + 3) / 4;
+        const std::size_t blocks_y = (std::max(height >> level, 1u) + 3) / 4;
+
+        data_size += blocks_x * blocks_y * block_size;
+    }
+
+    std::vector<char> bytes(128 + data_size, 0);
+
+    bytes[0] = 'D';
+    bytes[1] = 'D';
+    bytes[2] = 'S';
+    bytes[3] = ' ';
+
+    write_at<std::uint32_t>(bytes, 4, 124);
+    write_at<std::uint32_t>(bytes, 8, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT);
+    write_at<std::uint32_t>(bytes, 12, height);
+    write_at<std::uint32_t>(bytes, 16, width);
+    write_at<std::uint32_t>(bytes, 28, mip_levels);
+    write_at<std::uint32_t>(bytes, 76, 32);
+    write_at<std::uint32_t>(bytes, 80, DDPF_FOURCC);
+
+    for (std::size_t character = 0; character < 4; character++) {
+        bytes[84 + character] = four_cc[character];
+    }
+
+    write_at<std::uint32_t>(bytes, 108, DDSCAPS_TEXTURE);
+
+    std::ofstream file(file_name, std::ios::binary);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+} // namespace
+
+namespace inexor::vulkan_renderer {
+
+/// The packer only plans the packs, so the tests need texture files but no device.
+class TexturePackerTest : public ::testing::Test {
+private:
+    /// The texture files must not move, because the packer keeps pointers to them.
+    std::deque<TextureFile> texture_files;
+
+    std::size_t file_index = 0;
+
+    std::string get_file_name(const std::string &extension) {
+        return "texture_pack_test_" + std::to_string(file_index++) + extension;
+    }
+
+protected:
+    /// @brief Adds an RGBA8 texture to the packer. The file is removed once it is decoded.
+    std::size_t add_rgba_texture(TexturePacker &packer, const std::uint16_t width, const std::uint16_t height) {
+        const std::string file_name = get_file_name(".tga");
+
+        write_tga(file_name, width, height);
+        texture_files.emplace_back(file_name);
+        std::remove(file_name.c_str());
+
+        return packer.add_texture(texture_files.back());
+    }
+
+    /// @brief Adds a compressed texture to the packer. The file is removed once it is loaded.
+    std::size_t add_compressed_texture(TexturePacker &packer, const char *four_cc, const std::uint32_t width, const std::uint32_t height,
+                                       const std::uint32_t mip_levels) {
+        const std::string file_name = get_file_name(".dds");
+
+        write_dds(file_name, four_cc, width, height, mip_levels);
+        texture_files.emplace_back(file_name);
+        std::remove(file_name.c_str());
+
+        return packer.add_texture(texture_files.back());
+    }
+
+    /// @brief Returns the placement of a texture in its pack, and checks that it matches the entry of the texture.
+    static const TexturePlacement &get_placement(const TexturePacker &packer, const std::size_t texture_index) {
+        const TexturePackEntry &entry = packer.get_entry(texture_index).value();
+        const TexturePackLayout &layout = packer.get_layouts().at(entry.pack_index);
+
+        const auto placement = std::find_if(layout.placements.begin(), layout.placements.end(),
+                                            [&](const TexturePlacement &placement) { return placement.texture_index == texture_index; });
+
+        if (placement == layout.placements.end()) {
+            throw std::runtime_error("Error: The texture " + std::to_string(texture_index) + " has no placement in its pack!");
+        }
+
+        EXPECT_EQ(placement->layer, entry.push_constants.layer);
+        EXPECT_LT(placement->layer, layout.layer_count);
+
+        return *placement;
+    }
+
+    /// @brief Returns the layout of the pack a texture was packed into.
+    static const TexturePackLayout &get_layout(const TexturePacker &packer, const std::size_t texture_index) {
+        static_cast<void>(get_placement(packer, texture_index));
+
+        return packer.get_layouts().at(packer.get_entry(texture_index).value().pack_index);
+    }
+};
+
+TEST_F(TexturePackerTest, ArraysGroupTexturesByFormatSizeAndMipLevels) {
+    TexturePacker packer;
+
+    const std::vector<std::size_t> rgba = {add_rgba_texture(packer, 64, 64), add_rgba_texture(packer, 64, 64), add_rgba_texture(packer, 64, 64)};
+    const std::vector<std::size_t> rgba_narrow = {add_rgba_texture(packer, 32, 64), add_rgba_texture(packer, 32, 64)};
+    const std::vector<std::size_t> bc1 = {add_compressed_texture(packer, "DXT1", 64, 64, 7), add_compressed_texture(packer, "DXT1", 64, 64, 7)};
+    const std::vector<std::size_t> bc1_one_mip_level = {add_compressed_texture(packer, "DXT1", 64, 64, 1), add_compressed_texture(packer, "DXT1", 64, 64, 1)};
+    const std::vector<std::size_t> bc3 = {add_compressed_texture(packer, "DXT5", 64, 64, 7), add_compressed_texture(packer, "DXT5", 64, 64, 7)};
+
+    // Compressed textures can't be packed into atlas pages, so a single one stays a texture of its own.
+    const std::size_t single_bc3 = add_compressed_texture(packer, "DXT5", 128, 128, 8);
+
+    packer.pack();
+
+    ASSERT_EQ(packer.get_layouts().size(), 5u);
+    EXPECT_FALSE(packer.get_entry(single_bc3).has_value());
+
+    const auto expect_array = [&](const std::vector<std::size_t> &texture_indices, const VkFormat format, const std::uint32_t width,
+                                  const std::uint32_t height, const std::uint32_t mip_levels) {
+        const TexturePackLayout &layout = get_layout(packer, texture_indices.front());
+
+        EXPECT_FALSE(layout.atlas);
+        EXPECT_EQ(layout.format, format);
+        EXPECT_EQ(layout.width, width);
+        EXPECT_EQ(layout.height, height);
+        EXPECT_EQ(layout.mip_levels, mip_levels);
+        EXPECT_EQ(layout.layer_count, texture_indices.size());
+        EXPECT_EQ(layout.placements.size(), texture_indices.size());
+
+        for (const auto texture_index : texture_indices) {
+            const TexturePackEntry &entry = packer.get_entry(texture_index).value();
+
+            EXPECT_EQ(entry.pack_index, packer.get_entry(texture_indices.front()).value().pack_index);
+
+            // The textures of an array cover their whole layer.
+            EXPECT_FLOAT_EQ(entry.push_constants.uv_offset.x, 0.0f);
+            EXPECT_FLOAT_EQ(entry.push_constants.uv_scale.x, 1.0f);
+        }
+    };
+
+    expect_array(rgba, VK_FORMAT_R8G8B8A8_UNORM, 64, 64, 7);
+    expect_array(rgba_narrow, VK_FORMAT_R8G8B8A8_UNORM, 32, 64, 7);
+    expect_array(bc1, VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 64, 64, 7);
+    expect_array(bc1_one_mip_level, VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 64, 64, 1);
+    expect_array(bc3, VK_FORMAT_BC3_UNORM_BLOCK, 64, 64, 7);
+}
+
+TEST_F(TexturePackerTest, ArraysAreSplitAtMaxLayers) {
+    TexturePackerSettings settings;
+    settings.max_layers = 4;
+
+    TexturePacker packer(settings);
+
+    std::vector<std::size_t> texture_indices;
+
+    for (int texture = 0; texture < 10; texture++) {
+        texture_indices.push_back(add_rgba_texture(packer, 16, 16));
+    }
+
+    packer.pack();
+
+    ASSERT_EQ(packer.get_layouts().size(), 3u);
+    EXPECT_EQ(packer.get_layouts()[0].layer_count, 4u);
+    EXPECT_EQ(packer.get_layouts()[1].layer_count, 4u);
+    EXPECT_EQ(packer.get_layouts()[2].layer_count, 2u);
+
+    for (std::size_t texture = 0; texture < texture_indices.size(); texture++) {
+        EXPECT_EQ(packer.get_entry(texture_indices[texture]).value().pack_index, texture / 4);
+        EXPECT_EQ(get_placement(packer, texture_indices[texture]).layer, texture % 4);
+    }
+}
+
+TEST_F(TexturePackerTest, AtlasShelvesRollOverIntoNewShelvesAndPages) {
+    TexturePackerSettings settings;
+    settings.atlas_size = 64;
+    settings.atlas_padding = 2;
+    settings.max_atlas_texture_size = 28;
+
+    TexturePacker packer(settings);
+
+    // Every texture has a size of its own, so none of them is packed into an array. The tallest ones are packed first.
+    const std::size_t fifth = add_rgba_texture(packer, 24, 23);
+    const std::size_t first = add_rgba_texture(packer, 28, 28);
+    const std::size_t third = add_rgba_texture(packer, 26, 25);
+    const std::size_t second = add_rgba_texture(packer, 27, 26);
+    const std::size_t fourth = add_rgba_texture(packer, 25, 24);
+
+    packer.pack();
+
+    ASSERT_EQ(packer.get_layouts().size(), 1u);
+
+    const TexturePackLayout &layout = packer.get_layouts().front();
+
+    EXPECT_TRUE(layout.atlas);
+    EXPECT_EQ(layout.format, VK_FORMAT_R8G8B8A8_UNORM);
+    EXPECT_EQ(layout.width, 64u);
+    EXPECT_EQ(layout.height, 64u);
+    EXPECT_EQ(layout.mip_levels, 1u);
+    EXPECT_EQ(layout.layer_count, 2u);
+
+    const auto expect_placement = [&](const std::size_t texture_index, const std::uint32_t layer, const std::uint32_t x, const std::uint32_t y) {
+        const TexturePlacement &placement = get_placement(packer, texture_index);
+
+        EXPECT_EQ(placement.layer, layer);
+        EXPECT_EQ(placement.x, x);
+        EXPECT_EQ(placement.y, y);
+    };
+
+    // The first shelf is as tall as its first texture with padding, 32 texels.
+    expect_placement(first, 0, 2, 2);
+    expect_placement(second, 0, 34, 2);
+
+    // 63 + 30 texels don't fit into the width of the page, so the third texture starts the second shelf.
+    expect_placement(third, 0, 2, 34);
+    expect_placement(fourth, 0, 32, 34);
+
+    // A third shelf would start at 32 + 29 texels, which leaves no room for 27 texels, so the fifth texture starts the next page.
+    expect_placement(fifth, 1, 2, 2);
+}
+
+TEST_F(TexturePackerTest, AtlasRollsOverIntoNewLayoutAtMaxLayers) {
+    TexturePackerSettings settings;
+    settings.min_array_layers = 100;
+    settings.max_layers = 2;
+    settings.atlas_size = 64;
+    settings.atlas_padding = 2;
+    settings.max_atlas_texture_size = 28;
+
+    TexturePacker packer(settings);
+
+    // Four textures with their padding fill a page, so nine textures need three pages, but a layout has at most two.
+    std::vector<std::size_t> texture_indices;
+
+    for (int texture = 0; texture < 9; texture++) {
+        texture_indices.push_back(add_rgba_texture(packer, 28, 28));
+    }
+
+    packer.pack();
+
+    ASSERT_EQ(packer.get_layouts().size(), 2u);
+
+    EXPECT_TRUE(packer.get_layouts()[0].atlas);
+    EXPECT_EQ(packer.get_layouts()[0].layer_count, 2u);
+    EXPECT_EQ(packer.get_layouts()[0].placements.size(), 8u);
+
+    EXPECT_TRUE(packer.get_layouts()[1].atlas);
+    EXPECT_EQ(packer.get_layouts()[1].layer_count, 1u);
+    ASSERT_EQ(packer.get_layouts()[1].placements.size(), 1u);
+
+    for (std::size_t texture = 0; texture < texture_indices.size(); texture++) {
+        EXPECT_EQ(packer.get_entry(texture_indices[texture]).value().pack_index, texture / 8);
+        EXPECT_EQ(get_placement(packer, texture_indices[texture]).layer, (texture % 8) / 4);
+    }
+
+    // The new layout starts with an empty page.
+    const TexturePlacement &last_placement = get_placement(packer, texture_indices.back());
+
+    EXPECT_EQ(last_placement.layer, 0u);
+    EXPECT_EQ(last_placement.x, 2u);
+    EXPECT_EQ(last_placement.y, 2u);
+}
+
+TEST_F(TexturePackerTest, AtlasTextureCoordinatesExcludeThePadding) {
+    TexturePackerSettings settings;
+    settings.atlas_size = 64;
+    settings.atlas_padding = 2;
+    settings.max_atlas_texture_size = 28;
+
+    TexturePacker packer(settings);
+
+    const std::size_t first = add_rgba_texture(packer, 20, 10);
+    const std::size_t second = add_rgba_texture(packer, 8, 6);
+
+    packer.pack();
+
+    const auto &first_entry = packer.get_entry(first);
+    const auto &second_entry = packer.get_entry(second);
+
+    ASSERT_TRUE(first_entry.has_value());
+    ASSERT_TRUE(second_entry.has_value());
+
+    // The texture starts after the padding and is exactly as large as its texels.
+    EXPECT_FLOAT_EQ(first_entry->push_constants.uv_offset.x, 2.0f / 64.0f);
+    EXPECT_FLOAT_EQ(first_entry->push_constants.uv_offset.y, 2.0f / 64.0f);
+    EXPECT_FLOAT_EQ(first_entry->push_constants.uv_scale.x, 20.0f / 64.0f);
+    EXPECT_FLOAT_EQ(first_entry->push_constants.uv_scale.y, 10.0f / 64.0f);
+
+    // The second texture follows the first one and the padding of both.
+    EXPECT_FLOAT_EQ(second_entry->push_constants.uv_offset.x, (2.0f + 20.0f + 2.0f + 2.0f) / 64.0f);
+    EXPECT_FLOAT_EQ(second_entry->push_constants.uv_offset.y, 2.0f / 64.0f);
+    EXPECT_FLOAT_EQ(second_entry->push_constants.uv_scale.x, 8.0f / 64.0f);
+    EXPECT_FLOAT_EQ(second_entry->push_constants.uv_scale.y, 6.0f / 64.0f);
+}
+
+} // namespace inexor::vulkan_renderer
@@ -1,9 +1,6 @@
 #include <gtest/gtest.h>
 
-#include <iostream>
-
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
-    RUN_ALL_TESTS();
-    std::cin.get();
+    return RUN_ALL_TESTS();
 }
@@ -0,0 +1,255 @@
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace inexor::texture_compressor {
+
+namespace {
+
+constexpr std::size_t TEXELS_PER_BLOCK = 16;
+
+std::uint16_t to_rgb565(const float r, const float g, const float b) {
+    const auto quantize = [](const float value, const int max) {
+        return static_cast<std::uint16_t>(std::clamp(static_cast<int>(value * max / 255.0f + 0.5f), 0, max));
+    };
+
+    return static_cast<std::uint16_t>((quantize(r, 31) << 11) | (quantize(g, 63) << 5) | quantize(b, 31));
+}
+
+std::array<int, 3> from_rgb565(const std::uint16_t color) {
+    const int r = (color >> 11) & 31;
+    const int g = (color >> 5) & 63;
+    const int b = color & 31;
+
+    // The high bits are repeated in the low bits, so 31 and 63 expand to 255.
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+/// @brief Writes the color part of a BC1 or BC3 block, always in the 4 color mode.
+void compress_color_block(const std::uint8_t *texels, std::uint8_t *block) {
+    std::array<float, 3> mean{};
+
+    for (std::size_t i = 0; i < TEXELS_PER_BLOCK; i++) {
+        for (std::size_t c = 0; c < 3; c++) {
+            mean[c] += texels[4 * i + c];
+        }
+    }
+
+    for (auto &value : mean) {
+        value /= TEXELS_PER_BLOCK;
+    }
+
+    // The covariance matrix of the colors: rr, rg, rb, gg, gb, bb.
+    std::array<float, 6> covariance{};
+
+    for (std::size_t i = 0; i < TEXELS_PER_BLOCK; i++) {
+        const float r = texels[4 * i + 0] - mean[0];
+        const float g = texels[4 * i + 1] - mean[1];
+        const float b = texels[4 * i + 2] - mean[2];
+
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    // The principal axis is found by a few steps of power iteration.
+    std::array<float, 3> axis{1.0f, 1.0f, 1.0f};
+
+    for (int iteration = 0; iteration < 8; iteration++) {
+        const std::array<float, 3> next{covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                                        covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                                        covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+
+        const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+
+        if (length < 1e-6f) {
+            // All texels have the same color.
+            break;
+        }
+
+        axis = {next[0] / length, next[1] / length, next[2] / length};
+    }
+
+    const float axis_length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (auto &value : axis) {
+        value /= axis_length;
+    }
+
+    float min_projection = std::numeric_limits<float>::max();
+    float max_projection = std::numeric_limits<float>::lowest();
+
+    for (std::size_t i = 0; i < TEXELS_PER_BLOCK; i++) {
+        const float projection =
+            (texels[4 * i + 0] - mean[0]) * axis[0] + (texels[4 * i + 1] - mean[1]) * axis[1] + (texels[4 * i + 2] - mean[2]) * axis[2];
+
+        min_projection = std::min(min_projection, projection);
+        max_projection = std::max(max_projection, projection);
+    }
+
+    std::uint16_t color0 = to_rgb565(mean[0] + axis[0] * max_projection, mean[1] + axis[1] * max_projection, mean[2] + axis[2] * max_projection);
+    std::uint16_t color1 = to_rgb565(mean[0] + axis[0] * min_projection, mean[1] + axis[1] * min_projection, mean[2] + axis[2] * min_projection);
+
+    // BC1 decodes color0 <= color1 as the 3 color mode with transparent black.
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    std::uint32_t indices = 0;
+
+    if (color0 != color1) {
+        const auto endpoint0 = from_rgb565(color0);
+        const auto endpoint1 = from_rgb565(color1);
+
+        std::array<std::array<int, 3>, 4> palette{endpoint0, endpoint1};
+
+        for (std::size_t c = 0; c < 3; c++) {
+            palette[2][c] = (2 * endpoint0[c] + endpoint1[c]) / 3;
+            palette[3][c] = (endpoint0[c] + 2 * endpoint1[c]) / 3;
+        }
+
+        for (std::size_t i = 0; i < TEXELS_PER_BLOCK; i++) {
+            std::uint32_t best_index = 0;
+            int best_distance = std::numeric_limits<int>::max();
+
+            for (std::uint32_t index = 0; index < palette.size(); index++) {
+                int distance = 0;
+
+                for (std::size_t c = 0; c < 3; c++) {
+                    const int difference = texels[4 * i + c] - palette[index][c];
+                    distance += difference * difference;
+                }
+
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_index = index;
+                }
+            }
+
+            indices |= best_index << (2 * i);
+        }
+    }
+
+    block[0] = static_cast<std::uint8_t>(color0 & 0xFF);
+    block[1] = static_cast<std::uint8_t>(color0 >> 8);
+    block[2] = static_cast<std::uint8_t>(color1 & 0xFF);
+    block[3] = static_cast<std::uint8_t>(color1 >> 8);
+
+    for (std::size_t i = 0; i < 4; i++) {
+        block[4 + i] = static_cast<std::uint8_t>(indices >> (8 * i));
+    }
+}
+
+/// @brief Writes the alpha part of a BC3 block, always in the 8 alpha mode.
+void compress_alpha_block(const std::uint8_t *texels, std::uint8_t *block) {
+    int min_alpha = 255;
+    int max_alpha = 0;
+
+    for (std::size_t i = 0; i < TEXELS_PER_BLOCK; i++) {
+        min_alpha = std::min<int>(min_alpha, texels[4 * i + 3]);
+        max_alpha = std::max<int>(max_alpha, texels[4 * i + 3]);
+    }
+
+    block[0] = static_cast<std::uint8_t>(max_alpha);
+    block[1] = static_cast<std::uint8_t>(min_alpha);
+
+    std::uint64_t indices = 0;
+
+    if (max_alpha != min_alpha) {
+        // The first two entries are the endpoints, the other six are interpolated between them.
+        std::array<int, 8> palette{max_alpha, min_alpha};
+
+        for (int i = 1; i < 7; i++) {
+            palette[i + 1] = ((7 - i) * max_alpha + i * min_alpha) / 7;
+        }
+
+        for (std::size_t i = 0; i < TEXELS_PER_BLOCK; i++) {
+            std::uint64_t best_index = 0;
+            int best_distance = std::numeric_limits<int>::max();
+
+            for (std::uint64_t index = 0; index < palette.size(); index++) {
+                const int distance = std::abs(texels[4 * i + 3] - palette[index]);
+
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_index = index;
+                }
+            }
+
+            indices |= best_index << (3 * i);
+        }
+    }
+
+    for (std::size_t i = 0; i < 6; i++) {
+        block[2 + i] = static_cast<std::uint8_t>(indices >> (8 * i));
+    }
+}
+
+} // namespace
+
+std::uint32_t get_block_size(const BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+void compress_bc1_block(const std::uint8_t *texels, std::uint8_t *block) {
+    assert(texels);
+    assert(block);
+
+    compress_color_block(texels, block);
+}
+
+void compress_bc3_block(const std::uint8_t *texels, std::uint8_t *block) {
+    assert(texels);
+    assert(block);
+
+    compress_alpha_block(texels, block);
+    compress_color_block(texels, block + 8);
+}
+
+std::vector<std::uint8_t> compress_image(const std::uint8_t *rgba, const std::uint32_t width, const std::uint32_t height, const BlockFormat format) {
+    assert(rgba);
+    assert(width > 0);
+    assert(height > 0);
+
+    const std::uint32_t blocks_x = (width + 3) / 4;
+    const std::uint32_t blocks_y = (height + 3) / 4;
+    const std::uint32_t block_size = get_block_size(format);
+
+    std::vector<std::uint8_t> blocks(static_cast<std::size_t>(blocks_x) * blocks_y * block_size);
+
+    std::array<std::uint8_t, 4 * TEXELS_PER_BLOCK> texels{};
+
+    for (std::uint32_t block_y = 0; block_y < blocks_y; block_y++) {
+        for (std::uint32_t block_x = 0; block_x < blocks_x; block_x++) {
+            for (std::uint32_t y = 0; y < 4; y++) {
+                const std::uint32_t source_y = std::min(4 * block_y + y, height - 1);
+
+                for (std::uint32_t x = 0; x < 4; x++) {
+                    const std::uint32_t source_x = std::min(4 * block_x + x, width - 1);
+
+                    const std::uint8_t *source = rgba + 4 * (static_cast<std::size_t>(source_y) * width + source_x);
+                    std::copy(source, source + 4, texels.data() + 4 * (4 * y + x));
+                }
+            }
+
+            std::uint8_t *block = blocks.data() + (static_cast<std::size_t>(block_y) * blocks_x + block_x) * block_size;
+
+            if (format == BlockFormat::BC1) {
+                compress_bc1_block(texels.data(), block);
+            } else {
+                compress_bc3_block(texels.data(), block);
+            }
+        }
+    }
+
+    return blocks;
+}
+
+} // namespace inexor::texture_compressor
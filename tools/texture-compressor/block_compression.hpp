@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace inexor::texture_compressor {
+
+/// @brief The block compressed formats the texture compressor can encode.
+enum class BlockFormat {
+    /// RGB in 8 bytes per 4x4 block, for opaque textures.
+    BC1,
+
+    /// RGB like BC1 and interpolated alpha, in 16 bytes per 4x4 block.
+    BC3
+};
+
+/// @brief Returns the size of one 4x4 block in bytes.
+[[nodiscard]] std::uint32_t get_block_size(BlockFormat format);
+
+/// @brief Compresses a 4x4 block of RGBA8 texels into a BC1 block.
+/// The endpoints are the extremes of the texels along the principal axis of their colors.
+/// @param texels [in] The 16 texels, row by row.
+/// @param block [out] The 8 bytes of the block.
+void compress_bc1_block(const std::uint8_t *texels, std::uint8_t *block);
+
+/// @brief Compresses a 4x4 block of RGBA8 texels into a BC3 block.
+/// @param texels [in] The 16 texels, row by row.
+/// @param block [out] The 16 bytes of the block.
+void compress_bc3_block(const std::uint8_t *texels, std::uint8_t *block);
+
+/// @brief Compresses an RGBA8 image. Blocks at the right and bottom border repeat the last column and row of the image.
+/// @param rgba [in] The texels of the image, row by row.
+/// @return The blocks, row by row.
+[[nodiscard]] std::vector<std::uint8_t> compress_image(const std::uint8_t *rgba, std::uint32_t width, std::uint32_t height, BlockFormat format);
+
+} // namespace inexor::texture_compressor
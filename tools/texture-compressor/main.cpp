@@ -0,0 +1,362 @@
+#include "block_compression.hpp"
+
+#include <spdlog/spdlog.h>
+#include <stb_image.h>
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace inexor::texture_compressor;
+
+namespace {
+
+constexpr std::array<std::uint8_t, 12> KTX2_IDENTIFIER{0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// The color models and channels of the data format descriptor, see the Khronos Data Format Specification.
+// BC1 with and without punch-through alpha share one model, the channel of the sample tells them apart.
+constexpr std::uint8_t KHR_DF_MODEL_BC1A = 128;
+constexpr std::uint8_t KHR_DF_MODEL_BC3 = 130;
+constexpr std::uint8_t KHR_DF_CHANNEL_BC1A_COLOR = 0;
+constexpr std::uint8_t KHR_DF_CHANNEL_BC1A_ALPHA = 1;
+constexpr std::uint8_t KHR_DF_CHANNEL_BC3_COLOR = 0;
+constexpr std::uint8_t KHR_DF_CHANNEL_BC3_ALPHA = 15;
+constexpr std::uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+constexpr std::uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+constexpr std::uint8_t KHR_DF_TRANSFER_SRGB = 2;
+constexpr std::uint8_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+struct Settings {
+    /// The format is chosen by the alpha channel of each texture if it's not set.
+    std::optional<BlockFormat> format;
+
+    bool srgb = false;
+
+    /// The compressed files are written next to the source files if this is empty.
+    std::string output_folder;
+
+    std::vector<std::string> file_names;
+};
+
+template <typename T>
+void append(std::vector<std::uint8_t> &bytes, const T value) {
+    const auto *value_bytes = reinterpret_cast<const std::uint8_t *>(&value);
+    bytes.insert(bytes.end(), value_bytes, value_bytes + sizeof(T));
+}
+
+template <typename T>
+void write_at(std::vector<std::uint8_t> &bytes, const std::size_t offset, const T value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+/// @brief Generates the mip levels of an RGBA8 image with a 2x2 box filter, down to 1x1.
+std::vector<std::vector<std::uint8_t>> generate_mip_levels(const std::uint8_t *rgba, const std::uint32_t width, const std::uint32_t height) {
+    std::vector<std::vector<std::uint8_t>> mip_levels;
+    mip_levels.emplace_back(rgba, rgba + 4 * static_cast<std::size_t>(width) * height);
+
+    std::uint32_t source_width = width;
+    std::uint32_t source_height = height;
+
+    while (source_width > 1 || source_height > 1) {
+        const std::uint32_t level_width = std::max(source_width / 2, 1u);
+        const std::uint32_t level_height = std::max(source_height / 2, 1u);
+
+        const std::vector<std::uint8_t> &source = mip_levels.back();
+        std::vector<std::uint8_t> level(4 * static_cast<std::size_t>(level_width) * level_height);
+
+        for (std::uint32_t y = 0; y < level_height; y++) {
+            // Odd sizes repeat the last row or column of the source level.
+            const std::uint32_t y0 = std::min(2 * y, source_height - 1);
+            const std::uint32_t y1 = std::min(2 * y + 1, source_height - 1);
+
+            for (std::uint32_t x = 0; x < level_width; x++) {
+                const std::uint32_t x0 = std::min(2 * x, source_width - 1);
+                const std::uint32_t x1 = std::min(2 * x + 1, source_width - 1);
+
+                for (std::uint32_t channel = 0; channel < 4; channel++) {
+                    const int sum = source[(y0 * source_width + x0) * 4 + channel] + source[(y0 * source_width + x1) * 4 + channel] +
+                                    source[(y1 * source_width + x0) * 4 + channel] + source[(y1 * source_width + x1) * 4 + channel];
+
+                    level[(y * level_width + x) * 4 + channel] = static_cast<std::uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+
+        mip_levels.push_back(std::move(level));
+
+        source_width = level_width;
+        source_height = level_height;
+    }
+
+    return mip_levels;
+}
+
+/// @brief Appends the data format descriptor of a BC1 or BC3 format.
+/// @param vk_format [in] The format which is written into the header, which the descriptor must match.
+void append_data_format_descriptor(std::vector<std::uint8_t> &bytes, const VkFormat vk_format) {
+    BlockFormat format = BlockFormat::BC1;
+    bool srgb = false;
+    bool bc1_alpha = false;
+
+    switch (vk_format) {
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        srgb = true;
+        break;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        break;
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        srgb = true;
+        bc1_alpha = true;
+        break;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        bc1_alpha = true;
+        break;
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        format = BlockFormat::BC3;
+        srgb = true;
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        format = BlockFormat::BC3;
+        break;
+    default:
+        assert(false);
+        break;
+    }
+
+    const std::uint16_t sample_count = format == BlockFormat::BC1 ? 1 : 2;
+    const std::uint16_t descriptor_block_size = 24 + 16 * sample_count;
+
+    append<std::uint32_t>(bytes, 4 + descriptor_block_size);
+
+    // The vendor and the descriptor type of the basic descriptor block are both 0, the version is 2.
+    append<std::uint32_t>(bytes, 0);
+    append<std::uint16_t>(bytes, 2);
+    append<std::uint16_t>(bytes, descriptor_block_size);
+
+    append<std::uint8_t>(bytes, format == BlockFormat::BC1 ? KHR_DF_MODEL_BC1A : KHR_DF_MODEL_BC3);
+    append<std::uint8_t>(bytes, KHR_DF_PRIMARIES_BT709);
+    append<std::uint8_t>(bytes, srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR);
+    append<std::uint8_t>(bytes, 0);
+
+    // The texel block dimensions are stored minus 1, the block has one plane.
+    const std::array<std::uint8_t, 4> texel_block_dimensions{3, 3, 0, 0};
+    bytes.insert(bytes.end(), texel_block_dimensions.begin(), texel_block_dimensions.end());
+
+    std::array<std::uint8_t, 8> bytes_planes{};
+    bytes_planes[0] = static_cast<std::uint8_t>(get_block_size(format));
+    bytes.insert(bytes.end(), bytes_planes.begin(), bytes_planes.end());
+
+    const auto append_sample = [&](const std::uint16_t bit_offset, const std::uint8_t channel_type) {
+        append<std::uint16_t>(bytes, bit_offset);
+        append<std::uint8_t>(bytes, 63);
+        append<std::uint8_t>(bytes, channel_type);
+        append<std::uint32_t>(bytes, 0);
+        append<std::uint32_t>(bytes, 0);
+        append<std::uint32_t>(bytes, 0xFFFFFFFF);
+    };
+
+    if (format == BlockFormat::BC3) {
+        // Alpha is never encoded with the transfer function.
+        append_sample(0, KHR_DF_CHANNEL_BC3_ALPHA | (srgb ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0));
+        append_sample(64, KHR_DF_CHANNEL_BC3_COLOR);
+    } else {
+        // The opaque BC1 formats only have color, the others have punch-through alpha in the same block.
+        append_sample(0, bc1_alpha ? KHR_DF_CHANNEL_BC1A_ALPHA : KHR_DF_CHANNEL_BC1A_COLOR);
+    }
+}
+
+/// @brief Writes the compressed mip levels into a KTX2 file, without supercompression.
+bool write_ktx2(const std::string &file_name, const std::vector<std::vector<std::uint8_t>> &mip_levels, const std::uint32_t width,
+                const std::uint32_t height, const BlockFormat format, const bool srgb) {
+    VkFormat vk_format = VK_FORMAT_UNDEFINED;
+
+    if (format == BlockFormat::BC1) {
+        vk_format = srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    } else {
+        vk_format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    }
+
+    const auto level_count = static_cast<std::uint32_t>(mip_levels.size());
+
+    std::vector<std::uint8_t> bytes(KTX2_IDENTIFIER.begin(), KTX2_IDENTIFIER.end());
+
+    append<std::uint32_t>(bytes, vk_format);
+    append<std::uint32_t>(bytes, 1); // typeSize
+    append<std::uint32_t>(bytes, width);
+    append<std::uint32_t>(bytes, height);
+    append<std::uint32_t>(bytes, 0); // pixelDepth
+    append<std::uint32_t>(bytes, 0); // layerCount
+    append<std::uint32_t>(bytes, 1); // faceCount
+    append<std::uint32_t>(bytes, level_count);
+    append<std::uint32_t>(bytes, 0); // supercompressionScheme
+
+    // The index is written once the offsets are known.
+    const std::size_t index_offset = bytes.size();
+    bytes.resize(bytes.size() + 32);
+
+    const std::size_t level_index_offset = bytes.size();
+    bytes.resize(bytes.size() + 24 * static_cast<std::size_t>(level_count));
+
+    const auto dfd_offset = static_cast<std::uint32_t>(bytes.size());
+    append_data_format_descriptor(bytes, vk_format);
+    const auto dfd_length = static_cast<std::uint32_t>(bytes.size() - dfd_offset);
+
+    write_at<std::uint32_t>(bytes, index_offset, dfd_offset);
+    write_at<std::uint32_t>(bytes, index_offset + 4, dfd_length);
+
+    // The smallest mip level comes first, and every level is aligned to the block size.
+    for (std::size_t level = mip_levels.size(); level-- > 0;) {
+        bytes.resize((bytes.size() + get_block_size(format) - 1) / get_block_size(format) * get_block_size(format));
+
+        const std::size_t entry_offset = level_index_offset + 24 * level;
+
+        write_at<std::uint64_t>(bytes, entry_offset, bytes.size());
+        write_at<std::uint64_t>(bytes, entry_offset + 8, mip_levels[level].size());
+        write_at<std::uint64_t>(bytes, entry_offset + 16, mip_levels[level].size());
+
+        bytes.insert(bytes.end(), mip_levels[level].begin(), mip_levels[level].end());
+    }
+
+    std::ofstream file(file_name, std::ios::binary);
+
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    return file.good();
+}
+
+std::string get_output_file_name(const std::string &file_name, const std::string &output_folder) {
+    const std::size_t folder_end = file_name.find_last_of("/\\");
+    const std::size_t extension_begin = file_name.find_last_of('.');
+
+    std::string output_file_name = file_name;
+
+    if (extension_begin != std::string::npos && (folder_end == std::string::npos || extension_begin > folder_end)) {
+        output_file_name.resize(extension_begin);
+    }
+
+    output_file_name += ".ktx2";
+
+    if (!output_folder.empty()) {
+        output_file_name = output_folder + "/" + output_file_name.substr(folder_end == std::string::npos ? 0 : folder_end + 1);
+    }
+
+    return output_file_name;
+}
+
+bool compress_texture(const std::string &file_name, const Settings &settings) {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    stbi_uc *rgba = stbi_load(file_name.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+    if (rgba == nullptr) {
+        spdlog::error("Could not load texture file {} using stbi_load!", file_name);
+        return false;
+    }
+
+    BlockFormat format = BlockFormat::BC1;
+
+    if (settings.format) {
+        format = *settings.format;
+    } else {
+        // Textures which are fully opaque don't need the alpha block of BC3.
+        const std::size_t texel_count = static_cast<std::size_t>(width) * height;
+
+        for (std::size_t texel = 0; texel < texel_count; texel++) {
+            if (rgba[4 * texel + 3] != 255) {
+                format = BlockFormat::BC3;
+                break;
+            }
+        }
+    }
+
+    const auto mip_levels = generate_mip_levels(rgba, static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height));
+
+    stbi_image_free(rgba);
+
+    std::vector<std::vector<std::uint8_t>> compressed_mip_levels;
+    std::size_t uncompressed_size = 0;
+    std::size_t compressed_size = 0;
+
+    for (std::size_t level = 0; level < mip_levels.size(); level++) {
+        const std::uint32_t level_width = std::max(static_cast<std::uint32_t>(width) >> level, 1u);
+        const std::uint32_t level_height = std::max(static_cast<std::uint32_t>(height) >> level, 1u);
+
+        compressed_mip_levels.push_back(compress_image(mip_levels[level].data(), level_width, level_height, format));
+
+        uncompressed_size += mip_levels[level].size();
+        compressed_size += compressed_mip_levels.back().size();
+    }
+
+    const std::string output_file_name = get_output_file_name(file_name, settings.output_folder);
+
+    if (!write_ktx2(output_file_name, compressed_mip_levels, static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), format,
+                    settings.srgb)) {
+        spdlog::error("Could not write {}!", output_file_name);
+        return false;
+    }
+
+    spdlog::info("{} -> {}: {} {}x{}, {} mip levels, {} bytes instead of {} bytes.", file_name, output_file_name,
+                 format == BlockFormat::BC1 ? "BC1" : "BC3", width, height, mip_levels.size(), compressed_size, uncompressed_size);
+
+    return true;
+}
+
+void print_usage() {
+    spdlog::info("Usage: inexor-texture-compressor [-bc1 | -bc3] [-srgb] [-output <folder>] <texture files>");
+    spdlog::info("  -bc1             Compress into BC1, alpha is dropped.");
+    spdlog::info("  -bc3             Compress into BC3. By default, textures with transparent texels use BC3 and all others BC1.");
+    spdlog::info("  -srgb            Mark the textures as sRGB encoded.");
+    spdlog::info("  -output <folder> Write the KTX2 files into this folder instead of next to the texture files.");
+}
+
+} // namespace
+
+/// Compresses textures into KTX2 files with BC1 or BC3 and a full mip chain, which are loaded by Texture without decoding them.
+int main(int argc, char *argv[]) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+
+        if (argument == "-bc1") {
+            settings.format = BlockFormat::BC1;
+        } else if (argument == "-bc3") {
+            settings.format = BlockFormat::BC3;
+        } else if (argument == "-srgb") {
+            settings.srgb = true;
+        } else if (argument == "-output" && i + 1 < argc) {
+            settings.output_folder = argv[++i];
+        } else if (!argument.empty() && argument[0] == '-') {
+            spdlog::error("Unknown argument {}!", argument);
+            print_usage();
+            return 1;
+        } else {
+            settings.file_names.push_back(argument);
+        }
+    }
+
+    if (settings.file_names.empty()) {
+        print_usage();
+        return 1;
+    }
+
+    bool success = true;
+
+    for (const auto &file_name : settings.file_names) {
+        success = compress_texture(file_name, settings) && success;
+    }
+
+    return success ? 0 : 1;
+}
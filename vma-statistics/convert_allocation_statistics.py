@@ -0,0 +1,242 @@
+#
+# Converts an allocation statistics stream written by AllocationStatisticsStream into
+#  - one JSON file per snapshot, in the layout of vmaBuildStatsString (without the detailed map),
+#  - one CSV file in the layout of VMA's call recording, which can be replayed with VmaReplay.
+#
+# The binary format is described in src/vulkan-renderer/allocation_statistics_stream.cpp.
+#
+
+import argparse
+import json
+import os
+import struct
+
+
+PROGRAM_VERSION = 'Inexor allocation statistics converter 1.0.0'
+FILE_MAGIC = b'INXALLOC'
+FILE_VERSION = 1
+
+SNAPSHOT_RECORD = 0
+CREATE_BUFFER = 1
+DESTROY_BUFFER = 2
+CREATE_IMAGE = 3
+DESTROY_IMAGE = 4
+ALLOCATE_DEVICE_MEMORY = 5
+FREE_DEVICE_MEMORY = 6
+
+VK_MEMORY_HEAP_DEVICE_LOCAL_BIT = 0x1
+VK_MEMORY_PROPERTY_FLAGS = [
+    (0x1, 'DEVICE_LOCAL'),
+    (0x2, 'HOST_VISIBLE'),
+    (0x4, 'HOST_COHERENT'),
+    (0x8, 'HOST_CACHED'),
+    (0x10, 'LAZILY_ALLOCATED'),
+]
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+
+    def at_end(self):
+        return self.offset >= len(self.data)
+
+    def read(self, format):
+        values = struct.unpack_from('<' + format, self.data, self.offset)
+        self.offset += struct.calcsize('<' + format)
+        return values if len(values) > 1 else values[0]
+
+
+def read_header(reader):
+    if reader.data[:len(FILE_MAGIC)] != FILE_MAGIC:
+        raise ValueError('This is not an allocation statistics file.')
+    reader.offset = len(FILE_MAGIC)
+
+    version = reader.read('I')
+    if version != FILE_VERSION:
+        raise ValueError('Unsupported allocation statistics version {}.'.format(version))
+
+    heaps = [reader.read('QI') for _ in range(reader.read('I'))]
+    types = [reader.read('II') for _ in range(reader.read('I'))]
+    return heaps, types
+
+
+def read_stat_info(reader):
+    values = reader.read('III8Q')
+    return {
+        'Blocks': values[0],
+        'Allocations': values[1],
+        'UnusedRanges': values[2],
+        'UsedBytes': values[3],
+        'UnusedBytes': values[4],
+        'AllocationSizeMin': values[5],
+        'AllocationSizeAvg': values[6],
+        'AllocationSizeMax': values[7],
+        'UnusedRangeSizeMin': values[8],
+        'UnusedRangeSizeAvg': values[9],
+        'UnusedRangeSizeMax': values[10],
+    }
+
+
+def stat_info_to_json(stat_info):
+    # This leaves out the same values as vmaBuildStatsString.
+    result = {key: stat_info[key] for key in ['Blocks', 'Allocations', 'UnusedRanges', 'UsedBytes', 'UnusedBytes']}
+    if stat_info['Allocations'] > 1:
+        result['AllocationSize'] = {
+            'Min': stat_info['AllocationSizeMin'], 'Avg': stat_info['AllocationSizeAvg'], 'Max': stat_info['AllocationSizeMax']}
+    if stat_info['UnusedRanges'] > 1:
+        result['UnusedRangeSize'] = {
+            'Min': stat_info['UnusedRangeSizeMin'], 'Avg': stat_info['UnusedRangeSizeAvg'], 'Max': stat_info['UnusedRangeSizeMax']}
+    return result
+
+
+def read_snapshot(reader, heaps, types):
+    frame_index, time, dropped_events = reader.read('IdQ')
+    total = read_stat_info(reader)
+
+    stats = {'Total': stat_info_to_json(total)}
+    heap_stats = []
+    for _ in heaps:
+        budget = reader.read('4Q')
+        heap_stats.append((budget, read_stat_info(reader)))
+    type_stats = [read_stat_info(reader) for _ in types]
+
+    for heap_index, (heap_size, heap_flags) in enumerate(heaps):
+        budget, heap_stat_info = heap_stats[heap_index]
+        heap = {
+            'Size': heap_size,
+            'Flags': ['DEVICE_LOCAL'] if heap_flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT else [],
+            'Budget': {'BlockBytes': budget[0], 'AllocationBytes': budget[1], 'Usage': budget[2], 'Budget': budget[3]},
+        }
+        if heap_stat_info['Blocks'] > 0:
+            heap['Stats'] = stat_info_to_json(heap_stat_info)
+
+        for type_index, (type_heap_index, type_flags) in enumerate(types):
+            if type_heap_index != heap_index:
+                continue
+            memory_type = {'Flags': [name for bit, name in VK_MEMORY_PROPERTY_FLAGS if type_flags & bit]}
+            if type_stats[type_index]['Blocks'] > 0:
+                memory_type['Stats'] = stat_info_to_json(type_stats[type_index])
+            heap['Type {}'.format(type_index)] = memory_type
+
+        stats['Heap {}'.format(heap_index)] = heap
+
+    return frame_index, time, dropped_events, stats
+
+
+def read_allocation_create_info(reader):
+    return reader.read('5IQ')
+
+
+def read_event(reader, record_type):
+    thread_id, frame_index, time, handle = reader.read('IIdQ')
+    event = {'type': record_type, 'thread_id': thread_id, 'frame_index': frame_index, 'time': time, 'handle': handle}
+
+    if record_type == CREATE_BUFFER:
+        event['buffer'] = reader.read('IQII')
+        event['allocation'] = read_allocation_create_info(reader)
+    elif record_type == CREATE_IMAGE:
+        event['image'] = reader.read('13I')
+        event['allocation'] = read_allocation_create_info(reader)
+    elif record_type in (ALLOCATE_DEVICE_MEMORY, FREE_DEVICE_MEMORY):
+        event['memory_type'], event['size'] = reader.read('IQ')
+    elif record_type not in (DESTROY_BUFFER, DESTROY_IMAGE):
+        raise ValueError('Unknown record type {} at offset {}.'.format(record_type, reader.offset - 1))
+
+    return event
+
+
+def format_pointer(value):
+    # VMA's recording writes pointers with %p, which is 16 upper case hex digits on Windows.
+    return '{:016X}'.format(value)
+
+
+def write_replay(file, heaps, types, events):
+    file.write('Vulkan Memory Allocator,Calls recording\n')
+    file.write('1,8\n')
+
+    file.write('Config,Begin\n')
+    file.write('PhysicalDeviceMemory,HeapCount,{}\n'.format(len(heaps)))
+    for heap_index, (heap_size, heap_flags) in enumerate(heaps):
+        file.write('PhysicalDeviceMemory,Heap,{},size,{}\n'.format(heap_index, heap_size))
+        file.write('PhysicalDeviceMemory,Heap,{},flags,{}\n'.format(heap_index, heap_flags))
+    file.write('PhysicalDeviceMemory,TypeCount,{}\n'.format(len(types)))
+    for type_index, (heap_index, property_flags) in enumerate(types):
+        file.write('PhysicalDeviceMemory,Type,{},heapIndex,{}\n'.format(type_index, heap_index))
+        file.write('PhysicalDeviceMemory,Type,{},propertyFlags,{}\n'.format(type_index, property_flags))
+    file.write('Config,End\n')
+
+    for event in events:
+        prefix = '{},{:.3f},{},'.format(event['thread_id'], event['time'], event['frame_index'])
+        allocation = format_pointer(event['handle'])
+
+        if event['type'] == CREATE_BUFFER:
+            flags, size, usage, sharing_mode = event['buffer']
+            alloc_flags, memory_usage, required, preferred, memory_type_bits, pool = event['allocation']
+            file.write(prefix + 'vmaCreateBuffer,{},{},{},{},{},{},{},{},{},{},{},\n'.format(
+                flags, size, usage, sharing_mode, alloc_flags, memory_usage, required, preferred, memory_type_bits,
+                format_pointer(pool), allocation))
+        elif event['type'] == CREATE_IMAGE:
+            image = ','.join(str(value) for value in event['image'])
+            alloc_flags, memory_usage, required, preferred, memory_type_bits, pool = event['allocation']
+            file.write(prefix + 'vmaCreateImage,{},{},{},{},{},{},{},{},\n'.format(
+                image, alloc_flags, memory_usage, required, preferred, memory_type_bits, format_pointer(pool), allocation))
+        elif event['type'] == DESTROY_BUFFER:
+            file.write(prefix + 'vmaDestroyBuffer,{}\n'.format(allocation))
+        elif event['type'] == DESTROY_IMAGE:
+            file.write(prefix + 'vmaDestroyImage,{}\n'.format(allocation))
+
+        # VMA's recording has no calls for memory blocks, they follow from the replayed allocations.
+
+
+def main():
+    arg_parser = argparse.ArgumentParser(description='Converts an Inexor allocation statistics stream into VMA JSON dumps and a VMA replay CSV.')
+    arg_parser.add_argument('StatisticsFile', help='Path to the allocation statistics file, e.g. vma-statistics/allocation_statistics.bin')
+    arg_parser.add_argument('-v', '--version', action='version', version=PROGRAM_VERSION)
+    arg_parser.add_argument('--dumps', default='vma-dumps', help='Folder the JSON snapshots are written to')
+    arg_parser.add_argument('--replay', default='vma-replays/vma_replay.csv', help='Path to the replay CSV file')
+    args = arg_parser.parse_args()
+
+    with open(args.StatisticsFile, 'rb') as file:
+        reader = Reader(file.read())
+
+    heaps, types = read_header(reader)
+
+    events = []
+    snapshot_count = 0
+    dropped_events = 0
+    device_memory_events = 0
+
+    os.makedirs(args.dumps, exist_ok=True)
+
+    while not reader.at_end():
+        record_type = reader.read('B')
+
+        if record_type == SNAPSHOT_RECORD:
+            frame_index, time, dropped_events, stats = read_snapshot(reader, heaps, types)
+            dump_file_name = os.path.join(args.dumps, 'inexor_VMA_statistics_{}.json'.format(snapshot_count))
+            with open(dump_file_name, 'w', encoding='UTF-8') as dump_file:
+                json.dump(stats, dump_file, indent=1)
+            snapshot_count += 1
+            continue
+
+        event = read_event(reader, record_type)
+        if record_type in (ALLOCATE_DEVICE_MEMORY, FREE_DEVICE_MEMORY):
+            device_memory_events += 1
+        events.append(event)
+
+    replay_folder = os.path.dirname(args.replay)
+    if replay_folder:
+        os.makedirs(replay_folder, exist_ok=True)
+
+    with open(args.replay, 'w', encoding='UTF-8') as replay_file:
+        write_replay(replay_file, heaps, types, events)
+
+    print('Converted {} events ({} of them memory block events) and {} snapshots.'.format(len(events), device_memory_events, snapshot_count))
+    if dropped_events > 0:
+        print('Warning: {} events were dropped while recording, the replay is incomplete.'.format(dropped_events))
+
+
+if __name__ == '__main__':
+    main()